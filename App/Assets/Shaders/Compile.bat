@@ -1,3 +1,8 @@
 "glslc.exe" Shader.vert -o Vert.spv
 "glslc.exe" Shader.frag -o Frag.spv
+"glslc.exe" Depth.vert -o DepthVert.spv
+"glslc.exe" DepthPyramid.comp -o DepthPyramid.spv
+"glslc.exe" MeshletCull.comp -o MeshletCull.spv
+"glslc.exe" --target-env=vulkan1.3 Meshlet.task -o MeshletTask.spv
+"glslc.exe" --target-env=vulkan1.3 Meshlet.mesh -o MeshletMesh.spv
 pause
\ No newline at end of file
@@ -1,2 +1,7 @@
 ./glslc Shader.vert -o Vert.spv
 ./glslc Shader.frag -o Frag.spv
+./glslc Depth.vert -o DepthVert.spv
+./glslc DepthPyramid.comp -o DepthPyramid.spv
+./glslc MeshletCull.comp -o MeshletCull.spv
+./glslc --target-env=vulkan1.3 Meshlet.task -o MeshletTask.spv
+./glslc --target-env=vulkan1.3 Meshlet.mesh -o MeshletMesh.spv
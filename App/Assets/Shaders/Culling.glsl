@@ -0,0 +1,78 @@
+// The per cluster visibility test, shared by Meshlet.task and MeshletCull.comp
+
+#include "Meshlet.glsl"
+
+// Farthest depth per texel, built from the previous frame
+layout(set = 3, binding = 0) uniform sampler2D depthPyramid;
+
+// A world space sphere is hidden when its nearest depth lies behind everything the pyramid saw around it
+bool IsOccluded(vec3 center, float radius)
+{
+	vec2 minUv = vec2(1.0);
+	vec2 maxUv = vec2(0.0);
+	float nearestDepth = 1.0;
+
+	for (int i = 0; i < 8; i++)
+	{
+		vec3 corner = center + radius * vec3((i & 1) != 0 ? 1.0 : -1.0, (i & 2) != 0 ? 1.0 : -1.0, (i & 4) != 0 ? 1.0 : -1.0);
+		vec4 clip = camUBO.occlusionViewProj * vec4(corner, 1.0);
+
+		// Reaches behind the camera the pyramid was built from, nothing can be said about it
+		if (clip.w <= 0.0)
+			return false;
+
+		vec3 ndc = clip.xyz / clip.w;
+		minUv = min(minUv, ndc.xy * 0.5 + 0.5);
+		maxUv = max(maxUv, ndc.xy * 0.5 + 0.5);
+		nearestDepth = min(nearestDepth, ndc.z);
+	}
+
+	minUv = clamp(minUv, 0.0, 1.0);
+	maxUv = clamp(maxUv, 0.0, 1.0);
+
+	// The level where the bounds cover at most 2x2 texels
+	vec2 extent = (maxUv - minUv) * vec2(textureSize(depthPyramid, 0));
+	int level = int(ceil(log2(max(max(extent.x, extent.y), 1.0))));
+	level = min(level, textureQueryLevels(depthPyramid) - 1);
+
+	ivec2 levelSize = textureSize(depthPyramid, level);
+	ivec2 texel = min(ivec2(minUv * vec2(levelSize)), levelSize - 1);
+	ivec2 nextTexel = min(texel + 1, levelSize - 1);
+
+	float farthestDepth = max
+	(
+		max(texelFetch(depthPyramid, texel, level).r, texelFetch(depthPyramid, ivec2(nextTexel.x, texel.y), level).r),
+		max(texelFetch(depthPyramid, ivec2(texel.x, nextTexel.y), level).r, texelFetch(depthPyramid, nextTexel, level).r)
+	);
+
+	return nearestDepth > farthestDepth;
+}
+
+// Frustum, backfacing cone and, once a pyramid exists, occlusion
+bool IsMeshletVisible(Meshlet meshlet)
+{
+	mat4 model = meshUBO.model;
+	vec3 center = (model * vec4(meshlet.center, 1.0)).xyz;
+	float radius = meshlet.radius * max(length(model[0].xyz), max(length(model[1].xyz), length(model[2].xyz)));
+
+	for (int i = 0; i < 6; i++)
+	{
+		if (dot(camUBO.frustumPlanes[i].xyz, center) + camUBO.frustumPlanes[i].w < -radius)
+			return false;
+	}
+
+	// Every triangle faces away from the camera, a cutoff of 1 marks cones too wide to ever cull
+	if (meshlet.coneCutoff < 1.0)
+	{
+		vec3 axis = normalize(transpose(inverse(mat3(model))) * meshlet.coneAxis);
+		vec3 toCenter = center - camUBO.position.xyz;
+
+		if (dot(toCenter, axis) >= meshlet.coneCutoff * length(toCenter) + radius)
+			return false;
+	}
+
+	if (camUBO.cullFlags.x != 0 && IsOccluded(center, radius))
+		return false;
+
+	return true;
+}
\ No newline at end of file
@@ -0,0 +1,26 @@
+#version 450
+
+layout(set = 0, binding = 0) uniform CameraUBO
+{
+	mat4 view;
+	mat4 proj;
+} camUBO;
+
+layout(set = 1, binding = 0) uniform MeshUBO
+{
+	mat4 model;
+	vec4 positionOffset;
+	vec4 positionScale;
+} meshUBO;
+
+// Quantized position stream, unorm within the mesh bounds
+layout(location = 0) in vec4 inPosition;
+
+// Must match Shader.vert exactly, opaque shading after the depth prepass tests with EQUAL
+invariant gl_Position;
+
+void main()
+{
+	vec3 position = meshUBO.positionOffset.xyz + inPosition.xyz * meshUBO.positionScale.xyz;
+	gl_Position = camUBO.proj * camUBO.view * meshUBO.model * vec4(position, 1.0);
+}
\ No newline at end of file
@@ -0,0 +1,37 @@
+// Meshlets and the uniforms every cluster shader reads, shared by Meshlet.task, Meshlet.mesh and MeshletCull.comp
+
+// Matches Meshlet in Meshlet.h, bounds are in mesh space
+struct Meshlet
+{
+	vec3 center;
+	float radius;
+	vec3 coneAxis;
+	float coneCutoff;
+	uint vertexOffset;
+	uint triangleOffset;
+	uint vertexCount;
+	uint triangleCount;
+};
+
+layout(set = 0, binding = 0) uniform CameraUBO
+{
+	mat4 view;
+	mat4 proj;
+	vec4 position;
+	vec4 frustumPlanes[6];
+	mat4 occlusionViewProj;
+	uvec4 cullFlags;
+} camUBO;
+
+layout(set = 1, binding = 0) uniform MeshUBO
+{
+	mat4 model;
+	vec4 positionOffset;
+	vec4 positionScale;
+	uvec4 meshletInfo;
+} meshUBO;
+
+layout(set = 2, binding = 0) readonly buffer Meshlets
+{
+	Meshlet meshlets[];
+};
\ No newline at end of file
@@ -4,6 +4,9 @@ layout(set = 1, binding = 1) uniform sampler2D baseColorSampler;
 layout(set = 1, binding = 2) uniform sampler2D roughnessSampler;
 layout(set = 1, binding = 3) uniform sampler2D metallicSampler;
 
+// Only the alpha-tested pipeline sets this, the others keep early depth testing
+layout(constant_id = 0) const bool alphaTest = false;
+
 layout(location = 0) in vec2 fragTexCoord;
 
 layout(location = 0) out vec4 outColor;
@@ -11,6 +14,9 @@ layout(location = 0) out vec4 outColor;
 void main()
 {
 	vec4 baseColor = texture(baseColorSampler, fragTexCoord);
+	if (alphaTest && baseColor.a < 0.5)
+		discard;
+
 	vec4 roughness = texture(roughnessSampler, fragTexCoord);
 	vec4 metallic = texture(metallicSampler, fragTexCoord);
 
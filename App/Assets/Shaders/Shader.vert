@@ -9,15 +9,39 @@ layout(set = 0, binding = 0) uniform CameraUBO
 layout(set = 1, binding = 0) uniform MeshUBO
 {
 	mat4 model;
+	vec4 positionOffset;
+	vec4 positionScale;
 } meshUBO;
 
-layout(location = 0) in vec3 inPosition;
+// Quantized vertex, see PackedVertex
+layout(location = 0) in vec4 inPosition;		// Unorm within the mesh bounds, w is the bitangent sign as 0 or 1
 layout(location = 1) in vec2 inTexCoord;
+layout(location = 2) in vec4 inNormalTangent;	// Octahedral normal (xy) and tangent (zw)
 
 layout(location = 0) out vec2 fragTexCoord;
+layout(location = 1) out vec3 fragNormal;
+layout(location = 2) out vec4 fragTangent;
+
+// Must match Depth.vert exactly, opaque shading after the depth prepass tests with EQUAL
+invariant gl_Position;
+
+vec3 OctahedralDecode(vec2 encoded)
+{
+	vec3 direction = vec3(encoded, 1.0 - abs(encoded.x) - abs(encoded.y));
+	float fold = max(-direction.z, 0.0);
+	direction.x += direction.x >= 0.0 ? -fold : fold;
+	direction.y += direction.y >= 0.0 ? -fold : fold;
+	return normalize(direction);
+}
 
 void main()
 {
-	gl_Position = camUBO.proj * camUBO.view * meshUBO.model * vec4(inPosition, 1.0);
+	vec3 position = meshUBO.positionOffset.xyz + inPosition.xyz * meshUBO.positionScale.xyz;
+	gl_Position = camUBO.proj * camUBO.view * meshUBO.model * vec4(position, 1.0);
 	fragTexCoord = inTexCoord;
+
+	// World space, for lighting
+	mat3 normalMatrix = transpose(inverse(mat3(meshUBO.model)));
+	fragNormal = normalize(normalMatrix * OctahedralDecode(inNormalTangent.xy));
+	fragTangent = vec4(normalize(mat3(meshUBO.model) * OctahedralDecode(inNormalTangent.zw)), inPosition.w * 2.0 - 1.0);
 }
\ No newline at end of file
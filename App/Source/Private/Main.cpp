@@ -1,7 +1,77 @@
 #include <Engine.h>
 
+#include <cstring>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
 int main(int argc, char** argv)
 {
-	VulkanRenderer::Engine engine;
+	VulkanRenderer::EngineSettings settings;
+
+	for (int i = 1; i < argc; i++)
+	{
+		const char* arg = argv[i];
+		bool hasValue = i + 1 < argc;
+
+		if (strcmp(arg, "--headless") == 0)
+			settings.headless = true;
+		else if (strcmp(arg, "--frames") == 0 && hasValue)
+			settings.frameCount = static_cast<uint32_t>(strtoul(argv[++i], nullptr, 10));
+		else if (strcmp(arg, "--output") == 0 && hasValue)
+			settings.outputDirectory = argv[++i];
+		else if (strcmp(arg, "--width") == 0 && hasValue)
+			settings.width = static_cast<uint32_t>(strtoul(argv[++i], nullptr, 10));
+		else if (strcmp(arg, "--height") == 0 && hasValue)
+			settings.height = static_cast<uint32_t>(strtoul(argv[++i], nullptr, 10));
+		else if (strcmp(arg, "--trace") == 0 && hasValue)
+			settings.traceOutputPath = argv[++i];
+		else if (strcmp(arg, "--depth-prepass") == 0)
+			settings.depthPrepass = true;
+		else if (strcmp(arg, "--no-direct-uploads") == 0)
+			settings.directUploads = false;
+		else if (strcmp(arg, "--upload-benchmark") == 0)
+			settings.uploadBenchmark = true;
+		else if (strcmp(arg, "--no-texture-streaming") == 0)
+			settings.textureStreaming = false;
+		else if (strcmp(arg, "--texture-budget") == 0 && hasValue)
+			settings.textureStreamingBudget = strtoull(argv[++i], nullptr, 10) * 1024 * 1024;
+		else if (strcmp(arg, "--pak") == 0 && hasValue)
+			settings.pakPaths.push_back(argv[++i]);
+		else if (strcmp(arg, "--ddc") == 0 && hasValue)
+			settings.derivedDataCacheDirectory = argv[++i];
+		else if (strcmp(arg, "--ddc-size") == 0 && hasValue)
+			settings.derivedDataCacheSize = strtoull(argv[++i], nullptr, 10) * 1024 * 1024;
+		else if (strcmp(arg, "--mesh") == 0 && hasValue)
+			settings.cookedMeshPaths.push_back(argv[++i]);
+		else if (strcmp(arg, "--static-batching") == 0)
+			settings.staticBatching = true;
+		else if (strcmp(arg, "--hlod") == 0 && hasValue)
+			settings.hlodDirectory = argv[++i];
+		else if (strcmp(arg, "--hlod-distance") == 0 && hasValue)
+			settings.hlodDistance = strtof(argv[++i], nullptr);
+		else if (strcmp(arg, "--on-demand") == 0)
+			settings.renderOnDemand = true;
+		else if (strcmp(arg, "--fps-limit") == 0 && hasValue)
+			settings.fpsLimit = strtof(argv[++i], nullptr);
+		else if (strcmp(arg, "--present-mode") == 0 && hasValue)
+		{
+			std::string mode = argv[++i];
+			if (mode == "immediate")
+				settings.presentMode = VK_PRESENT_MODE_IMMEDIATE_KHR;
+			else if (mode == "mailbox")
+				settings.presentMode = VK_PRESENT_MODE_MAILBOX_KHR;
+			else if (mode == "fifo")
+				settings.presentMode = VK_PRESENT_MODE_FIFO_KHR;
+			else if (mode == "fifo-relaxed")
+				settings.presentMode = VK_PRESENT_MODE_FIFO_RELAXED_KHR;
+			else
+				std::cerr << "Unknown present mode " << mode << ", expected immediate, mailbox, fifo or fifo-relaxed" << std::endl;
+		}
+		else
+			std::cerr << "Ignoring unknown argument " << arg << std::endl;
+	}
+
+	VulkanRenderer::Engine engine(settings);
 	engine.Run();
 }
\ No newline at end of file
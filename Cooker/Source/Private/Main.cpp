@@ -0,0 +1,257 @@
+#include <CookedMesh.h>
+
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <filesystem>
+#include <memory>
+#include <cstdlib>
+
+#include <glm/glm.hpp>
+
+#include <fastgltf/core.hpp>
+#include <fastgltf/tools.hpp>
+#include <fastgltf/glm_element_traits.hpp>
+
+using namespace VulkanRenderer;
+
+namespace
+{
+	struct CookerSettings
+	{
+		std::filesystem::path inputPath;
+		std::filesystem::path outputDirectory;
+
+		// Used for materials without a texture, which the engine always samples
+		std::string fallbackTexturePath;
+
+		bool optimize = true;
+		bool generateLods = true;
+
+		// Unchanged primitives are taken from here instead of cooked again, empty to always cook
+		std::string cacheDirectory;
+		uint64_t cacheSize = 1024ull * 1024 * 1024;
+	};
+
+	// Texture paths are stored as given, relative to the directory the engine runs from
+	std::string GetTexturePath(const fastgltf::Asset& asset, const fastgltf::Optional<fastgltf::TextureInfo>& textureInfo, const CookerSettings& settings)
+	{
+		if (!textureInfo.has_value())
+			return settings.fallbackTexturePath;
+
+		const fastgltf::Texture& texture = asset.textures[textureInfo->textureIndex];
+		if (!texture.imageIndex.has_value())
+			return settings.fallbackTexturePath;
+
+		// The engine loads textures from files only, images embedded in buffers fall back
+		const fastgltf::Image& image = asset.images[texture.imageIndex.value()];
+		const fastgltf::sources::URI* uri = std::get_if<fastgltf::sources::URI>(&image.data);
+		if (!uri || !uri->uri.isLocalPath())
+		{
+			std::cerr << "Using the fallback texture for an embedded image" << std::endl;
+			return settings.fallbackTexturePath;
+		}
+
+		return (settings.inputPath.parent_path() / uri->uri.fspath()).generic_string();
+	}
+
+	bool ReadPrimitive(const fastgltf::Asset& asset, const fastgltf::Primitive& primitive, const CookerSettings& settings, MeshInfo& info)
+	{
+		if (primitive.type != fastgltf::PrimitiveType::Triangles)
+		{
+			std::cerr << "Skipping a primitive that is not a triangle list" << std::endl;
+			return false;
+		}
+
+		auto positionAttribute = primitive.findAttribute("POSITION");
+		if (positionAttribute == primitive.attributes.end())
+		{
+			std::cerr << "Skipping a primitive without positions" << std::endl;
+			return false;
+		}
+
+		const fastgltf::Accessor& positionAccessor = asset.accessors[positionAttribute->accessorIndex];
+		info.vertices.resize(positionAccessor.count);
+
+		fastgltf::iterateAccessorWithIndex<glm::vec3>(asset, positionAccessor, [&](glm::vec3 position, size_t index)
+		{
+			info.vertices[index].position = position;
+		});
+
+		auto normalAttribute = primitive.findAttribute("NORMAL");
+		if (normalAttribute != primitive.attributes.end())
+		{
+			fastgltf::iterateAccessorWithIndex<glm::vec3>(asset, asset.accessors[normalAttribute->accessorIndex], [&](glm::vec3 normal, size_t index)
+			{
+				info.vertices[index].normal = normal;
+			});
+		}
+
+		auto tangentAttribute = primitive.findAttribute("TANGENT");
+		if (tangentAttribute != primitive.attributes.end())
+		{
+			fastgltf::iterateAccessorWithIndex<glm::vec4>(asset, asset.accessors[tangentAttribute->accessorIndex], [&](glm::vec4 tangent, size_t index)
+			{
+				info.vertices[index].tangent = tangent;
+			});
+		}
+
+		// glTF puts v = 0 at the top of the image, textures are loaded flipped so the engine has it at the bottom
+		auto texCoordAttribute = primitive.findAttribute("TEXCOORD_0");
+		if (texCoordAttribute != primitive.attributes.end())
+		{
+			fastgltf::iterateAccessorWithIndex<glm::vec2>(asset, asset.accessors[texCoordAttribute->accessorIndex], [&](glm::vec2 texCoord, size_t index)
+			{
+				info.vertices[index].texCoord = {texCoord.x, 1.0f - texCoord.y};
+			});
+		}
+
+		if (primitive.indicesAccessor.has_value())
+		{
+			const fastgltf::Accessor& indexAccessor = asset.accessors[primitive.indicesAccessor.value()];
+			info.indices.resize(indexAccessor.count);
+
+			fastgltf::iterateAccessorWithIndex<uint32_t>(asset, indexAccessor, [&](uint32_t vertexIndex, size_t index)
+			{
+				info.indices[index] = vertexIndex;
+			});
+		}
+		else
+		{
+			info.indices.resize(info.vertices.size());
+			for (uint32_t i = 0; i < info.indices.size(); i++)
+				info.indices[i] = i;
+		}
+
+		// Roughness and metallic share a texture in glTF, the engine samples them from two
+		if (primitive.materialIndex.has_value())
+		{
+			const fastgltf::Material& material = asset.materials[primitive.materialIndex.value()];
+
+			info.baseColorPath = GetTexturePath(asset, material.pbrData.baseColorTexture, settings);
+			info.roughnessPath = GetTexturePath(asset, material.pbrData.metallicRoughnessTexture, settings);
+			info.metallicPath = info.roughnessPath;
+
+			if (material.alphaMode == fastgltf::AlphaMode::Mask)
+				info.blendMode = BlendMode::AlphaTest;
+			else if (material.alphaMode == fastgltf::AlphaMode::Blend)
+				info.blendMode = BlendMode::Transparent;
+		}
+		else
+		{
+			info.baseColorPath = settings.fallbackTexturePath;
+			info.roughnessPath = settings.fallbackTexturePath;
+			info.metallicPath = settings.fallbackTexturePath;
+		}
+
+		if (info.baseColorPath.empty() || info.roughnessPath.empty())
+		{
+			std::cerr << "Skipping a primitive without textures, pass --fallback-texture to cook it" << std::endl;
+			return false;
+		}
+
+		info.optimize = settings.optimize;
+		info.generateLods = settings.generateLods;
+		return true;
+	}
+}
+
+// Cooks every triangle primitive of a glTF file into <output directory>/<mesh>_<primitive>.vrmesh for Engine::LoadMesh.
+// Primitives are cooked in mesh space, node transforms are left to whoever places the meshes.
+int main(int argc, char** argv)
+{
+	CookerSettings settings;
+
+	for (int i = 1; i < argc; i++)
+	{
+		const char* arg = argv[i];
+		bool hasValue = i + 1 < argc;
+
+		if (strcmp(arg, "--fallback-texture") == 0 && hasValue)
+			settings.fallbackTexturePath = argv[++i];
+		else if (strcmp(arg, "--no-optimize") == 0)
+			settings.optimize = false;
+		else if (strcmp(arg, "--no-lods") == 0)
+			settings.generateLods = false;
+		else if (strcmp(arg, "--ddc") == 0 && hasValue)
+			settings.cacheDirectory = argv[++i];
+		else if (strcmp(arg, "--ddc-size") == 0 && hasValue)
+			settings.cacheSize = strtoull(argv[++i], nullptr, 10) * 1024 * 1024;
+		else if (settings.inputPath.empty())
+			settings.inputPath = arg;
+		else if (settings.outputDirectory.empty())
+			settings.outputDirectory = arg;
+		else
+			std::cerr << "Ignoring unknown argument " << arg << std::endl;
+	}
+
+	if (settings.inputPath.empty() || settings.outputDirectory.empty())
+	{
+		std::cerr << "Usage: Cooker <input.gltf|glb> <output directory> [--fallback-texture <path>] [--no-optimize] [--no-lods] [--ddc <cache directory>] [--ddc-size <MiB>]" << std::endl;
+		return 1;
+	}
+
+	fastgltf::Expected<fastgltf::GltfDataBuffer> data = fastgltf::GltfDataBuffer::FromPath(settings.inputPath);
+	if (data.error() != fastgltf::Error::None)
+	{
+		std::cerr << "Failed to read " << settings.inputPath.generic_string() << ": " << fastgltf::getErrorMessage(data.error()) << std::endl;
+		return 1;
+	}
+
+	fastgltf::Parser parser;
+	// Buffers are resolved against an absolute directory, a bare file name has no parent
+	fastgltf::Expected<fastgltf::Asset> asset = parser.loadGltf(data.get(), std::filesystem::absolute(settings.inputPath).parent_path(), fastgltf::Options::LoadExternalBuffers);
+	if (asset.error() != fastgltf::Error::None)
+	{
+		std::cerr << "Failed to parse " << settings.inputPath.generic_string() << ": " << fastgltf::getErrorMessage(asset.error()) << std::endl;
+		return 1;
+	}
+
+	std::filesystem::create_directories(settings.outputDirectory);
+
+	std::unique_ptr<DerivedDataCache> cache;
+	if (!settings.cacheDirectory.empty())
+		cache = std::make_unique<DerivedDataCache>(settings.cacheDirectory, settings.cacheSize);
+
+	uint32_t cookedCount = 0;
+	for (size_t meshIndex = 0; meshIndex < asset->meshes.size(); meshIndex++)
+	{
+		const fastgltf::Mesh& mesh = asset->meshes[meshIndex];
+		std::string meshName = mesh.name.empty() ? "mesh" + std::to_string(meshIndex) : std::string(mesh.name);
+
+		for (size_t primitiveIndex = 0; primitiveIndex < mesh.primitives.size(); primitiveIndex++)
+		{
+			MeshInfo info;
+			if (!ReadPrimitive(asset.get(), mesh.primitives[primitiveIndex], settings, info))
+				continue;
+
+			std::filesystem::path outputPath = settings.outputDirectory / (meshName + "_" + std::to_string(primitiveIndex) + ".vrmesh");
+
+			CookedMeshData cookedData;
+			CookedMeshFile cookedFile;
+			CookedMeshView cooked;
+			if (cache)
+			{
+				if (!cookedFile.Open(info, *cache))
+					continue;
+				cooked = cookedFile.GetView();
+			}
+			else
+			{
+				cookedData = CookMesh(info);
+				cooked = cookedData.GetView();
+			}
+
+			if (!WriteCookedMesh(outputPath.generic_string(), cooked))
+				continue;
+
+			std::cout << "Cooked " << outputPath.generic_string() << ": " << info.indices.size() / 3 << " triangles, " << cooked.lods.count << " levels, " << cooked.meshlets.count << " meshlets" << std::endl;
+			cookedCount++;
+		}
+	}
+
+	if (cache)
+		std::cout << cache->GetReport() << std::endl;
+
+	return cookedCount > 0 ? 0 : 1;
+}
\ No newline at end of file
@@ -0,0 +1,27 @@
+project "Cooker"
+	kind "ConsoleApp"
+	language "C++"
+	cppdialect "C++17"
+
+	local outBinDir = "%{wks.location}/out/bin/" .. outputdir .. "/%{prj.name}"
+
+	targetdir (outBinDir)
+	objdir ("%{wks.location}/out/obj/" .. outputdir .. "/%{prj.name}")
+
+	defines { "VK_NO_PROTOTYPES" }
+
+	files {
+		"Source/**.h",
+		"Source/**.cpp"
+	}
+
+	includedirs {
+		"Source/Public",
+		"%{wks.location}/Engine/Source/Public",
+		"%{wks.location}/Engine/Vendor/vulkan-headers/include",
+		"%{wks.location}/Engine/Vendor/volk",
+		"%{wks.location}/Engine/Vendor/glm",
+		"%{wks.location}/Engine/Vendor/fastgltf/include"
+	}
+
+	links { "Engine", "fastgltf" }
\ No newline at end of file
@@ -1,11 +1,12 @@
 #include <Camera.h>
 
 #include <iostream>
+#include <cmath>
 
 #include <VulkanConfig.h>
-#include <CameraUBO.h>
 
 #include <VulkanDevice.h>
+#include <VulkanDescriptorAllocator.h>
 
 using namespace VulkanRenderer;
 
@@ -20,45 +21,33 @@ Camera::~Camera()
 
 }
 
-void Camera::CreateDescriptorSets(VkDescriptorPool descriptorPool)
+void Camera::CreateDescriptorSets(VulkanDescriptorAllocator* descriptorAllocator)
 {
-	VkDevice logicalDevice = device->GetLogical();
-
-	std::vector<VkDescriptorSetLayout> layouts(VulkanConfig::MAX_FRAMES_IN_FLIGHT, descriptorSetLayout);
-
-	VkDescriptorSetAllocateInfo allocInfo{};
-	allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-	allocInfo.descriptorPool = descriptorPool;
-	allocInfo.descriptorSetCount = static_cast<uint32_t>(VulkanConfig::MAX_FRAMES_IN_FLIGHT);
-	allocInfo.pSetLayouts = layouts.data();
-
 	descriptorSets.resize(VulkanConfig::MAX_FRAMES_IN_FLIGHT);
-	if (vkAllocateDescriptorSets(logicalDevice, &allocInfo, descriptorSets.data()) != VK_SUCCESS)
-	{
-		std::cerr << "Failed to allocate camera descriptor sets" << std::endl;
-		return;
-	}
 
 	for (size_t i = 0; i < VulkanConfig::MAX_FRAMES_IN_FLIGHT; i++)
 	{
-		VkDescriptorBufferInfo bufferInfo{};
-		bufferInfo.buffer = uniformBuffers[i].Get();
-		bufferInfo.offset = 0;
-		bufferInfo.range = sizeof(CameraUBO);
-		
-		VkWriteDescriptorSet descriptorWrite{};
-		descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-		descriptorWrite.dstSet = descriptorSets[i];
-		descriptorWrite.dstBinding = 0;
-		descriptorWrite.dstArrayElement = 0;
-		descriptorWrite.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-		descriptorWrite.descriptorCount = 1;
-		descriptorWrite.pBufferInfo = &bufferInfo;
-
-		vkUpdateDescriptorSets(logicalDevice, 1, &descriptorWrite, 0, nullptr);
+		std::vector<DescriptorBinding> bindings =
+		{
+			DescriptorBinding::Buffer(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, uniformBuffers[i].Get(), 0, sizeof(CameraUBO))
+		};
+
+		descriptorSets[i] = descriptorAllocator->GetOrCreate(descriptorSetLayout, bindings);
+		if (descriptorSets[i] == VK_NULL_HANDLE)
+		{
+			std::cerr << "Failed to allocate camera descriptor sets" << std::endl;
+			return;
+		}
 	}
 }
 
+void Camera::RecreateFrameResources(VulkanDescriptorAllocator* descriptorAllocator)
+{
+	uniformBuffers.clear();
+	CreateUniformBuffers();
+	CreateDescriptorSets(descriptorAllocator);
+}
+
 void Camera::CreateUniformBuffers()
 {
 	VkDeviceSize bufferSize = sizeof(CameraUBO);
@@ -66,11 +55,17 @@ void Camera::CreateUniformBuffers()
 
 	for (size_t i = 0; i < VulkanConfig::MAX_FRAMES_IN_FLIGHT; i++)
 	{
-		uniformBuffers.emplace_back(device, bufferSize, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+		uniformBuffers.emplace_back(device, bufferSize, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, device->GetDynamicMemoryProperties());
 	}
 }
 
-void Camera::UpdateUniformBuffer(uint32_t currentImage, VkExtent2D swapChainExtent)
+float Camera::GetPixelsPerUnit(VkExtent2D swapChainExtent) const
+{
+	// fov is vertical, as passed to the projection
+	return static_cast<float>(swapChainExtent.height) / (2.0f * std::tan(glm::radians(fov) * 0.5f));
+}
+
+CameraUBO Camera::BuildUniformData(VkExtent2D swapChainExtent) const
 {
 	CameraUBO ubo{};
 
@@ -81,6 +76,29 @@ void Camera::UpdateUniformBuffer(uint32_t currentImage, VkExtent2D swapChainExte
 	ubo.view = glm::inverse(world);
 	ubo.proj = glm::perspective(glm::radians(fov), (float)swapChainExtent.width / (float)swapChainExtent.height, 0.01f, 100.0f);
 	ubo.proj[1][1] *= -1;
-	
+
+	ubo.position = glm::vec4(transform.position, 1.0f);
+
+	// Planes from the rows of the view projection, with Vulkan's clip volume: -w <= x, y <= w and 0 <= z <= w
+	glm::mat4 viewProj = glm::transpose(ubo.proj * ubo.view);
+	ubo.frustumPlanes[0] = viewProj[3] + viewProj[0];
+	ubo.frustumPlanes[1] = viewProj[3] - viewProj[0];
+	ubo.frustumPlanes[2] = viewProj[3] + viewProj[1];
+	ubo.frustumPlanes[3] = viewProj[3] - viewProj[1];
+	ubo.frustumPlanes[4] = viewProj[2];
+	ubo.frustumPlanes[5] = viewProj[3] - viewProj[2];
+
+	// Normalized so the distance to a plane can be compared against a radius
+	for (glm::vec4& plane : ubo.frustumPlanes)
+		plane /= glm::length(glm::vec3(plane));
+
+	ubo.occlusionViewProj = glm::mat4(1.0f);
+	ubo.cullFlags = glm::uvec4(0);
+
+	return ubo;
+}
+
+void Camera::WriteUniformBuffer(uint32_t currentImage, const CameraUBO& ubo)
+{
 	memcpy(uniformBuffers[currentImage].GetMappedData(), &ubo, sizeof(ubo));
 }
\ No newline at end of file
@@ -0,0 +1,175 @@
+#include <Compression.h>
+
+#include <cstring>
+
+namespace VulkanRenderer
+{
+	namespace
+	{
+		constexpr size_t MinMatchLength = 4;
+		constexpr size_t MaxMatchOffset = 65535;
+		constexpr uint32_t HashBits = 16;
+
+		// A token's nibble saturates at this value and the rest of the length follows in bytes
+		constexpr uint32_t TokenMask = 15;
+
+		uint32_t Read32(const uint8_t* data)
+		{
+			uint32_t value;
+			memcpy(&value, data, sizeof(value));
+			return value;
+		}
+
+		uint32_t Hash(uint32_t value)
+		{
+			return (value * 2654435761u) >> (32 - HashBits);
+		}
+
+		void WriteLength(std::vector<uint8_t>& out, size_t length)
+		{
+			while (length >= 255)
+			{
+				out.push_back(255);
+				length -= 255;
+			}
+			out.push_back(static_cast<uint8_t>(length));
+		}
+
+		bool ReadLength(const uint8_t*& ip, const uint8_t* end, size_t& length)
+		{
+			uint8_t byte;
+			do
+			{
+				if (ip == end)
+					return false;
+
+				byte = *ip++;
+				length += byte;
+			} while (byte == 255);
+
+			return true;
+		}
+
+		// A match without literals after it would be the end of the data, so the last sequence is literals only
+		void WriteSequence(std::vector<uint8_t>& out, const uint8_t* literals, size_t literalCount, size_t offset, size_t matchLength)
+		{
+			size_t matchCode = matchLength >= MinMatchLength ? matchLength - MinMatchLength : 0;
+
+			uint8_t token = static_cast<uint8_t>((literalCount < TokenMask ? literalCount : TokenMask) << 4);
+			if (matchLength > 0)
+				token |= static_cast<uint8_t>(matchCode < TokenMask ? matchCode : TokenMask);
+			out.push_back(token);
+
+			if (literalCount >= TokenMask)
+				WriteLength(out, literalCount - TokenMask);
+			out.insert(out.end(), literals, literals + literalCount);
+
+			if (matchLength == 0)
+				return;
+
+			out.push_back(static_cast<uint8_t>(offset & 0xFF));
+			out.push_back(static_cast<uint8_t>(offset >> 8));
+
+			if (matchCode >= TokenMask)
+				WriteLength(out, matchCode - TokenMask);
+		}
+	}
+
+	std::vector<uint8_t> LzCompress(const uint8_t* data, size_t size)
+	{
+		std::vector<uint8_t> out;
+		out.reserve(size / 2 + 16);
+
+		// Last position each hashed four bytes were seen at, plus one so zero means never
+		std::vector<uint32_t> table(size_t(1) << HashBits, 0);
+
+		size_t anchor = 0;
+		size_t position = 0;
+		while (position + MinMatchLength <= size)
+		{
+			uint32_t value = Read32(data + position);
+			uint32_t& slot = table[Hash(value)];
+			size_t candidate = slot;
+			slot = static_cast<uint32_t>(position + 1);
+
+			if (candidate == 0 || position - (candidate - 1) > MaxMatchOffset || Read32(data + candidate - 1) != value)
+			{
+				position++;
+				continue;
+			}
+			candidate--;
+
+			size_t matchLength = MinMatchLength;
+			while (position + matchLength < size && data[candidate + matchLength] == data[position + matchLength])
+			{
+				matchLength++;
+			}
+
+			WriteSequence(out, data + anchor, position - anchor, position - candidate, matchLength);
+
+			position += matchLength;
+			anchor = position;
+		}
+
+		WriteSequence(out, data + anchor, size - anchor, 0, 0);
+		return out;
+	}
+
+	bool LzDecompress(const uint8_t* src, size_t srcSize, uint8_t* dst, size_t dstSize)
+	{
+		const uint8_t* ip = src;
+		const uint8_t* end = src + srcSize;
+		size_t op = 0;
+
+		while (ip < end)
+		{
+			uint8_t token = *ip++;
+
+			size_t literalCount = token >> 4;
+			if (literalCount == TokenMask && !ReadLength(ip, end, literalCount))
+				return false;
+
+			if (literalCount > static_cast<size_t>(end - ip) || literalCount > dstSize - op)
+				return false;
+
+			memcpy(dst + op, ip, literalCount);
+			ip += literalCount;
+			op += literalCount;
+
+			// Only the last sequence ends right after its literals
+			if (ip == end)
+				break;
+
+			if (end - ip < 2)
+				return false;
+
+			size_t offset = ip[0] | (static_cast<size_t>(ip[1]) << 8);
+			ip += 2;
+
+			size_t matchLength = token & TokenMask;
+			if (matchLength == TokenMask && !ReadLength(ip, end, matchLength))
+				return false;
+			matchLength += MinMatchLength;
+
+			if (offset == 0 || offset > op || matchLength > dstSize - op)
+				return false;
+
+			// Matches may overlap their own output to repeat a short run, those are copied a byte at a time
+			const uint8_t* match = dst + op - offset;
+			if (offset >= matchLength)
+			{
+				memcpy(dst + op, match, matchLength);
+			}
+			else
+			{
+				for (size_t i = 0; i < matchLength; i++)
+				{
+					dst[op + i] = match[i];
+				}
+			}
+			op += matchLength;
+		}
+
+		return op == dstSize;
+	}
+}
\ No newline at end of file
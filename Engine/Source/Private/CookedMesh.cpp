@@ -0,0 +1,360 @@
+#include <CookedMesh.h>
+
+#include <iostream>
+#include <fstream>
+#include <cstring>
+#include <iterator>
+
+namespace VulkanRenderer
+{
+	namespace
+	{
+		template<typename T>
+		CookedSpan<T> MakeSpan(const std::vector<T>& values)
+		{
+			return {values.data(), values.size()};
+		}
+
+		uint64_t AlignSection(uint64_t offset)
+		{
+			return (offset + CookedMeshAlignment - 1) & ~(CookedMeshAlignment - 1);
+		}
+
+		template<typename T>
+		bool ReadSection(const uint8_t* fileData, const CookedMeshSectionRange& section, CookedSpan<T>& span)
+		{
+			if (section.size % sizeof(T) != 0)
+				return false;
+
+			span.data = reinterpret_cast<const T*>(fileData + section.offset);
+			span.count = static_cast<size_t>(section.size / sizeof(T));
+			return true;
+		}
+
+		// Splits the next null terminated string off the front of the strings section
+		bool ReadString(const char*& strings, const char* end, std::string& value)
+		{
+			const char* terminator = static_cast<const char*>(memchr(strings, '\0', end - strings));
+			if (!terminator)
+				return false;
+
+			value.assign(strings, terminator);
+			strings = terminator + 1;
+			return true;
+		}
+	}
+
+	CookedMeshView CookedMeshData::GetView() const
+	{
+		CookedMeshView view;
+		view.vertices = MakeSpan(vertices);
+		view.positions = MakeSpan(positions);
+		view.indices = MakeSpan(indices);
+		view.indexType = indexType;
+		view.lods = MakeSpan(lods);
+		view.ranges = MakeSpan(ranges);
+		view.meshlets = MakeSpan(meshletData.meshlets);
+		view.meshletVertices = MakeSpan(meshletData.vertices);
+		view.meshletTriangles = MakeSpan(meshletData.triangles);
+		view.bounds = bounds;
+		view.optimizationStats = optimizationStats;
+		view.blendMode = blendMode;
+		view.baseColorPath = baseColorPath;
+		view.roughnessPath = roughnessPath;
+		view.metallicPath = metallicPath;
+		return view;
+	}
+
+	CookedMeshData CookMesh(const MeshInfo& info)
+	{
+		CookedMeshData cooked;
+		cooked.blendMode = info.blendMode;
+		cooked.baseColorPath = info.baseColorPath;
+		cooked.roughnessPath = info.roughnessPath;
+		cooked.metallicPath = info.metallicPath;
+
+		// A static batch's ranges index its triangles as given
+		cooked.ranges = info.ranges;
+		bool isStaticBatch = !info.ranges.empty();
+
+		std::vector<Vertex> vertices = info.vertices;
+		std::vector<uint32_t> indices = info.indices;
+		if (info.optimize && !isStaticBatch)
+		{
+			cooked.optimizationStats = OptimizeMesh(vertices, indices);
+		}
+
+		// Built after optimization so each meshlet is a run of cache-local triangles
+		if (indices.size() / 3 >= ClusterCullingMinTriangles)
+		{
+			cooked.meshletData = BuildMeshlets(vertices, indices);
+		}
+
+		// Quantized once, the vertex shader decodes positions with the bounds from the uniform buffer
+		cooked.bounds = VertexBounds::Compute(vertices);
+
+		cooked.vertices.reserve(vertices.size());
+		cooked.positions.reserve(vertices.size());
+		for (const Vertex& vertex : vertices)
+		{
+			cooked.vertices.push_back(PackedVertex::Pack(vertex, cooked.bounds));
+			cooked.positions.push_back({cooked.vertices.back().position});
+		}
+
+		// Every level indexes the same vertices, their indices follow each other in one buffer
+		std::vector<uint32_t> lodIndices;
+		if (info.generateLods && !isStaticBatch)
+		{
+			cooked.lods = BuildLodChain(vertices, indices, lodIndices);
+		}
+		else
+		{
+			cooked.lods = {{0, static_cast<uint32_t>(indices.size()), 0.0f}};
+			lodIndices = indices;
+		}
+
+		// Half the index memory and bandwidth for meshes small enough, primitive restart is off so 0xFFFF is a valid index
+		cooked.indexType = vertices.size() <= 65536 ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32;
+		if (cooked.indexType == VK_INDEX_TYPE_UINT16)
+		{
+			cooked.indices.resize(lodIndices.size() * sizeof(uint16_t));
+			uint16_t* narrowIndices = reinterpret_cast<uint16_t*>(cooked.indices.data());
+			for (size_t i = 0; i < lodIndices.size(); i++)
+			{
+				narrowIndices[i] = static_cast<uint16_t>(lodIndices[i]);
+			}
+		}
+		else
+		{
+			cooked.indices.resize(lodIndices.size() * sizeof(uint32_t));
+			memcpy(cooked.indices.data(), lodIndices.data(), cooked.indices.size());
+		}
+
+		return cooked;
+	}
+
+	std::vector<uint8_t> SerializeCookedMesh(const CookedMeshView& mesh)
+	{
+		std::string strings = mesh.baseColorPath + '\0' + mesh.roughnessPath + '\0' + mesh.metallicPath + '\0';
+
+		// In CookedMeshSection order
+		const void* sectionData[] = { mesh.vertices.data, mesh.positions.data, mesh.indices.data, mesh.lods.data, mesh.ranges.data, mesh.meshlets.data, mesh.meshletVertices.data, mesh.meshletTriangles.data, strings.data() };
+		uint64_t sectionSizes[] = { mesh.vertices.GetSize(), mesh.positions.GetSize(), mesh.indices.GetSize(), mesh.lods.GetSize(), mesh.ranges.GetSize(), mesh.meshlets.GetSize(), mesh.meshletVertices.GetSize(), mesh.meshletTriangles.GetSize(), strings.size() };
+		static_assert(std::size(sectionSizes) == static_cast<size_t>(CookedMeshSection::Count), "Every section needs its data");
+
+		CookedMeshHeader header{};
+		header.magic = CookedMeshMagic;
+		header.version = CookedMeshVersion;
+		header.indexType = static_cast<uint32_t>(mesh.indexType);
+		header.blendMode = static_cast<uint32_t>(mesh.blendMode);
+		header.boundsMin = mesh.bounds.min;
+		header.boundsExtent = mesh.bounds.extent;
+		header.acmrBefore = mesh.optimizationStats.acmrBefore;
+		header.acmrAfter = mesh.optimizationStats.acmrAfter;
+		header.vertexCountBefore = mesh.optimizationStats.vertexCountBefore;
+		header.vertexCountAfter = mesh.optimizationStats.vertexCountAfter;
+
+		uint64_t offset = AlignSection(sizeof(header));
+		for (size_t i = 0; i < std::size(sectionSizes); i++)
+		{
+			header.sections[i] = {offset, sectionSizes[i]};
+			offset = AlignSection(offset + sectionSizes[i]);
+		}
+
+		// Zeroed, so the padding between sections is too
+		std::vector<uint8_t> bytes(static_cast<size_t>(header.sections[std::size(sectionSizes) - 1].offset + sectionSizes[std::size(sectionSizes) - 1]), 0);
+		memcpy(bytes.data(), &header, sizeof(header));
+
+		for (size_t i = 0; i < std::size(sectionSizes); i++)
+		{
+			if (sectionSizes[i] > 0)
+				memcpy(bytes.data() + header.sections[i].offset, sectionData[i], static_cast<size_t>(sectionSizes[i]));
+		}
+		return bytes;
+	}
+
+	bool WriteCookedMesh(const std::string& path, const CookedMeshView& mesh)
+	{
+		std::vector<uint8_t> bytes = SerializeCookedMesh(mesh);
+
+		std::ofstream file(path, std::ios::binary);
+		if (!file.is_open())
+		{
+			std::cerr << "Failed to open file: " << path << std::endl;
+			return false;
+		}
+
+		file.write(reinterpret_cast<const char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+
+		if (!file.good())
+		{
+			std::cerr << "Failed to write cooked mesh: " << path << std::endl;
+			return false;
+		}
+		return true;
+	}
+
+	DerivedDataKey GetCookedMeshKey(const MeshInfo& info)
+	{
+		// Vertex and MeshRange are tightly packed floats and integers, their bytes are their values
+		DerivedDataKey key("CookedMesh", CookedMeshVersion);
+		key.AddValue(CookMeshVersion);
+		key.Add(info.vertices).Add(info.indices).Add(info.ranges);
+		key.Add(info.baseColorPath).Add(info.roughnessPath).Add(info.metallicPath);
+		key.AddValue(info.blendMode).AddValue(info.optimize).AddValue(info.generateLods);
+		return key;
+	}
+
+	bool CookedMeshFile::Open(const std::string& path)
+	{
+		if (!FileSystem::ReadFile(path, file))
+			return false;
+
+		return Parse(path);
+	}
+
+	bool CookedMeshFile::Open(const MeshInfo& info, DerivedDataCache& cache)
+	{
+		DerivedDataKey key = GetCookedMeshKey(info);
+		std::string name = "derived data " + key.ToString();
+
+		if (cache.Get(key, file) && Parse(name))
+			return true;
+
+		std::vector<uint8_t> bytes = SerializeCookedMesh(CookMesh(info).GetView());
+		cache.Put(key, bytes.data(), bytes.size());
+
+		memcpy(file.Allocate(bytes.size()), bytes.data(), bytes.size());
+		return Parse(name);
+	}
+
+	bool CookedMeshFile::Parse(const std::string& path)
+	{
+		const uint8_t* data = file.GetData();
+		size_t size = file.GetSize();
+
+		CookedMeshHeader header;
+		if (size < sizeof(header))
+		{
+			std::cerr << "Failed to load cooked mesh, the file is truncated: " << path << std::endl;
+			return false;
+		}
+		memcpy(&header, data, sizeof(header));
+
+		if (header.magic != CookedMeshMagic)
+		{
+			std::cerr << "Failed to load cooked mesh, not a cooked mesh: " << path << std::endl;
+			return false;
+		}
+
+		if (header.version != CookedMeshVersion)
+		{
+			std::cerr << "Failed to load cooked mesh, version " << header.version << " instead of " << CookedMeshVersion << " needs cooking again: " << path << std::endl;
+			return false;
+		}
+
+		for (const CookedMeshSectionRange& section : header.sections)
+		{
+			if (section.offset % CookedMeshAlignment != 0 || section.offset > size || section.size > size - section.offset)
+			{
+				std::cerr << "Failed to load cooked mesh, a section lies outside the file: " << path << std::endl;
+				return false;
+			}
+		}
+
+		auto getSection = [&](CookedMeshSection section) -> const CookedMeshSectionRange&
+		{
+			return header.sections[static_cast<uint32_t>(section)];
+		};
+
+		view.indexType = static_cast<VkIndexType>(header.indexType);
+		size_t indexSize = view.indexType == VK_INDEX_TYPE_UINT16 ? sizeof(uint16_t) : sizeof(uint32_t);
+
+		bool valid = (view.indexType == VK_INDEX_TYPE_UINT16 || view.indexType == VK_INDEX_TYPE_UINT32) && header.blendMode < BlendModeCount;
+		valid = valid && ReadSection(data, getSection(CookedMeshSection::Vertices), view.vertices);
+		valid = valid && ReadSection(data, getSection(CookedMeshSection::Positions), view.positions);
+		valid = valid && ReadSection(data, getSection(CookedMeshSection::Indices), view.indices);
+		valid = valid && ReadSection(data, getSection(CookedMeshSection::Lods), view.lods);
+		valid = valid && ReadSection(data, getSection(CookedMeshSection::Ranges), view.ranges);
+		valid = valid && ReadSection(data, getSection(CookedMeshSection::Meshlets), view.meshlets);
+		valid = valid && ReadSection(data, getSection(CookedMeshSection::MeshletVertices), view.meshletVertices);
+		valid = valid && ReadSection(data, getSection(CookedMeshSection::MeshletTriangles), view.meshletTriangles);
+		valid = valid && view.vertices.count == view.positions.count && view.indices.count % indexSize == 0 && view.lods.count > 0;
+
+		// Draws index straight into the buffer, every level has to lie within it
+		size_t indexCount = view.indices.count / indexSize;
+		for (size_t i = 0; valid && i < view.lods.count; i++)
+		{
+			const MeshLod& lod = view.lods.data[i];
+			valid = static_cast<uint64_t>(lod.indexOffset) + lod.indexCount <= indexCount;
+		}
+
+		for (size_t i = 0; valid && i < view.ranges.count; i++)
+		{
+			const MeshRange& range = view.ranges.data[i];
+			valid = static_cast<uint64_t>(range.indexOffset) + range.indexCount <= indexCount;
+		}
+
+		// Vertex fetch reads the vertex buffer at these without bounds checks
+		for (size_t i = 0; valid && i < indexCount; i++)
+		{
+			uint32_t index = indexSize == sizeof(uint16_t) ? reinterpret_cast<const uint16_t*>(view.indices.data)[i] : reinterpret_cast<const uint32_t*>(view.indices.data)[i];
+			valid = index < view.vertices.count;
+		}
+
+		// The culling and mesh shaders fetch through these without bounds checks, and a meshlet has to fit the
+		// mesh shader's max_vertices and max_primitives
+		uint64_t meshletIndexCount = 0;
+		for (size_t i = 0; valid && i < view.meshlets.count; i++)
+		{
+			const Meshlet& meshlet = view.meshlets.data[i];
+			valid = meshlet.vertexCount <= MeshletMaxVertices && meshlet.triangleCount <= MeshletMaxTriangles &&
+				static_cast<uint64_t>(meshlet.vertexOffset) + meshlet.vertexCount <= view.meshletVertices.count &&
+				static_cast<uint64_t>(meshlet.triangleOffset) + meshlet.triangleCount <= view.meshletTriangles.count;
+
+			// Three 8-bit indices into the meshlet's own vertices
+			for (uint32_t j = 0; valid && j < meshlet.triangleCount; j++)
+			{
+				uint32_t packed = view.meshletTriangles.data[meshlet.triangleOffset + j];
+				for (uint32_t k = 0; valid && k < 3; k++)
+					valid = ((packed >> (k * 8)) & 0xFF) < meshlet.vertexCount;
+			}
+
+			meshletIndexCount += meshlet.triangleCount * 3;
+		}
+
+		// Cluster culling appends the surviving triangles to a buffer sized for the finest level's indices
+		valid = valid && meshletIndexCount <= view.lods.data[0].indexCount;
+
+		for (size_t i = 0; valid && i < view.meshletVertices.count; i++)
+		{
+			valid = view.meshletVertices.data[i] < view.vertices.count;
+		}
+
+		const CookedMeshSectionRange& strings = getSection(CookedMeshSection::Strings);
+		const char* stringData = reinterpret_cast<const char*>(data + strings.offset);
+		const char* stringEnd = stringData + strings.size;
+		valid = valid && ReadString(stringData, stringEnd, view.baseColorPath) && ReadString(stringData, stringEnd, view.roughnessPath) && ReadString(stringData, stringEnd, view.metallicPath);
+
+		if (!valid)
+		{
+			std::cerr << "Failed to load cooked mesh, the sections are inconsistent: " << path << std::endl;
+			return false;
+		}
+
+		view.blendMode = static_cast<BlendMode>(header.blendMode);
+		view.bounds.min = header.boundsMin;
+		view.bounds.extent = header.boundsExtent;
+		view.optimizationStats.acmrBefore = header.acmrBefore;
+		view.optimizationStats.acmrAfter = header.acmrAfter;
+		view.optimizationStats.vertexCountBefore = static_cast<size_t>(header.vertexCountBefore);
+		view.optimizationStats.vertexCountAfter = static_cast<size_t>(header.vertexCountAfter);
+
+		return true;
+	}
+
+	const CookedMeshView& CookedMeshFile::GetView() const
+	{
+		return view;
+	}
+}
\ No newline at end of file
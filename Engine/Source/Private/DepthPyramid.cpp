@@ -0,0 +1,299 @@
+#include <DepthPyramid.h>
+
+#include <iostream>
+#include <array>
+#include <algorithm>
+
+#include <Shader.h>
+#include <VulkanDevice.h>
+#include <VulkanHelpers.h>
+#include <VulkanDescriptorAllocator.h>
+
+using namespace VulkanRenderer;
+
+namespace
+{
+	uint32_t PreviousPowerOfTwo(uint32_t value)
+	{
+		uint32_t result = 1;
+		while (result * 2 <= value)
+			result *= 2;
+		return result;
+	}
+
+	constexpr uint32_t groupSize = 8;
+}
+
+DepthPyramid::DepthPyramid(VulkanDevice* device, VkExtent2D depthExtent)
+	: device(device)
+{
+	extent.width = PreviousPowerOfTwo(std::max(depthExtent.width, 1u));
+	extent.height = PreviousPowerOfTwo(std::max(depthExtent.height, 1u));
+
+	while ((std::max(extent.width, extent.height) >> mipLevels) > 0)
+		mipLevels++;
+
+	CreateImage();
+	CreateSampler();
+	CreatePipeline();
+}
+
+DepthPyramid::~DepthPyramid()
+{
+	VkDevice logicalDevice = device->GetLogical();
+
+	vkDestroyPipeline(logicalDevice, pipeline, nullptr);
+	vkDestroyPipelineLayout(logicalDevice, pipelineLayout, nullptr);
+	vkDestroyDescriptorSetLayout(logicalDevice, descriptorSetLayout, nullptr);
+
+	vkDestroySampler(logicalDevice, sampler, nullptr);
+
+	for (VkImageView mipView : mipViews)
+		vkDestroyImageView(logicalDevice, mipView, nullptr);
+	vkDestroyImageView(logicalDevice, imageView, nullptr);
+
+	vkDestroyImage(logicalDevice, image, nullptr);
+	vkFreeMemory(logicalDevice, memory, nullptr);
+}
+
+bool DepthPyramid::IsValid() const
+{
+	return valid;
+}
+
+void DepthPyramid::Invalidate()
+{
+	valid = false;
+}
+
+const glm::mat4& DepthPyramid::GetViewProjection() const
+{
+	return viewProjection;
+}
+
+VkImage DepthPyramid::GetImage() const
+{
+	return image;
+}
+
+VkImageView DepthPyramid::GetImageView() const
+{
+	return imageView;
+}
+
+VkSampler DepthPyramid::GetSampler() const
+{
+	return sampler;
+}
+
+VkExtent2D DepthPyramid::GetExtent() const
+{
+	return extent;
+}
+
+void DepthPyramid::CreateImage()
+{
+	VkDevice logicalDevice = device->GetLogical();
+
+	VkImageCreateInfo imageInfo{};
+	imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+	imageInfo.imageType = VK_IMAGE_TYPE_2D;
+	imageInfo.extent = { extent.width, extent.height, 1 };
+	imageInfo.mipLevels = mipLevels;
+	imageInfo.arrayLayers = 1;
+	imageInfo.format = format;
+	imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+	imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	imageInfo.usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_STORAGE_BIT;
+	imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+	imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+	if (vkCreateImage(logicalDevice, &imageInfo, nullptr, &image) != VK_SUCCESS)
+	{
+		std::cerr << "Failed to create depth pyramid image" << std::endl;
+		return;
+	}
+
+	VkMemoryRequirements memoryRequirements;
+	vkGetImageMemoryRequirements(logicalDevice, image, &memoryRequirements);
+
+	VkMemoryAllocateInfo allocateInfo{};
+	allocateInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+	allocateInfo.allocationSize = memoryRequirements.size;
+	allocateInfo.memoryTypeIndex = device->FindMemoryType(memoryRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+	if (vkAllocateMemory(logicalDevice, &allocateInfo, nullptr, &memory) != VK_SUCCESS)
+	{
+		std::cerr << "Failed to allocate depth pyramid memory" << std::endl;
+		return;
+	}
+
+	vkBindImageMemory(logicalDevice, image, memory, 0);
+
+	VkImageViewCreateInfo viewInfo{};
+	viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+	viewInfo.image = image;
+	viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+	viewInfo.format = format;
+	viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	viewInfo.subresourceRange.baseMipLevel = 0;
+	viewInfo.subresourceRange.levelCount = mipLevels;
+	viewInfo.subresourceRange.baseArrayLayer = 0;
+	viewInfo.subresourceRange.layerCount = 1;
+
+	if (vkCreateImageView(logicalDevice, &viewInfo, nullptr, &imageView) != VK_SUCCESS)
+		std::cerr << "Failed to create depth pyramid image view" << std::endl;
+
+	mipViews.resize(mipLevels, VK_NULL_HANDLE);
+	for (uint32_t level = 0; level < mipLevels; level++)
+	{
+		viewInfo.subresourceRange.baseMipLevel = level;
+		viewInfo.subresourceRange.levelCount = 1;
+
+		if (vkCreateImageView(logicalDevice, &viewInfo, nullptr, &mipViews[level]) != VK_SUCCESS)
+			std::cerr << "Failed to create depth pyramid mip view" << std::endl;
+	}
+
+	// The render graph imports the pyramid in the general layout, it stays there between frames
+	VkImageMemoryBarrier2 barrier{};
+	barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2;
+	barrier.srcStageMask = VK_PIPELINE_STAGE_2_NONE;
+	barrier.srcAccessMask = VK_ACCESS_2_NONE;
+	barrier.dstStageMask = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+	barrier.dstAccessMask = VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT;
+	barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	barrier.newLayout = VK_IMAGE_LAYOUT_GENERAL;
+	barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.image = image;
+	barrier.subresourceRange = viewInfo.subresourceRange;
+	barrier.subresourceRange.baseMipLevel = 0;
+	barrier.subresourceRange.levelCount = mipLevels;
+
+	VkCommandBuffer commandBuffer = device->BeginSingleTimeCommands();
+	RecordPipelineBarrier(device, commandBuffer, {barrier});
+	device->EndSingleTimeCommands(commandBuffer);
+}
+
+void DepthPyramid::CreateSampler()
+{
+	// Only read with texelFetch, the farthest depth is taken in the shaders rather than by filtering
+	VkSamplerCreateInfo samplerInfo{};
+	samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+	samplerInfo.magFilter = VK_FILTER_NEAREST;
+	samplerInfo.minFilter = VK_FILTER_NEAREST;
+	samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+	samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	samplerInfo.anisotropyEnable = VK_FALSE;
+	samplerInfo.maxAnisotropy = 1.0f;
+	samplerInfo.borderColor = VK_BORDER_COLOR_FLOAT_OPAQUE_WHITE;
+	samplerInfo.unnormalizedCoordinates = VK_FALSE;
+	samplerInfo.compareEnable = VK_FALSE;
+	samplerInfo.compareOp = VK_COMPARE_OP_ALWAYS;
+	samplerInfo.minLod = 0.0f;
+	samplerInfo.maxLod = static_cast<float>(mipLevels);
+
+	if (vkCreateSampler(device->GetLogical(), &samplerInfo, nullptr, &sampler) != VK_SUCCESS)
+		std::cerr << "Failed to create depth pyramid sampler" << std::endl;
+}
+
+void DepthPyramid::CreatePipeline()
+{
+	VkDevice logicalDevice = device->GetLogical();
+
+	VkDescriptorSetLayoutBinding sourceBinding{};
+	sourceBinding.binding = 0;
+	sourceBinding.descriptorCount = 1;
+	sourceBinding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	sourceBinding.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+
+	VkDescriptorSetLayoutBinding destinationBinding{};
+	destinationBinding.binding = 1;
+	destinationBinding.descriptorCount = 1;
+	destinationBinding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+	destinationBinding.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+
+	std::array<VkDescriptorSetLayoutBinding, 2> bindings = { sourceBinding, destinationBinding };
+
+	VkDescriptorSetLayoutCreateInfo layoutInfo{};
+	layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
+	layoutInfo.pBindings = bindings.data();
+
+	if (vkCreateDescriptorSetLayout(logicalDevice, &layoutInfo, nullptr, &descriptorSetLayout) != VK_SUCCESS)
+		std::cerr << "Failed to create depth pyramid descriptor set layout" << std::endl;
+
+	VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+	pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	pipelineLayoutInfo.setLayoutCount = 1;
+	pipelineLayoutInfo.pSetLayouts = &descriptorSetLayout;
+
+	if (vkCreatePipelineLayout(logicalDevice, &pipelineLayoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS)
+		std::cerr << "Failed to create depth pyramid pipeline layout" << std::endl;
+
+	Shader computeShader(logicalDevice, "Assets/Shaders/DepthPyramid.spv", VK_SHADER_STAGE_COMPUTE_BIT);
+
+	VkComputePipelineCreateInfo pipelineInfo{};
+	pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+	pipelineInfo.stage = computeShader.GetStageCreateInfo();
+	pipelineInfo.layout = pipelineLayout;
+
+	if (vkCreateComputePipelines(logicalDevice, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &pipeline) != VK_SUCCESS)
+		std::cerr << "Failed to create depth pyramid pipeline" << std::endl;
+}
+
+void DepthPyramid::Record(VkCommandBuffer commandBuffer, VkImageView depthView, const glm::mat4& depthViewProjection, VulkanDescriptorAllocator* frameDescriptorAllocator)
+{
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline);
+
+	for (uint32_t level = 0; level < mipLevels; level++)
+	{
+		// Level 0 reduces the depth image, every other level the one above it
+		std::vector<DescriptorBinding> bindings =
+		{
+			level == 0
+				? DescriptorBinding::Image(0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, depthView, sampler, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL)
+				: DescriptorBinding::Image(0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, mipViews[level - 1], sampler, VK_IMAGE_LAYOUT_GENERAL),
+			DescriptorBinding::Image(1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, mipViews[level], VK_NULL_HANDLE, VK_IMAGE_LAYOUT_GENERAL)
+		};
+
+		VkDescriptorSet descriptorSet = frameDescriptorAllocator->GetOrCreate(descriptorSetLayout, bindings);
+		if (descriptorSet == VK_NULL_HANDLE)
+		{
+			std::cerr << "Failed to allocate depth pyramid descriptor set" << std::endl;
+			valid = false;
+			return;
+		}
+
+		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipelineLayout, 0, 1, &descriptorSet, 0, nullptr);
+
+		uint32_t levelWidth = std::max(extent.width >> level, 1u);
+		uint32_t levelHeight = std::max(extent.height >> level, 1u);
+		vkCmdDispatch(commandBuffer, (levelWidth + groupSize - 1) / groupSize, (levelHeight + groupSize - 1) / groupSize, 1);
+
+		// The next level samples this one
+		VkImageMemoryBarrier2 barrier{};
+		barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2;
+		barrier.srcStageMask = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+		barrier.srcAccessMask = VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT;
+		barrier.dstStageMask = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+		barrier.dstAccessMask = VK_ACCESS_2_SHADER_SAMPLED_READ_BIT;
+		barrier.oldLayout = VK_IMAGE_LAYOUT_GENERAL;
+		barrier.newLayout = VK_IMAGE_LAYOUT_GENERAL;
+		barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.image = image;
+		barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		barrier.subresourceRange.baseMipLevel = level;
+		barrier.subresourceRange.levelCount = 1;
+		barrier.subresourceRange.baseArrayLayer = 0;
+		barrier.subresourceRange.layerCount = 1;
+
+		RecordPipelineBarrier(device, commandBuffer, {barrier});
+	}
+
+	viewProjection = depthViewProjection;
+	valid = true;
+}
\ No newline at end of file
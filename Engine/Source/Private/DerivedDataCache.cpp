@@ -0,0 +1,378 @@
+#include <DerivedDataCache.h>
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <algorithm>
+#include <filesystem>
+#include <random>
+#include <chrono>
+#include <cstring>
+
+namespace VulkanRenderer
+{
+	namespace
+	{
+		// "VRDD" read as a little-endian uint32
+		constexpr uint32_t TrailerMagic = 0x44445256;
+		constexpr uint32_t TrailerVersion = 1;
+
+		// Evictions go this far below the size, so the next few writes do not trim again
+		constexpr double TrimTarget = 0.9;
+
+		// Temporary files this old were left behind by a writer that died
+		constexpr std::chrono::hours StaleTemporaryAge(1);
+
+		// After the data, little-endian
+		struct Trailer
+		{
+			uint32_t magic;
+			uint32_t version;
+			uint64_t key[2];
+			uint64_t size;
+			uint64_t checksum[2];
+		};
+
+		static_assert(sizeof(Trailer) == 48, "Trailer is part of the entry format");
+
+		uint64_t Rotl(uint64_t x, int r)
+		{
+			return (x << r) | (x >> (64 - r));
+		}
+
+		uint64_t Mix(uint64_t k)
+		{
+			k ^= k >> 33;
+			k *= 0xFF51AFD7ED558CCDull;
+			k ^= k >> 33;
+			k *= 0xC4CEB9FE1A85EC53ull;
+			k ^= k >> 33;
+			return k;
+		}
+
+		// MurmurHash3 x64 128 continuing from a previous hash instead of a seed, so keys can be built up piece by piece
+		void Murmur3(const void* key, size_t length, uint64_t hash[2])
+		{
+			const uint8_t* data = static_cast<const uint8_t*>(key);
+			const size_t blockCount = length / 16;
+
+			uint64_t h1 = hash[0];
+			uint64_t h2 = hash[1];
+
+			const uint64_t c1 = 0x87C37B91114253D5ull;
+			const uint64_t c2 = 0x4CF5AD432745937Full;
+
+			for (size_t i = 0; i < blockCount; i++)
+			{
+				uint64_t k1, k2;
+				memcpy(&k1, data + i * 16, sizeof(k1));
+				memcpy(&k2, data + i * 16 + 8, sizeof(k2));
+
+				k1 *= c1; k1 = Rotl(k1, 31); k1 *= c2; h1 ^= k1;
+				h1 = Rotl(h1, 27); h1 += h2; h1 = h1 * 5 + 0x52DCE729;
+
+				k2 *= c2; k2 = Rotl(k2, 33); k2 *= c1; h2 ^= k2;
+				h2 = Rotl(h2, 31); h2 += h1; h2 = h2 * 5 + 0x38495AB5;
+			}
+
+			const uint8_t* tail = data + blockCount * 16;
+			uint64_t k1 = 0;
+			uint64_t k2 = 0;
+
+			switch (length & 15)
+			{
+			case 15: k2 ^= static_cast<uint64_t>(tail[14]) << 48; [[fallthrough]];
+			case 14: k2 ^= static_cast<uint64_t>(tail[13]) << 40; [[fallthrough]];
+			case 13: k2 ^= static_cast<uint64_t>(tail[12]) << 32; [[fallthrough]];
+			case 12: k2 ^= static_cast<uint64_t>(tail[11]) << 24; [[fallthrough]];
+			case 11: k2 ^= static_cast<uint64_t>(tail[10]) << 16; [[fallthrough]];
+			case 10: k2 ^= static_cast<uint64_t>(tail[9]) << 8; [[fallthrough]];
+			case 9:  k2 ^= static_cast<uint64_t>(tail[8]);
+				k2 *= c2; k2 = Rotl(k2, 33); k2 *= c1; h2 ^= k2;
+				[[fallthrough]];
+			case 8: k1 ^= static_cast<uint64_t>(tail[7]) << 56; [[fallthrough]];
+			case 7: k1 ^= static_cast<uint64_t>(tail[6]) << 48; [[fallthrough]];
+			case 6: k1 ^= static_cast<uint64_t>(tail[5]) << 40; [[fallthrough]];
+			case 5: k1 ^= static_cast<uint64_t>(tail[4]) << 32; [[fallthrough]];
+			case 4: k1 ^= static_cast<uint64_t>(tail[3]) << 24; [[fallthrough]];
+			case 3: k1 ^= static_cast<uint64_t>(tail[2]) << 16; [[fallthrough]];
+			case 2: k1 ^= static_cast<uint64_t>(tail[1]) << 8; [[fallthrough]];
+			case 1: k1 ^= static_cast<uint64_t>(tail[0]);
+				k1 *= c1; k1 = Rotl(k1, 31); k1 *= c2; h1 ^= k1;
+			}
+
+			h1 ^= length;
+			h2 ^= length;
+
+			h1 += h2;
+			h2 += h1;
+
+			h1 = Mix(h1);
+			h2 = Mix(h2);
+
+			h1 += h2;
+			h2 += h1;
+
+			hash[0] = h1;
+			hash[1] = h2;
+		}
+
+		// Unique per writer, so two processes storing the same key never write the same temporary file
+		std::string GetTemporarySuffix()
+		{
+			static std::atomic<uint64_t> counter = 0;
+			static const uint64_t processId = std::random_device()();
+
+			std::ostringstream suffix;
+			suffix << '.' << std::hex << processId << '-' << counter++ << ".tmp";
+			return suffix.str();
+		}
+
+		bool IsTemporary(const std::filesystem::path& path)
+		{
+			return path.extension() == ".tmp";
+		}
+	}
+
+	DerivedDataKey::DerivedDataKey(const char* kind, uint32_t version)
+		: hash{0, 0}
+	{
+		Add(std::string(kind));
+		AddValue(version);
+	}
+
+	DerivedDataKey& DerivedDataKey::Add(const void* data, size_t size)
+	{
+		Murmur3(data, size, hash);
+		return *this;
+	}
+
+	DerivedDataKey& DerivedDataKey::Add(const std::string& value)
+	{
+		uint64_t length = value.size();
+		Add(&length, sizeof(length));
+		return Add(value.data(), value.size());
+	}
+
+	std::string DerivedDataKey::ToString() const
+	{
+		std::ostringstream text;
+		text << std::hex << std::setfill('0') << std::setw(16) << hash[0] << std::setw(16) << hash[1];
+		return text.str();
+	}
+
+	bool DerivedDataKey::operator==(const DerivedDataKey& other) const
+	{
+		return hash[0] == other.hash[0] && hash[1] == other.hash[1];
+	}
+
+	DerivedDataCache::DerivedDataCache(const std::string& directory, uint64_t maxSize)
+		: directory(directory), maxSize(maxSize)
+	{
+		std::error_code error;
+		std::filesystem::create_directories(directory, error);
+		if (error)
+			std::cerr << "Failed to create derived data cache directory: " << directory << std::endl;
+
+		// Counts the entries left by earlier runs and trims them to this run's size
+		Trim();
+	}
+
+	bool DerivedDataCache::Get(const DerivedDataKey& key, FileData& data)
+	{
+		std::string path = GetEntryPath(key);
+
+		// Most misses end here, without an error from mapping a file that is not there
+		std::error_code error;
+		if (!std::filesystem::is_regular_file(path, error) || !data.Map(path))
+		{
+			misses++;
+			return false;
+		}
+
+		bool valid = data.GetSize() >= sizeof(Trailer);
+
+		Trailer trailer{};
+		if (valid)
+			memcpy(&trailer, data.GetData() + data.GetSize() - sizeof(Trailer), sizeof(Trailer));
+
+		uint64_t checksum[2] = {0, 0};
+		valid = valid && trailer.magic == TrailerMagic && trailer.version == TrailerVersion && trailer.key[0] == key.hash[0] && trailer.key[1] == key.hash[1];
+		valid = valid && trailer.size == data.GetSize() - sizeof(Trailer);
+		if (valid)
+		{
+			Murmur3(data.GetData(), static_cast<size_t>(trailer.size), checksum);
+			valid = checksum[0] == trailer.checksum[0] && checksum[1] == trailer.checksum[1];
+		}
+
+		if (!valid)
+		{
+			std::cerr << "Removing corrupt derived data cache entry: " << path << std::endl;
+			data.Reset();
+			std::filesystem::remove(path, error);
+
+			misses++;
+			return false;
+		}
+
+		data.Truncate(static_cast<size_t>(trailer.size));
+
+		// The modification time doubles as the last use for eviction
+		std::filesystem::last_write_time(path, std::filesystem::file_time_type::clock::now(), error);
+
+		hits++;
+		return true;
+	}
+
+	bool DerivedDataCache::Put(const DerivedDataKey& key, const uint8_t* data, size_t size)
+	{
+		std::string path = GetEntryPath(key);
+		std::string temporaryPath = path + GetTemporarySuffix();
+
+		std::error_code error;
+		std::filesystem::create_directories(std::filesystem::path(path).parent_path(), error);
+
+		Trailer trailer{};
+		trailer.magic = TrailerMagic;
+		trailer.version = TrailerVersion;
+		trailer.key[0] = key.hash[0];
+		trailer.key[1] = key.hash[1];
+		trailer.size = size;
+		Murmur3(data, size, trailer.checksum);
+
+		{
+			std::ofstream file(temporaryPath, std::ios::binary);
+			file.write(reinterpret_cast<const char*>(data), static_cast<std::streamsize>(size));
+			file.write(reinterpret_cast<const char*>(&trailer), sizeof(trailer));
+
+			if (!file.good())
+			{
+				std::cerr << "Failed to write derived data cache entry: " << temporaryPath << std::endl;
+				file.close();
+				std::filesystem::remove(temporaryPath, error);
+				return false;
+			}
+		}
+
+		// Atomic, a concurrent writer of the same key renames identical data over it
+		std::filesystem::rename(temporaryPath, path, error);
+		if (error)
+		{
+			std::cerr << "Failed to store derived data cache entry: " << path << std::endl;
+			std::filesystem::remove(temporaryPath, error);
+			return false;
+		}
+
+		writes++;
+
+		bool full;
+		{
+			std::lock_guard<std::mutex> lock(sizeMutex);
+			cacheSize += size + sizeof(Trailer);
+			full = cacheSize > maxSize;
+		}
+
+		if (full)
+			Trim();
+		return true;
+	}
+
+	void DerivedDataCache::Trim()
+	{
+		std::lock_guard<std::mutex> lock(sizeMutex);
+
+		struct Entry
+		{
+			std::filesystem::path path;
+			uint64_t size;
+			std::filesystem::file_time_type lastUse;
+		};
+
+		std::vector<Entry> entries;
+		uint64_t totalSize = 0;
+		auto now = std::filesystem::file_time_type::clock::now();
+
+		std::error_code error;
+		for (const std::filesystem::directory_entry& file : std::filesystem::recursive_directory_iterator(directory, error))
+		{
+			std::error_code fileError;
+			if (!file.is_regular_file(fileError))
+				continue;
+
+			std::filesystem::file_time_type lastUse = file.last_write_time(fileError);
+			if (fileError)
+				continue;
+
+			// Another writer's file until it has been around for long
+			if (IsTemporary(file.path()))
+			{
+				if (now - lastUse > StaleTemporaryAge)
+					std::filesystem::remove(file.path(), fileError);
+				continue;
+			}
+
+			uint64_t fileSize = file.file_size(fileError);
+			if (fileError)
+				continue;
+
+			entries.push_back({file.path(), fileSize, lastUse});
+			totalSize += fileSize;
+		}
+
+		if (totalSize > maxSize)
+		{
+			std::sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b)
+			{
+				return a.lastUse < b.lastUse;
+			});
+
+			uint64_t targetSize = static_cast<uint64_t>(maxSize * TrimTarget);
+			for (const Entry& entry : entries)
+			{
+				if (totalSize <= targetSize)
+					break;
+
+				// Fails for entries another process has mapped on Windows, those go on a later trim
+				std::error_code removeError;
+				if (std::filesystem::remove(entry.path, removeError))
+				{
+					totalSize -= entry.size;
+					evictions++;
+				}
+			}
+		}
+
+		cacheSize = totalSize;
+	}
+
+	DerivedDataCacheStats DerivedDataCache::GetStats() const
+	{
+		DerivedDataCacheStats stats;
+		stats.hits = hits;
+		stats.misses = misses;
+		stats.writes = writes;
+		stats.evictions = evictions;
+
+		std::lock_guard<std::mutex> lock(sizeMutex);
+		stats.size = cacheSize;
+		return stats;
+	}
+
+	std::string DerivedDataCache::GetReport() const
+	{
+		DerivedDataCacheStats stats = GetStats();
+
+		std::ostringstream report;
+		report << "Derived data cache " << directory << ": " << stats.hits << " hits, " << stats.misses << " misses, " << stats.writes << " writes, "
+			<< stats.evictions << " evictions, " << (stats.size + 1024 * 1024 - 1) / (1024 * 1024) << " MiB";
+		return report.str();
+	}
+
+	std::string DerivedDataCache::GetEntryPath(const DerivedDataKey& key) const
+	{
+		// Fanned out by the first byte so no directory grows too large
+		std::string name = key.ToString();
+		return (std::filesystem::path(directory) / name.substr(0, 2) / name).string();
+	}
+}
\ No newline at end of file
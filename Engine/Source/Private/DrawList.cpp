@@ -0,0 +1,198 @@
+#include <DrawList.h>
+
+#include <array>
+#include <algorithm>
+#include <cstring>
+
+#include <Mesh.h>
+
+using namespace VulkanRenderer;
+
+namespace
+{
+	constexpr uint32_t meshIndexBits = 22;
+	constexpr uint32_t materialBits = 24;
+	constexpr uint32_t coarseDepthBits = 16;
+
+	// Maps a float to an unsigned integer with the same ordering, negative values included
+	uint32_t ToSortableBits(float value)
+	{
+		uint32_t bits;
+		memcpy(&bits, &value, sizeof(bits));
+		return (bits & 0x80000000u) ? ~bits : bits | 0x80000000u;
+	}
+
+	// Distance in front of the camera of the mesh origin, the camera looks down -Z in view space
+	float GetViewDepth(const glm::mat4& view, const MeshUBO& uniforms)
+	{
+		return -(view * uniforms.model[3]).z;
+	}
+
+	uint64_t MakeOpaqueKey(BlendMode blendMode, float viewDepth, uint32_t materialId, uint32_t meshIndex)
+	{
+		// The top bits of a float keep its exponent and a few mantissa bits, logarithmic depth buckets let
+		// draws at about the same distance group by material
+		uint64_t coarseDepth = ToSortableBits(viewDepth) >> (32 - coarseDepthBits);
+
+		uint64_t key = static_cast<uint64_t>(blendMode) << (meshIndexBits + materialBits + coarseDepthBits);
+		key |= coarseDepth << (meshIndexBits + materialBits);
+		key |= static_cast<uint64_t>(materialId & ((1u << materialBits) - 1)) << meshIndexBits;
+		key |= meshIndex & ((1u << meshIndexBits) - 1);
+		return key;
+	}
+
+	uint64_t MakeTransparentKey(float viewDepth, uint32_t meshIndex)
+	{
+		// Inverted so the farthest draw sorts first
+		uint64_t depth = ~ToSortableBits(viewDepth);
+		return depth << 32 | meshIndex;
+	}
+
+	uint64_t MakeDepthPrepassKey(float viewDepth, uint32_t meshIndex)
+	{
+		uint64_t depth = ToSortableBits(viewDepth);
+		return depth << 32 | meshIndex;
+	}
+
+	// Appends the batch's ranges whose bounding spheres touch the frustum, merging neighbours into one run
+	void CullRanges(const Mesh* mesh, const glm::mat4& model, const CameraUBO& cameraUniforms, std::vector<DrawRange>& ranges)
+	{
+		float scale = std::max(glm::length(glm::vec3(model[0])), std::max(glm::length(glm::vec3(model[1])), glm::length(glm::vec3(model[2]))));
+		size_t firstRun = ranges.size();
+
+		for (const MeshRange& range : mesh->GetRanges())
+		{
+			glm::vec3 center = glm::vec3(model * glm::vec4(range.center, 1.0f));
+			float radius = range.radius * scale;
+
+			bool visible = true;
+			for (const glm::vec4& plane : cameraUniforms.frustumPlanes)
+			{
+				if (glm::dot(glm::vec3(plane), center) + plane.w < -radius)
+				{
+					visible = false;
+					break;
+				}
+			}
+
+			if (!visible)
+				continue;
+
+			if (ranges.size() > firstRun && ranges.back().firstIndex + ranges.back().indexCount == range.indexOffset)
+				ranges.back().indexCount += range.indexCount;
+			else
+				ranges.push_back({range.indexOffset, range.indexCount});
+		}
+	}
+}
+
+void VulkanRenderer::RadixSortDrawItems(std::vector<DrawItem>& items, std::vector<DrawItem>& scratch)
+{
+	if (items.size() < 2)
+		return;
+
+	// One pass over the keys builds the histograms of all eight digits
+	std::array<std::array<uint32_t, 256>, 8> histograms{};
+	for (const DrawItem& item : items)
+	{
+		for (uint32_t digit = 0; digit < 8; digit++)
+			histograms[digit][(item.sortKey >> (digit * 8)) & 0xFF]++;
+	}
+
+	scratch.resize(items.size());
+
+	for (uint32_t digit = 0; digit < 8; digit++)
+	{
+		std::array<uint32_t, 256>& histogram = histograms[digit];
+
+		// Every key has the same value in this digit, the pass would not move anything
+		uint32_t firstDigitValue = (items[0].sortKey >> (digit * 8)) & 0xFF;
+		if (histogram[firstDigitValue] == items.size())
+			continue;
+
+		uint32_t offset = 0;
+		for (uint32_t& count : histogram)
+		{
+			uint32_t bucketSize = count;
+			count = offset;
+			offset += bucketSize;
+		}
+
+		for (const DrawItem& item : items)
+			scratch[histogram[(item.sortKey >> (digit * 8)) & 0xFF]++] = item;
+
+		items.swap(scratch);
+	}
+}
+
+void DrawList::Build(const std::vector<Mesh*>& meshes, const std::vector<MeshUBO>& meshUniforms, const std::vector<uint32_t>& meshLods, const CameraUBO& cameraUniforms, bool useDepthPrepass, bool useClusterCulling)
+{
+	clustered.clear();
+	opaque.clear();
+	transparent.clear();
+	depthPrepass.clear();
+	ranges.clear();
+
+	for (uint32_t i = 0; i < meshes.size(); i++)
+	{
+		const Mesh* mesh = meshes[i];
+		float viewDepth = GetViewDepth(cameraUniforms.view, meshUniforms[i]);
+		uint32_t lod = meshLods[i];
+
+		// Transparent meshes are sorted as a whole, their clusters are never culled. Meshlets are built from the
+		// full resolution level only, simplified levels are drawn whole.
+		bool isClustered = useClusterCulling && mesh->HasMeshlets() && lod == 0 && mesh->blendMode != BlendMode::Transparent;
+
+		// Clustered batches are culled finer on the GPU, the rest draw only the runs of their visible ranges
+		uint32_t firstRange = static_cast<uint32_t>(ranges.size());
+		uint32_t rangeCount = 0;
+		if (mesh->IsStaticBatch() && !isClustered)
+		{
+			CullRanges(mesh, meshUniforms[i].model, cameraUniforms, ranges);
+
+			rangeCount = static_cast<uint32_t>(ranges.size()) - firstRange;
+			if (rangeCount == 0)
+				continue;
+		}
+
+		if (mesh->blendMode == BlendMode::Transparent)
+			transparent.push_back({MakeTransparentKey(viewDepth, i), i, lod, firstRange, rangeCount});
+		else if (isClustered)
+			clustered.push_back({MakeOpaqueKey(mesh->blendMode, viewDepth, mesh->materialId, i), i, lod});
+		else
+			opaque.push_back({MakeOpaqueKey(mesh->blendMode, viewDepth, mesh->materialId, i), i, lod, firstRange, rangeCount});
+
+		if (useDepthPrepass && mesh->blendMode == BlendMode::Opaque && !isClustered)
+			depthPrepass.push_back({MakeDepthPrepassKey(viewDepth, i), i, lod, firstRange, rangeCount});
+	}
+
+	RadixSortDrawItems(clustered, scratch);
+	RadixSortDrawItems(opaque, scratch);
+	RadixSortDrawItems(transparent, scratch);
+	RadixSortDrawItems(depthPrepass, scratch);
+}
+
+const std::vector<DrawItem>& DrawList::GetClustered() const
+{
+	return clustered;
+}
+
+const std::vector<DrawItem>& DrawList::GetOpaque() const
+{
+	return opaque;
+}
+
+const std::vector<DrawItem>& DrawList::GetTransparent() const
+{
+	return transparent;
+}
+
+const std::vector<DrawItem>& DrawList::GetDepthPrepass() const
+{
+	return depthPrepass;
+}
+
+const std::vector<DrawRange>& DrawList::GetRanges() const
+{
+	return ranges;
+}
\ No newline at end of file
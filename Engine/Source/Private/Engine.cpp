@@ -1,6 +1,9 @@
 #include <Engine.h>
 
 #include <iostream>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
 
 #include <volk.h>
 
@@ -11,30 +14,87 @@
 #include <VulkanSwapChain.h>
 #include <VulkanRenderPass.h>
 #include <VulkanPipeline.h>
-#include <VulkanDescriptorPool.h>
+#include <VulkanDescriptorAllocator.h>
 #include <VulkanSync.h>
+#include <Profiler.h>
+#include <FramePacer.h>
+#include <RenderThread.h>
 #include <Vertex.h>
 #include <VulkanImGuiOverlay.h>
+#include <VulkanOffscreenTarget.h>
+#include <DepthPyramid.h>
+#include <ImageWriter.h>
+#include <StaticBatch.h>
+#include <CookedMesh.h>
+#include <FileSystem.h>
+#include <DerivedDataCache.h>
+#include <VulkanUpload.h>
+#include <TextureStreamer.h>
 
 namespace VulkanRenderer
 {
-	Engine::Engine()
+	Engine::Engine(const EngineSettings& settings)
+		: settings(settings)
 	{
 		if (volkInitialize() != VK_SUCCESS)
 		{
 			std::cerr << "Failed to initialize Volk" << std::endl;
 		}
+
+		// Before anything loads, shaders included
+		for (const std::string& path : settings.pakPaths)
+		{
+			FileSystem::MountPak(path);
+		}
+
+		if (!settings.derivedDataCacheDirectory.empty())
+			derivedDataCache = std::make_unique<DerivedDataCache>(settings.derivedDataCacheDirectory, settings.derivedDataCacheSize);
 		
-		glfwWindow = std::make_unique<GlfwWindow>(this);
-		instance = std::make_unique<VulkanInstance>(glfwWindow->Get());
-		device = std::make_unique<VulkanDevice>(instance->Get(), instance->GetSurface());
-		swapChain = std::make_unique<VulkanSwapChain>(device.get(), instance->GetSurface(), glfwWindow->Get());
-		renderPass = std::make_unique<VulkanRenderPass>(device.get(), swapChain->imageFormat);
-		swapChain->CreateFramebuffers(renderPass->Get());
-		pipeline = std::make_unique<VulkanPipeline>(device.get(), swapChain.get(), renderPass.get());
+		if (settings.headless)
+		{
+			if (this->settings.frameCount == 0)
+				this->settings.frameCount = 1;
+
+			instance = std::make_unique<VulkanInstance>(nullptr);
+			device = std::make_unique<VulkanDevice>(instance->Get(), VK_NULL_HANDLE);
+			offscreenTarget = std::make_unique<VulkanOffscreenTarget>(device.get(), VkExtent2D{settings.width, settings.height});
+			renderPass = std::make_unique<VulkanRenderPass>(device.get(), offscreenTarget->GetColorFormat());
+		}
+		else
+		{
+			glfwWindow = std::make_unique<GlfwWindow>(this);
+			instance = std::make_unique<VulkanInstance>(glfwWindow->Get());
+			device = std::make_unique<VulkanDevice>(instance->Get(), instance->GetSurface());
+			swapChain = std::make_unique<VulkanSwapChain>(device.get(), instance->GetSurface(), glfwWindow->Get(), settings.presentMode);
+			renderPass = std::make_unique<VulkanRenderPass>(device.get(), swapChain->imageFormat);
+		}
+
+		// Before the first buffer is created, uniform buffers pick their memory from it too
+		device->directUploads = device->directUploads && settings.directUploads;
+
+		if (settings.uploadBenchmark)
+			RunUploadBenchmark(device.get());
+
+		// Before the first mesh, so its textures load their tail only
+		if (settings.textureStreaming)
+			textureStreamer = std::make_unique<TextureStreamer>(device.get(), settings.textureStreamingBudget);
+
+		pipeline = std::make_unique<VulkanPipeline>(device.get(), renderPass.get());
+		pipeline->depthPrepass = settings.depthPrepass;
+		pipeline->clusterCulling = settings.clusterCulling;
+		pipeline->lodErrorThreshold = settings.lodErrorThreshold;
+		pipeline->hlodDistance = settings.hlodDistance;
 		
+		// Long-lived sets (camera, meshes) come from a growable allocator, transient sets from a per-frame allocator
+		descriptorAllocator = std::make_unique<VulkanDescriptorAllocator>(device.get());
+		for (int i = 0; i < VulkanConfig::MAX_FRAMES_IN_FLIGHT; i++)
+		{
+			frameDescriptorAllocators.push_back(std::make_unique<VulkanDescriptorAllocator>(device.get(), 16));
+		}
+
 		camera = std::make_unique<Camera>(device.get(), pipeline->GetCameraDescriptorSetLayout());
 		camera->transform.position = {0.0f, 0.0f, 0.0f};
+		camera->CreateDescriptorSets(descriptorAllocator.get());
 
 		// MeshInfo holds the vertices, indices, and texture paths to be passed to Mesh constructor
 		MeshInfo meshInfo;
@@ -68,96 +128,635 @@ namespace VulkanRenderer
 		meshInfo3.baseColorPath = "Assets/Textures/Glass_Vintage_001_basecolor.png";
 		meshInfo3.roughnessPath = "Assets/Textures/Glass_Vintage_001_roughness.jpg";
 		meshInfo3.metallicPath = "Assets/Textures/Glass_Vintage_001_metallic.png";
+		meshInfo3.blendMode = BlendMode::Transparent;
 		
-		meshes.push_back(std::make_unique<Mesh>(device.get(), pipeline->GetMeshDescriptorSetLayout(), meshInfo));
-		meshes.push_back(std::make_unique<Mesh>(device.get(), pipeline->GetMeshDescriptorSetLayout(), meshInfo2));
-		meshes.push_back(std::make_unique<Mesh>(device.get(), pipeline->GetMeshDescriptorSetLayout(), meshInfo3));
+		std::vector<Transform> sceneTransforms(3);
+		sceneTransforms[0].position = {-1.0f, 0.0f, -2.0f};
+		sceneTransforms[1].position = { 1.0f, 0.0f, -2.0f};
+		sceneTransforms[2].position = { 0.0f, 0.0f, -3.5f};
+
+		std::vector<StaticMeshSource> sceneSources =
+		{
+			{&meshInfo, sceneTransforms[0].GetMatrix()},
+			{&meshInfo2, sceneTransforms[1].GetMatrix()},
+			{&meshInfo3, sceneTransforms[2].GetMatrix()}
+		};
 
-		meshes[0]->transform.position = {-1.0f, 0.0f, -2.0f};
-		meshes[1]->transform.position = { 1.0f, 0.0f, -2.0f};
-		meshes[2]->transform.position = { 0.0f, 0.0f, -3.5f};
+		// The offline steps run in place here, a real scene would build its batches and proxies once and load
+		// them with the level. Batched sources are only drawn through their batch.
+		std::vector<bool> batched(sceneSources.size(), false);
+		if (settings.staticBatching)
+		{
+			for (const StaticBatch& batch : BuildStaticBatches(sceneSources, StaticBatchSettings()))
+			{
+				AddMesh(batch.info);
+				for (uint32_t source : batch.sources)
+				{
+					batched[source] = true;
+				}
+			}
+		}
 
-		descriptorPool = std::make_unique<VulkanDescriptorPool>(device.get(), meshes.size());
-		
-		camera->CreateDescriptorSets(descriptorPool->Get());
-		
-		for (std::unique_ptr<Mesh>& mesh : meshes)
+		// HLODs group the meshes left unbatched
+		std::vector<StaticMeshSource> hlodSources;
+		std::vector<Mesh*> hlodMeshes;
+		for (size_t i = 0; i < sceneSources.size(); i++)
+		{
+			if (batched[i])
+				continue;
+
+			Mesh* mesh = AddMesh(*sceneSources[i].info);
+			mesh->transform = sceneTransforms[i];
+
+			hlodSources.push_back(sceneSources[i]);
+			hlodMeshes.push_back(mesh);
+		}
+
+		for (const std::string& path : settings.cookedMeshPaths)
+		{
+			LoadMesh(path);
+		}
+
+		if (!settings.hlodDirectory.empty())
+		{
+			HlodBuildSettings hlodSettings;
+			hlodSettings.outputDirectory = settings.hlodDirectory;
+
+			for (const HlodProxy& proxy : BuildHlodProxies(hlodSources, hlodSettings))
+			{
+				std::vector<Mesh*> members;
+				for (uint32_t source : proxy.sources)
+				{
+					members.push_back(hlodMeshes[source]);
+				}
+				AddHlod(proxy, members);
+			}
+		}
+
+		if (derivedDataCache)
+			std::cout << derivedDataCache->GetReport() << std::endl;
+
+		sync = std::make_unique<VulkanSync>(device->GetLogical(), swapChain ? swapChain->GetImageCount() : 1);
+		pipeline->SetSync(sync.get());
+
+		if (textureStreamer)
 		{
-			mesh->CreateDescriptorSets(descriptorPool->Get());
+			textureStreamer->SetSync(sync.get());
+
+			// Captured frames are compared across runs, so each one waits for the levels it asked for
+			textureStreamer->waitForDecodes = settings.headless;
+			pipeline->SetTextureStreamer(textureStreamer.get());
 		}
 
-		sync = std::make_unique<VulkanSync>(device->GetLogical());
+		profiler = std::make_unique<Profiler>(device.get(), VulkanConfig::MAX_FRAMES_IN_FLIGHT);
+		pipeline->SetProfiler(profiler.get());
+
+		framePacer = std::make_unique<FramePacer>(device.get());
+		framePacer->targetFps = settings.fpsLimit;
+		framePacer->renderOnDemand = settings.renderOnDemand;
+		framePacer->RequestRedraw();
+		framePacer->requestedPresentMode = settings.presentMode;
+
+		// Read by the UI on the main thread, so it is not refreshed when the render thread recreates the swap chain
+		if (swapChain)
+			framePacer->supportedPresentModes = swapChain->supportedPresentModes;
+		pipeline->SetFramePacer(framePacer.get());
+
+		renderGraph = std::make_unique<RenderGraph>(device.get());
+		renderGraph->SetProfiler(profiler.get());
+		renderGraph->SetSync(sync.get());
+		BuildRenderGraph();
 		
-		GLFWwindow* window = glfwWindow->Get();
-		imGuiOverlay = std::make_unique<VulkanImGuiOverlay>(instance.get(), device.get(), swapChain.get(), renderPass.get(), window);
-		pipeline->SetImGuiOverlay(imGuiOverlay.get());
+		// The overlay needs a window for input, headless runs render the scene only
+		if (glfwWindow)
+		{
+			GLFWwindow* window = glfwWindow->Get();
+			imGuiOverlay = std::make_unique<VulkanImGuiOverlay>(instance.get(), device.get(), swapChain.get(), renderPass.get(), window);
+			pipeline->SetImGuiOverlay(imGuiOverlay.get());
+		}
 	}
 
 	Engine::~Engine()
 	{
 		imGuiOverlay.reset();
+		FileSystem::UnmountAll();
+	}
+
+	Mesh* Engine::AddMesh(const MeshInfo& info)
+	{
+		std::unique_ptr<Mesh> mesh;
+
+		// Falls back to cooking in memory when the cache cannot produce a cook
+		CookedMeshFile file;
+		if (derivedDataCache && file.Open(info, *derivedDataCache))
+			mesh = std::make_unique<Mesh>(device.get(), pipeline->GetMeshDescriptorSetLayout(), pipeline->GetClusterDescriptorSetLayout(), file.GetView(), textureStreamer.get());
+		else
+			mesh = std::make_unique<Mesh>(device.get(), pipeline->GetMeshDescriptorSetLayout(), pipeline->GetClusterDescriptorSetLayout(), info, textureStreamer.get());
+
+		mesh->CreateDescriptorSets(descriptorAllocator.get());
+
+		meshes.push_back(std::move(mesh));
+		return meshes.back().get();
+	}
+
+	Mesh* Engine::LoadMesh(const std::string& path)
+	{
+		// Held only while the mesh uploads, its sections go into staging memory without being parsed
+		CookedMeshFile file;
+		if (!file.Open(path))
+			return nullptr;
+
+		std::unique_ptr<Mesh> mesh = std::make_unique<Mesh>(device.get(), pipeline->GetMeshDescriptorSetLayout(), pipeline->GetClusterDescriptorSetLayout(), file.GetView(), textureStreamer.get());
+		mesh->CreateDescriptorSets(descriptorAllocator.get());
+
+		meshes.push_back(std::move(mesh));
+		return meshes.back().get();
+	}
+
+	Mesh* Engine::AddHlod(const HlodProxy& proxy, const std::vector<Mesh*>& members)
+	{
+		// Members are drawn until the first frame finds the group far enough away
+		Mesh* proxyMesh = AddMesh(proxy.info);
+		proxyMesh->hidden = true;
+
+		hlodGroups.push_back({proxyMesh, members, proxy.center, proxy.radius});
+		return proxyMesh;
 	}
 
 	void Engine::Run()
 	{
-		while (!glfwWindowShouldClose(glfwWindow->Get()))
+		if (settings.headless)
 		{
-			glfwPollEvents();
-			DrawFrame();
+			// Each frame is readback bound, there is nothing for a second thread to overlap
+			FramePacket packet;
+
+			while (frameNumber < settings.frameCount)
+			{
+				BuildFramePacket(packet, GetRenderExtent());
+				DrawOffscreenFrame(packet);
+			}
+		}
+		else
+		{
+			// The main thread polls input and builds packets, the render thread records, submits and presents them
+			renderThread = std::make_unique<RenderThread>([this](FramePacket& packet)
+			{
+				DrawFrame(packet);
+			});
+
+			std::unique_ptr<FramePacket> packet = std::make_unique<FramePacket>();
+			uint32_t submittedFrames = 0;
+
+			while (!glfwWindowShouldClose(glfwWindow->Get()) && (settings.frameCount == 0 || submittedFrames < settings.frameCount))
+			{
+				// Limit before polling so the frame is built from the freshest input
+				framePacer->WaitForNextFrame();
+				framePacer->PollEvents();
+				framePacer->MarkInputSampled();
+
+				// A minimized window has nothing to present to
+				int width = 0, height = 0;
+				glfwWindow->GetFramebufferSize(&width, &height);
+				if (width == 0 || height == 0)
+				{
+					glfwWaitEvents();
+					continue;
+				}
+
+				if (SceneChanged())
+					framePacer->RequestRedraw();
+
+				if (!framePacer->ShouldDrawFrame())
+					continue;
+
+				// Apply a frames in flight change requested from the UI between frames
+				if (sync->requestedFramesInFlight != VulkanConfig::MAX_FRAMES_IN_FLIGHT)
+					SetFramesInFlight(sync->requestedFramesInFlight);
+
+				BuildFramePacket(*packet, {static_cast<uint32_t>(width), static_cast<uint32_t>(height)});
+				renderThread->Submit(packet);
+				submittedFrames++;
+			}
+
+			// Draws the frames still queued before joining
+			renderThread.reset();
 		}
 		vkDeviceWaitIdle(device->GetLogical());
+
+		if (!settings.traceOutputPath.empty())
+			profiler->WriteChromeTrace(settings.traceOutputPath);
+	}
+
+	void Engine::BuildRenderGraph()
+	{
+		renderGraph->Reset();
+
+		VkExtent2D extent = GetRenderExtent();
+
+		if (offscreenTarget)
+		{
+			// The previous frame's readback copy is the last use of the offscreen image
+			RenderGraphImageState initialState{VK_PIPELINE_STAGE_2_COPY_BIT, VK_ACCESS_2_NONE, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL};
+			backbuffer = renderGraph->ImportImage("Offscreen color", offscreenTarget->GetColorFormat(), extent, initialState, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL);
+			renderGraph->BindImportedImage(backbuffer, offscreenTarget->GetColorImage(), offscreenTarget->GetColorImageView());
+		}
+		else
+		{
+			// The frame submit waits for image acquisition at color attachment output, the first write chains onto that
+			RenderGraphImageState initialState{VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_2_NONE, VK_IMAGE_LAYOUT_UNDEFINED};
+			backbuffer = renderGraph->ImportImage("Swap chain image", swapChain->imageFormat, extent, initialState, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR);
+		}
+
+		RenderGraphResource depth = renderGraph->CreateImage("Depth", FindDepthFormat(device->GetPhysical()), extent);
+
+		// Sized to the new depth extent, frames in flight may still test against the old pyramid
+		if (depthPyramid)
+		{
+			DepthPyramid* oldDepthPyramid = depthPyramid.release();
+			sync->Retire(sync->GetSubmittedFrameValue(), [oldDepthPyramid]()
+			{
+				delete oldDepthPyramid;
+			});
+		}
+		depthPyramid = std::make_unique<DepthPyramid>(device.get(), extent);
+
+		// Every frame leaves the pyramid in the general layout after building it
+		RenderGraphImageState pyramidState{VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT, VK_IMAGE_LAYOUT_GENERAL};
+		RenderGraphResource pyramid = renderGraph->ImportImage("Depth pyramid", DepthPyramid::format, depthPyramid->GetExtent(), pyramidState, VK_IMAGE_LAYOUT_GENERAL);
+		renderGraph->BindImportedImage(pyramid, depthPyramid->GetImage(), depthPyramid->GetImageView());
+
+		// Without mesh shaders the clusters are culled into indirect draws ahead of the scene
+		if (!device->meshShaderEnabled)
+		{
+			renderGraph->AddPass("Cluster cull")
+				.ReadTexture(pyramid, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT)
+				.SetSideEffects()
+				.SetExecute([this](VkCommandBuffer commandBuffer, VkExtent2D)
+				{
+					pipeline->RecordClusterCulling(commandBuffer, currentFrame, currentPacket->meshes, currentPacket->drawList, camera.get(), occlusionDescriptorSet);
+				});
+		}
+
+		RenderGraphPass& scenePass = renderGraph->AddPass("Scene")
+			.WriteColor(backbuffer, true)
+			.WriteDepth(depth, true)
+			.SetExecute([this](VkCommandBuffer commandBuffer, VkExtent2D extent)
+			{
+				pipeline->RecordCommandBuffer(commandBuffer, extent, currentFrame, currentPacket->meshes, currentPacket->drawList, camera.get(), occlusionDescriptorSet, currentPacket->ui.Get());
+			});
+
+		// The task shader tests clusters against the previous frame's pyramid
+		if (device->meshShaderEnabled)
+			scenePass.ReadTexture(pyramid, VK_PIPELINE_STAGE_2_TASK_SHADER_BIT_EXT);
+
+		renderGraph->AddPass("Depth pyramid")
+			.ReadTexture(depth, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT)
+			.WriteStorage(pyramid)
+			.SetExecute([this, depth](VkCommandBuffer commandBuffer, VkExtent2D)
+			{
+				// Nothing culls against it next frame, skip the reduction
+				if (currentPacket->drawList.GetClustered().empty())
+				{
+					depthPyramid->Invalidate();
+					return;
+				}
+
+				glm::mat4 viewProjection = currentPacket->cameraUniforms.proj * currentPacket->cameraUniforms.view;
+				depthPyramid->Record(commandBuffer, renderGraph->GetImageView(depth), viewProjection, frameDescriptorAllocators[currentFrame].get());
+			});
+
+		// Only copy frames back to the host when something consumes them
+		if (offscreenTarget && (!settings.outputDirectory.empty() || settings.onFrameReadback))
+		{
+			renderGraph->AddPass("Readback")
+				.ReadTransfer(backbuffer)
+				.SetSideEffects()
+				.SetExecute([this](VkCommandBuffer commandBuffer, VkExtent2D)
+				{
+					offscreenTarget->RecordReadback(commandBuffer);
+				});
+		}
+
+		renderGraph->Compile();
+	}
+
+	VkExtent2D Engine::GetRenderExtent() const
+	{
+		return offscreenTarget ? offscreenTarget->extent : swapChain->extent;
+	}
+
+	bool Engine::BeginCommandBuffer(VkCommandBuffer commandBuffer)
+	{
+		VkCommandBufferBeginInfo beginInfo{};
+		beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+		beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+		beginInfo.pInheritanceInfo = nullptr;
+
+		if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS)
+		{
+			std::cerr << "Failed to begin recording command buffer" << std::endl;
+			return false;
+		}
+		return true;
+	}
+
+	bool Engine::EndCommandBuffer(VkCommandBuffer commandBuffer)
+	{
+		if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS)
+		{
+			std::cerr << "Failed to record command buffer" << std::endl;
+			return false;
+		}
+		return true;
+	}
+
+	void Engine::RequestRedraw()
+	{
+		if (framePacer)
+			framePacer->RequestRedraw();
+	}
+
+	bool Engine::SceneChanged()
+	{
+		bool changed = camera->transform != lastCameraTransform || camera->fov != lastCameraFov || meshes.size() != lastMeshTransforms.size();
+
+		lastCameraTransform = camera->transform;
+		lastCameraFov = camera->fov;
+		lastMeshTransforms.resize(meshes.size());
+
+		for (size_t i = 0; i < meshes.size(); i++)
+		{
+			if (meshes[i]->transform != lastMeshTransforms[i])
+			{
+				changed = true;
+				lastMeshTransforms[i] = meshes[i]->transform;
+			}
+		}
+
+		return changed;
+	}
+
+	void Engine::SetFramesInFlight(int count)
+	{
+		count = std::clamp(count, VulkanConfig::MIN_SUPPORTED_FRAMES_IN_FLIGHT, VulkanConfig::MAX_SUPPORTED_FRAMES_IN_FLIGHT);
+		sync->requestedFramesInFlight = count;
+
+		if (count == VulkanConfig::MAX_FRAMES_IN_FLIGHT)
+			return;
+
+		// Every per-frame resource below is used by the render thread
+		if (renderThread)
+			renderThread->WaitIdle();
+
+		vkDeviceWaitIdle(device->GetLogical());
+
+		VulkanConfig::MAX_FRAMES_IN_FLIGHT = count;
+
+		device->RecreateCommandBuffers();
+
+		sync->CleanupSyncObjects();
+		sync->CreateSyncObjects(swapChain ? swapChain->GetImageCount() : 1);
+
+		profiler->RecreateFrameResources(count);
+
+		frameDescriptorAllocators.clear();
+		for (int i = 0; i < VulkanConfig::MAX_FRAMES_IN_FLIGHT; i++)
+		{
+			frameDescriptorAllocators.push_back(std::make_unique<VulkanDescriptorAllocator>(device.get(), 16));
+		}
+
+		// Every cached set references a per-frame uniform buffer that is about to be replaced
+		descriptorAllocator->ResetPools();
+
+		camera->RecreateFrameResources(descriptorAllocator.get());
+		for (std::unique_ptr<Mesh>& mesh : meshes)
+		{
+			mesh->RecreateFrameResources(descriptorAllocator.get());
+		}
+
+		currentFrame = 0;
 	}
 
-	void Engine::DrawFrame()
+	void Engine::BuildFramePacket(FramePacket& packet, VkExtent2D framebufferExtent)
 	{
-		vkWaitForFences(device->GetLogical(), 1, &sync->inFlightFences[currentFrame], VK_TRUE, UINT64_MAX);
+		ProfileScope scope(profiler.get(), "Build frame packet");
+
+		packet.framebufferExtent = framebufferExtent;
+		packet.presentMode = framePacer->requestedPresentMode;
+		packet.inputTime = framePacer->GetInputTime();
+
+		packet.cameraUniforms = camera->BuildUniformData(framebufferExtent);
+
+		// Levels of detail are picked by their error in pixels at the packet's resolution
+		float pixelsPerUnit = camera->GetPixelsPerUnit(framebufferExtent);
+
+		UpdateHlods();
+
+		packet.meshes.clear();
+		packet.meshUniforms.clear();
+		packet.meshLods.clear();
+		packet.meshScreenSizes.clear();
+		for (std::unique_ptr<Mesh>& mesh : meshes)
+		{
+			if (mesh->hidden)
+				continue;
+
+			packet.meshes.push_back(mesh.get());
+			packet.meshUniforms.push_back(mesh->BuildUniformData());
+
+			uint32_t lod = pipeline->lodErrorThreshold > 0.0f ? mesh->SelectLod(packet.meshUniforms.back().model, camera->transform.position, pixelsPerUnit, pipeline->lodErrorThreshold) : 0;
+			packet.meshLods.push_back(lod);
+			packet.meshScreenSizes.push_back(mesh->GetScreenSize(packet.meshUniforms.back().model, camera->transform.position, pixelsPerUnit));
+		}
+
+		{
+			ProfileScope sortScope(profiler.get(), "Sort draws");
+			packet.drawList.Build(packet.meshes, packet.meshUniforms, packet.meshLods, packet.cameraUniforms, pipeline->depthPrepass, pipeline->clusterCulling);
+		}
+
+		if (imGuiOverlay)
+		{
+			pipeline->BuildUI(camera.get(), meshes);
+			imGuiOverlay->Render(packet.ui);
+		}
+		else
+		{
+			packet.ui.Clear();
+		}
+	}
+
+	void Engine::UpdateHlods()
+	{
+		for (HlodGroup& group : hlodGroups)
+		{
+			// Measured to the nearest point of the group, a camera inside it always sees the members
+			float distance = glm::length(group.center - camera->transform.position) - group.radius;
+			float threshold = group.useProxy ? pipeline->hlodDistance * HlodHysteresis : pipeline->hlodDistance;
+
+			group.useProxy = pipeline->hlodDistance > 0.0f && distance > threshold;
+
+			group.proxy->hidden = !group.useProxy;
+			for (Mesh* member : group.members)
+			{
+				member->hidden = group.useProxy;
+			}
+		}
+	}
+
+	void Engine::PrepareClusterCulling(FramePacket& packet)
+	{
+		packet.cameraUniforms.occlusionViewProj = depthPyramid->GetViewProjection();
+		packet.cameraUniforms.cullFlags = glm::uvec4(depthPyramid->IsValid() ? 1 : 0, 0, 0, 0);
+
+		// The render graph moves the pyramid to the shader read only layout before any pass culls against it
+		std::vector<DescriptorBinding> bindings =
+		{
+			DescriptorBinding::Image(0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, depthPyramid->GetImageView(), depthPyramid->GetSampler(), VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL)
+		};
+
+		occlusionDescriptorSet = frameDescriptorAllocators[currentFrame]->GetOrCreate(pipeline->GetOcclusionDescriptorSetLayout(), bindings);
+		if (occlusionDescriptorSet == VK_NULL_HANDLE)
+		{
+			std::cerr << "Failed to allocate occlusion descriptor set" << std::endl;
+		}
+	}
+
+	void Engine::WriteUniformBuffers(const FramePacket& packet)
+	{
+		ProfileScope scope(profiler.get(), "Update uniforms");
+
+		camera->WriteUniformBuffer(currentFrame, packet.cameraUniforms);
+
+		for (size_t i = 0; i < packet.meshes.size(); i++)
+		{
+			packet.meshes[i]->WriteUniformBuffer(currentFrame, packet.meshUniforms[i]);
+		}
+	}
+
+	void Engine::StreamTextures(VkCommandBuffer commandBuffer, const FramePacket& packet)
+	{
+		ProfileScope scope(profiler.get(), "Stream textures");
+
+		if (textureStreamer)
+		{
+			for (size_t i = 0; i < packet.meshes.size(); i++)
+			{
+				packet.meshes[i]->RequestTextureMips(textureStreamer.get(), packet.meshScreenSizes[i]);
+			}
+
+			textureStreamer->Update(commandBuffer);
+		}
+
+		// The frame slot is idle, so its descriptor sets can be rewritten
+		for (Mesh* mesh : packet.meshes)
+		{
+			mesh->UpdateDescriptorSet(currentFrame);
+		}
+	}
+
+	void Engine::WaitForSubmittedUploads()
+	{
+		uint64_t uploadValue = device->GetSubmittedUploadValue();
+		if (uploadValue > 0)
+			sync->AddTimelineWait(device->GetUploadTimeline(), uploadValue, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT);
+	}
+
+	void Engine::DrawFrame(FramePacket& packet)
+	{
+		swapChain->framebufferExtent = packet.framebufferExtent;
+
+		// Present modes are fixed at swap chain creation, a change from the UI recreates it
+		if (packet.presentMode != swapChain->preferredPresentMode)
+		{
+			swapChain->preferredPresentMode = packet.presentMode;
+			RecreateSwapChain();
+		}
+
+		framePacer->PollPresents(swapChain->Get());
+
+		profiler->BeginFrame(currentFrame);
+
+		{
+			ProfileScope scope(profiler.get(), "Wait for frame slot");
+			sync->WaitForFrameSlot(currentFrame);
+		}
+
+		// Swap chains and graph resources replaced by a resize are freed once their last frame completes
+		sync->ReleaseRetired();
+		device->ReleaseCompletedUploads();
+
+		// GPU is done with this frame's transient descriptor sets, recycle its pools
+		frameDescriptorAllocators[currentFrame]->ResetPools();
+
+		auto acquireStart = std::chrono::steady_clock::now();
 
 		uint32_t imageIndex;
-		VkResult result = vkAcquireNextImageKHR(device->GetLogical(), swapChain->Get(), UINT64_MAX, sync->imageAvailableSemaphores[currentFrame], VK_NULL_HANDLE, &imageIndex);
-		if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR || framebufferResized)
+		VkResult result;
+		{
+			ProfileScope scope(profiler.get(), "Acquire");
+			result = vkAcquireNextImageKHR(device->GetLogical(), swapChain->Get(), UINT64_MAX, sync->imageAvailableSemaphores[currentFrame], VK_NULL_HANDLE, &imageIndex);
+		}
+		// A failed acquire signals nothing. A suboptimal image has signalled the acquire semaphore, so it is still
+		// drawn and presented to consume that signal, and the swap chain is recreated after the present.
+		if (result == VK_ERROR_OUT_OF_DATE_KHR)
 		{
 			framebufferResized = false;
 			RecreateSwapChain();
 			return;
 		}
-		else if (result != VK_SUCCESS)
+		else if (result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR)
 		{
 			std::cerr << "Failed to acquire swap chain image" << std::endl;
 			return;
 		}
-		
-		camera->UpdateUniformBuffer(currentFrame, swapChain->extent);
 
-		for (std::unique_ptr<Mesh>& mesh : meshes)
+		bool acquiredSuboptimal = result == VK_SUBOPTIMAL_KHR;
+
+		std::chrono::duration<double, std::milli> acquireTime = std::chrono::steady_clock::now() - acquireStart;
+		FrameTimings::Smooth(sync->timings.acquireMs, acquireTime.count());
+
+		PrepareClusterCulling(packet);
+		WriteUniformBuffers(packet);
+
+		VkCommandBuffer commandBuffer = device->commandBuffers[currentFrame];
+		if (!BeginCommandBuffer(commandBuffer))
+			return;
+
 		{
-			mesh->UpdateUniformBuffer(currentFrame, swapChain->extent);
-		}
+			ProfileScope scope(profiler.get(), "Record");
+
+			profiler->RecordQueryReset(commandBuffer);
+			profiler->BeginGpuScope(commandBuffer, "Frame");
 
-		pipeline->RecordCommandBuffer(device->commandBuffers[currentFrame], imageIndex, currentFrame, meshes, camera.get());
+			StreamTextures(commandBuffer, packet);
 
-		vkResetFences(device->GetLogical(), 1, &sync->inFlightFences[currentFrame]);
+			renderGraph->BindImportedImage(backbuffer, swapChain->GetImage(imageIndex), swapChain->GetImageView(imageIndex));
 
-		VkSubmitInfo submitInfo{};
-		submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+			currentPacket = &packet;
+			renderGraph->Execute(commandBuffer);
+			currentPacket = nullptr;
 
-		VkSemaphore waitSemaphores[] = { sync->imageAvailableSemaphores[currentFrame] };
-		VkPipelineStageFlags waitStages[] = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT };
-		submitInfo.waitSemaphoreCount = 1;
-		submitInfo.pWaitSemaphores = waitSemaphores;
-		submitInfo.pWaitDstStageMask = waitStages;
-		submitInfo.commandBufferCount = 1;
-		submitInfo.pCommandBuffers = &device->commandBuffers[currentFrame];
+			profiler->EndGpuScope(commandBuffer);
+		}
 
-		VkSemaphore signalSemaphores[] = { sync->renderFinishedSemaphores[currentFrame] };
-		submitInfo.signalSemaphoreCount = 1;
-		submitInfo.pSignalSemaphores = signalSemaphores;
+		if (!EndCommandBuffer(commandBuffer))
+			return;
 
-		if (vkQueueSubmit(device->graphicsQueue, 1, &submitInfo, sync->inFlightFences[currentFrame]) != VK_SUCCESS)
 		{
-			std::cerr << "Failed to submit draw command buffer" << std::endl;
-			return;
+			ProfileScope scope(profiler.get(), "Submit");
+			std::lock_guard<std::mutex> lock(device->queueMutex);
+
+			WaitForSubmittedUploads();
+
+			if (sync->SubmitFrame(device->graphicsQueue, commandBuffer, currentFrame, sync->imageAvailableSemaphores[currentFrame], sync->renderFinishedSemaphores[imageIndex]) != VK_SUCCESS)
+			{
+				std::cerr << "Failed to submit draw command buffer" << std::endl;
+				return;
+			}
 		}
 
+		VkSemaphore signalSemaphores[] = { sync->renderFinishedSemaphores[imageIndex] };
+
 		VkPresentInfoKHR presentInfo{};
 		presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
 		presentInfo.waitSemaphoreCount = 1;
@@ -169,8 +768,31 @@ namespace VulkanRenderer
 		presentInfo.pImageIndices = &imageIndex;
 		presentInfo.pResults = nullptr;
 
-		result = vkQueuePresentKHR(device->presentQueue, &presentInfo);
-		if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR || framebufferResized)
+		// Tagging the present lets a later frame find out when it reached the display
+		uint64_t presentId = framePacer->BeginPresent(packet.inputTime);
+
+		VkPresentIdKHR presentIdInfo{};
+		presentIdInfo.sType = VK_STRUCTURE_TYPE_PRESENT_ID_KHR;
+		presentIdInfo.swapchainCount = 1;
+		presentIdInfo.pPresentIds = &presentId;
+
+		if (presentId != 0)
+			presentInfo.pNext = &presentIdInfo;
+
+		auto presentStart = std::chrono::steady_clock::now();
+
+		{
+			ProfileScope scope(profiler.get(), "Present");
+			std::lock_guard<std::mutex> lock(device->queueMutex);
+			result = vkQueuePresentKHR(device->presentQueue, &presentInfo);
+		}
+
+		std::chrono::duration<double, std::milli> presentTime = std::chrono::steady_clock::now() - presentStart;
+		FrameTimings::Smooth(sync->timings.presentMs, presentTime.count());
+		sync->MarkPresented();
+		framePacer->EndPresent(presentId, packet.inputTime);
+
+		if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR || acquiredSuboptimal || framebufferResized)
 		{
 			framebufferResized = false;
 			RecreateSwapChain();
@@ -180,28 +802,118 @@ namespace VulkanRenderer
 			std::cerr << "Failed to present swap chain image" << std::endl;
 		}
 
+		sync->PublishTimings();
+		profiler->EndFrame();
+
+		frameNumber++;
 		currentFrame = (currentFrame + 1) % VulkanConfig::MAX_FRAMES_IN_FLIGHT;
 	}
-	
-	void Engine::RecreateSwapChain()
+
+	void Engine::DrawOffscreenFrame(FramePacket& packet)
 	{
-		int width = 0, height = 0;
-		glfwWindow->GetFramebufferSize(&width, &height);
+		if (sync->requestedFramesInFlight != VulkanConfig::MAX_FRAMES_IN_FLIGHT)
+			SetFramesInFlight(sync->requestedFramesInFlight);
+
+		profiler->BeginFrame(currentFrame);
 
-		while (width == 0 || height == 0)
 		{
-			glfwWindow->GetFramebufferSize(&width, &height);
-			glfwWaitEvents();
+			ProfileScope scope(profiler.get(), "Wait for frame slot");
+			sync->WaitForFrameSlot(currentFrame);
 		}
 
-		vkDeviceWaitIdle(device->GetLogical());
+		// Streamed texture images and staging replaced in earlier frames are freed once those frames complete
+		sync->ReleaseRetired();
+		device->ReleaseCompletedUploads();
 
-		swapChain->CleanupSwapChain();
-		sync->CleanupSyncObjects();
+		frameDescriptorAllocators[currentFrame]->ResetPools();
+
+		PrepareClusterCulling(packet);
+		WriteUniformBuffers(packet);
+
+		VkCommandBuffer commandBuffer = device->commandBuffers[currentFrame];
+		if (!BeginCommandBuffer(commandBuffer))
+			return;
+
+		{
+			ProfileScope scope(profiler.get(), "Record");
+
+			profiler->RecordQueryReset(commandBuffer);
+			profiler->BeginGpuScope(commandBuffer, "Frame");
+
+			StreamTextures(commandBuffer, packet);
+
+			currentPacket = &packet;
+			renderGraph->Execute(commandBuffer);
+			currentPacket = nullptr;
+
+			profiler->EndGpuScope(commandBuffer);
+		}
+
+		if (!EndCommandBuffer(commandBuffer))
+			return;
+
+		{
+			ProfileScope scope(profiler.get(), "Submit");
+			std::lock_guard<std::mutex> lock(device->queueMutex);
+
+			WaitForSubmittedUploads();
+
+			if (sync->SubmitFrame(device->graphicsQueue, commandBuffer, currentFrame, VK_NULL_HANDLE, VK_NULL_HANDLE) != VK_SUCCESS)
+			{
+				std::cerr << "Failed to submit draw command buffer" << std::endl;
+				return;
+			}
+		}
+
+		{
+			ProfileScope scope(profiler.get(), "Readback");
+			ReadbackFrame();
+		}
+
+		sync->MarkPresented();
+		sync->PublishTimings();
+		profiler->EndFrame();
+
+		frameNumber++;
+		currentFrame = (currentFrame + 1) % VulkanConfig::MAX_FRAMES_IN_FLIGHT;
+	}
+
+	void Engine::ReadbackFrame()
+	{
+		// Frames only stall on the GPU when someone consumes the pixels
+		if (settings.outputDirectory.empty() && !settings.onFrameReadback)
+			return;
+
+		sync->WaitForAllFrames();
+
+		const std::vector<uint8_t>& pixels = offscreenTarget->ReadPixels();
+		VkExtent2D extent = offscreenTarget->extent;
+
+		if (settings.onFrameReadback)
+			settings.onFrameReadback(frameNumber, pixels, extent.width, extent.height);
+
+		if (!settings.outputDirectory.empty())
+		{
+			char fileName[32];
+			snprintf(fileName, sizeof(fileName), "frame_%04u.png", frameNumber);
+
+			WritePng(settings.outputDirectory + "/" + fileName, extent.width, extent.height, pixels.data());
+		}
+	}
+	
+	void Engine::RecreateSwapChain()
+	{
+		// No idle wait: frames in flight keep the old swap chain, graph images and present semaphores alive
+		// until they complete, the new ones are used from the next frame on. The main thread stops sending
+		// packets while the window is minimized, a surface that still has no area is retried next frame.
+		if (!swapChain->RecreateSwapChain(sync.get()))
+		{
+			framebufferResized = true;
+			return;
+		}
 
-		swapChain->CreateSwapChain();
-		swapChain->CreateDepthResources();
-		swapChain->CreateFramebuffers(renderPass->Get());
-		sync->CreateSyncObjects();
+		framePacer->DropPendingPresents();
+		BuildRenderGraph();
+		sync->RecreateSwapChainSemaphores(swapChain->GetImageCount());
 	}
 }
\ No newline at end of file
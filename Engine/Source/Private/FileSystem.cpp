@@ -0,0 +1,107 @@
+#include <FileSystem.h>
+
+#include <iostream>
+#include <algorithm>
+#include <filesystem>
+
+#include <Pak.h>
+
+namespace VulkanRenderer
+{
+	namespace
+	{
+		std::vector<std::unique_ptr<PakFile>> mountedPaks;
+	}
+
+	const uint8_t* FileData::GetData() const
+	{
+		return data;
+	}
+
+	size_t FileData::GetSize() const
+	{
+		return size;
+	}
+
+	void FileData::SetView(const uint8_t* viewData, size_t viewSize)
+	{
+		Reset();
+		data = viewData;
+		size = viewSize;
+	}
+
+	bool FileData::Map(const std::string& path)
+	{
+		Reset();
+		if (!mappedFile.Open(path))
+			return false;
+
+		data = mappedFile.GetData();
+		size = mappedFile.GetSize();
+		return true;
+	}
+
+	uint8_t* FileData::Allocate(size_t bufferSize)
+	{
+		Reset();
+
+		// Left uninitialized, the caller overwrites all of it
+		buffer.reset(new uint8_t[bufferSize]);
+		data = buffer.get();
+		size = bufferSize;
+		return buffer.get();
+	}
+
+	void FileData::Truncate(size_t newSize)
+	{
+		size = newSize < size ? newSize : size;
+	}
+
+	void FileData::Reset()
+	{
+		mappedFile.Close();
+		buffer.reset();
+		data = nullptr;
+		size = 0;
+	}
+
+	namespace FileSystem
+	{
+		bool MountPak(const std::string& path)
+		{
+			std::unique_ptr<PakFile> pak = std::make_unique<PakFile>();
+			if (!pak->Open(path))
+				return false;
+
+			std::cout << "Mounted " << path << " with " << pak->GetEntryCount() << " files" << std::endl;
+			mountedPaks.push_back(std::move(pak));
+			return true;
+		}
+
+		void UnmountAll()
+		{
+			mountedPaks.clear();
+		}
+
+		bool ReadFile(const std::string& path, FileData& data)
+		{
+			std::string normalizedPath = NormalizePath(path);
+			for (auto pak = mountedPaks.rbegin(); pak != mountedPaks.rend(); ++pak)
+			{
+				if (const PakEntry* entry = (*pak)->Find(normalizedPath))
+					return (*pak)->Read(*entry, data);
+			}
+
+			return data.Map(path);
+		}
+
+		std::string NormalizePath(const std::string& path)
+		{
+			// Backslashes are only separators on Windows, paks are the same everywhere
+			std::string generic = path;
+			std::replace(generic.begin(), generic.end(), '\\', '/');
+
+			return std::filesystem::path(generic).lexically_normal().generic_string();
+		}
+	}
+}
\ No newline at end of file
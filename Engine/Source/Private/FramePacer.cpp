@@ -0,0 +1,196 @@
+#include <FramePacer.h>
+
+#include <thread>
+
+#include <GLFW/glfw3.h>
+
+#include <imgui.h>
+
+#include <VulkanDevice.h>
+#include <VulkanSync.h>
+
+using namespace VulkanRenderer;
+
+namespace
+{
+	// OS sleeps overshoot by up to a scheduler tick, the last stretch before a deadline is spun instead
+	constexpr std::chrono::microseconds spinThreshold(2000);
+
+	// Bounds the pending ids when presents never complete, e.g. while the window is minimized
+	constexpr size_t maxPendingPresents = 16;
+
+	// ImGui needs a couple of frames after an event for hover states and layout to settle
+	constexpr uint32_t redrawSettleFrames = 3;
+
+	constexpr double idleWaitSeconds = 0.25;
+
+	struct PresentModeName
+	{
+		VkPresentModeKHR mode;
+		const char* name;
+	};
+
+	constexpr PresentModeName presentModeNames[] =
+	{
+		{VK_PRESENT_MODE_IMMEDIATE_KHR, "Immediate"},
+		{VK_PRESENT_MODE_MAILBOX_KHR, "Mailbox"},
+		{VK_PRESENT_MODE_FIFO_KHR, "FIFO"},
+		{VK_PRESENT_MODE_FIFO_RELAXED_KHR, "FIFO relaxed"}
+	};
+
+	// Null for modes the pacer does not offer, e.g. the shared refresh modes
+	const char* GetPresentModeName(VkPresentModeKHR mode)
+	{
+		for (const PresentModeName& entry : presentModeNames)
+		{
+			if (entry.mode == mode)
+				return entry.name;
+		}
+		return nullptr;
+	}
+}
+
+FramePacer::FramePacer(VulkanDevice* device)
+	: device(device)
+{
+	nextFrameTime = std::chrono::steady_clock::now();
+	inputTime = nextFrameTime;
+}
+
+void FramePacer::WaitForNextFrame()
+{
+	auto now = std::chrono::steady_clock::now();
+
+	if (targetFps <= 0.0f)
+	{
+		nextFrameTime = now;
+		return;
+	}
+
+	auto framePeriod = std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(1.0 / targetFps));
+
+	// A frame that ran long starts a new schedule instead of rushing the following frames to catch up
+	if (now - nextFrameTime > framePeriod)
+		nextFrameTime = now;
+
+	if (nextFrameTime - now > spinThreshold)
+		std::this_thread::sleep_for(nextFrameTime - now - spinThreshold);
+
+	while (std::chrono::steady_clock::now() < nextFrameTime)
+		std::this_thread::yield();
+
+	nextFrameTime += framePeriod;
+}
+
+void FramePacer::MarkInputSampled()
+{
+	inputTime = std::chrono::steady_clock::now();
+}
+
+std::chrono::steady_clock::time_point FramePacer::GetInputTime() const
+{
+	return inputTime;
+}
+
+uint64_t FramePacer::BeginPresent(std::chrono::steady_clock::time_point frameInputTime)
+{
+	if (!device->presentWaitEnabled)
+		return 0;
+
+	if (pendingPresents.size() >= maxPendingPresents)
+		pendingPresents.pop_front();
+
+	uint64_t presentId = nextPresentId++;
+	pendingPresents.push_back({presentId, frameInputTime});
+	return presentId;
+}
+
+void FramePacer::EndPresent(uint64_t presentId, std::chrono::steady_clock::time_point frameInputTime)
+{
+	// Without present wait the best CPU-side estimate ends when the present call returns
+	if (presentId == 0)
+		AddLatencySample(frameInputTime);
+}
+
+void FramePacer::AddLatencySample(std::chrono::steady_clock::time_point frameInputTime)
+{
+	std::chrono::duration<double, std::milli> latency = std::chrono::steady_clock::now() - frameInputTime;
+
+	double smoothed = latencyMs;
+	FrameTimings::Smooth(smoothed, latency.count());
+	latencyMs = smoothed;
+}
+
+void FramePacer::PollPresents(VkSwapchainKHR swapChain)
+{
+	while (!pendingPresents.empty())
+	{
+		const PendingPresent& pending = pendingPresents.front();
+
+		// A zero timeout only checks, present ids complete in order so the first pending one gates the rest
+		VkResult result = vkWaitForPresentKHR(device->GetLogical(), swapChain, pending.presentId, 0);
+		if (result == VK_TIMEOUT)
+			return;
+
+		if (result != VK_SUCCESS)
+		{
+			pendingPresents.clear();
+			return;
+		}
+
+		AddLatencySample(pending.inputTime);
+		pendingPresents.pop_front();
+	}
+}
+
+void FramePacer::DropPendingPresents()
+{
+	pendingPresents.clear();
+}
+
+void FramePacer::PollEvents()
+{
+	if (renderOnDemand && pendingRedrawFrames == 0)
+		glfwWaitEventsTimeout(idleWaitSeconds);
+	else
+		glfwPollEvents();
+}
+
+void FramePacer::RequestRedraw()
+{
+	pendingRedrawFrames = redrawSettleFrames;
+}
+
+bool FramePacer::ShouldDrawFrame()
+{
+	if (!renderOnDemand)
+		return true;
+
+	if (pendingRedrawFrames == 0)
+		return false;
+
+	pendingRedrawFrames--;
+	return true;
+}
+
+void FramePacer::DrawImGui()
+{
+	ImGui::Text("Input to present: %.2f ms (%s)", latencyMs.load(), device->presentWaitEnabled ? "present wait" : "CPU estimate");
+
+	const char* currentName = GetPresentModeName(requestedPresentMode);
+	if (ImGui::BeginCombo("Present mode", currentName ? currentName : "Other"))
+	{
+		for (VkPresentModeKHR mode : supportedPresentModes)
+		{
+			const char* name = GetPresentModeName(mode);
+			if (name && ImGui::Selectable(name, mode == requestedPresentMode))
+				requestedPresentMode = mode;
+		}
+		ImGui::EndCombo();
+	}
+
+	// 0 renders as fast as the present mode allows
+	ImGui::SliderFloat("FPS limit", &targetFps, 0.0f, 240.0f, targetFps > 0.0f ? "%.0f" : "Off");
+
+	ImGui::Checkbox("Render on demand", &renderOnDemand);
+}
\ No newline at end of file
@@ -13,6 +13,12 @@ GlfwWindow::GlfwWindow(Engine* engine)
 	window = glfwCreateWindow(1280, 720, "Vulkan Test", nullptr, nullptr);
 	glfwSetWindowUserPointer(window, engine);
 	glfwSetFramebufferSizeCallback(window, FramebufferResizeCallback);
+	glfwSetCursorPosCallback(window, CursorPosCallback);
+	glfwSetMouseButtonCallback(window, MouseButtonCallback);
+	glfwSetScrollCallback(window, ScrollCallback);
+	glfwSetKeyCallback(window, KeyCallback);
+	glfwSetCharCallback(window, CharCallback);
+	glfwSetWindowRefreshCallback(window, WindowRefreshCallback);
 }
 
 GlfwWindow::~GlfwWindow()
@@ -35,4 +41,41 @@ void GlfwWindow::FramebufferResizeCallback(GLFWwindow* window, int width, int he
 {
 	Engine* engine = reinterpret_cast<Engine*>(glfwGetWindowUserPointer(window));
 	engine->framebufferResized = true;
+	engine->RequestRedraw();
+}
+
+void GlfwWindow::CursorPosCallback(GLFWwindow* window, double, double)
+{
+	RequestRedraw(window);
+}
+
+void GlfwWindow::MouseButtonCallback(GLFWwindow* window, int, int, int)
+{
+	RequestRedraw(window);
+}
+
+void GlfwWindow::ScrollCallback(GLFWwindow* window, double, double)
+{
+	RequestRedraw(window);
+}
+
+void GlfwWindow::KeyCallback(GLFWwindow* window, int, int, int, int)
+{
+	RequestRedraw(window);
+}
+
+void GlfwWindow::CharCallback(GLFWwindow* window, unsigned int)
+{
+	RequestRedraw(window);
+}
+
+void GlfwWindow::WindowRefreshCallback(GLFWwindow* window)
+{
+	RequestRedraw(window);
+}
+
+void GlfwWindow::RequestRedraw(GLFWwindow* window)
+{
+	Engine* engine = reinterpret_cast<Engine*>(glfwGetWindowUserPointer(window));
+	engine->RequestRedraw();
 }
\ No newline at end of file
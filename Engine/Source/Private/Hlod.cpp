@@ -0,0 +1,231 @@
+#include <Hlod.h>
+
+#include <iostream>
+#include <algorithm>
+#include <cmath>
+#include <cfloat>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <tuple>
+
+#include <stb_image.h>
+
+#include <ImageWriter.h>
+#include <FileSystem.h>
+
+namespace VulkanRenderer
+{
+	namespace
+	{
+		struct Image
+		{
+			uint32_t width = 0;
+			uint32_t height = 0;
+			std::vector<uint8_t> pixels;
+		};
+
+		// Flipped like VulkanTexture loads it, so rows run bottom to top the way they are sampled
+		Image LoadImage(const std::string& path)
+		{
+			stbi_set_flip_vertically_on_load(true);
+
+			Image image;
+			FileData file;
+			int width, height, channels;
+			stbi_uc* pixels = FileSystem::ReadFile(path, file) ? stbi_load_from_memory(file.GetData(), static_cast<int>(file.GetSize()), &width, &height, &channels, STBI_rgb_alpha) : nullptr;
+			if (!pixels)
+			{
+				std::cerr << "Failed to load HLOD source texture: " << path << std::endl;
+				return image;
+			}
+
+			image.width = static_cast<uint32_t>(width);
+			image.height = static_cast<uint32_t>(height);
+			image.pixels.assign(pixels, pixels + static_cast<size_t>(width) * height * 4);
+
+			stbi_image_free(pixels);
+			return image;
+		}
+
+		// Box filters the image into a square tile of the atlas, an image that failed to load leaves the tile grey
+		void ResampleIntoTile(const Image& image, std::vector<uint8_t>& atlas, uint32_t atlasWidth, uint32_t tileX, uint32_t tileY, uint32_t tileSize, bool opaque)
+		{
+			for (uint32_t y = 0; y < tileSize; y++)
+			{
+				for (uint32_t x = 0; x < tileSize; x++)
+				{
+					uint8_t* texel = &atlas[(static_cast<size_t>(tileY + y) * atlasWidth + tileX + x) * 4];
+
+					if (image.pixels.empty())
+					{
+						memset(texel, 128, 4);
+						texel[3] = 255;
+						continue;
+					}
+
+					// Every source texel the tile texel covers, at least one when magnifying
+					uint32_t y0 = y * image.height / tileSize;
+					uint32_t y1 = std::max(y0 + 1, (y + 1) * image.height / tileSize);
+					uint32_t x0 = x * image.width / tileSize;
+					uint32_t x1 = std::max(x0 + 1, (x + 1) * image.width / tileSize);
+
+					uint32_t sum[4] = {};
+					for (uint32_t sy = y0; sy < y1; sy++)
+					{
+						const uint8_t* row = &image.pixels[static_cast<size_t>(sy) * image.width * 4];
+						for (uint32_t sx = x0; sx < x1; sx++)
+						{
+							for (int c = 0; c < 4; c++)
+								sum[c] += row[sx * 4 + c];
+						}
+					}
+
+					uint32_t count = (y1 - y0) * (x1 - x0);
+					for (int c = 0; c < 4; c++)
+						texel[c] = static_cast<uint8_t>((sum[c] + count / 2) / count);
+
+					if (opaque)
+						texel[3] = 255;
+				}
+			}
+		}
+
+		// The atlas rows run bottom to top like loaded textures, PNG rows top to bottom
+		bool WriteAtlas(const std::string& path, uint32_t width, uint32_t height, const std::vector<uint8_t>& pixels)
+		{
+			const size_t rowSize = static_cast<size_t>(width) * 4;
+
+			std::vector<uint8_t> flipped(pixels.size());
+			for (uint32_t y = 0; y < height; y++)
+			{
+				memcpy(&flipped[(height - 1 - y) * rowSize], &pixels[y * rowSize], rowSize);
+			}
+
+			return WritePng(path, width, height, flipped.data());
+		}
+	}
+
+	std::vector<HlodProxy> BuildHlodProxies(const std::vector<StaticMeshSource>& sources, const HlodBuildSettings& settings)
+	{
+		// Ordered so the same scene always yields the same proxies and atlas names
+		std::map<std::tuple<int, int, int>, std::vector<uint32_t>> cells;
+
+		for (uint32_t i = 0; i < sources.size(); i++)
+		{
+			const MeshInfo& info = *sources[i].info;
+
+			// Blended meshes are sorted back to front one by one, merging them would break that order
+			if (info.blendMode == BlendMode::Transparent || info.vertices.empty())
+				continue;
+
+			glm::vec3 boundsMin(FLT_MAX);
+			glm::vec3 boundsMax(-FLT_MAX);
+			for (const Vertex& vertex : info.vertices)
+			{
+				glm::vec3 position = glm::vec3(sources[i].model * glm::vec4(vertex.position, 1.0f));
+				boundsMin = glm::min(boundsMin, position);
+				boundsMax = glm::max(boundsMax, position);
+			}
+
+			// Cells are centered on multiples of the cell size, so a scene laid out around the origin is not split by it
+			glm::ivec3 cell = glm::ivec3(glm::floor((boundsMin + boundsMax) * 0.5f / settings.cellSize + 0.5f));
+			cells[{cell.x, cell.y, cell.z}].push_back(i);
+		}
+
+		std::vector<HlodProxy> proxies;
+
+		for (const auto& [cell, members] : cells)
+		{
+			if (members.size() < std::max(settings.minMeshes, 1u))
+				continue;
+
+			HlodProxy proxy;
+			proxy.sources = members;
+
+			// Meshes sharing a material share its tile
+			std::map<std::string, uint32_t> tileIndices;
+			std::vector<const MeshInfo*> tileMaterials;
+			std::vector<uint32_t> memberTiles;
+
+			for (uint32_t source : members)
+			{
+				const MeshInfo& info = *sources[source].info;
+
+				std::string key = info.baseColorPath + "|" + info.roughnessPath + "|" + info.metallicPath + "|" + std::to_string(static_cast<uint32_t>(info.blendMode));
+				auto [tile, inserted] = tileIndices.emplace(key, static_cast<uint32_t>(tileMaterials.size()));
+				if (inserted)
+					tileMaterials.push_back(&info);
+				memberTiles.push_back(tile->second);
+
+				if (info.blendMode == BlendMode::AlphaTest)
+					proxy.info.blendMode = BlendMode::AlphaTest;
+			}
+
+			const uint32_t tileCount = static_cast<uint32_t>(tileMaterials.size());
+			const uint32_t columns = static_cast<uint32_t>(std::ceil(std::sqrt(static_cast<float>(tileCount))));
+			const uint32_t rows = (tileCount + columns - 1) / columns;
+			const uint32_t tileSize = settings.tileSize;
+			const uint32_t atlasWidth = columns * tileSize;
+			const uint32_t atlasHeight = rows * tileSize;
+
+			char name[64];
+			snprintf(name, sizeof(name), "hlod_%d_%d_%d", std::get<0>(cell), std::get<1>(cell), std::get<2>(cell));
+			std::string basePath = settings.outputDirectory + "/" + name;
+
+			proxy.info.baseColorPath = basePath + "_basecolor.png";
+			proxy.info.roughnessPath = basePath + "_roughness.png";
+			proxy.info.metallicPath = basePath + "_metallic.png";
+
+			const std::string MeshInfo::* texturePaths[] = { &MeshInfo::baseColorPath, &MeshInfo::roughnessPath, &MeshInfo::metallicPath };
+			for (const std::string MeshInfo::* texturePath : texturePaths)
+			{
+				std::vector<uint8_t> atlas(static_cast<size_t>(atlasWidth) * atlasHeight * 4, 0);
+
+				for (uint32_t tile = 0; tile < tileCount; tile++)
+				{
+					const MeshInfo& material = *tileMaterials[tile];
+
+					// Only base color alpha is tested, opaque materials may carry anything in it
+					bool opaque = texturePath != &MeshInfo::baseColorPath || material.blendMode == BlendMode::Opaque;
+					ResampleIntoTile(LoadImage(material.*texturePath), atlas, atlasWidth, (tile % columns) * tileSize, (tile / columns) * tileSize, tileSize, opaque);
+				}
+
+				WriteAtlas(proxy.info.*texturePath, atlasWidth, atlasHeight, atlas);
+			}
+
+			// Texture coordinates stay half a texel inside their tile, so filtering never reads a neighbouring one
+			const float inset = 0.5f / tileSize;
+			const glm::vec2 gridSize(static_cast<float>(columns), static_cast<float>(rows));
+
+			glm::vec3 boundsMin(FLT_MAX);
+			glm::vec3 boundsMax(-FLT_MAX);
+
+			for (size_t m = 0; m < members.size(); m++)
+			{
+				const MeshInfo& info = *sources[members[m]].info;
+				uint32_t baseVertex = AppendTransformedGeometry(info.vertices, info.indices, sources[members[m]].model, proxy.info.vertices, proxy.info.indices);
+
+				glm::vec2 tileOrigin(static_cast<float>(memberTiles[m] % columns), static_cast<float>(memberTiles[m] / columns));
+
+				for (size_t v = baseVertex; v < proxy.info.vertices.size(); v++)
+				{
+					Vertex& merged = proxy.info.vertices[v];
+
+					glm::vec2 texCoord = glm::clamp(merged.texCoord, 0.0f, 1.0f);
+					merged.texCoord = (tileOrigin + inset + texCoord * (1.0f - 2.0f * inset)) / gridSize;
+
+					boundsMin = glm::min(boundsMin, merged.position);
+					boundsMax = glm::max(boundsMax, merged.position);
+				}
+			}
+
+			proxy.center = (boundsMin + boundsMax) * 0.5f;
+			proxy.radius = glm::length(boundsMax - boundsMin) * 0.5f;
+
+			proxies.push_back(std::move(proxy));
+		}
+
+		return proxies;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,117 @@
+#include <ImageWriter.h>
+
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <array>
+#include <algorithm>
+
+namespace VulkanRenderer
+{
+	namespace
+	{
+		uint32_t Crc32(const uint8_t* data, size_t size, uint32_t crc = 0)
+		{
+			static const std::array<uint32_t, 256> table = []()
+			{
+				std::array<uint32_t, 256> result{};
+				for (uint32_t i = 0; i < 256; i++)
+				{
+					uint32_t c = i;
+					for (int k = 0; k < 8; k++)
+						c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+					result[i] = c;
+				}
+				return result;
+			}();
+
+			crc = ~crc;
+			for (size_t i = 0; i < size; i++)
+				crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+			return ~crc;
+		}
+
+		void AppendBigEndian(std::vector<uint8_t>& out, uint32_t value)
+		{
+			out.push_back(static_cast<uint8_t>(value >> 24));
+			out.push_back(static_cast<uint8_t>(value >> 16));
+			out.push_back(static_cast<uint8_t>(value >> 8));
+			out.push_back(static_cast<uint8_t>(value));
+		}
+
+		void AppendChunk(std::vector<uint8_t>& out, const char type[4], const std::vector<uint8_t>& data)
+		{
+			AppendBigEndian(out, static_cast<uint32_t>(data.size()));
+
+			size_t typeOffset = out.size();
+			out.insert(out.end(), type, type + 4);
+			out.insert(out.end(), data.begin(), data.end());
+
+			AppendBigEndian(out, Crc32(out.data() + typeOffset, data.size() + 4));
+		}
+	}
+
+	bool WritePng(const std::string& path, uint32_t width, uint32_t height, const uint8_t* rgbaPixels)
+	{
+		const size_t rowSize = static_cast<size_t>(width) * 4;
+
+		// Each scanline is prefixed with filter type 0 (none)
+		std::vector<uint8_t> raw;
+		raw.reserve((rowSize + 1) * height);
+		for (uint32_t y = 0; y < height; y++)
+		{
+			raw.push_back(0);
+			raw.insert(raw.end(), rgbaPixels + y * rowSize, rgbaPixels + (y + 1) * rowSize);
+		}
+
+		// Zlib stream made of stored (uncompressed) deflate blocks of at most 65535 bytes
+		std::vector<uint8_t> zlib = { 0x78, 0x01 };
+		size_t offset = 0;
+		do
+		{
+			uint16_t blockSize = static_cast<uint16_t>(std::min<size_t>(raw.size() - offset, 65535));
+			bool finalBlock = offset + blockSize == raw.size();
+
+			zlib.push_back(finalBlock ? 1 : 0);
+			zlib.push_back(static_cast<uint8_t>(blockSize));
+			zlib.push_back(static_cast<uint8_t>(blockSize >> 8));
+			zlib.push_back(static_cast<uint8_t>(~blockSize));
+			zlib.push_back(static_cast<uint8_t>(~blockSize >> 8));
+			zlib.insert(zlib.end(), raw.begin() + offset, raw.begin() + offset + blockSize);
+
+			offset += blockSize;
+		} while (offset < raw.size());
+
+		uint32_t a = 1, b = 0;
+		for (uint8_t value : raw)
+		{
+			a = (a + value) % 65521;
+			b = (b + a) % 65521;
+		}
+		AppendBigEndian(zlib, (b << 16) | a);
+
+		std::vector<uint8_t> header;
+		AppendBigEndian(header, width);
+		AppendBigEndian(header, height);
+		header.push_back(8);	// Bit depth
+		header.push_back(6);	// Color type RGBA
+		header.push_back(0);	// Compression
+		header.push_back(0);	// Filter
+		header.push_back(0);	// Interlace
+
+		std::vector<uint8_t> png = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+		AppendChunk(png, "IHDR", header);
+		AppendChunk(png, "IDAT", zlib);
+		AppendChunk(png, "IEND", {});
+
+		std::ofstream file(path, std::ios::binary);
+		if (!file.is_open())
+		{
+			std::cerr << "Failed to open file: " << path << std::endl;
+			return false;
+		}
+
+		file.write(reinterpret_cast<const char*>(png.data()), png.size());
+		return true;
+	}
+}
\ No newline at end of file
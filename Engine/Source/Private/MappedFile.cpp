@@ -0,0 +1,121 @@
+#include <MappedFile.h>
+
+#include <iostream>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace VulkanRenderer
+{
+	MappedFile::~MappedFile()
+	{
+		Close();
+	}
+
+	bool MappedFile::Open(const std::string& path)
+	{
+		Close();
+
+#ifdef _WIN32
+		fileHandle = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+		if (fileHandle == INVALID_HANDLE_VALUE)
+		{
+			fileHandle = nullptr;
+			std::cerr << "Failed to open file: " << path << std::endl;
+			return false;
+		}
+
+		LARGE_INTEGER fileSize;
+		if (!GetFileSizeEx(fileHandle, &fileSize) || fileSize.QuadPart == 0)
+		{
+			std::cerr << "Failed to map empty or unreadable file: " << path << std::endl;
+			Close();
+			return false;
+		}
+
+		mappingHandle = CreateFileMappingA(fileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		void* view = mappingHandle ? MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0) : nullptr;
+		if (!view)
+		{
+			std::cerr << "Failed to map file: " << path << std::endl;
+			Close();
+			return false;
+		}
+
+		data = static_cast<const uint8_t*>(view);
+		size = static_cast<size_t>(fileSize.QuadPart);
+#else
+		fileDescriptor = open(path.c_str(), O_RDONLY);
+		if (fileDescriptor < 0)
+		{
+			std::cerr << "Failed to open file: " << path << std::endl;
+			return false;
+		}
+
+		struct stat fileStat;
+		if (fstat(fileDescriptor, &fileStat) != 0 || fileStat.st_size == 0)
+		{
+			std::cerr << "Failed to map empty or unreadable file: " << path << std::endl;
+			Close();
+			return false;
+		}
+
+		void* view = mmap(nullptr, static_cast<size_t>(fileStat.st_size), PROT_READ, MAP_PRIVATE, fileDescriptor, 0);
+		if (view == MAP_FAILED)
+		{
+			std::cerr << "Failed to map file: " << path << std::endl;
+			Close();
+			return false;
+		}
+
+		// Every section is copied out right away, start reading the whole file ahead
+		madvise(view, static_cast<size_t>(fileStat.st_size), MADV_WILLNEED);
+
+		data = static_cast<const uint8_t*>(view);
+		size = static_cast<size_t>(fileStat.st_size);
+#endif
+		return true;
+	}
+
+	void MappedFile::Close()
+	{
+#ifdef _WIN32
+		if (data)
+			UnmapViewOfFile(data);
+		if (mappingHandle)
+			CloseHandle(mappingHandle);
+		if (fileHandle)
+			CloseHandle(fileHandle);
+
+		mappingHandle = nullptr;
+		fileHandle = nullptr;
+#else
+		if (data)
+			munmap(const_cast<uint8_t*>(data), size);
+		if (fileDescriptor >= 0)
+			close(fileDescriptor);
+
+		fileDescriptor = -1;
+#endif
+		data = nullptr;
+		size = 0;
+	}
+
+	const uint8_t* MappedFile::GetData() const
+	{
+		return data;
+	}
+
+	size_t MappedFile::GetSize() const
+	{
+		return size;
+	}
+}
\ No newline at end of file
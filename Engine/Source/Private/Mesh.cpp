@@ -1,7 +1,10 @@
 #include <Mesh.h>
 
 #include <iostream>
+#include <algorithm>
 #include <chrono>
+#include <functional>
+#include <limits>
 
 #include <stb_image.h>
 
@@ -9,24 +12,53 @@
 #include <VulkanDevice.h>
 #include <VulkanTexture.h>
 #include <VulkanBuffer.h>
-#include <MeshUBO.h>
+#include <VulkanDescriptorAllocator.h>
+#include <CookedMesh.h>
+#include <VulkanUpload.h>
+#include <TextureStreamer.h>
 
 namespace VulkanRenderer
 {
-	Mesh::Mesh(VulkanDevice* device, VkDescriptorSetLayout descriptorSetLayout, const MeshInfo& info)
-		: device(device), descriptorSetLayout(descriptorSetLayout)
-	{
-		baseColorTexture = new VulkanTexture(device, info.baseColorPath);
-		roughnessTexture = new VulkanTexture(device, info.roughnessPath);
-		metallicTexture = new VulkanTexture(device, info.metallicPath);
-		CreateVertexBuffer(info.vertices);
-		CreateIndexBuffer(info.indices);
+	Mesh::Mesh(VulkanDevice* device, VkDescriptorSetLayout descriptorSetLayout, VkDescriptorSetLayout clusterDescriptorSetLayout, const MeshInfo& info, TextureStreamer* textureStreamer)
+		: Mesh(device, descriptorSetLayout, clusterDescriptorSetLayout, CookMesh(info).GetView(), textureStreamer)
+	{
+	}
+
+	Mesh::Mesh(VulkanDevice* device, VkDescriptorSetLayout descriptorSetLayout, VkDescriptorSetLayout clusterDescriptorSetLayout, const CookedMeshView& cooked, TextureStreamer* textureStreamer)
+		: blendMode(cooked.blendMode), optimizationStats(cooked.optimizationStats), device(device), descriptorSetLayout(descriptorSetLayout), clusterDescriptorSetLayout(clusterDescriptorSetLayout),
+		indexType(cooked.indexType), lods(cooked.lods.data, cooked.lods.data + cooked.lods.count), ranges(cooked.ranges.data, cooked.ranges.data + cooked.ranges.count),
+		meshletCount(static_cast<uint32_t>(cooked.meshlets.count)), bounds(cooked.bounds)
+	{
+		materialId = static_cast<uint32_t>(std::hash<std::string>()(cooked.baseColorPath + "|" + cooked.roughnessPath + "|" + cooked.metallicPath));
+
+		baseColorTexture = new VulkanTexture(device, cooked.baseColorPath, textureStreamer);
+		roughnessTexture = new VulkanTexture(device, cooked.roughnessPath, textureStreamer);
+		metallicTexture = new VulkanTexture(device, cooked.metallicPath, textureStreamer);
+
+		// Mesh shaders fetch meshlet vertices from a storage buffer instead of the vertex input stage
+		VkBufferUsageFlags vertexUsageFlags = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT;
+		if (HasMeshlets())
+			vertexUsageFlags |= VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+
+		// Every stream is already in its GPU layout and goes into staging memory as is
+		vertexBuffer = CreateDeviceLocalBuffer(device, cooked.vertices.data, cooked.vertices.GetSize(), vertexUsageFlags);
+		positionBuffer = CreateDeviceLocalBuffer(device, cooked.positions.data, cooked.positions.GetSize(), VK_BUFFER_USAGE_VERTEX_BUFFER_BIT);
+		indexBuffer = CreateDeviceLocalBuffer(device, cooked.indices.data, cooked.indices.GetSize(), VK_BUFFER_USAGE_INDEX_BUFFER_BIT);
 		CreateUniformBuffers();
+
+		if (HasMeshlets())
+			CreateMeshletBuffers(cooked);
 	}
 
 	Mesh::~Mesh()
 	{
+		delete drawCommandBuffer;
+		delete culledIndexBuffer;
+		delete meshletTriangleBuffer;
+		delete meshletVertexBuffer;
+		delete meshletBuffer;
 		delete indexBuffer;
+		delete positionBuffer;
 		delete vertexBuffer;
 		delete metallicTexture;
 		delete roughnessTexture;
@@ -35,126 +67,193 @@ namespace VulkanRenderer
 
 	size_t Mesh::GetIndicesSize() const
 	{
-		return indicesSize;
+		return lods[0].indexCount;
 	}
 
-	void Mesh::CreateDescriptorSets(VkDescriptorPool descriptorPool)
+	uint32_t Mesh::GetLodCount() const
 	{
-		VkDevice logicalDevice = device->GetLogical();
-
-		std::vector<VkDescriptorSetLayout> layouts(VulkanConfig::MAX_FRAMES_IN_FLIGHT, descriptorSetLayout);
+		return static_cast<uint32_t>(lods.size());
+	}
 
-		VkDescriptorSetAllocateInfo allocInfo{};
-		allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-		allocInfo.descriptorPool = descriptorPool;
-		allocInfo.descriptorSetCount = static_cast<uint32_t>(VulkanConfig::MAX_FRAMES_IN_FLIGHT);
-		allocInfo.pSetLayouts = layouts.data();
+	const MeshLod& Mesh::GetLod(uint32_t lod) const
+	{
+		return lods[lod];
+	}
 
-		// Allocate a descriptor set for each frame in flight
-		descriptorSets.resize(VulkanConfig::MAX_FRAMES_IN_FLIGHT);
-		if (vkAllocateDescriptorSets(logicalDevice, &allocInfo, descriptorSets.data()) != VK_SUCCESS)
+	uint32_t Mesh::SelectLod(const glm::mat4& model, const glm::vec3& cameraPosition, float pixelsPerUnit, float errorThreshold)
+	{
+		// Bounding sphere of the quantization bounds in world space
+		float scale = std::max(glm::length(glm::vec3(model[0])), std::max(glm::length(glm::vec3(model[1])), glm::length(glm::vec3(model[2]))));
+		glm::vec3 center = glm::vec3(model * glm::vec4(bounds.min + bounds.extent * 0.5f, 1.0f));
+		float radius = glm::length(bounds.extent) * 0.5f * scale;
+
+		// Errors are measured at the nearest point of the sphere, a camera inside it keeps full resolution
+		float distance = glm::length(center - cameraPosition) - radius;
+		if (distance <= 0.0f)
 		{
-			std::cerr << "Failed to allocate mesh descriptor sets" << std::endl;
-			return;
+			currentLod = 0;
+			return currentLod;
 		}
 
-		// Update the descriptor set for each frame in flight
-		for (size_t i = 0; i < VulkanConfig::MAX_FRAMES_IN_FLIGHT; i++)
+		auto projectedError = [&](uint32_t lod)
 		{
-			VkDescriptorBufferInfo bufferInfo{};
-			bufferInfo.buffer = uniformBuffers[i].Get();
-			bufferInfo.offset = 0;
-			bufferInfo.range = sizeof(MeshUBO);
-
-			VkDescriptorImageInfo baseColorInfo{};
-			baseColorInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-			baseColorInfo.imageView = baseColorTexture->GetImageView();
-			baseColorInfo.sampler = baseColorTexture->GetSampler();
-
-			VkDescriptorImageInfo roughnessInfo{};
-			roughnessInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-			roughnessInfo.imageView = roughnessTexture->GetImageView();
-			roughnessInfo.sampler = roughnessTexture->GetSampler();
-
-			VkDescriptorImageInfo metallicInfo{};
-			metallicInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-			metallicInfo.imageView = metallicTexture->GetImageView();
-			metallicInfo.sampler = metallicTexture->GetSampler();
-
-			std::array<VkWriteDescriptorSet, 4> descriptorWrites{};
-			descriptorWrites[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-			descriptorWrites[0].dstSet = descriptorSets[i];
-			descriptorWrites[0].dstBinding = 0;
-			descriptorWrites[0].dstArrayElement = 0;
-			descriptorWrites[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-			descriptorWrites[0].descriptorCount = 1;
-			descriptorWrites[0].pBufferInfo = &bufferInfo;
-
-			descriptorWrites[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-			descriptorWrites[1].dstSet = descriptorSets[i];
-			descriptorWrites[1].dstBinding = 1;
-			descriptorWrites[1].dstArrayElement = 0;
-			descriptorWrites[1].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-			descriptorWrites[1].descriptorCount = 1;
-			descriptorWrites[1].pImageInfo = &baseColorInfo;
-
-			descriptorWrites[2].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-			descriptorWrites[2].dstSet = descriptorSets[i];
-			descriptorWrites[2].dstBinding = 2;
-			descriptorWrites[2].dstArrayElement = 0;
-			descriptorWrites[2].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-			descriptorWrites[2].descriptorCount = 1;
-			descriptorWrites[2].pImageInfo = &roughnessInfo;
-
-			descriptorWrites[3].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-			descriptorWrites[3].dstSet = descriptorSets[i];
-			descriptorWrites[3].dstBinding = 3;
-			descriptorWrites[3].dstArrayElement = 0;
-			descriptorWrites[3].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-			descriptorWrites[3].descriptorCount = 1;
-			descriptorWrites[3].pImageInfo = &metallicInfo;
-
-			vkUpdateDescriptorSets(logicalDevice, static_cast<uint32_t>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
-		}
+			return lods[lod].error * scale / distance * pixelsPerUnit;
+		};
+
+		auto coarsestWithin = [&](float threshold)
+		{
+			uint32_t lod = 0;
+			while (lod + 1 < lods.size() && projectedError(lod + 1) <= threshold)
+				lod++;
+			return lod;
+		};
+
+		// Refine as soon as the current level is too coarse, coarsen only well below the threshold
+		uint32_t refined = coarsestWithin(errorThreshold);
+		if (refined < currentLod)
+			currentLod = refined;
+		else
+			currentLod = std::max(currentLod, coarsestWithin(errorThreshold * LodHysteresis));
+
+		return currentLod;
+	}
+
+	uint32_t Mesh::GetSelectedLod() const
+	{
+		return currentLod;
 	}
 
-	void Mesh::CreateVertexBuffer(const std::vector<Vertex>& vertices)
+	float Mesh::GetScreenSize(const glm::mat4& model, const glm::vec3& cameraPosition, float pixelsPerUnit) const
 	{
-		VkDevice logicalDevice = device->GetLogical();
+		// Bounding sphere of the quantization bounds in world space, as in SelectLod
+		float scale = std::max(glm::length(glm::vec3(model[0])), std::max(glm::length(glm::vec3(model[1])), glm::length(glm::vec3(model[2]))));
+		glm::vec3 center = glm::vec3(model * glm::vec4(bounds.min + bounds.extent * 0.5f, 1.0f));
+		float radius = glm::length(bounds.extent) * 0.5f * scale;
+
+		float distance = glm::length(center - cameraPosition) - radius;
+		if (distance <= 0.0f)
+			return std::numeric_limits<float>::infinity();
+
+		return 2.0f * radius / distance * pixelsPerUnit;
+	}
+
+	void Mesh::RequestTextureMips(TextureStreamer* textureStreamer, float screenSize)
+	{
+		textureStreamer->Request(baseColorTexture, screenSize);
+		textureStreamer->Request(roughnessTexture, screenSize);
+		textureStreamer->Request(metallicTexture, screenSize);
+	}
+
+	uint64_t Mesh::GetTextureVersion() const
+	{
+		return baseColorTexture->GetVersion() + roughnessTexture->GetVersion() + metallicTexture->GetVersion();
+	}
+
+	bool Mesh::IsStaticBatch() const
+	{
+		return !ranges.empty();
+	}
 
-		VkDeviceSize bufferSize = sizeof(vertices[0]) * vertices.size();
+	const std::vector<MeshRange>& Mesh::GetRanges() const
+	{
+		return ranges;
+	}
 
-		VulkanBuffer stagingBuffer(device, bufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+	VkIndexType Mesh::GetIndexType() const
+	{
+		return indexType;
+	}
 
-		void* data;
-		vkMapMemory(logicalDevice, stagingBuffer.GetMemory(), 0, bufferSize, 0, &data);
-		memcpy(data, vertices.data(), (size_t)bufferSize);
-		vkUnmapMemory(logicalDevice, stagingBuffer.GetMemory());
+	bool Mesh::HasMeshlets() const
+	{
+		return meshletCount > 0;
+	}
 
-		vertexBuffer = new VulkanBuffer(device, bufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-		
-		CopyBuffer(device, stagingBuffer.Get(), vertexBuffer->Get(), bufferSize);
+	uint32_t Mesh::GetMeshletCount() const
+	{
+		return meshletCount;
 	}
 
-	void Mesh::CreateIndexBuffer(const std::vector<uint16_t>& indices)
+	void Mesh::CreateDescriptorSets(VulkanDescriptorAllocator* descriptorAllocator)
 	{
-		VkDevice logicalDevice = device->GetLogical();
+		// A descriptor set for each frame in flight. They hold the mesh's own uniform buffers, so nothing would share
+		// them through the allocator cache, and they stay private so streamed textures can be rebound in place.
+		descriptorSets.resize(VulkanConfig::MAX_FRAMES_IN_FLIGHT);
+		descriptorSetTextureVersions.assign(VulkanConfig::MAX_FRAMES_IN_FLIGHT, GetTextureVersion());
+
+		for (size_t i = 0; i < VulkanConfig::MAX_FRAMES_IN_FLIGHT; i++)
+		{
+			if (!descriptorAllocator->Allocate(descriptorSetLayout, &descriptorSets[i]))
+			{
+				std::cerr << "Failed to allocate mesh descriptor sets" << std::endl;
+				return;
+			}
+
+			WriteDescriptorSet(device->GetLogical(), descriptorSets[i], GetDescriptorBindings(static_cast<uint32_t>(i)));
+		}
+
+		if (!HasMeshlets())
+			return;
+
+		std::vector<DescriptorBinding> clusterBindings =
+		{
+			DescriptorBinding::Buffer(0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, meshletBuffer->Get(), 0, VK_WHOLE_SIZE),
+			DescriptorBinding::Buffer(1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, meshletVertexBuffer->Get(), 0, VK_WHOLE_SIZE),
+			DescriptorBinding::Buffer(2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, meshletTriangleBuffer->Get(), 0, VK_WHOLE_SIZE),
+			DescriptorBinding::Buffer(3, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, vertexBuffer->Get(), 0, VK_WHOLE_SIZE),
+			DescriptorBinding::Buffer(4, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, culledIndexBuffer->Get(), 0, VK_WHOLE_SIZE),
+			DescriptorBinding::Buffer(5, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, drawCommandBuffer->Get(), 0, VK_WHOLE_SIZE)
+		};
+
+		clusterDescriptorSet = descriptorAllocator->GetOrCreate(clusterDescriptorSetLayout, clusterBindings);
+		if (clusterDescriptorSet == VK_NULL_HANDLE)
+		{
+			std::cerr << "Failed to allocate mesh cluster descriptor set" << std::endl;
+		}
+	}
 
-		VkDeviceSize bufferSize = sizeof(indices[0]) * indices.size();
+	void Mesh::UpdateDescriptorSet(uint32_t currentImage)
+	{
+		uint64_t textureVersion = GetTextureVersion();
+		if (descriptorSetTextureVersions[currentImage] == textureVersion)
+			return;
 
-		VulkanBuffer stagingBuffer(device, bufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+		WriteDescriptorSet(device->GetLogical(), descriptorSets[currentImage], GetDescriptorBindings(currentImage));
+		descriptorSetTextureVersions[currentImage] = textureVersion;
+	}
 
-		void* data;
-		vkMapMemory(logicalDevice, stagingBuffer.GetMemory(), 0, bufferSize, 0, &data);
-		memcpy(data, indices.data(), (size_t)bufferSize);
-		vkUnmapMemory(logicalDevice, stagingBuffer.GetMemory());
+	std::vector<DescriptorBinding> Mesh::GetDescriptorBindings(uint32_t frame) const
+	{
+		return
+		{
+			DescriptorBinding::Buffer(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, uniformBuffers[frame].Get(), 0, sizeof(MeshUBO)),
+			DescriptorBinding::Image(1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, baseColorTexture->GetImageView(), baseColorTexture->GetSampler(), VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL),
+			DescriptorBinding::Image(2, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, roughnessTexture->GetImageView(), roughnessTexture->GetSampler(), VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL),
+			DescriptorBinding::Image(3, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, metallicTexture->GetImageView(), metallicTexture->GetSampler(), VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL)
+		};
+	}
 
-		indexBuffer = new VulkanBuffer(device, bufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-		
-		CopyBuffer(device, stagingBuffer.Get(), indexBuffer->Get(), bufferSize);
+	void Mesh::RecreateFrameResources(VulkanDescriptorAllocator* descriptorAllocator)
+	{
+		uniformBuffers.clear();
+		CreateUniformBuffers();
+		CreateDescriptorSets(descriptorAllocator);
+	}
 
-		// Cache indices size for indices draw call
-		indicesSize = indices.size();
+	void Mesh::CreateMeshletBuffers(const CookedMeshView& cooked)
+	{
+		meshletBuffer = CreateDeviceLocalBuffer(device, cooked.meshlets.data, cooked.meshlets.GetSize(), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
+		meshletVertexBuffer = CreateDeviceLocalBuffer(device, cooked.meshletVertices.data, cooked.meshletVertices.GetSize(), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
+		meshletTriangleBuffer = CreateDeviceLocalBuffer(device, cooked.meshletTriangles.data, cooked.meshletTriangles.GetSize(), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
+
+		// Room for every triangle of the full resolution level, when nothing is culled
+		culledIndexBuffer = CreateDeviceLocalBuffer(device, nullptr, sizeof(uint32_t) * lods[0].indexCount, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT);
+
+		// One instance, the culling pass resets the index count and adds the surviving triangles to it
+		VkDrawIndexedIndirectCommand drawCommand{};
+		drawCommand.indexCount = 0;
+		drawCommand.instanceCount = 1;
+		drawCommandBuffer = CreateDeviceLocalBuffer(device, &drawCommand, sizeof(drawCommand), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT);
 	}
 
 	void Mesh::CreateUniformBuffers()
@@ -164,15 +263,23 @@ namespace VulkanRenderer
 
 		for (size_t i = 0; i < VulkanConfig::MAX_FRAMES_IN_FLIGHT; i++)
 		{
-			uniformBuffers.emplace_back(device, bufferSize, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+			uniformBuffers.emplace_back(device, bufferSize, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, device->GetDynamicMemoryProperties());
 		}
 	}
 
-	void Mesh::UpdateUniformBuffer(uint32_t currentImage, VkExtent2D swapChainExtent)
+	MeshUBO Mesh::BuildUniformData() const
 	{
 		MeshUBO ubo{};
-		ubo.model = glm::translate(glm::mat4(1.0f), transform.position) * glm::mat4_cast(transform.rotation) * glm::scale(glm::mat4(1.0f), transform.scale);
-		
+		ubo.model = transform.GetMatrix();
+		ubo.positionOffset = glm::vec4(bounds.min, 0.0f);
+		ubo.positionScale = glm::vec4(bounds.extent, 0.0f);
+		ubo.meshletInfo = glm::uvec4(meshletCount, 0, 0, 0);
+
+		return ubo;
+	}
+
+	void Mesh::WriteUniformBuffer(uint32_t currentImage, const MeshUBO& ubo)
+	{
 		memcpy(uniformBuffers[currentImage].GetMappedData(), &ubo, sizeof(ubo));
 	}
 }
\ No newline at end of file
@@ -0,0 +1,423 @@
+#include <MeshOptimizer.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <unordered_map>
+
+namespace VulkanRenderer
+{
+	namespace
+	{
+		// Vertices are welded by comparing their bytes, padding would make equal vertices differ
+		static_assert(sizeof(Vertex) == 12 * sizeof(float), "Vertex must not contain padding");
+
+		struct VertexBytesHash
+		{
+			size_t operator()(const Vertex& vertex) const
+			{
+				// FNV-1a over the raw attribute bytes
+				const unsigned char* bytes = reinterpret_cast<const unsigned char*>(&vertex);
+				uint64_t hash = 14695981039346656037ull;
+				for (size_t i = 0; i < sizeof(Vertex); i++)
+				{
+					hash = (hash ^ bytes[i]) * 1099511628211ull;
+				}
+				return static_cast<size_t>(hash);
+			}
+		};
+
+		struct VertexBytesEqual
+		{
+			bool operator()(const Vertex& a, const Vertex& b) const
+			{
+				return memcmp(&a, &b, sizeof(Vertex)) == 0;
+			}
+		};
+
+		// Scoring constants from Forsyth's article, the scoring cache is larger than the simulated one on purpose
+		constexpr uint32_t ScoringCacheSize = 32;
+		constexpr float CacheDecayPower = 1.5f;
+		constexpr float LastTriangleScore = 0.75f;
+		constexpr float ValenceBoostScale = 2.0f;
+		constexpr float ValenceBoostPower = 0.5f;
+
+		float ScoreVertex(int cachePosition, uint32_t remainingTriangles)
+		{
+			// Nothing left to draw with this vertex
+			if (remainingTriangles == 0)
+			{
+				return -1.0f;
+			}
+
+			float score = 0.0f;
+			if (cachePosition >= 0)
+			{
+				// The last triangle's vertices score a fixed amount so its immediate neighbours are not always preferred
+				if (cachePosition < 3)
+				{
+					score = LastTriangleScore;
+				}
+				else
+				{
+					float scaler = 1.0f / (ScoringCacheSize - 3);
+					score = std::pow(1.0f - (cachePosition - 3) * scaler, CacheDecayPower);
+				}
+			}
+
+			// Vertices with few triangles left are finished first so they can leave the cache for good
+			score += ValenceBoostScale * std::pow(static_cast<float>(remainingTriangles), -ValenceBoostPower);
+			return score;
+		}
+
+		// FIFO post-transform cache, a vertex is resident while fewer than cacheSize misses happened since its own
+		class CacheSimulator
+		{
+		public:
+			CacheSimulator(size_t vertexCount, uint32_t cacheSize)
+				: cacheSize(cacheSize), insertTime(vertexCount, 0), time(cacheSize + 1)
+			{
+			}
+
+			// Returns true on a miss
+			bool Access(uint32_t vertex)
+			{
+				if (time - insertTime[vertex] <= cacheSize)
+				{
+					return false;
+				}
+
+				insertTime[vertex] = time++;
+				return true;
+			}
+
+		private:
+			uint32_t cacheSize;
+			std::vector<uint32_t> insertTime;
+			uint32_t time;
+		};
+	}
+
+	void WeldVertices(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices)
+	{
+		std::unordered_map<Vertex, uint32_t, VertexBytesHash, VertexBytesEqual> uniqueVertices;
+		uniqueVertices.reserve(vertices.size());
+
+		std::vector<uint32_t> remap(vertices.size());
+		std::vector<Vertex> welded;
+		welded.reserve(vertices.size());
+
+		for (size_t i = 0; i < vertices.size(); i++)
+		{
+			auto [it, inserted] = uniqueVertices.try_emplace(vertices[i], static_cast<uint32_t>(welded.size()));
+			if (inserted)
+			{
+				welded.push_back(vertices[i]);
+			}
+			remap[i] = it->second;
+		}
+
+		for (uint32_t& index : indices)
+		{
+			index = remap[index];
+		}
+
+		vertices.swap(welded);
+	}
+
+	void OptimizeVertexCache(std::vector<uint32_t>& indices, size_t vertexCount)
+	{
+		uint32_t triangleCount = static_cast<uint32_t>(indices.size() / 3);
+		if (triangleCount == 0)
+		{
+			return;
+		}
+
+		// Triangles of each vertex in one shared array, the undrawn ones are kept at the front of each range
+		std::vector<uint32_t> triangleOffsets(vertexCount + 1, 0);
+		for (uint32_t index : indices)
+		{
+			triangleOffsets[index + 1]++;
+		}
+		for (size_t v = 0; v < vertexCount; v++)
+		{
+			triangleOffsets[v + 1] += triangleOffsets[v];
+		}
+
+		std::vector<uint32_t> vertexTriangles(indices.size());
+		std::vector<uint32_t> remainingTriangles(vertexCount, 0);
+		for (uint32_t t = 0; t < triangleCount; t++)
+		{
+			for (uint32_t k = 0; k < 3; k++)
+			{
+				uint32_t v = indices[t * 3 + k];
+				vertexTriangles[triangleOffsets[v] + remainingTriangles[v]++] = t;
+			}
+		}
+
+		std::vector<float> vertexScores(vertexCount);
+		for (size_t v = 0; v < vertexCount; v++)
+		{
+			vertexScores[v] = ScoreVertex(-1, remainingTriangles[v]);
+		}
+
+		std::vector<float> triangleScores(triangleCount);
+		std::vector<bool> emitted(triangleCount, false);
+		uint32_t bestTriangle = 0;
+		for (uint32_t t = 0; t < triangleCount; t++)
+		{
+			triangleScores[t] = vertexScores[indices[t * 3]] + vertexScores[indices[t * 3 + 1]] + vertexScores[indices[t * 3 + 2]];
+			if (triangleScores[t] > triangleScores[bestTriangle])
+			{
+				bestTriangle = t;
+			}
+		}
+
+		std::vector<uint32_t> result;
+		result.reserve(indices.size());
+
+		std::vector<uint32_t> cache;
+		std::vector<uint32_t> newCache;
+		uint32_t nextUnemitted = 0;
+
+		while (bestTriangle != UINT32_MAX)
+		{
+			emitted[bestTriangle] = true;
+			const uint32_t* triangle = &indices[bestTriangle * 3];
+
+			newCache.clear();
+			for (uint32_t k = 0; k < 3; k++)
+			{
+				uint32_t v = triangle[k];
+				result.push_back(v);
+
+				// Move the triangle out of the vertex's undrawn range
+				uint32_t* begin = &vertexTriangles[triangleOffsets[v]];
+				uint32_t* end = begin + remainingTriangles[v];
+				std::iter_swap(std::find(begin, end, bestTriangle), end - 1);
+				remainingTriangles[v]--;
+
+				if (std::find(newCache.begin(), newCache.end(), v) == newCache.end())
+				{
+					newCache.push_back(v);
+				}
+			}
+
+			// The triangle's vertices move to the front of the LRU cache, the rest shift back
+			for (uint32_t v : cache)
+			{
+				if (v != triangle[0] && v != triangle[1] && v != triangle[2])
+				{
+					newCache.push_back(v);
+				}
+			}
+
+			// Rescore every vertex whose cache position changed, including the evicted ones, and pass the
+			// difference on to their undrawn triangles
+			for (size_t i = 0; i < newCache.size(); i++)
+			{
+				uint32_t v = newCache[i];
+				int position = i < ScoringCacheSize ? static_cast<int>(i) : -1;
+
+				float score = ScoreVertex(position, remainingTriangles[v]);
+				float delta = score - vertexScores[v];
+				vertexScores[v] = score;
+
+				for (uint32_t j = 0; j < remainingTriangles[v]; j++)
+				{
+					triangleScores[vertexTriangles[triangleOffsets[v] + j]] += delta;
+				}
+			}
+
+			if (newCache.size() > ScoringCacheSize)
+			{
+				newCache.resize(ScoringCacheSize);
+			}
+			cache.swap(newCache);
+
+			// The best undrawn triangle is almost always next to the cache, only look there
+			bestTriangle = UINT32_MAX;
+			float bestScore = -1.0f;
+			for (uint32_t v : cache)
+			{
+				for (uint32_t j = 0; j < remainingTriangles[v]; j++)
+				{
+					uint32_t t = vertexTriangles[triangleOffsets[v] + j];
+					if (triangleScores[t] > bestScore)
+					{
+						bestScore = triangleScores[t];
+						bestTriangle = t;
+					}
+				}
+			}
+
+			// Cache exhausted, continue from the next undrawn triangle in the original order
+			if (bestTriangle == UINT32_MAX)
+			{
+				while (nextUnemitted < triangleCount && emitted[nextUnemitted])
+				{
+					nextUnemitted++;
+				}
+				if (nextUnemitted < triangleCount)
+				{
+					bestTriangle = nextUnemitted;
+				}
+			}
+		}
+
+		indices.swap(result);
+	}
+
+	void OptimizeOverdraw(std::vector<uint32_t>& indices, const std::vector<Vertex>& vertices)
+	{
+		size_t triangleCount = indices.size() / 3;
+		if (triangleCount < 2)
+		{
+			return;
+		}
+
+		// A cluster starts wherever a triangle misses the cache on all three vertices, reordering whole clusters
+		// leaves the cache efficiency within them intact
+		std::vector<size_t> clusterStarts;
+		CacheSimulator cache(vertices.size(), MeshOptimizerCacheSize);
+		for (size_t t = 0; t < triangleCount; t++)
+		{
+			uint32_t misses = 0;
+			for (size_t k = 0; k < 3; k++)
+			{
+				misses += cache.Access(indices[t * 3 + k]) ? 1 : 0;
+			}
+
+			if (t == 0 || misses == 3)
+			{
+				clusterStarts.push_back(t);
+			}
+		}
+		clusterStarts.push_back(triangleCount);
+
+		struct Cluster
+		{
+			size_t firstTriangle;
+			size_t endTriangle;
+			glm::vec3 centroid;
+			glm::vec3 normal;
+			float sortKey;
+		};
+
+		std::vector<Cluster> clusters;
+		clusters.reserve(clusterStarts.size() - 1);
+
+		glm::vec3 meshCentroid(0.0f);
+		float meshArea = 0.0f;
+
+		for (size_t i = 0; i + 1 < clusterStarts.size(); i++)
+		{
+			Cluster cluster{clusterStarts[i], clusterStarts[i + 1], glm::vec3(0.0f), glm::vec3(0.0f), 0.0f};
+
+			// Area weighted, the cross product's length is twice the triangle area
+			float clusterArea = 0.0f;
+			for (size_t t = cluster.firstTriangle; t < cluster.endTriangle; t++)
+			{
+				const glm::vec3& a = vertices[indices[t * 3]].position;
+				const glm::vec3& b = vertices[indices[t * 3 + 1]].position;
+				const glm::vec3& c = vertices[indices[t * 3 + 2]].position;
+
+				glm::vec3 normal = glm::cross(b - a, c - a);
+				float area = glm::length(normal);
+
+				cluster.centroid += (a + b + c) * (area / 3.0f);
+				cluster.normal += normal;
+				clusterArea += area;
+			}
+
+			meshCentroid += cluster.centroid;
+			meshArea += clusterArea;
+
+			if (clusterArea > 0.0f)
+			{
+				cluster.centroid /= clusterArea;
+			}
+
+			clusters.push_back(cluster);
+		}
+
+		if (meshArea > 0.0f)
+		{
+			meshCentroid /= meshArea;
+		}
+
+		// Clusters far out along their own normal are likely to face the viewer and occlude the inner ones
+		for (Cluster& cluster : clusters)
+		{
+			float normalLength = glm::length(cluster.normal);
+			cluster.sortKey = normalLength > 0.0f ? glm::dot(cluster.centroid - meshCentroid, cluster.normal / normalLength) : 0.0f;
+		}
+
+		std::stable_sort(clusters.begin(), clusters.end(), [](const Cluster& a, const Cluster& b)
+		{
+			return a.sortKey > b.sortKey;
+		});
+
+		std::vector<uint32_t> result;
+		result.reserve(indices.size());
+		for (const Cluster& cluster : clusters)
+		{
+			result.insert(result.end(), indices.begin() + cluster.firstTriangle * 3, indices.begin() + cluster.endTriangle * 3);
+		}
+
+		indices.swap(result);
+	}
+
+	void OptimizeVertexFetch(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices)
+	{
+		std::vector<uint32_t> remap(vertices.size(), UINT32_MAX);
+		std::vector<Vertex> reordered;
+		reordered.reserve(vertices.size());
+
+		for (uint32_t& index : indices)
+		{
+			if (remap[index] == UINT32_MAX)
+			{
+				remap[index] = static_cast<uint32_t>(reordered.size());
+				reordered.push_back(vertices[index]);
+			}
+			index = remap[index];
+		}
+
+		vertices.swap(reordered);
+	}
+
+	float ComputeAcmr(const std::vector<uint32_t>& indices, size_t vertexCount, uint32_t cacheSize)
+	{
+		size_t triangleCount = indices.size() / 3;
+		if (triangleCount == 0)
+		{
+			return 0.0f;
+		}
+
+		CacheSimulator cache(vertexCount, cacheSize);
+		size_t misses = 0;
+		for (uint32_t index : indices)
+		{
+			misses += cache.Access(index) ? 1 : 0;
+		}
+
+		return static_cast<float>(misses) / static_cast<float>(triangleCount);
+	}
+
+	MeshOptimizationStats OptimizeMesh(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices)
+	{
+		MeshOptimizationStats stats;
+		stats.vertexCountBefore = vertices.size();
+		stats.acmrBefore = ComputeAcmr(indices, vertices.size());
+
+		WeldVertices(vertices, indices);
+		OptimizeVertexCache(indices, vertices.size());
+		OptimizeOverdraw(indices, vertices);
+		OptimizeVertexFetch(vertices, indices);
+
+		stats.vertexCountAfter = vertices.size();
+		stats.acmrAfter = ComputeAcmr(indices, vertices.size());
+		return stats;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,313 @@
+#include <MeshSimplifier.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cfloat>
+#include <cstring>
+#include <unordered_map>
+
+#include <MeshOptimizer.h>
+
+namespace VulkanRenderer
+{
+	namespace
+	{
+		// Sum of squared distances to a set of planes, p^T Q p for p = (x, y, z, 1). Only the upper triangle of the
+		// symmetric 4x4 matrix is stored, in doubles since the sums lose precision in floats on dense meshes.
+		struct Quadric
+		{
+			double a00 = 0.0, a01 = 0.0, a02 = 0.0, a03 = 0.0;
+			double a11 = 0.0, a12 = 0.0, a13 = 0.0;
+			double a22 = 0.0, a23 = 0.0;
+			double a33 = 0.0;
+
+			void AddPlane(const glm::vec3& normal, float distance)
+			{
+				double x = normal.x, y = normal.y, z = normal.z, d = distance;
+				a00 += x * x; a01 += x * y; a02 += x * z; a03 += x * d;
+				a11 += y * y; a12 += y * z; a13 += y * d;
+				a22 += z * z; a23 += z * d;
+				a33 += d * d;
+			}
+
+			void Add(const Quadric& other)
+			{
+				a00 += other.a00; a01 += other.a01; a02 += other.a02; a03 += other.a03;
+				a11 += other.a11; a12 += other.a12; a13 += other.a13;
+				a22 += other.a22; a23 += other.a23;
+				a33 += other.a33;
+			}
+
+			double Evaluate(const glm::vec3& point) const
+			{
+				double x = point.x, y = point.y, z = point.z;
+				double error = a00 * x * x + a11 * y * y + a22 * z * z
+					+ 2.0 * (a01 * x * y + a02 * x * z + a12 * y * z)
+					+ 2.0 * (a03 * x + a13 * y + a23 * z)
+					+ a33;
+
+				// Rounding can push a zero error slightly negative
+				return std::max(error, 0.0);
+			}
+		};
+
+		struct PositionHash
+		{
+			size_t operator()(const glm::vec3& position) const
+			{
+				uint32_t bits[3];
+				memcpy(bits, &position, sizeof(bits));
+				return static_cast<size_t>(bits[0] * 73856093u ^ bits[1] * 19349663u ^ bits[2] * 83492791u);
+			}
+		};
+
+		uint64_t MakeEdgeKey(uint32_t a, uint32_t b)
+		{
+			return a < b ? static_cast<uint64_t>(a) << 32 | b : static_cast<uint64_t>(b) << 32 | a;
+		}
+
+		struct Collapse
+		{
+			uint32_t from;
+			uint32_t to;
+			double cost;
+		};
+	}
+
+	float SimplifyMesh(const std::vector<Vertex>& vertices, std::vector<uint32_t>& indices, size_t targetIndexCount, float maxError)
+	{
+		size_t vertexCount = vertices.size();
+
+		// Vertices that share a position across a UV or normal seam are one point of the surface
+		std::vector<uint32_t> positionIds(vertexCount);
+		std::vector<uint32_t> positionCopies(vertexCount, 0);
+		{
+			std::unordered_map<glm::vec3, uint32_t, PositionHash> firstVertices;
+			firstVertices.reserve(vertexCount);
+
+			for (uint32_t i = 0; i < vertexCount; i++)
+			{
+				positionIds[i] = firstVertices.emplace(vertices[i].position, i).first->second;
+				positionCopies[positionIds[i]]++;
+			}
+		}
+
+		// Seams would tear if only one copy moved and open borders would shrink, both are left where they are
+		std::vector<bool> locked(vertexCount, false);
+		{
+			std::unordered_map<uint64_t, uint32_t> edgeUses;
+			for (size_t i = 0; i < indices.size(); i += 3)
+			{
+				for (uint32_t k = 0; k < 3; k++)
+					edgeUses[MakeEdgeKey(positionIds[indices[i + k]], positionIds[indices[i + (k + 1) % 3]])]++;
+			}
+
+			for (const auto& [edge, uses] : edgeUses)
+			{
+				if (uses == 1)
+				{
+					locked[static_cast<uint32_t>(edge >> 32)] = true;
+					locked[static_cast<uint32_t>(edge & 0xFFFFFFFFu)] = true;
+				}
+			}
+
+			for (uint32_t i = 0; i < vertexCount; i++)
+			{
+				if (positionCopies[positionIds[i]] > 1 || locked[positionIds[i]])
+					locked[i] = true;
+			}
+		}
+
+		// Planes of the triangles around each position, unweighted so the error stays a distance
+		std::vector<Quadric> quadrics(vertexCount);
+		for (size_t i = 0; i < indices.size(); i += 3)
+		{
+			const glm::vec3& p0 = vertices[indices[i + 0]].position;
+			const glm::vec3& p1 = vertices[indices[i + 1]].position;
+			const glm::vec3& p2 = vertices[indices[i + 2]].position;
+
+			glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+			float length = glm::length(normal);
+			if (length == 0.0f)
+				continue;
+
+			normal /= length;
+			float distance = -glm::dot(normal, p0);
+
+			for (uint32_t k = 0; k < 3; k++)
+				quadrics[positionIds[indices[i + k]]].AddPlane(normal, distance);
+		}
+
+		std::vector<uint32_t> remap(vertexCount);
+		std::vector<bool> touched(vertexCount);
+		std::vector<uint32_t> triangleOffsets(vertexCount + 1);
+		std::vector<uint32_t> vertexTriangles;
+		std::vector<Collapse> collapses;
+
+		float resultError = 0.0f;
+
+		// Each pass collapses the cheapest edges whose neighbourhoods do not overlap, then rebuilds the triangle list
+		while (indices.size() > targetIndexCount)
+		{
+			collapses.clear();
+			for (size_t i = 0; i < indices.size(); i += 3)
+			{
+				for (uint32_t k = 0; k < 3; k++)
+				{
+					uint32_t a = indices[i + k];
+					uint32_t b = indices[i + (k + 1) % 3];
+
+					if (!locked[a])
+						collapses.push_back({a, b, quadrics[positionIds[a]].Evaluate(vertices[b].position)});
+					if (!locked[b])
+						collapses.push_back({b, a, quadrics[positionIds[b]].Evaluate(vertices[a].position)});
+				}
+			}
+
+			if (collapses.empty())
+				break;
+
+			std::sort(collapses.begin(), collapses.end(), [](const Collapse& a, const Collapse& b)
+			{
+				return a.cost < b.cost;
+			});
+
+			// Triangles around every vertex
+			std::fill(triangleOffsets.begin(), triangleOffsets.end(), 0);
+			for (uint32_t index : indices)
+				triangleOffsets[index + 1]++;
+			for (size_t i = 0; i < vertexCount; i++)
+				triangleOffsets[i + 1] += triangleOffsets[i];
+
+			vertexTriangles.resize(indices.size());
+			std::vector<uint32_t> fill(triangleOffsets.begin(), triangleOffsets.end() - 1);
+			for (size_t i = 0; i < indices.size(); i++)
+				vertexTriangles[fill[indices[i]]++] = static_cast<uint32_t>(i / 3);
+
+			for (uint32_t i = 0; i < vertexCount; i++)
+				remap[i] = i;
+			std::fill(touched.begin(), touched.end(), false);
+
+			size_t triangleCount = indices.size() / 3;
+			size_t targetTriangleCount = targetIndexCount / 3;
+			size_t appliedCount = 0;
+
+			for (const Collapse& collapse : collapses)
+			{
+				if (triangleCount <= targetTriangleCount)
+					break;
+
+				float error = static_cast<float>(std::sqrt(collapse.cost));
+				if (error > maxError)
+					break;
+
+				if (touched[collapse.from] || touched[collapse.to])
+					continue;
+
+				const glm::vec3& target = vertices[collapse.to].position;
+
+				// Every triangle around the moved vertex must keep its orientation and its other vertices must not
+				// have moved this pass, the checks would be stale otherwise
+				bool valid = true;
+				size_t removedTriangles = 0;
+				for (uint32_t t = triangleOffsets[collapse.from]; t < triangleOffsets[collapse.from + 1] && valid; t++)
+				{
+					const uint32_t* triangle = &indices[vertexTriangles[t] * 3];
+					if (triangle[0] == collapse.to || triangle[1] == collapse.to || triangle[2] == collapse.to)
+					{
+						removedTriangles++;
+						continue;
+					}
+
+					glm::vec3 before[3];
+					glm::vec3 after[3];
+					for (uint32_t k = 0; k < 3; k++)
+					{
+						if (triangle[k] != collapse.from && touched[triangle[k]])
+							valid = false;
+
+						before[k] = vertices[triangle[k]].position;
+						after[k] = triangle[k] == collapse.from ? target : before[k];
+					}
+
+					glm::vec3 normalBefore = glm::cross(before[1] - before[0], before[2] - before[0]);
+					glm::vec3 normalAfter = glm::cross(after[1] - after[0], after[2] - after[0]);
+					if (glm::dot(normalBefore, normalAfter) <= 0.0f)
+						valid = false;
+				}
+
+				if (!valid)
+					continue;
+
+				remap[collapse.from] = collapse.to;
+				quadrics[positionIds[collapse.to]].Add(quadrics[positionIds[collapse.from]]);
+
+				touched[collapse.from] = true;
+				touched[collapse.to] = true;
+				for (uint32_t t = triangleOffsets[collapse.from]; t < triangleOffsets[collapse.from + 1]; t++)
+				{
+					for (uint32_t k = 0; k < 3; k++)
+						touched[indices[vertexTriangles[t] * 3 + k]] = true;
+				}
+
+				triangleCount -= removedTriangles;
+				resultError = std::max(resultError, error);
+				appliedCount++;
+			}
+
+			if (appliedCount == 0)
+				break;
+
+			// Triangles that lost an edge to a collapse are dropped
+			size_t writeIndex = 0;
+			for (size_t i = 0; i < indices.size(); i += 3)
+			{
+				uint32_t a = remap[indices[i + 0]];
+				uint32_t b = remap[indices[i + 1]];
+				uint32_t c = remap[indices[i + 2]];
+
+				if (a == b || b == c || c == a)
+					continue;
+
+				indices[writeIndex++] = a;
+				indices[writeIndex++] = b;
+				indices[writeIndex++] = c;
+			}
+			indices.resize(writeIndex);
+		}
+
+		return resultError;
+	}
+
+	std::vector<MeshLod> BuildLodChain(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices, std::vector<uint32_t>& lodIndices)
+	{
+		std::vector<MeshLod> lods;
+		lods.push_back({0, static_cast<uint32_t>(indices.size()), 0.0f});
+		lodIndices = indices;
+
+		std::vector<uint32_t> levelIndices = indices;
+		float error = 0.0f;
+
+		while (lods.size() < MeshMaxLods)
+		{
+			size_t previousIndexCount = levelIndices.size();
+			size_t targetIndexCount = previousIndexCount / 6 * 3;
+			if (targetIndexCount < LodMinTriangles * 3)
+				break;
+
+			// Each level is simplified from the one before, so the errors of the steps add up
+			error += SimplifyMesh(vertices, levelIndices, targetIndexCount, FLT_MAX);
+
+			// Locked borders and seams hold most of what is left, another level would barely differ
+			if (levelIndices.size() > previousIndexCount * 7 / 8)
+				break;
+
+			OptimizeVertexCache(levelIndices, vertices.size());
+
+			lods.push_back({static_cast<uint32_t>(lodIndices.size()), static_cast<uint32_t>(levelIndices.size()), error});
+			lodIndices.insert(lodIndices.end(), levelIndices.begin(), levelIndices.end());
+		}
+
+		return lods;
+	}
+}
\ No newline at end of file
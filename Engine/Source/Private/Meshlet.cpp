@@ -0,0 +1,127 @@
+#include <Meshlet.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cfloat>
+
+namespace VulkanRenderer
+{
+	namespace
+	{
+		void ComputeMeshletBounds(Meshlet& meshlet, const MeshletData& data, const std::vector<Vertex>& vertices)
+		{
+			// Sphere around the bounding box, loose but cheap and stable
+			glm::vec3 min(FLT_MAX);
+			glm::vec3 max(-FLT_MAX);
+			for (uint32_t i = 0; i < meshlet.vertexCount; i++)
+			{
+				const glm::vec3& position = vertices[data.vertices[meshlet.vertexOffset + i]].position;
+				min = glm::min(min, position);
+				max = glm::max(max, position);
+			}
+
+			meshlet.center = (min + max) * 0.5f;
+			meshlet.radius = 0.0f;
+			for (uint32_t i = 0; i < meshlet.vertexCount; i++)
+			{
+				const glm::vec3& position = vertices[data.vertices[meshlet.vertexOffset + i]].position;
+				meshlet.radius = std::max(meshlet.radius, glm::length(position - meshlet.center));
+			}
+
+			// Normal cone: the average triangle normal and the widest angle any triangle makes with it
+			std::vector<glm::vec3> normals;
+			normals.reserve(meshlet.triangleCount);
+
+			glm::vec3 normalSum(0.0f);
+			for (uint32_t i = 0; i < meshlet.triangleCount; i++)
+			{
+				uint32_t triangle = data.triangles[meshlet.triangleOffset + i];
+				const glm::vec3& a = vertices[data.vertices[meshlet.vertexOffset + (triangle & 0xFF)]].position;
+				const glm::vec3& b = vertices[data.vertices[meshlet.vertexOffset + ((triangle >> 8) & 0xFF)]].position;
+				const glm::vec3& c = vertices[data.vertices[meshlet.vertexOffset + ((triangle >> 16) & 0xFF)]].position;
+
+				glm::vec3 normal = glm::cross(b - a, c - a);
+				float length = glm::length(normal);
+
+				// Degenerate triangles are never rasterized, they do not widen the cone
+				if (length <= 0.0f)
+					continue;
+
+				normals.push_back(normal / length);
+				normalSum += normals.back();
+			}
+
+			meshlet.coneAxis = glm::vec3(0.0f, 0.0f, 1.0f);
+			meshlet.coneCutoff = 1.0f;
+
+			float sumLength = glm::length(normalSum);
+			if (normals.empty() || sumLength <= 0.0f)
+				return;
+
+			meshlet.coneAxis = normalSum / sumLength;
+
+			float minDot = 1.0f;
+			for (const glm::vec3& normal : normals)
+				minDot = std::min(minDot, glm::dot(normal, meshlet.coneAxis));
+
+			// A spread of 90 degrees or more always has a triangle facing the viewer
+			meshlet.coneCutoff = minDot <= 0.0f ? 1.0f : std::sqrt(1.0f - minDot * minDot);
+		}
+	}
+
+	MeshletData BuildMeshlets(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices)
+	{
+		MeshletData data;
+
+		// Local index of each mesh vertex in the meshlet being built, 0xFF when it is not in it yet
+		std::vector<uint8_t> localIndices(vertices.size(), 0xFF);
+
+		Meshlet current{};
+
+		auto finishMeshlet = [&]()
+		{
+			if (current.triangleCount == 0)
+				return;
+
+			for (uint32_t i = 0; i < current.vertexCount; i++)
+				localIndices[data.vertices[current.vertexOffset + i]] = 0xFF;
+
+			ComputeMeshletBounds(current, data, vertices);
+			data.meshlets.push_back(current);
+
+			current = Meshlet{};
+			current.vertexOffset = static_cast<uint32_t>(data.vertices.size());
+			current.triangleOffset = static_cast<uint32_t>(data.triangles.size());
+		};
+
+		for (size_t t = 0; t + 2 < indices.size(); t += 3)
+		{
+			uint32_t a = indices[t];
+			uint32_t b = indices[t + 1];
+			uint32_t c = indices[t + 2];
+
+			uint32_t newVertices = (localIndices[a] == 0xFF) + (localIndices[b] == 0xFF && b != a) + (localIndices[c] == 0xFF && c != a && c != b);
+			if (current.vertexCount + newVertices > MeshletMaxVertices || current.triangleCount == MeshletMaxTriangles)
+				finishMeshlet();
+
+			uint32_t packed = 0;
+			uint32_t corners[3] = { a, b, c };
+			for (uint32_t k = 0; k < 3; k++)
+			{
+				uint8_t& local = localIndices[corners[k]];
+				if (local == 0xFF)
+				{
+					local = static_cast<uint8_t>(current.vertexCount++);
+					data.vertices.push_back(corners[k]);
+				}
+				packed |= static_cast<uint32_t>(local) << (k * 8);
+			}
+
+			data.triangles.push_back(packed);
+			current.triangleCount++;
+		}
+
+		finishMeshlet();
+		return data;
+	}
+}
\ No newline at end of file
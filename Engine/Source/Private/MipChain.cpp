@@ -0,0 +1,134 @@
+#include <MipChain.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+namespace VulkanRenderer
+{
+	namespace
+	{
+		struct SrgbTables
+		{
+			float toLinear[256];
+
+			// Indexed by linear value * (EncodeSteps - 1), fine enough that every 8-bit result is reachable
+			static constexpr uint32_t EncodeSteps = 4096;
+			uint8_t toSrgb[EncodeSteps];
+
+			SrgbTables()
+			{
+				for (uint32_t i = 0; i < 256; i++)
+				{
+					float c = i / 255.0f;
+					toLinear[i] = c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+				}
+
+				for (uint32_t i = 0; i < EncodeSteps; i++)
+				{
+					float l = i / static_cast<float>(EncodeSteps - 1);
+					float c = l <= 0.0031308f ? l * 12.92f : 1.055f * std::pow(l, 1.0f / 2.4f) - 0.055f;
+					toSrgb[i] = static_cast<uint8_t>(std::clamp(c * 255.0f + 0.5f, 0.0f, 255.0f));
+				}
+			}
+		};
+
+		const SrgbTables& GetSrgbTables()
+		{
+			static const SrgbTables tables;
+			return tables;
+		}
+
+		// Odd sizes clamp the last row and column instead of reading past them
+		void Downsample(const uint8_t* source, uint32_t sourceWidth, uint32_t sourceHeight, uint8_t* target)
+		{
+			const SrgbTables& tables = GetSrgbTables();
+
+			uint32_t width = std::max(sourceWidth >> 1, 1u);
+			uint32_t height = std::max(sourceHeight >> 1, 1u);
+
+			for (uint32_t y = 0; y < height; y++)
+			{
+				const uint8_t* row0 = source + static_cast<size_t>(std::min(y * 2, sourceHeight - 1)) * sourceWidth * 4;
+				const uint8_t* row1 = source + static_cast<size_t>(std::min(y * 2 + 1, sourceHeight - 1)) * sourceWidth * 4;
+
+				for (uint32_t x = 0; x < width; x++)
+				{
+					size_t x0 = static_cast<size_t>(std::min(x * 2, sourceWidth - 1)) * 4;
+					size_t x1 = static_cast<size_t>(std::min(x * 2 + 1, sourceWidth - 1)) * 4;
+
+					uint8_t* texel = target + (static_cast<size_t>(y) * width + x) * 4;
+
+					for (uint32_t c = 0; c < 3; c++)
+					{
+						float linear = (tables.toLinear[row0[x0 + c]] + tables.toLinear[row0[x1 + c]] + tables.toLinear[row1[x0 + c]] + tables.toLinear[row1[x1 + c]]) * 0.25f;
+						texel[c] = tables.toSrgb[static_cast<uint32_t>(linear * (SrgbTables::EncodeSteps - 1) + 0.5f)];
+					}
+
+					texel[3] = static_cast<uint8_t>((row0[x0 + 3] + row0[x1 + 3] + row1[x0 + 3] + row1[x1 + 3] + 2) / 4);
+				}
+			}
+		}
+	}
+
+	uint32_t GetMipLevelCount(uint32_t width, uint32_t height)
+	{
+		uint32_t levels = 1;
+		for (uint32_t size = std::max(width, height); size > 1; size >>= 1)
+			levels++;
+		return levels;
+	}
+
+	uint32_t GetMipExtent(uint32_t size, uint32_t level)
+	{
+		return std::max(size >> level, 1u);
+	}
+
+	size_t GetMipLevelSize(uint32_t width, uint32_t height, uint32_t level)
+	{
+		return static_cast<size_t>(GetMipExtent(width, level)) * GetMipExtent(height, level) * 4;
+	}
+
+	size_t GetMipChainSize(uint32_t width, uint32_t height, uint32_t firstLevel)
+	{
+		size_t size = 0;
+		for (uint32_t level = firstLevel; level < GetMipLevelCount(width, height); level++)
+			size += GetMipLevelSize(width, height, level);
+		return size;
+	}
+
+	void BuildMipChain(const uint8_t* pixels, uint32_t width, uint32_t height, uint32_t firstLevel, uint8_t* target)
+	{
+		uint32_t levelCount = GetMipLevelCount(width, height);
+		firstLevel = std::min(firstLevel, levelCount - 1);
+
+		if (firstLevel == 0 && target != pixels)
+			memcpy(target, pixels, GetMipLevelSize(width, height, 0));
+
+		// Levels finer than the first one kept are only needed to filter the next. Built in place each one overwrites
+		// the start of the one it is filtered from, a texel is never written before the source texels still to be
+		// read. Otherwise two scratch levels take turns.
+		bool inPlace = target == pixels;
+		std::vector<uint8_t> scratch[2];
+
+		const uint8_t* source = pixels;
+		uint8_t* output = target + (firstLevel == 0 ? GetMipLevelSize(width, height, 0) : 0);
+
+		for (uint32_t level = 1; level < levelCount; level++)
+		{
+			uint8_t* levelTarget = output;
+			if (level < firstLevel && !inPlace)
+			{
+				scratch[level & 1].resize(GetMipLevelSize(width, height, level));
+				levelTarget = scratch[level & 1].data();
+			}
+
+			Downsample(source, GetMipExtent(width, level - 1), GetMipExtent(height, level - 1), levelTarget);
+
+			source = levelTarget;
+			if (level >= firstLevel)
+				output += GetMipLevelSize(width, height, level);
+		}
+	}
+}
\ No newline at end of file
@@ -0,0 +1,395 @@
+#include <Pak.h>
+
+#include <iostream>
+#include <fstream>
+#include <algorithm>
+#include <functional>
+#include <atomic>
+#include <thread>
+#include <set>
+#include <cstring>
+
+#include <Compression.h>
+
+namespace VulkanRenderer
+{
+	namespace
+	{
+		// Runs the calls on as many threads as there are cores, a single call runs on the calling thread
+		void ParallelFor(uint32_t count, const std::function<void(uint32_t)>& function)
+		{
+			uint32_t threadCount = std::min(count, std::max(1u, std::thread::hardware_concurrency()));
+			if (threadCount <= 1)
+			{
+				for (uint32_t i = 0; i < count; i++)
+				{
+					function(i);
+				}
+				return;
+			}
+
+			std::atomic<uint32_t> next = 0;
+			auto work = [&]()
+			{
+				for (uint32_t i = next++; i < count; i = next++)
+				{
+					function(i);
+				}
+			};
+
+			std::vector<std::thread> threads;
+			for (uint32_t i = 1; i < threadCount; i++)
+			{
+				threads.emplace_back(work);
+			}
+			work();
+
+			for (std::thread& thread : threads)
+			{
+				thread.join();
+			}
+		}
+
+		bool ReadSourceFile(const std::string& path, std::vector<uint8_t>& bytes)
+		{
+			std::ifstream file(path, std::ios::ate | std::ios::binary);
+			if (!file.is_open())
+				return false;
+
+			bytes.resize(static_cast<size_t>(file.tellg()));
+			file.seekg(0);
+			file.read(reinterpret_cast<char*>(bytes.data()), bytes.size());
+			return static_cast<bool>(file);
+		}
+
+		void WritePadding(std::ofstream& out, uint64_t& offset)
+		{
+			static const char zeros[PakAlignment] = {};
+
+			uint64_t padding = (PakAlignment - offset % PakAlignment) % PakAlignment;
+			out.write(zeros, padding);
+			offset += padding;
+		}
+
+		template<typename T>
+		void WriteArray(std::ofstream& out, uint64_t& offset, const std::vector<T>& values)
+		{
+			out.write(reinterpret_cast<const char*>(values.data()), values.size() * sizeof(T));
+			offset += values.size() * sizeof(T);
+		}
+
+		// Tables are read in place, so they have to be aligned as well as lie within the file
+		bool TableFits(uint64_t offset, uint64_t count, uint64_t elementSize, size_t fileSize)
+		{
+			return offset % PakAlignment == 0 && offset <= fileSize && count <= (fileSize - offset) / elementSize;
+		}
+	}
+
+	uint64_t HashPakPath(std::string_view path)
+	{
+		uint64_t hash = 14695981039346656037ull;
+		for (char c : path)
+		{
+			hash ^= static_cast<uint8_t>(c);
+			hash *= 1099511628211ull;
+		}
+		return hash;
+	}
+
+	bool WritePak(const std::string& path, const std::vector<PakSource>& sources, const PakBuildSettings& settings, PakBuildStats* stats)
+	{
+		std::ofstream out(path, std::ios::binary);
+		if (!out.is_open())
+		{
+			std::cerr << "Failed to create pak: " << path << std::endl;
+			return false;
+		}
+
+		PakHeader header{};
+		out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		uint64_t offset = sizeof(header);
+
+		std::vector<PakEntry> entries;
+		std::vector<PakBlock> blocks;
+		std::string strings;
+		std::set<std::string> paths;
+		PakBuildStats buildStats;
+
+		for (const PakSource& source : sources)
+		{
+			std::string entryPath = FileSystem::NormalizePath(source.path);
+			if (!paths.insert(entryPath).second)
+			{
+				std::cerr << "Failed to write pak, " << entryPath << " is added twice: " << path << std::endl;
+				return false;
+			}
+
+			std::vector<uint8_t> bytes;
+			if (!ReadSourceFile(source.filePath, bytes))
+			{
+				std::cerr << "Failed to read pak source: " << source.filePath << std::endl;
+				return false;
+			}
+
+			PakEntry entry{};
+			entry.pathHash = HashPakPath(entryPath);
+			entry.pathOffset = static_cast<uint32_t>(strings.size());
+			entry.pathLength = static_cast<uint32_t>(entryPath.size());
+			entry.size = bytes.size();
+			entry.compression = static_cast<uint32_t>(PakCompression::None);
+			strings += entryPath;
+
+			if (settings.compress && !bytes.empty())
+			{
+				uint32_t blockCount = static_cast<uint32_t>((bytes.size() + PakBlockSize - 1) / PakBlockSize);
+				std::vector<std::vector<uint8_t>> compressedBlocks(blockCount);
+
+				ParallelFor(blockCount, [&](uint32_t i)
+				{
+					size_t blockStart = static_cast<size_t>(i) * PakBlockSize;
+					size_t blockSize = std::min<size_t>(PakBlockSize, bytes.size() - blockStart);
+
+					compressedBlocks[i] = LzCompress(bytes.data() + blockStart, blockSize);
+
+					// Stored as is when compression does not help, which the reader sees from the equal sizes
+					if (compressedBlocks[i].size() >= blockSize)
+						compressedBlocks[i].assign(bytes.begin() + blockStart, bytes.begin() + blockStart + blockSize);
+				});
+
+				uint64_t compressedSize = 0;
+				for (const std::vector<uint8_t>& block : compressedBlocks)
+				{
+					compressedSize += block.size();
+				}
+
+				if (compressedSize <= bytes.size() * (1.0 - settings.minSavings))
+				{
+					entry.compression = static_cast<uint32_t>(PakCompression::Lz);
+					entry.firstBlock = static_cast<uint32_t>(blocks.size());
+					entry.blockCount = blockCount;
+					entry.offset = offset;
+
+					for (uint32_t i = 0; i < blockCount; i++)
+					{
+						size_t blockStart = static_cast<size_t>(i) * PakBlockSize;
+
+						PakBlock block{};
+						block.offset = offset;
+						block.compressedSize = static_cast<uint32_t>(compressedBlocks[i].size());
+						block.size = static_cast<uint32_t>(std::min<size_t>(PakBlockSize, bytes.size() - blockStart));
+						blocks.push_back(block);
+
+						WriteArray(out, offset, compressedBlocks[i]);
+					}
+
+					buildStats.compressedEntryCount++;
+					buildStats.storedSize += compressedSize;
+				}
+			}
+
+			if (entry.compression == static_cast<uint32_t>(PakCompression::None))
+			{
+				WritePadding(out, offset);
+				entry.offset = offset;
+				WriteArray(out, offset, bytes);
+
+				buildStats.storedSize += bytes.size();
+			}
+
+			buildStats.size += bytes.size();
+			entries.push_back(entry);
+		}
+
+		// Sorted for a binary search by hash, paths that share a hash are told apart by their string
+		std::sort(entries.begin(), entries.end(), [&](const PakEntry& a, const PakEntry& b)
+		{
+			return a.pathHash < b.pathHash;
+		});
+
+		WritePadding(out, offset);
+		header.entriesOffset = offset;
+		WriteArray(out, offset, entries);
+
+		WritePadding(out, offset);
+		header.blocksOffset = offset;
+		WriteArray(out, offset, blocks);
+
+		WritePadding(out, offset);
+		header.stringsOffset = offset;
+		header.stringsSize = strings.size();
+		out.write(strings.data(), strings.size());
+
+		header.magic = PakMagic;
+		header.version = PakVersion;
+		header.entryCount = static_cast<uint32_t>(entries.size());
+		header.blockCount = static_cast<uint32_t>(blocks.size());
+
+		out.seekp(0);
+		out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+		if (!out)
+		{
+			std::cerr << "Failed to write pak: " << path << std::endl;
+			return false;
+		}
+
+		if (stats)
+			*stats = buildStats;
+		return true;
+	}
+
+	bool PakFile::Open(const std::string& path)
+	{
+		this->path = path;
+		entries = nullptr;
+		entryCount = 0;
+
+		if (!file.Open(path))
+			return false;
+
+		const uint8_t* data = file.GetData();
+		size_t size = file.GetSize();
+
+		PakHeader header;
+		if (size < sizeof(header))
+		{
+			std::cerr << "Failed to mount pak, the file is truncated: " << path << std::endl;
+			return false;
+		}
+		memcpy(&header, data, sizeof(header));
+
+		if (header.magic != PakMagic)
+		{
+			std::cerr << "Failed to mount pak, not a pak: " << path << std::endl;
+			return false;
+		}
+
+		if (header.version != PakVersion)
+		{
+			std::cerr << "Failed to mount pak, version " << header.version << " instead of " << PakVersion << " needs building again: " << path << std::endl;
+			return false;
+		}
+
+		if (!TableFits(header.entriesOffset, header.entryCount, sizeof(PakEntry), size) || !TableFits(header.blocksOffset, header.blockCount, sizeof(PakBlock), size) ||
+			header.stringsOffset > size || header.stringsSize > size - header.stringsOffset)
+		{
+			std::cerr << "Failed to mount pak, a table lies outside the file: " << path << std::endl;
+			return false;
+		}
+
+		const PakEntry* fileEntries = reinterpret_cast<const PakEntry*>(data + header.entriesOffset);
+		const PakBlock* fileBlocks = reinterpret_cast<const PakBlock*>(data + header.blocksOffset);
+
+		// Checked once here so reads only have to decompress
+		for (uint32_t i = 0; i < header.entryCount; i++)
+		{
+			const PakEntry& entry = fileEntries[i];
+
+			bool valid = static_cast<uint64_t>(entry.pathOffset) + entry.pathLength <= header.stringsSize;
+			valid = valid && (i == 0 || fileEntries[i - 1].pathHash <= entry.pathHash);
+
+			if (entry.compression == static_cast<uint32_t>(PakCompression::None))
+			{
+				valid = valid && entry.offset <= size && entry.size <= size - entry.offset;
+			}
+			else if (entry.compression == static_cast<uint32_t>(PakCompression::Lz))
+			{
+				valid = valid && static_cast<uint64_t>(entry.firstBlock) + entry.blockCount <= header.blockCount;
+
+				uint64_t blockSizes = 0;
+				for (uint32_t j = 0; valid && j < entry.blockCount; j++)
+				{
+					const PakBlock& block = fileBlocks[entry.firstBlock + j];
+					bool last = j + 1 == entry.blockCount;
+
+					// Reads place block j at j * PakBlockSize
+					valid = block.offset <= size && block.compressedSize <= size - block.offset && (last ? block.size <= PakBlockSize : block.size == PakBlockSize);
+					blockSizes += block.size;
+				}
+				valid = valid && blockSizes == entry.size;
+			}
+			else
+			{
+				valid = false;
+			}
+
+			if (!valid)
+			{
+				std::cerr << "Failed to mount pak, entry " << i << " is malformed: " << path << std::endl;
+				return false;
+			}
+		}
+
+		entries = fileEntries;
+		entryCount = header.entryCount;
+		blocks = fileBlocks;
+		strings = reinterpret_cast<const char*>(data + header.stringsOffset);
+		return true;
+	}
+
+	const PakEntry* PakFile::Find(std::string_view path) const
+	{
+		uint64_t hash = HashPakPath(path);
+
+		const PakEntry* end = entries + entryCount;
+		const PakEntry* entry = std::lower_bound(entries, end, hash, [](const PakEntry& a, uint64_t b)
+		{
+			return a.pathHash < b;
+		});
+
+		for (; entry != end && entry->pathHash == hash; ++entry)
+		{
+			if (GetEntryPath(*entry) == path)
+				return entry;
+		}
+		return nullptr;
+	}
+
+	bool PakFile::Read(const PakEntry& entry, FileData& data) const
+	{
+		if (entry.compression == static_cast<uint32_t>(PakCompression::None))
+		{
+			data.SetView(file.GetData() + entry.offset, entry.size);
+			return true;
+		}
+
+		uint8_t* out = data.Allocate(entry.size);
+
+		// Every block but the last is a full PakBlockSize, Open checked the sizes add up
+		std::atomic<bool> failed = false;
+		ParallelFor(entry.blockCount, [&](uint32_t i)
+		{
+			const PakBlock& block = blocks[entry.firstBlock + i];
+			const uint8_t* src = file.GetData() + block.offset;
+			uint8_t* dst = out + static_cast<size_t>(i) * PakBlockSize;
+
+			if (block.compressedSize == block.size)
+				memcpy(dst, src, block.size);
+			else if (!LzDecompress(src, block.compressedSize, dst, block.size))
+				failed = true;
+		});
+
+		if (failed)
+		{
+			std::cerr << "Failed to decompress " << GetEntryPath(entry) << " from pak: " << path << std::endl;
+			data.Reset();
+			return false;
+		}
+		return true;
+	}
+
+	uint32_t PakFile::GetEntryCount() const
+	{
+		return entryCount;
+	}
+
+	const std::string& PakFile::GetPath() const
+	{
+		return path;
+	}
+
+	std::string_view PakFile::GetEntryPath(const PakEntry& entry) const
+	{
+		return std::string_view(strings + entry.pathOffset, entry.pathLength);
+	}
+}
\ No newline at end of file
@@ -0,0 +1,472 @@
+#include <Profiler.h>
+
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <algorithm>
+#include <atomic>
+
+#include <imgui.h>
+
+#include <VulkanDevice.h>
+
+using namespace VulkanRenderer;
+
+namespace
+{
+	constexpr uint32_t maxQueriesPerFrame = 128;
+	constexpr size_t maxHistoryFrames = 240;
+
+	struct OpenCpuScope
+	{
+		const char* name;
+		std::chrono::steady_clock::time_point start;
+	};
+
+	// Scopes nest per thread, each thread gets its own lane in the flame chart and the trace
+	struct ThreadScopes
+	{
+		uint32_t threadIndex;
+		std::vector<OpenCpuScope> stack;
+	};
+
+	std::atomic<uint32_t> nextThreadIndex{0};
+
+	thread_local ThreadScopes threadScopes{nextThreadIndex++, {}};
+
+	double ToMs(std::chrono::steady_clock::duration duration)
+	{
+		return std::chrono::duration<double, std::milli>(duration).count();
+	}
+
+	void WriteJsonString(std::ofstream& file, const char* text)
+	{
+		file << '"';
+		for (const char* c = text; *c; c++)
+		{
+			if (*c == '"' || *c == '\\')
+				file << '\\';
+			file << *c;
+		}
+		file << '"';
+	}
+
+	ImU32 ColorForName(const char* name)
+	{
+		// Stable per-name color so the same scope keeps its color from frame to frame
+		uint32_t hash = 2166136261u;
+		for (const char* c = name; *c; c++)
+			hash = (hash ^ static_cast<uint8_t>(*c)) * 16777619u;
+
+		return IM_COL32(80 + (hash & 0x7F), 80 + ((hash >> 8) & 0x7F), 80 + ((hash >> 16) & 0x7F), 255);
+	}
+
+	void DrawFlameLane(const char* label, const std::vector<ProfileEvent>& events, uint32_t threadIndex, double frameMs)
+	{
+		uint32_t maxDepth = 0;
+		for (const ProfileEvent& event : events)
+		{
+			if (event.threadIndex == threadIndex)
+				maxDepth = std::max(maxDepth, event.depth + 1);
+		}
+
+		if (maxDepth == 0)
+			return;
+
+		ImGui::TextUnformatted(label);
+
+		const float rowHeight = ImGui::GetTextLineHeight() + 2.0f;
+		ImVec2 origin = ImGui::GetCursorScreenPos();
+		float width = ImGui::GetContentRegionAvail().x;
+		float scale = frameMs > 0.0 ? width / static_cast<float>(frameMs) : 0.0f;
+
+		ImDrawList* drawList = ImGui::GetWindowDrawList();
+
+		for (const ProfileEvent& event : events)
+		{
+			if (event.threadIndex != threadIndex)
+				continue;
+
+			ImVec2 min(origin.x + static_cast<float>(event.startMs) * scale, origin.y + event.depth * rowHeight);
+			ImVec2 max(min.x + std::max(static_cast<float>(event.durationMs) * scale, 1.0f), min.y + rowHeight - 1.0f);
+
+			drawList->AddRectFilled(min, max, ColorForName(event.name));
+
+			// Only label blocks wide enough to fit some text
+			if (max.x - min.x > 30.0f)
+			{
+				drawList->PushClipRect(min, max, true);
+				drawList->AddText(ImVec2(min.x + 2.0f, min.y + 1.0f), IM_COL32(255, 255, 255, 255), event.name);
+				drawList->PopClipRect();
+			}
+
+			if (ImGui::IsMouseHoveringRect(min, max))
+				ImGui::SetTooltip("%s: %.3f ms", event.name, event.durationMs);
+		}
+
+		ImGui::Dummy(ImVec2(width, maxDepth * rowHeight));
+	}
+}
+
+Profiler::Profiler(VulkanDevice* device, uint32_t framesInFlight)
+	: device(device), epoch(std::chrono::steady_clock::now())
+{
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(device->GetPhysical(), &properties);
+
+	uint32_t queueFamilyCount = 0;
+	vkGetPhysicalDeviceQueueFamilyProperties(device->GetPhysical(), &queueFamilyCount, nullptr);
+
+	std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+	vkGetPhysicalDeviceQueueFamilyProperties(device->GetPhysical(), &queueFamilyCount, queueFamilies.data());
+
+	uint32_t validBits = queueFamilies[device->graphicsQueueFamily].timestampValidBits;
+
+	gpuTimestampsSupported = validBits > 0 && properties.limits.timestampPeriod > 0.0f;
+	timestampPeriodNs = properties.limits.timestampPeriod;
+	timestampMask = validBits >= 64 ? ~0ull : (1ull << validBits) - 1;
+
+	if (!gpuTimestampsSupported)
+	{
+		std::cout << "GPU timestamps are not supported by the graphics queue, profiling CPU scopes only" << std::endl;
+	}
+
+	CreateQueryPools(framesInFlight);
+}
+
+Profiler::~Profiler()
+{
+	DestroyQueryPools();
+}
+
+void Profiler::CreateQueryPools(uint32_t framesInFlight)
+{
+	queryPools.assign(framesInFlight, VK_NULL_HANDLE);
+	pendingFrames.assign(framesInFlight, PendingFrame());
+
+	if (!gpuTimestampsSupported)
+		return;
+
+	VkQueryPoolCreateInfo poolInfo{};
+	poolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+	poolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+	poolInfo.queryCount = maxQueriesPerFrame;
+
+	for (VkQueryPool& pool : queryPools)
+	{
+		if (vkCreateQueryPool(device->GetLogical(), &poolInfo, nullptr, &pool) != VK_SUCCESS)
+		{
+			std::cerr << "Failed to create timestamp query pool" << std::endl;
+			gpuTimestampsSupported = false;
+			return;
+		}
+	}
+}
+
+void Profiler::DestroyQueryPools()
+{
+	for (VkQueryPool pool : queryPools)
+	{
+		if (pool != VK_NULL_HANDLE)
+			vkDestroyQueryPool(device->GetLogical(), pool, nullptr);
+	}
+
+	queryPools.clear();
+	pendingFrames.clear();
+}
+
+void Profiler::RecreateFrameResources(uint32_t framesInFlight)
+{
+	DestroyQueryPools();
+	CreateQueryPools(framesInFlight);
+
+	frameOpen = false;
+	currentFrameIndex = 0;
+}
+
+std::deque<ProfileFrame> Profiler::GetHistory() const
+{
+	std::lock_guard<std::mutex> lock(historyMutex);
+	return history;
+}
+
+void Profiler::BeginFrame(uint32_t frameIndex)
+{
+	// A frame that never reached EndFrame (e.g. a swap chain recreation) is dropped
+	frameStart = std::chrono::steady_clock::now();
+
+	std::lock_guard<std::mutex> lock(cpuEventMutex);
+
+	currentFrame = PendingFrame();
+	currentFrame.frame.frameNumber = frameCounter++;
+	currentFrame.frame.startUs = ToMs(frameStart - epoch) * 1000.0;
+	currentFrameIndex = frameIndex;
+	gpuScopeStack.clear();
+	frameOpen = true;
+}
+
+void Profiler::EndFrame()
+{
+	if (!frameOpen)
+		return;
+
+	std::lock_guard<std::mutex> lock(cpuEventMutex);
+
+	currentFrame.frame.cpuFrameMs = ToMs(std::chrono::steady_clock::now() - frameStart);
+	currentFrame.valid = true;
+	frameOpen = false;
+
+	if (currentFrameIndex < pendingFrames.size())
+		pendingFrames[currentFrameIndex] = std::move(currentFrame);
+}
+
+void Profiler::RecordQueryReset(VkCommandBuffer commandBuffer)
+{
+	if (!frameOpen || currentFrameIndex >= pendingFrames.size())
+		return;
+
+	ResolvePendingFrame(currentFrameIndex);
+
+	if (gpuTimestampsSupported)
+		vkCmdResetQueryPool(commandBuffer, queryPools[currentFrameIndex], 0, maxQueriesPerFrame);
+}
+
+void Profiler::ResolvePendingFrame(uint32_t frameIndex)
+{
+	PendingFrame& pending = pendingFrames[frameIndex];
+	if (!pending.valid)
+		return;
+
+	ProfileFrame& frame = pending.frame;
+
+	if (pending.queryCount > 0)
+	{
+		std::vector<uint64_t> timestamps(pending.queryCount);
+
+		// No WAIT flag, the frame slot has already been waited on so the results should be available
+		VkResult result = vkGetQueryPoolResults(device->GetLogical(), queryPools[frameIndex], 0, pending.queryCount,
+			timestamps.size() * sizeof(uint64_t), timestamps.data(), sizeof(uint64_t), VK_QUERY_RESULT_64_BIT);
+
+		if (result == VK_SUCCESS)
+		{
+			uint64_t frameBegin = timestamps[0] & timestampMask;
+			double frameEndMs = 0.0;
+
+			for (const GpuScope& scope : pending.gpuScopes)
+			{
+				if (scope.endQuery == UINT32_MAX)
+					continue;
+
+				uint64_t begin = timestamps[scope.beginQuery] & timestampMask;
+				uint64_t end = timestamps[scope.endQuery] & timestampMask;
+
+				double startMs = static_cast<double>(begin - frameBegin) * timestampPeriodNs / 1e6;
+				double durationMs = static_cast<double>(end - begin) * timestampPeriodNs / 1e6;
+
+				frame.gpuEvents.push_back({scope.name, 0, scope.depth, startMs, durationMs});
+				frameEndMs = std::max(frameEndMs, startMs + durationMs);
+			}
+
+			frame.gpuFrameMs = frameEndMs;
+		}
+	}
+
+	if (!paused)
+	{
+		std::lock_guard<std::mutex> lock(historyMutex);
+
+		history.push_back(std::move(frame));
+		if (history.size() > maxHistoryFrames)
+			history.pop_front();
+	}
+
+	pending = PendingFrame();
+}
+
+void Profiler::BeginCpuScope(const char* name)
+{
+	threadScopes.stack.push_back({name, std::chrono::steady_clock::now()});
+}
+
+void Profiler::EndCpuScope()
+{
+	if (threadScopes.stack.empty())
+		return;
+
+	OpenCpuScope scope = threadScopes.stack.back();
+	threadScopes.stack.pop_back();
+
+	auto end = std::chrono::steady_clock::now();
+
+	std::lock_guard<std::mutex> lock(cpuEventMutex);
+	if (!frameOpen)
+		return;
+
+	ProfileEvent event{};
+	event.name = scope.name;
+	event.threadIndex = threadScopes.threadIndex;
+	event.depth = static_cast<uint32_t>(threadScopes.stack.size());
+	event.startMs = ToMs(scope.start - frameStart);
+	event.durationMs = ToMs(end - scope.start);
+
+	currentFrame.frame.cpuEvents.push_back(event);
+}
+
+void Profiler::BeginGpuScope(VkCommandBuffer commandBuffer, const char* name)
+{
+	if (!gpuTimestampsSupported || !frameOpen)
+		return;
+
+	// Out of queries, the scope is kept on the stack so its matching end still pops correctly
+	if (currentFrame.queryCount + 2 > maxQueriesPerFrame)
+	{
+		gpuScopeStack.push_back(UINT32_MAX);
+		return;
+	}
+
+	GpuScope scope{};
+	scope.name = name;
+	scope.depth = static_cast<uint32_t>(gpuScopeStack.size());
+	scope.beginQuery = currentFrame.queryCount++;
+	scope.endQuery = UINT32_MAX;
+
+	vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, queryPools[currentFrameIndex], scope.beginQuery);
+
+	gpuScopeStack.push_back(static_cast<uint32_t>(currentFrame.gpuScopes.size()));
+	currentFrame.gpuScopes.push_back(scope);
+}
+
+void Profiler::EndGpuScope(VkCommandBuffer commandBuffer)
+{
+	if (!gpuTimestampsSupported || !frameOpen || gpuScopeStack.empty())
+		return;
+
+	uint32_t scopeIndex = gpuScopeStack.back();
+	gpuScopeStack.pop_back();
+
+	if (scopeIndex == UINT32_MAX)
+		return;
+
+	GpuScope& scope = currentFrame.gpuScopes[scopeIndex];
+	scope.endQuery = currentFrame.queryCount++;
+
+	vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, queryPools[currentFrameIndex], scope.endQuery);
+}
+
+void Profiler::DrawImGui()
+{
+	std::unique_lock<std::mutex> lock(historyMutex);
+
+	if (history.empty())
+	{
+		ImGui::Text("Waiting for the first resolved frame");
+		return;
+	}
+
+	const ProfileFrame& latest = history.back();
+
+	ImGui::Text("CPU frame: %.2f ms", latest.cpuFrameMs);
+	ImGui::Text("GPU frame: %.2f ms", latest.gpuFrameMs);
+
+	std::vector<float> cpuTimes;
+	std::vector<float> gpuTimes;
+	cpuTimes.reserve(history.size());
+	gpuTimes.reserve(history.size());
+
+	float maxTime = 0.0f;
+	for (const ProfileFrame& frame : history)
+	{
+		cpuTimes.push_back(static_cast<float>(frame.cpuFrameMs));
+		gpuTimes.push_back(static_cast<float>(frame.gpuFrameMs));
+		maxTime = std::max({maxTime, cpuTimes.back(), gpuTimes.back()});
+	}
+
+	// Shared scale so the two histograms can be compared at a glance
+	ImVec2 plotSize(0.0f, 50.0f);
+	ImGui::PlotHistogram("CPU ms", cpuTimes.data(), static_cast<int>(cpuTimes.size()), 0, nullptr, 0.0f, maxTime, plotSize);
+	ImGui::PlotHistogram("GPU ms", gpuTimes.data(), static_cast<int>(gpuTimes.size()), 0, nullptr, 0.0f, maxTime, plotSize);
+
+	bool pause = paused;
+	if (ImGui::Checkbox("Pause", &pause))
+		paused = pause;
+
+	ImGui::SameLine();
+	bool saveTrace = ImGui::Button("Save Chrome trace");
+
+	// Both lanes share one time scale so CPU and GPU cost line up
+	double frameMs = std::max(latest.cpuFrameMs, latest.gpuFrameMs);
+
+	uint32_t threadCount = 0;
+	for (const ProfileEvent& event : latest.cpuEvents)
+		threadCount = std::max(threadCount, event.threadIndex + 1);
+
+	for (uint32_t thread = 0; thread < threadCount; thread++)
+	{
+		std::string label = "CPU thread " + std::to_string(thread);
+		DrawFlameLane(label.c_str(), latest.cpuEvents, thread, frameMs);
+	}
+
+	DrawFlameLane("GPU", latest.gpuEvents, 0, frameMs);
+
+	// WriteChromeTrace takes the history lock itself
+	lock.unlock();
+
+	if (saveTrace)
+	{
+		WriteChromeTrace("profile_trace.json");
+	}
+}
+
+bool Profiler::WriteChromeTrace(const std::string& path) const
+{
+	std::ofstream file(path);
+	if (!file)
+	{
+		std::cerr << "Failed to open trace file " << path << std::endl;
+		return false;
+	}
+
+	std::lock_guard<std::mutex> lock(historyMutex);
+
+	file << std::fixed << std::setprecision(3);
+	file << "{\"traceEvents\":[\n";
+	file << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":0,\"args\":{\"name\":\"CPU\"}},\n";
+	file << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"GPU\"}}";
+
+	// GPU clocks are not calibrated against the CPU, GPU events are placed relative to their CPU frame start
+	for (const ProfileFrame& frame : history)
+	{
+		for (int pid = 0; pid < 2; pid++)
+		{
+			const std::vector<ProfileEvent>& events = pid == 0 ? frame.cpuEvents : frame.gpuEvents;
+
+			for (const ProfileEvent& event : events)
+			{
+				file << ",\n{\"name\":";
+				WriteJsonString(file, event.name);
+				file << ",\"ph\":\"X\",\"pid\":" << pid << ",\"tid\":" << event.threadIndex;
+				file << ",\"ts\":" << frame.startUs + event.startMs * 1000.0;
+				file << ",\"dur\":" << event.durationMs * 1000.0;
+				file << ",\"args\":{\"frame\":" << frame.frameNumber << "}}";
+			}
+		}
+	}
+
+	file << "\n]}\n";
+
+	std::cout << "Wrote " << history.size() << " profiled frames to " << path << std::endl;
+	return true;
+}
+
+ProfileScope::ProfileScope(Profiler* profiler, const char* name)
+	: profiler(profiler)
+{
+	if (profiler)
+		profiler->BeginCpuScope(name);
+}
+
+ProfileScope::~ProfileScope()
+{
+	if (profiler)
+		profiler->EndCpuScope();
+}
\ No newline at end of file
@@ -0,0 +1,831 @@
+#include <RenderGraph.h>
+
+#include <iostream>
+#include <algorithm>
+
+#include <VulkanHelpers.h>
+#include <VulkanDevice.h>
+#include <VulkanImage.h>
+#include <Profiler.h>
+#include <VulkanSync.h>
+
+using namespace VulkanRenderer;
+
+namespace
+{
+	constexpr VkAccessFlags2 writeAccessFlags =
+		VK_ACCESS_2_SHADER_WRITE_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT | VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT |
+		VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT | VK_ACCESS_2_TRANSFER_WRITE_BIT | VK_ACCESS_2_HOST_WRITE_BIT |
+		VK_ACCESS_2_MEMORY_WRITE_BIT;
+}
+
+RenderGraphPass::RenderGraphPass(const char* name)
+	: name(name)
+{
+
+}
+
+void RenderGraphPass::AddUse(const ResourceUse& use)
+{
+	uses.push_back(use);
+}
+
+bool RenderGraphPass::HasAttachments() const
+{
+	return !colorAttachments.empty() || depthAttachment.has_value();
+}
+
+RenderGraphPass& RenderGraphPass::WriteColor(RenderGraphResource resource, bool clear, VkClearColorValue clearValue)
+{
+	Attachment attachment{};
+	attachment.resource = resource;
+	attachment.loadOp = clear ? VK_ATTACHMENT_LOAD_OP_CLEAR : VK_ATTACHMENT_LOAD_OP_LOAD;
+	attachment.clearValue.color = clearValue;
+	colorAttachments.push_back(attachment);
+
+	// A cleared attachment is never read, blending and loads are the only color reads
+	VkAccessFlags2 accessMask = clear ? VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT : VK_ACCESS_2_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT;
+	AddUse({resource, VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT, accessMask, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT, !clear, true});
+	return *this;
+}
+
+RenderGraphPass& RenderGraphPass::WriteDepth(RenderGraphResource resource, bool clear, float clearDepth)
+{
+	Attachment attachment{};
+	attachment.resource = resource;
+	attachment.loadOp = clear ? VK_ATTACHMENT_LOAD_OP_CLEAR : VK_ATTACHMENT_LOAD_OP_LOAD;
+	attachment.clearValue.depthStencil = { clearDepth, 0 };
+	depthAttachment = attachment;
+
+	ImageLayoutAccess access = GetLayoutAccess(VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL);
+	AddUse({resource, access.stageMask, access.accessMask, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, !clear, true});
+	return *this;
+}
+
+RenderGraphPass& RenderGraphPass::ReadTexture(RenderGraphResource resource, VkPipelineStageFlags2 stageMask)
+{
+	AddUse({resource, stageMask, VK_ACCESS_2_SHADER_SAMPLED_READ_BIT, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_USAGE_SAMPLED_BIT, true, false});
+	return *this;
+}
+
+RenderGraphPass& RenderGraphPass::ReadTransfer(RenderGraphResource resource)
+{
+	AddUse({resource, VK_PIPELINE_STAGE_2_COPY_BIT, VK_ACCESS_2_TRANSFER_READ_BIT, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_SRC_BIT, true, false});
+	return *this;
+}
+
+RenderGraphPass& RenderGraphPass::WriteStorage(RenderGraphResource resource, VkPipelineStageFlags2 stageMask)
+{
+	AddUse({resource, stageMask, VK_ACCESS_2_SHADER_STORAGE_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT, VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_USAGE_STORAGE_BIT, false, true});
+	return *this;
+}
+
+RenderGraphPass& RenderGraphPass::WriteTransfer(RenderGraphResource resource)
+{
+	AddUse({resource, VK_PIPELINE_STAGE_2_COPY_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_DST_BIT, false, true});
+	return *this;
+}
+
+RenderGraphPass& RenderGraphPass::SetSideEffects()
+{
+	sideEffects = true;
+	return *this;
+}
+
+RenderGraphPass& RenderGraphPass::SetExecute(std::function<void(VkCommandBuffer commandBuffer, VkExtent2D extent)> callback)
+{
+	execute = std::move(callback);
+	return *this;
+}
+
+RenderGraph::RenderGraph(VulkanDevice* device)
+	: device(device)
+{
+
+}
+
+RenderGraph::~RenderGraph()
+{
+	DestroyPhysicalResources(true);
+}
+
+void RenderGraph::SetProfiler(Profiler* frameProfiler)
+{
+	profiler = frameProfiler;
+}
+
+void RenderGraph::SetSync(VulkanSync* frameSync)
+{
+	sync = frameSync;
+}
+
+VkImageView RenderGraph::GetImageView(RenderGraphResource resource) const
+{
+	return resources[resource].imageView;
+}
+
+uint32_t RenderGraph::GetCulledPassCount() const
+{
+	return culledPassCount;
+}
+
+VkDeviceSize RenderGraph::GetTransientMemorySize() const
+{
+	VkDeviceSize size = 0;
+	for (const MemoryBlock& block : memoryBlocks)
+		size += block.size;
+	return size;
+}
+
+VkDeviceSize RenderGraph::GetUnaliasedTransientMemorySize() const
+{
+	return unaliasedMemorySize;
+}
+
+void RenderGraph::Reset()
+{
+	DestroyPhysicalResources(false);
+
+	resources.clear();
+	passes.clear();
+
+	culledPassCount = 0;
+	unaliasedMemorySize = 0;
+}
+
+void RenderGraph::DestroyPhysicalResources(bool immediate)
+{
+	VkDevice logicalDevice = device->GetLogical();
+
+	// Gather the handles first so they can outlive the graph's bookkeeping when retired
+	std::vector<VkFramebuffer> framebuffers;
+	std::vector<VkRenderPass> renderPasses;
+	std::vector<VulkanImage*> views;
+	std::vector<VkImage> images;
+	std::vector<VkDeviceMemory> memories;
+
+	for (auto& [key, framebuffer] : framebufferCache)
+		framebuffers.push_back(framebuffer);
+	framebufferCache.clear();
+
+	for (std::unique_ptr<RenderGraphPass>& pass : passes)
+	{
+		if (pass->renderPass != VK_NULL_HANDLE)
+			renderPasses.push_back(pass->renderPass);
+		pass->renderPass = VK_NULL_HANDLE;
+	}
+
+	for (Resource& resource : resources)
+	{
+		if (resource.imported)
+			continue;
+
+		if (resource.view)
+			views.push_back(resource.view);
+		resource.view = nullptr;
+
+		if (resource.image != VK_NULL_HANDLE)
+			images.push_back(resource.image);
+		resource.image = VK_NULL_HANDLE;
+		resource.imageView = VK_NULL_HANDLE;
+	}
+
+	for (MemoryBlock& block : memoryBlocks)
+		memories.push_back(block.memory);
+	memoryBlocks.clear();
+
+	auto destroy = [logicalDevice, framebuffers, renderPasses, views, images, memories]()
+	{
+		for (VkFramebuffer framebuffer : framebuffers)
+			vkDestroyFramebuffer(logicalDevice, framebuffer, nullptr);
+		for (VkRenderPass renderPass : renderPasses)
+			vkDestroyRenderPass(logicalDevice, renderPass, nullptr);
+		for (VulkanImage* view : views)
+			delete view;
+		for (VkImage image : images)
+			vkDestroyImage(logicalDevice, image, nullptr);
+		for (VkDeviceMemory memory : memories)
+			vkFreeMemory(logicalDevice, memory, nullptr);
+	};
+
+	// Frames still in flight may reference any of these, let them finish before the objects go away
+	if (!immediate && sync)
+		sync->Retire(sync->GetSubmittedFrameValue(), destroy);
+	else
+		destroy();
+}
+
+RenderGraphResource RenderGraph::ImportImage(const char* name, VkFormat format, VkExtent2D extent, const RenderGraphImageState& initialState, VkImageLayout finalLayout)
+{
+	Resource resource{};
+	resource.name = name;
+	resource.format = format;
+	resource.extent = extent;
+	resource.imported = true;
+	resource.initialState = initialState;
+	resource.finalLayout = finalLayout;
+
+	resources.push_back(resource);
+	return static_cast<RenderGraphResource>(resources.size() - 1);
+}
+
+void RenderGraph::BindImportedImage(RenderGraphResource resource, VkImage image, VkImageView imageView)
+{
+	resources[resource].image = image;
+	resources[resource].imageView = imageView;
+}
+
+RenderGraphResource RenderGraph::CreateImage(const char* name, VkFormat format, VkExtent2D extent)
+{
+	Resource resource{};
+	resource.name = name;
+	resource.format = format;
+	resource.extent = extent;
+	resource.imported = false;
+
+	resources.push_back(resource);
+	return static_cast<RenderGraphResource>(resources.size() - 1);
+}
+
+RenderGraphPass& RenderGraph::AddPass(const char* name)
+{
+	passes.push_back(std::unique_ptr<RenderGraphPass>(new RenderGraphPass(name)));
+	return *passes.back();
+}
+
+void RenderGraph::Compile()
+{
+	DestroyPhysicalResources(false);
+
+	CullPasses();
+	ComputeLifetimes();
+	AllocateTransients();
+	CreateRenderPasses();
+}
+
+void RenderGraph::CullPasses()
+{
+	// Reference counting from the outputs back: imported images and side effects are the roots
+	for (Resource& resource : resources)
+		resource.refCount = resource.imported ? 1 : 0;
+
+	for (std::unique_ptr<RenderGraphPass>& pass : passes)
+	{
+		pass->culled = false;
+		pass->refCount = pass->sideEffects ? 1 : 0;
+
+		for (const RenderGraphPass::ResourceUse& use : pass->uses)
+		{
+			if (use.writes)
+				pass->refCount++;
+			if (use.reads)
+				resources[use.resource].refCount++;
+		}
+	}
+
+	std::vector<RenderGraphResource> unreferenced;
+	for (RenderGraphResource i = 0; i < resources.size(); i++)
+	{
+		if (resources[i].refCount == 0)
+			unreferenced.push_back(i);
+	}
+
+	while (!unreferenced.empty())
+	{
+		RenderGraphResource resource = unreferenced.back();
+		unreferenced.pop_back();
+
+		for (std::unique_ptr<RenderGraphPass>& pass : passes)
+		{
+			if (pass->culled)
+				continue;
+
+			bool writesResource = std::any_of(pass->uses.begin(), pass->uses.end(), [resource](const RenderGraphPass::ResourceUse& use)
+			{
+				return use.resource == resource && use.writes;
+			});
+
+			if (!writesResource || --pass->refCount > 0)
+				continue;
+
+			pass->culled = true;
+
+			for (const RenderGraphPass::ResourceUse& use : pass->uses)
+			{
+				if (use.reads && --resources[use.resource].refCount == 0)
+					unreferenced.push_back(use.resource);
+			}
+		}
+	}
+
+	culledPassCount = static_cast<uint32_t>(std::count_if(passes.begin(), passes.end(), [](const std::unique_ptr<RenderGraphPass>& pass)
+	{
+		return pass->culled;
+	}));
+}
+
+void RenderGraph::ComputeLifetimes()
+{
+	for (Resource& resource : resources)
+	{
+		resource.firstPass = UINT32_MAX;
+		resource.lastPass = 0;
+		resource.usage = 0;
+	}
+
+	for (uint32_t passIndex = 0; passIndex < passes.size(); passIndex++)
+	{
+		RenderGraphPass& pass = *passes[passIndex];
+		if (pass.culled)
+			continue;
+
+		for (const RenderGraphPass::ResourceUse& use : pass.uses)
+		{
+			Resource& resource = resources[use.resource];
+			resource.firstPass = std::min(resource.firstPass, passIndex);
+			resource.lastPass = std::max(resource.lastPass, passIndex);
+			resource.usage |= use.usage;
+		}
+	}
+}
+
+void RenderGraph::AllocateTransients()
+{
+	VkDevice logicalDevice = device->GetLogical();
+
+	std::vector<RenderGraphResource> transients;
+	unaliasedMemorySize = 0;
+
+	for (RenderGraphResource i = 0; i < resources.size(); i++)
+	{
+		Resource& resource = resources[i];
+		if (resource.imported || resource.firstPass == UINT32_MAX)
+			continue;
+
+		VkImageCreateInfo imageInfo{};
+		imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+		imageInfo.imageType = VK_IMAGE_TYPE_2D;
+		imageInfo.extent = { resource.extent.width, resource.extent.height, 1 };
+		imageInfo.mipLevels = 1;
+		imageInfo.arrayLayers = 1;
+		imageInfo.format = resource.format;
+		imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+		imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		imageInfo.usage = resource.usage;
+		imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+		imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+		if (vkCreateImage(logicalDevice, &imageInfo, nullptr, &resource.image) != VK_SUCCESS)
+		{
+			std::cerr << "Failed to create render graph image " << resource.name << std::endl;
+			continue;
+		}
+
+		vkGetImageMemoryRequirements(logicalDevice, resource.image, &resource.memoryRequirements);
+		unaliasedMemorySize += resource.memoryRequirements.size;
+
+		transients.push_back(i);
+	}
+
+	// Largest first, so every block is sized by its first image and later aliases always fit at offset 0
+	std::sort(transients.begin(), transients.end(), [this](RenderGraphResource a, RenderGraphResource b)
+	{
+		return resources[a].memoryRequirements.size > resources[b].memoryRequirements.size;
+	});
+
+	for (RenderGraphResource index : transients)
+	{
+		Resource& resource = resources[index];
+		const VkMemoryRequirements& requirements = resource.memoryRequirements;
+
+		for (size_t blockIndex = 0; blockIndex < memoryBlocks.size() && resource.memoryBlock < 0; blockIndex++)
+		{
+			MemoryBlock& block = memoryBlocks[blockIndex];
+
+			if ((block.memoryTypeBits & requirements.memoryTypeBits) == 0 || block.size < requirements.size)
+				continue;
+
+			bool overlaps = std::any_of(block.resources.begin(), block.resources.end(), [this, &resource](RenderGraphResource other)
+			{
+				return resource.firstPass <= resources[other].lastPass && resources[other].firstPass <= resource.lastPass;
+			});
+
+			if (overlaps)
+				continue;
+
+			block.memoryTypeBits &= requirements.memoryTypeBits;
+			block.resources.push_back(index);
+			resource.memoryBlock = static_cast<int>(blockIndex);
+		}
+
+		if (resource.memoryBlock < 0)
+		{
+			MemoryBlock block{};
+			block.size = requirements.size;
+			block.memoryTypeBits = requirements.memoryTypeBits;
+			block.resources.push_back(index);
+
+			memoryBlocks.push_back(block);
+			resource.memoryBlock = static_cast<int>(memoryBlocks.size() - 1);
+		}
+	}
+
+	for (MemoryBlock& block : memoryBlocks)
+	{
+		VkMemoryAllocateInfo allocateInfo{};
+		allocateInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+		allocateInfo.allocationSize = block.size;
+		allocateInfo.memoryTypeIndex = device->FindMemoryType(block.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+		if (vkAllocateMemory(logicalDevice, &allocateInfo, nullptr, &block.memory) != VK_SUCCESS)
+		{
+			std::cerr << "Failed to allocate render graph memory" << std::endl;
+			continue;
+		}
+
+		for (RenderGraphResource index : block.resources)
+		{
+			Resource& resource = resources[index];
+			vkBindImageMemory(logicalDevice, resource.image, block.memory, 0);
+
+			VkImageAspectFlags aspectFlags = GetImageAspectFlags(resource.format);
+			if (aspectFlags & VK_IMAGE_ASPECT_DEPTH_BIT)
+				aspectFlags = VK_IMAGE_ASPECT_DEPTH_BIT;
+
+			resource.view = new VulkanImage(device, resource.image, resource.format, aspectFlags);
+			resource.imageView = resource.view->GetImageView();
+			resource.state = BarrierState();
+		}
+	}
+}
+
+void RenderGraph::CreateRenderPasses()
+{
+	for (uint32_t passIndex = 0; passIndex < passes.size(); passIndex++)
+	{
+		RenderGraphPass& pass = *passes[passIndex];
+		if (pass.culled || pass.uses.empty())
+			continue;
+
+		// Passes run at the size of the first image they touch
+		pass.extent = resources[pass.uses[0].resource].extent;
+
+		if (!pass.HasAttachments())
+			continue;
+
+		// Contents only need to be stored when they outlive the pass: imported images or later readers
+		auto resolveOps = [this, passIndex](RenderGraphPass::Attachment& attachment)
+		{
+			const Resource& resource = resources[attachment.resource];
+
+			bool readLater = false;
+			for (uint32_t later = passIndex + 1; later < passes.size() && !readLater; later++)
+			{
+				if (passes[later]->culled)
+					continue;
+
+				for (const RenderGraphPass::ResourceUse& use : passes[later]->uses)
+				{
+					if (use.resource == attachment.resource && use.reads)
+						readLater = true;
+				}
+			}
+
+			attachment.storeOp = resource.imported || readLater ? VK_ATTACHMENT_STORE_OP_STORE : VK_ATTACHMENT_STORE_OP_DONT_CARE;
+
+			// Loading a transient on its first use would only read undefined memory
+			if (attachment.loadOp == VK_ATTACHMENT_LOAD_OP_LOAD && !resource.imported && resource.firstPass == passIndex)
+				attachment.loadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+		};
+
+		for (RenderGraphPass::Attachment& attachment : pass.colorAttachments)
+			resolveOps(attachment);
+		if (pass.depthAttachment)
+			resolveOps(*pass.depthAttachment);
+
+		// Dynamic rendering takes the formats and ops when recording, no render pass or framebuffer is needed
+		if (!device->dynamicRenderingEnabled)
+			pass.renderPass = CreateRenderPass(pass);
+	}
+}
+
+VkRenderPass RenderGraph::CreateRenderPass(const RenderGraphPass& pass)
+{
+	// Attachments stay in their attachment layout for the whole pass, the graph's barriers do the transitions.
+	// Colors come first and depth last, which keeps the pass compatible with pipelines built against VulkanRenderPass.
+	std::vector<VkAttachmentDescription> attachments;
+	std::vector<VkAttachmentReference> colorReferences;
+	VkAttachmentReference depthReference{};
+
+	for (const RenderGraphPass::Attachment& attachment : pass.colorAttachments)
+	{
+		VkAttachmentDescription description{};
+		description.format = resources[attachment.resource].format;
+		description.samples = VK_SAMPLE_COUNT_1_BIT;
+		description.loadOp = attachment.loadOp;
+		description.storeOp = attachment.storeOp;
+		description.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+		description.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+		description.initialLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+		description.finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
+		colorReferences.push_back({static_cast<uint32_t>(attachments.size()), VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL});
+		attachments.push_back(description);
+	}
+
+	if (pass.depthAttachment)
+	{
+		VkAttachmentDescription description{};
+		description.format = resources[pass.depthAttachment->resource].format;
+		description.samples = VK_SAMPLE_COUNT_1_BIT;
+		description.loadOp = pass.depthAttachment->loadOp;
+		description.storeOp = pass.depthAttachment->storeOp;
+		description.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+		description.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+		description.initialLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+		description.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+		depthReference = {static_cast<uint32_t>(attachments.size()), VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL};
+		attachments.push_back(description);
+	}
+
+	VkSubpassDescription subpass{};
+	subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+	subpass.colorAttachmentCount = static_cast<uint32_t>(colorReferences.size());
+	subpass.pColorAttachments = colorReferences.data();
+	subpass.pDepthStencilAttachment = pass.depthAttachment ? &depthReference : nullptr;
+
+	VkRenderPassCreateInfo renderPassInfo{};
+	renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+	renderPassInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
+	renderPassInfo.pAttachments = attachments.data();
+	renderPassInfo.subpassCount = 1;
+	renderPassInfo.pSubpasses = &subpass;
+
+	VkRenderPass renderPass = VK_NULL_HANDLE;
+	if (vkCreateRenderPass(device->GetLogical(), &renderPassInfo, nullptr, &renderPass) != VK_SUCCESS)
+	{
+		std::cerr << "Failed to create render pass for " << pass.name << std::endl;
+	}
+	return renderPass;
+}
+
+VkFramebuffer RenderGraph::GetFramebuffer(const RenderGraphPass& pass)
+{
+	std::vector<VkImageView> views;
+	for (const RenderGraphPass::Attachment& attachment : pass.colorAttachments)
+		views.push_back(resources[attachment.resource].imageView);
+	if (pass.depthAttachment)
+		views.push_back(resources[pass.depthAttachment->resource].imageView);
+
+	std::vector<uint64_t> key = { reinterpret_cast<uint64_t>(pass.renderPass) };
+	for (VkImageView view : views)
+		key.push_back(reinterpret_cast<uint64_t>(view));
+
+	auto it = framebufferCache.find(key);
+	if (it != framebufferCache.end())
+		return it->second;
+
+	VkFramebufferCreateInfo framebufferInfo{};
+	framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+	framebufferInfo.renderPass = pass.renderPass;
+	framebufferInfo.attachmentCount = static_cast<uint32_t>(views.size());
+	framebufferInfo.pAttachments = views.data();
+	framebufferInfo.width = pass.extent.width;
+	framebufferInfo.height = pass.extent.height;
+	framebufferInfo.layers = 1;
+
+	VkFramebuffer framebuffer = VK_NULL_HANDLE;
+	if (vkCreateFramebuffer(device->GetLogical(), &framebufferInfo, nullptr, &framebuffer) != VK_SUCCESS)
+	{
+		std::cerr << "Failed to create framebuffer for " << pass.name << std::endl;
+	}
+
+	framebufferCache.emplace(std::move(key), framebuffer);
+	return framebuffer;
+}
+
+void RenderGraph::BeginRendering(VkCommandBuffer commandBuffer, const RenderGraphPass& pass)
+{
+	if (pass.renderPass != VK_NULL_HANDLE)
+	{
+		std::vector<VkClearValue> clearValues;
+		for (const RenderGraphPass::Attachment& attachment : pass.colorAttachments)
+			clearValues.push_back(attachment.clearValue);
+		if (pass.depthAttachment)
+			clearValues.push_back(pass.depthAttachment->clearValue);
+
+		VkRenderPassBeginInfo renderPassInfo{};
+		renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+		renderPassInfo.renderPass = pass.renderPass;
+		renderPassInfo.framebuffer = GetFramebuffer(pass);
+		renderPassInfo.renderArea.offset = { 0, 0 };
+		renderPassInfo.renderArea.extent = pass.extent;
+		renderPassInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
+		renderPassInfo.pClearValues = clearValues.data();
+
+		vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+		return;
+	}
+
+	auto makeAttachmentInfo = [this](const RenderGraphPass::Attachment& attachment, VkImageLayout layout)
+	{
+		VkRenderingAttachmentInfo attachmentInfo{};
+		attachmentInfo.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO;
+		attachmentInfo.imageView = resources[attachment.resource].imageView;
+		attachmentInfo.imageLayout = layout;
+		attachmentInfo.loadOp = attachment.loadOp;
+		attachmentInfo.storeOp = attachment.storeOp;
+		attachmentInfo.clearValue = attachment.clearValue;
+		return attachmentInfo;
+	};
+
+	std::vector<VkRenderingAttachmentInfo> colorAttachments;
+	for (const RenderGraphPass::Attachment& attachment : pass.colorAttachments)
+		colorAttachments.push_back(makeAttachmentInfo(attachment, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL));
+
+	VkRenderingAttachmentInfo depthAttachment{};
+	if (pass.depthAttachment)
+		depthAttachment = makeAttachmentInfo(*pass.depthAttachment, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL);
+
+	VkRenderingInfo renderingInfo{};
+	renderingInfo.sType = VK_STRUCTURE_TYPE_RENDERING_INFO;
+	renderingInfo.renderArea.offset = { 0, 0 };
+	renderingInfo.renderArea.extent = pass.extent;
+	renderingInfo.layerCount = 1;
+	renderingInfo.colorAttachmentCount = static_cast<uint32_t>(colorAttachments.size());
+	renderingInfo.pColorAttachments = colorAttachments.data();
+	renderingInfo.pDepthAttachment = pass.depthAttachment ? &depthAttachment : nullptr;
+
+	vkCmdBeginRendering(commandBuffer, &renderingInfo);
+}
+
+void RenderGraph::EndRendering(VkCommandBuffer commandBuffer, const RenderGraphPass& pass)
+{
+	if (pass.renderPass != VK_NULL_HANDLE)
+		vkCmdEndRenderPass(commandBuffer);
+	else
+		vkCmdEndRendering(commandBuffer);
+}
+
+bool RenderGraph::AddBarrier(const RenderGraphPass::ResourceUse& use, std::vector<VkImageMemoryBarrier2>& barriers)
+{
+	Resource& resource = resources[use.resource];
+	BarrierState& state = resource.state;
+
+	// First use this frame: imported images start from their declared state, transients wait on whatever last
+	// used their memory (an alias or the previous frame) and never keep their contents
+	if (!state.usedThisFrame)
+	{
+		state = BarrierState();
+		state.usedThisFrame = true;
+
+		if (resource.imported)
+		{
+			state.layout = use.reads ? resource.initialState.layout : VK_IMAGE_LAYOUT_UNDEFINED;
+			state.writeStageMask = resource.initialState.stageMask;
+			state.writeAccessMask = resource.initialState.accessMask;
+		}
+		else
+		{
+			const MemoryBlock& block = memoryBlocks[resource.memoryBlock];
+			state.writeStageMask = block.stageMask;
+			state.writeAccessMask = block.accessMask;
+		}
+	}
+
+	bool layoutChange = state.layout != use.layout;
+	VkImageLayout oldLayout = state.layout;
+	VkPipelineStageFlags2 srcStages;
+	VkAccessFlags2 srcAccess;
+
+	if (!use.writes && !layoutChange)
+	{
+		// Read after read in the same layout only needs a barrier if this stage has not seen the last write yet
+		if ((state.readStageMask & use.stageMask) == use.stageMask && (state.readAccessMask & use.accessMask) == use.accessMask)
+			return false;
+
+		srcStages = state.writeStageMask;
+		srcAccess = state.writeAccessMask;
+
+		state.readStageMask |= use.stageMask;
+		state.readAccessMask |= use.accessMask;
+	}
+	else
+	{
+		// Writes and layout transitions wait for every earlier reader and writer
+		srcStages = state.writeStageMask | state.readStageMask;
+		srcAccess = state.writeAccessMask;
+
+		state.layout = use.layout;
+		state.writeStageMask = use.stageMask;
+		state.writeAccessMask = use.writes ? (use.accessMask & writeAccessFlags) : 0;
+		state.readStageMask = use.writes ? 0 : use.stageMask;
+		state.readAccessMask = use.writes ? 0 : use.accessMask;
+	}
+
+	if (!resource.imported)
+	{
+		MemoryBlock& block = memoryBlocks[resource.memoryBlock];
+		block.stageMask = state.writeStageMask | state.readStageMask;
+		block.accessMask = state.writeAccessMask;
+	}
+
+	VkImageMemoryBarrier2 barrier{};
+	barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2;
+	barrier.srcStageMask = srcStages;
+	barrier.srcAccessMask = srcAccess;
+	barrier.dstStageMask = use.stageMask;
+	barrier.dstAccessMask = use.accessMask;
+	barrier.oldLayout = oldLayout;
+	barrier.newLayout = use.layout;
+	barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.image = resource.image;
+	barrier.subresourceRange.aspectMask = GetImageAspectFlags(resource.format);
+	barrier.subresourceRange.baseMipLevel = 0;
+	barrier.subresourceRange.levelCount = VK_REMAINING_MIP_LEVELS;
+	barrier.subresourceRange.baseArrayLayer = 0;
+	barrier.subresourceRange.layerCount = 1;
+
+	barriers.push_back(barrier);
+	return true;
+}
+
+void RenderGraph::AddFinalTransitions(VkCommandBuffer commandBuffer)
+{
+	std::vector<VkImageMemoryBarrier2> barriers;
+
+	for (Resource& resource : resources)
+	{
+		if (!resource.imported || !resource.state.usedThisFrame || resource.state.layout == resource.finalLayout)
+			continue;
+
+		// Presentation and later submissions synchronize through semaphores, nothing in this command buffer waits
+		VkImageMemoryBarrier2 barrier{};
+		barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2;
+		barrier.srcStageMask = resource.state.writeStageMask | resource.state.readStageMask;
+		barrier.srcAccessMask = resource.state.writeAccessMask;
+		barrier.dstStageMask = VK_PIPELINE_STAGE_2_NONE;
+		barrier.dstAccessMask = VK_ACCESS_2_NONE;
+		barrier.oldLayout = resource.state.layout;
+		barrier.newLayout = resource.finalLayout;
+		barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.image = resource.image;
+		barrier.subresourceRange.aspectMask = GetImageAspectFlags(resource.format);
+		barrier.subresourceRange.baseMipLevel = 0;
+		barrier.subresourceRange.levelCount = VK_REMAINING_MIP_LEVELS;
+		barrier.subresourceRange.baseArrayLayer = 0;
+		barrier.subresourceRange.layerCount = 1;
+
+		barriers.push_back(barrier);
+		resource.state.layout = resource.finalLayout;
+	}
+
+	RecordPipelineBarrier(device, commandBuffer, barriers);
+}
+
+void RenderGraph::Execute(VkCommandBuffer commandBuffer)
+{
+	for (Resource& resource : resources)
+		resource.state.usedThisFrame = false;
+
+	std::vector<VkImageMemoryBarrier2> barriers;
+
+	for (std::unique_ptr<RenderGraphPass>& passPointer : passes)
+	{
+		RenderGraphPass& pass = *passPointer;
+		if (pass.culled)
+			continue;
+
+		if (profiler)
+			profiler->BeginGpuScope(commandBuffer, pass.name);
+
+		// All of a pass's barriers go into a single barrier call
+		barriers.clear();
+		for (const RenderGraphPass::ResourceUse& use : pass.uses)
+			AddBarrier(use, barriers);
+
+		RecordPipelineBarrier(device, commandBuffer, barriers);
+
+		if (pass.HasAttachments())
+		{
+			BeginRendering(commandBuffer, pass);
+
+			if (pass.execute)
+				pass.execute(commandBuffer, pass.extent);
+
+			EndRendering(commandBuffer, pass);
+		}
+		else if (pass.execute)
+		{
+			pass.execute(commandBuffer, pass.extent);
+		}
+
+		if (profiler)
+			profiler->EndGpuScope(commandBuffer);
+	}
+
+	AddFinalTransitions(commandBuffer);
+}
\ No newline at end of file
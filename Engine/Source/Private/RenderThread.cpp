@@ -0,0 +1,69 @@
+#include <RenderThread.h>
+
+using namespace VulkanRenderer;
+
+RenderThread::RenderThread(std::function<void(FramePacket& packet)> drawFrame)
+	: drawFrame(drawFrame)
+{
+	pendingPacket = std::make_unique<FramePacket>();
+	drawingPacket = std::make_unique<FramePacket>();
+
+	thread = std::thread(&RenderThread::Run, this);
+}
+
+RenderThread::~RenderThread()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	condition.notify_all();
+
+	thread.join();
+}
+
+void RenderThread::Submit(std::unique_ptr<FramePacket>& packet)
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	condition.wait(lock, [this]() { return !packetPending; });
+
+	std::swap(pendingPacket, packet);
+	packetPending = true;
+
+	lock.unlock();
+	condition.notify_all();
+}
+
+void RenderThread::WaitIdle()
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	condition.wait(lock, [this]() { return !packetPending && !drawing; });
+}
+
+void RenderThread::Run()
+{
+	std::unique_lock<std::mutex> lock(mutex);
+
+	while (true)
+	{
+		condition.wait(lock, [this]() { return packetPending || stopping; });
+
+		// A pending packet is still drawn when stopping so the last submitted frame is presented
+		if (!packetPending)
+			break;
+
+		// The finished packet goes back into the pending slot for the main thread to refill
+		std::swap(drawingPacket, pendingPacket);
+		packetPending = false;
+		drawing = true;
+
+		lock.unlock();
+		condition.notify_all();
+
+		drawFrame(*drawingPacket);
+
+		lock.lock();
+		drawing = false;
+		condition.notify_all();
+	}
+}
\ No newline at end of file
@@ -1,16 +1,18 @@
 #include <Shader.h>
 
 #include <iostream>
-#include <fstream>
+
+#include <FileSystem.h>
 
 using namespace VulkanRenderer;
 
 Shader::Shader(VkDevice device, const std::string& filePath, VkShaderStageFlagBits stageFlag)
 	: device(device)
 {
-	std::vector<char> code = ReadFile(filePath);
-
-	CreateShaderModule(code);
+	// SPIR-V is read as 32-bit words, pak entries and mappings are aligned well past that
+	FileData code;
+	if (FileSystem::ReadFile(filePath, code))
+		CreateShaderModule(code.GetData(), code.GetSize());
 
 	stageCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
 	stageCreateInfo.stage = stageFlag;
@@ -29,32 +31,13 @@ const VkPipelineShaderStageCreateInfo& Shader::GetStageCreateInfo() const
 	return stageCreateInfo;
 }
 
-void Shader::CreateShaderModule(const std::vector<char>& code)
+void Shader::CreateShaderModule(const uint8_t* code, size_t codeSize)
 {
 	VkShaderModuleCreateInfo createInfo{};
 	createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-	createInfo.codeSize = code.size();
-	createInfo.pCode = reinterpret_cast<const uint32_t*>(code.data());
+	createInfo.codeSize = codeSize;
+	createInfo.pCode = reinterpret_cast<const uint32_t*>(code);
 
 	if (vkCreateShaderModule(device, &createInfo, nullptr, &shaderModule) != VK_SUCCESS)
 		std::cerr << "Failed to create shader module" << std::endl;
-}
-
-std::vector<char> Shader::ReadFile(const std::string& filePath)
-{
-	std::ifstream file(filePath, std::ios::ate | std::ios::binary);
-	if (!file.is_open())
-	{
-		std::cerr << "Failed to open file: " << filePath << std::endl;
-		return std::vector<char>();
-	}
-
-	size_t fileSize = (size_t)file.tellg();
-	std::vector<char> buffer(fileSize);
-
-	file.seekg(0);
-	file.read(buffer.data(), fileSize);
-	file.close();
-
-	return buffer;
 }
\ No newline at end of file
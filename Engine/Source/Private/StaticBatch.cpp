@@ -0,0 +1,121 @@
+#include <StaticBatch.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cfloat>
+#include <map>
+#include <string>
+#include <tuple>
+
+#include <MeshOptimizer.h>
+
+namespace VulkanRenderer
+{
+	uint32_t AppendTransformedGeometry(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices, const glm::mat4& model, std::vector<Vertex>& outVertices, std::vector<uint32_t>& outIndices)
+	{
+		glm::mat3 linear = glm::mat3(model);
+		glm::mat3 normalMatrix = glm::transpose(glm::inverse(linear));
+		bool mirrored = glm::determinant(linear) < 0.0f;
+
+		uint32_t baseVertex = static_cast<uint32_t>(outVertices.size());
+		for (const Vertex& vertex : vertices)
+		{
+			Vertex transformed = vertex;
+			transformed.position = glm::vec3(model * glm::vec4(vertex.position, 1.0f));
+			transformed.normal = glm::normalize(normalMatrix * vertex.normal);
+			transformed.tangent = glm::vec4(glm::normalize(linear * glm::vec3(vertex.tangent)), mirrored ? -vertex.tangent.w : vertex.tangent.w);
+
+			outVertices.push_back(transformed);
+		}
+
+		for (size_t i = 0; i + 2 < indices.size(); i += 3)
+		{
+			outIndices.push_back(baseVertex + indices[i]);
+			outIndices.push_back(baseVertex + indices[mirrored ? i + 2 : i + 1]);
+			outIndices.push_back(baseVertex + indices[mirrored ? i + 1 : i + 2]);
+		}
+
+		return baseVertex;
+	}
+
+	std::vector<StaticBatch> BuildStaticBatches(const std::vector<StaticMeshSource>& sources, const StaticBatchSettings& settings)
+	{
+		// Keyed by material, then cell, ordered so the same scene always yields the same batches
+		std::map<std::tuple<std::string, int, int, int>, std::vector<uint32_t>> groups;
+
+		for (uint32_t i = 0; i < sources.size(); i++)
+		{
+			const MeshInfo& info = *sources[i].info;
+
+			// Blended meshes are sorted back to front one by one, merging them would break that order
+			if (info.blendMode == BlendMode::Transparent || info.vertices.empty() || !info.ranges.empty())
+				continue;
+
+			glm::vec3 boundsMin(FLT_MAX);
+			glm::vec3 boundsMax(-FLT_MAX);
+			for (const Vertex& vertex : info.vertices)
+			{
+				glm::vec3 position = glm::vec3(sources[i].model * glm::vec4(vertex.position, 1.0f));
+				boundsMin = glm::min(boundsMin, position);
+				boundsMax = glm::max(boundsMax, position);
+			}
+
+			glm::ivec3 cell = glm::ivec3(glm::floor((boundsMin + boundsMax) * 0.5f / settings.cellSize + 0.5f));
+
+			std::string material = info.baseColorPath + "|" + info.roughnessPath + "|" + info.metallicPath + "|" + std::to_string(static_cast<uint32_t>(info.blendMode));
+			groups[{material, cell.x, cell.y, cell.z}].push_back(i);
+		}
+
+		std::vector<StaticBatch> batches;
+
+		for (const auto& [key, members] : groups)
+		{
+			if (members.size() < std::max(settings.minMeshes, 1u))
+				continue;
+
+			StaticBatch batch;
+			batch.sources = members;
+
+			const MeshInfo& material = *sources[members[0]].info;
+			batch.info.baseColorPath = material.baseColorPath;
+			batch.info.roughnessPath = material.roughnessPath;
+			batch.info.metallicPath = material.metallicPath;
+			batch.info.blendMode = material.blendMode;
+
+			for (uint32_t source : members)
+			{
+				const MeshInfo& info = *sources[source].info;
+
+				std::vector<Vertex> vertices = info.vertices;
+				std::vector<uint32_t> indices = info.indices;
+				if (info.optimize)
+				{
+					OptimizeMesh(vertices, indices);
+				}
+
+				MeshRange range;
+				range.indexOffset = static_cast<uint32_t>(batch.info.indices.size());
+				range.indexCount = static_cast<uint32_t>(indices.size());
+
+				uint32_t baseVertex = AppendTransformedGeometry(vertices, indices, sources[source].model, batch.info.vertices, batch.info.indices);
+
+				glm::vec3 boundsMin(FLT_MAX);
+				glm::vec3 boundsMax(-FLT_MAX);
+				for (size_t v = baseVertex; v < batch.info.vertices.size(); v++)
+				{
+					boundsMin = glm::min(boundsMin, batch.info.vertices[v].position);
+					boundsMax = glm::max(boundsMax, batch.info.vertices[v].position);
+				}
+
+				range.center = (boundsMin + boundsMax) * 0.5f;
+				range.radius = glm::length(boundsMax - boundsMin) * 0.5f;
+
+				batch.info.ranges.push_back(range);
+			}
+
+			batches.push_back(std::move(batch));
+		}
+
+		return batches;
+	}
+}
\ No newline at end of file
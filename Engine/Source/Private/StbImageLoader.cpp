@@ -1,2 +1,105 @@
+#include <StbImageLoader.h>
+
+#include <cstdlib>
+#include <cstring>
+
+namespace VulkanRenderer
+{
+	namespace
+	{
+		struct DecodeTarget
+		{
+			uint8_t* data;
+			size_t size;		// Of the decoded pixels
+			size_t capacity;
+			bool handedOut;
+		};
+
+		// Set only while DecodeImage runs on this thread, other stb calls allocate from the heap as usual
+		thread_local DecodeTarget* decodeTarget = nullptr;
+
+		// The final image is the only allocation of the target's size for most formats, if an intermediate buffer
+		// happens to match it is freed or reallocated before the final one is made and the target is handed out again
+		void* StbiMalloc(size_t size)
+		{
+			if (decodeTarget && !decodeTarget->handedOut && size >= decodeTarget->size && size <= decodeTarget->size + DecodeImageSlack && size <= decodeTarget->capacity)
+			{
+				decodeTarget->handedOut = true;
+				return decodeTarget->data;
+			}
+			return malloc(size);
+		}
+
+		void StbiFree(void* pointer)
+		{
+			if (decodeTarget && pointer == decodeTarget->data)
+			{
+				decodeTarget->handedOut = false;
+				return;
+			}
+			free(pointer);
+		}
+
+		void* StbiRealloc(void* pointer, size_t size)
+		{
+			if (decodeTarget && pointer && pointer == decodeTarget->data)
+			{
+				void* moved = malloc(size);
+				if (moved)
+					memcpy(moved, pointer, size < decodeTarget->capacity ? size : decodeTarget->capacity);
+
+				decodeTarget->handedOut = false;
+				return moved;
+			}
+			return realloc(pointer, size);
+		}
+	}
+}
+
+#define STBI_MALLOC(size) VulkanRenderer::StbiMalloc(size)
+#define STBI_REALLOC(pointer, size) VulkanRenderer::StbiRealloc(pointer, size)
+#define STBI_FREE(pointer) VulkanRenderer::StbiFree(pointer)
+
 #define STB_IMAGE_IMPLEMENTATION
 #include <stb_image.h>
+
+namespace VulkanRenderer
+{
+	bool GetImageSize(const uint8_t* data, size_t size, uint32_t& width, uint32_t& height)
+	{
+		int imageWidth, imageHeight, channels;
+		if (!stbi_info_from_memory(data, static_cast<int>(size), &imageWidth, &imageHeight, &channels))
+			return false;
+
+		width = static_cast<uint32_t>(imageWidth);
+		height = static_cast<uint32_t>(imageHeight);
+		return true;
+	}
+
+	bool DecodeImage(const uint8_t* data, size_t size, uint8_t* target, size_t targetCapacity)
+	{
+		uint32_t width, height;
+		if (!GetImageSize(data, size, width, height) || static_cast<size_t>(width) * height * 4 > targetCapacity)
+			return false;
+
+		stbi_set_flip_vertically_on_load(true);
+
+		DecodeTarget decode{target, static_cast<size_t>(width) * height * 4, targetCapacity, false};
+		decodeTarget = &decode;
+
+		int decodedWidth, decodedHeight, channels;
+		stbi_uc* pixels = stbi_load_from_memory(data, static_cast<int>(size), &decodedWidth, &decodedHeight, &channels, STBI_rgb_alpha);
+
+		decodeTarget = nullptr;
+
+		if (!pixels)
+			return false;
+
+		if (pixels != target)
+		{
+			memcpy(target, pixels, decode.size);
+			stbi_image_free(pixels);
+		}
+		return true;
+	}
+}
\ No newline at end of file
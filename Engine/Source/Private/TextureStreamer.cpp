@@ -0,0 +1,480 @@
+#include <TextureStreamer.h>
+
+#include <iostream>
+#include <algorithm>
+#include <cmath>
+
+#include <imgui.h>
+
+#include <VulkanDevice.h>
+#include <VulkanSync.h>
+#include <VulkanImage.h>
+#include <VulkanTexture.h>
+#include <VulkanStagingRing.h>
+#include <FileSystem.h>
+#include <StbImageLoader.h>
+#include <MipChain.h>
+
+namespace VulkanRenderer
+{
+	TextureStreamer::TextureStreamer(VulkanDevice* device, VkDeviceSize budget)
+		: budget(budget), device(device)
+	{
+		decodeThread = std::thread(&TextureStreamer::RunDecodeThread, this);
+	}
+
+	TextureStreamer::~TextureStreamer()
+	{
+		{
+			std::lock_guard<std::mutex> lock(decodeMutex);
+			stopping = true;
+		}
+		decodeCondition.notify_all();
+		decodeThread.join();
+
+		for (const DecodeResult& result : decodeResults)
+		{
+			if (result.decoded)
+				device->GetStagingRing()->Release(result.staging);
+		}
+	}
+
+	uint32_t TextureStreamer::GetTailMip(uint32_t width, uint32_t height)
+	{
+		uint32_t mip = 0;
+		while (std::max(GetMipExtent(width, mip), GetMipExtent(height, mip)) > TailSize)
+			mip++;
+		return mip;
+	}
+
+	void TextureStreamer::SetSync(VulkanSync* frameSync)
+	{
+		sync = frameSync;
+	}
+
+	void TextureStreamer::Register(VulkanTexture* texture)
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+
+		Entry entry{};
+		entry.texture = texture;
+		entry.id = nextId++;
+		entry.tailMip = GetTailMip(texture->width, texture->height);
+		entry.wantedMip = entry.tailMip;
+
+		residentSize += GetResidentSize(entry, texture->residentMip);
+		entries.emplace(texture, entry);
+	}
+
+	void TextureStreamer::Unregister(VulkanTexture* texture)
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+
+		auto it = entries.find(texture);
+		if (it == entries.end())
+			return;
+
+		uint64_t id = it->second.id;
+		residentSize -= GetResidentSize(it->second, texture->residentMip);
+		entries.erase(it);
+
+		// A decode already running finishes and is dropped when its result finds no entry
+		std::lock_guard<std::mutex> decodeLock(decodeMutex);
+		decodeJobs.erase(std::remove_if(decodeJobs.begin(), decodeJobs.end(), [id](const DecodeJob& job)
+		{
+			return job.id == id;
+		}), decodeJobs.end());
+	}
+
+	void TextureStreamer::Request(VulkanTexture* texture, float screenSize)
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+
+		auto it = entries.find(texture);
+		if (it == entries.end())
+			return;
+
+		Entry& entry = it->second;
+		if (entry.lastUsedFrame != frameIndex)
+		{
+			entry.lastUsedFrame = frameIndex;
+			entry.wantedMip = entry.tailMip;
+		}
+
+		// One texel per pixel, every halving of the screen size drops a level. A camera inside the mesh gets an
+		// infinite size and full resolution.
+		uint32_t mip = entry.tailMip;
+		if (screenSize > 0.0f)
+		{
+			float texelsPerPixel = std::max(texture->width, texture->height) / screenSize;
+			mip = texelsPerPixel > 1.0f ? static_cast<uint32_t>(std::min(std::floor(std::log2(texelsPerPixel)), static_cast<float>(entry.tailMip))) : 0;
+		}
+
+		entry.wantedMip = std::min(entry.wantedMip, mip);
+	}
+
+	void TextureStreamer::Update(VkCommandBuffer commandBuffer)
+	{
+		std::vector<DecodeResult> results;
+		{
+			std::lock_guard<std::mutex> decodeLock(decodeMutex);
+			results.swap(decodeResults);
+		}
+
+		std::lock_guard<std::mutex> lock(mutex);
+
+		UploadDecodes(commandBuffer, results);
+
+		// The budget may have been lowered, or textures registered past it
+		Evict(commandBuffer, budget.load(), nullptr);
+
+		uint32_t pendingCount = QueueDecodes();
+
+		if (waitForDecodes && pendingCount > 0)
+		{
+			{
+				std::unique_lock<std::mutex> decodeLock(decodeMutex);
+				resultCondition.wait(decodeLock, [this, pendingCount]()
+				{
+					return decodeResults.size() >= pendingCount;
+				});
+
+				results.clear();
+				results.swap(decodeResults);
+			}
+
+			UploadDecodes(commandBuffer, results);
+			pendingCount = 0;
+		}
+
+		uint32_t streamedCount = 0;
+		for (const auto& [texture, entry] : entries)
+		{
+			if (texture->residentMip < entry.tailMip)
+				streamedCount++;
+		}
+
+		publishedResidentSize = residentSize;
+		publishedTextureCount = static_cast<uint32_t>(entries.size());
+		publishedStreamedCount = streamedCount;
+		publishedPendingCount = pendingCount;
+
+		frameIndex++;
+	}
+
+	void TextureStreamer::DrawImGui()
+	{
+		const double mebibyte = 1024.0 * 1024.0;
+
+		ImGui::Text("Resident: %.1f of %.1f MiB", publishedResidentSize.load() / mebibyte, budget.load() / mebibyte);
+		ImGui::Text("Textures: %u, %u above their mip tail", publishedTextureCount.load(), publishedStreamedCount.load());
+		ImGui::Text("Decodes in flight: %u", publishedPendingCount.load());
+		ImGui::Text("Streamed in: %llu, evicted: %llu", static_cast<unsigned long long>(streamedInCount.load()), static_cast<unsigned long long>(evictedCount.load()));
+
+		int budgetMiB = static_cast<int>(budget.load() / (1024 * 1024));
+		if (ImGui::SliderInt("Budget (MiB)", &budgetMiB, 16, 4096))
+			budget = static_cast<VkDeviceSize>(budgetMiB) * 1024 * 1024;
+	}
+
+	void TextureStreamer::RunDecodeThread()
+	{
+		while (true)
+		{
+			DecodeJob job;
+			{
+				std::unique_lock<std::mutex> lock(decodeMutex);
+				decodeCondition.wait(lock, [this]()
+				{
+					return stopping || !decodeJobs.empty();
+				});
+
+				if (stopping)
+					return;
+
+				job = std::move(decodeJobs.front());
+				decodeJobs.pop_front();
+			}
+
+			DecodeResult result{job.id, job.mip, false, {}};
+
+			// The levels already resident stay, so the source must still have the size they were built from
+			FileData file;
+			uint32_t width, height;
+			if (FileSystem::ReadFile(job.path, file) && GetImageSize(file.GetData(), file.GetSize(), width, height) && width == job.width && height == job.height)
+			{
+				size_t pixelsSize = GetMipLevelSize(width, height, 0);
+				size_t chainSize = GetMipChainSize(width, height, job.mip);
+
+				// Decoded straight into mapped staging memory, the requested levels are then filtered in place over the pixels
+				VulkanStagingRing* stagingRing = device->GetStagingRing();
+				result.staging = stagingRing->Allocate(std::max(chainSize, pixelsSize + DecodeImageSlack));
+
+				result.decoded = DecodeImage(file.GetData(), file.GetSize(), result.staging.data, static_cast<size_t>(result.staging.size));
+				if (result.decoded)
+					BuildMipChain(result.staging.data, width, height, job.mip, result.staging.data);
+				else
+					stagingRing->Release(result.staging);
+			}
+
+			if (!result.decoded)
+				std::cerr << "Failed to stream texture " << job.path << std::endl;
+
+			{
+				std::lock_guard<std::mutex> lock(decodeMutex);
+				decodeResults.push_back(std::move(result));
+			}
+			resultCondition.notify_all();
+		}
+	}
+
+	TextureStreamer::Entry* TextureStreamer::FindEntry(uint64_t id)
+	{
+		for (auto& [texture, entry] : entries)
+		{
+			if (entry.id == id)
+				return &entry;
+		}
+		return nullptr;
+	}
+
+	void TextureStreamer::UploadDecodes(VkCommandBuffer commandBuffer, std::vector<DecodeResult>& results)
+	{
+		VkDeviceSize limit = budget.load();
+		VulkanStagingRing* stagingRing = device->GetStagingRing();
+
+		for (DecodeResult& result : results)
+		{
+			// Unregistered meanwhile
+			Entry* entry = FindEntry(result.id);
+			if (!entry || entry->pendingMip != result.mip)
+			{
+				if (result.decoded)
+					stagingRing->Release(result.staging);
+				continue;
+			}
+
+			entry->pendingMip = NoMip;
+
+			if (!result.decoded)
+			{
+				entry->failed = true;
+				continue;
+			}
+
+			// Room comes out of the other textures first, when even that is not enough the upload is coarsened
+			uint32_t residentMip = entry->texture->residentMip;
+			VkDeviceSize residentEntrySize = GetResidentSize(*entry, residentMip);
+			VkDeviceSize evictableSize = GetEvictableSize(entry);
+
+			uint32_t mip = result.mip;
+			while (mip < residentMip && residentSize - evictableSize + GetResidentSize(*entry, mip) - residentEntrySize > limit)
+				mip++;
+
+			if (mip >= residentMip)
+			{
+				stagingRing->Release(result.staging);
+				continue;
+			}
+
+			Evict(commandBuffer, limit - (GetResidentSize(*entry, mip) - residentEntrySize), entry);
+
+			// Levels are packed finest first, coarsening skips the finest ones
+			VkDeviceSize skippedSize = GetResidentSize(*entry, result.mip) - GetResidentSize(*entry, mip);
+			UploadMips(commandBuffer, *entry, mip, result.staging, skippedSize);
+		}
+	}
+
+	uint32_t TextureStreamer::QueueDecodes()
+	{
+		VkDeviceSize limit = budget.load();
+
+		// Decodes in flight have their room reserved
+		VkDeviceSize pendingSize = 0;
+		uint32_t pendingCount = 0;
+
+		std::vector<Entry*> requests;
+		for (auto& [texture, entry] : entries)
+		{
+			if (entry.pendingMip != NoMip)
+			{
+				if (entry.pendingMip < texture->residentMip)
+					pendingSize += GetResidentSize(entry, entry.pendingMip) - GetResidentSize(entry, texture->residentMip);
+				pendingCount++;
+			}
+			else if (entry.lastUsedFrame == frameIndex && entry.wantedMip < texture->residentMip && !entry.failed)
+			{
+				requests.push_back(&entry);
+			}
+		}
+
+		// Textures furthest from the levels they want go first
+		std::sort(requests.begin(), requests.end(), [](const Entry* a, const Entry* b)
+		{
+			uint32_t missingA = a->texture->residentMip - a->wantedMip;
+			uint32_t missingB = b->texture->residentMip - b->wantedMip;
+			return missingA != missingB ? missingA > missingB : a->id < b->id;
+		});
+
+		VkDeviceSize available = limit + GetEvictableSize(nullptr);
+
+		std::vector<DecodeJob> jobs;
+		for (Entry* entry : requests)
+		{
+			if (!waitForDecodes && pendingCount >= MaxPendingDecodes)
+				break;
+
+			// Only as fine as can fit, a decode that would be coarsened away on arrival is never started
+			VulkanTexture* texture = entry->texture;
+			VkDeviceSize residentEntrySize = GetResidentSize(*entry, texture->residentMip);
+
+			uint32_t mip = entry->wantedMip;
+			while (mip < texture->residentMip && residentSize + pendingSize + GetResidentSize(*entry, mip) - residentEntrySize > available)
+				mip++;
+
+			if (mip >= texture->residentMip)
+				continue;
+
+			entry->pendingMip = mip;
+			pendingSize += GetResidentSize(*entry, mip) - residentEntrySize;
+			pendingCount++;
+
+			jobs.push_back({entry->id, texture->path, texture->width, texture->height, mip});
+		}
+
+		if (!jobs.empty())
+		{
+			{
+				std::lock_guard<std::mutex> lock(decodeMutex);
+				for (DecodeJob& job : jobs)
+				{
+					decodeJobs.push_back(std::move(job));
+				}
+			}
+			decodeCondition.notify_all();
+		}
+
+		return pendingCount;
+	}
+
+	uint32_t TextureStreamer::GetEvictionFloor(const Entry& entry) const
+	{
+		// Textures on screen keep what they asked for this frame, the rest can go down to their tail
+		return entry.lastUsedFrame == frameIndex ? entry.wantedMip : entry.tailMip;
+	}
+
+	VkDeviceSize TextureStreamer::GetEvictableSize(const Entry* keep) const
+	{
+		VkDeviceSize size = 0;
+		for (const auto& [texture, entry] : entries)
+		{
+			uint32_t floor = GetEvictionFloor(entry);
+			if (&entry != keep && floor > texture->residentMip)
+				size += GetResidentSize(entry, texture->residentMip) - GetResidentSize(entry, floor);
+		}
+		return size;
+	}
+
+	void TextureStreamer::Evict(VkCommandBuffer commandBuffer, VkDeviceSize limit, const Entry* keep)
+	{
+		if (residentSize <= limit)
+			return;
+
+		std::vector<Entry*> candidates;
+		for (auto& [texture, entry] : entries)
+		{
+			if (&entry != keep && GetEvictionFloor(entry) > texture->residentMip)
+				candidates.push_back(&entry);
+		}
+
+		std::sort(candidates.begin(), candidates.end(), [](const Entry* a, const Entry* b)
+		{
+			return a->lastUsedFrame < b->lastUsedFrame;
+		});
+
+		for (Entry* entry : candidates)
+		{
+			// Only as many levels as it takes, the finest level alone is three quarters of a texture
+			uint32_t residentMip = entry->texture->residentMip;
+			uint32_t floor = GetEvictionFloor(*entry);
+
+			uint32_t mip = residentMip + 1;
+			while (mip < floor && residentSize - (GetResidentSize(*entry, residentMip) - GetResidentSize(*entry, mip)) > limit)
+				mip++;
+
+			CopyMips(commandBuffer, *entry, mip);
+			evictedCount++;
+
+			if (residentSize <= limit)
+				break;
+		}
+	}
+
+	void TextureStreamer::UploadMips(VkCommandBuffer commandBuffer, Entry& entry, uint32_t mip, const StagingAllocation& staging, VkDeviceSize levelsOffset)
+	{
+		VulkanTexture* texture = entry.texture;
+		VulkanStagingRing* stagingRing = device->GetStagingRing();
+
+		VulkanImage* image = texture->CreateMipImage(mip);
+		texture->RecordMipUploads(commandBuffer, image, staging.buffer, staging.offset + levelsOffset, mip);
+
+		// Read by this frame's copies
+		sync->Retire(sync->GetSubmittedFrameValue() + 1, [stagingRing, staging]()
+		{
+			stagingRing->Release(staging);
+		});
+
+		ReplaceImage(entry, image, mip);
+		streamedInCount++;
+	}
+
+	void TextureStreamer::CopyMips(VkCommandBuffer commandBuffer, Entry& entry, uint32_t mip)
+	{
+		VulkanTexture* texture = entry.texture;
+		VulkanImage* source = texture->image;
+		VulkanImage* image = texture->CreateMipImage(mip);
+
+		// Frames in flight may still sample the old image, the barrier waits for their fragment shaders on the
+		// GPU since they were submitted to the same queue earlier
+		source->RecordLayoutTransition(commandBuffer, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL);
+		image->RecordLayoutTransition(commandBuffer, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+
+		std::vector<VkImageCopy> regions;
+		for (uint32_t level = mip; level < texture->mipLevels; level++)
+		{
+			VkImageCopy region{};
+			region.srcSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, level - texture->residentMip, 0, 1};
+			region.dstSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, level - mip, 0, 1};
+			region.extent = {GetMipExtent(texture->width, level), GetMipExtent(texture->height, level), 1};
+			regions.push_back(region);
+		}
+
+		vkCmdCopyImage(commandBuffer, source->Get(), VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, image->Get(), VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, static_cast<uint32_t>(regions.size()), regions.data());
+
+		image->RecordLayoutTransition(commandBuffer, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+
+		ReplaceImage(entry, image, mip);
+	}
+
+	void TextureStreamer::ReplaceImage(Entry& entry, VulkanImage* image, uint32_t mip)
+	{
+		VulkanTexture* texture = entry.texture;
+
+		residentSize = residentSize - GetResidentSize(entry, texture->residentMip) + GetResidentSize(entry, mip);
+
+		// This frame may still copy from it
+		VulkanImage* oldImage = texture->image;
+		sync->Retire(sync->GetSubmittedFrameValue() + 1, [oldImage]()
+		{
+			delete oldImage;
+		});
+
+		texture->image = image;
+		texture->residentMip = mip;
+		texture->version++;
+	}
+
+	VkDeviceSize TextureStreamer::GetResidentSize(const Entry& entry, uint32_t mip) const
+	{
+		return GetMipChainSize(entry.texture->width, entry.texture->height, mip);
+	}
+}
\ No newline at end of file
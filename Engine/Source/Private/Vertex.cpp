@@ -1,34 +1,83 @@
 #include <Vertex.h>
 
 #include <iostream>
+#include <cmath>
+
+#include <glm/gtc/packing.hpp>
 
 using namespace VulkanRenderer;
 
-VkVertexInputBindingDescription Vertex::GetBindingDescription()
+namespace
+{
+	glm::vec2 SignNotZero(glm::vec2 value)
+	{
+		return {value.x >= 0.0f ? 1.0f : -1.0f, value.y >= 0.0f ? 1.0f : -1.0f};
+	}
+
+	// Projects a unit vector onto an octahedron and unfolds it into the [-1, 1] square
+	glm::vec2 OctahedralEncode(glm::vec3 direction)
+	{
+		direction /= std::abs(direction.x) + std::abs(direction.y) + std::abs(direction.z);
+
+		glm::vec2 encoded(direction.x, direction.y);
+		if (direction.z < 0.0f)
+			encoded = (1.0f - glm::abs(glm::vec2(encoded.y, encoded.x))) * SignNotZero(encoded);
+
+		return encoded;
+	}
+
+	int8_t PackSnorm8(float value)
+	{
+		return static_cast<int8_t>(std::round(glm::clamp(value, -1.0f, 1.0f) * 127.0f));
+	}
+
+	uint16_t PackUnorm16(float value)
+	{
+		return static_cast<uint16_t>(std::round(glm::clamp(value, 0.0f, 1.0f) * 65535.0f));
+	}
+}
+
+VertexBounds VertexBounds::Compute(const std::vector<Vertex>& vertices)
 {
-	VkVertexInputBindingDescription bindingDescription{};
-	bindingDescription.binding = 0;
-	bindingDescription.stride = sizeof(Vertex);
-	bindingDescription.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+	VertexBounds bounds;
+	if (vertices.empty())
+		return bounds;
+
+	glm::vec3 max = vertices[0].position;
+	bounds.min = vertices[0].position;
 
-	return bindingDescription;
+	for (const Vertex& vertex : vertices)
+	{
+		bounds.min = glm::min(bounds.min, vertex.position);
+		max = glm::max(max, vertex.position);
+	}
+
+	bounds.extent = max - bounds.min;
+	return bounds;
 }
 
-std::array<VkVertexInputAttributeDescription, 2> Vertex::GetAttributeDescriptions()
+PackedVertex PackedVertex::Pack(const Vertex& vertex, const VertexBounds& bounds)
 {
-	std::array<VkVertexInputAttributeDescription, 2> attributeDescriptions{};
-
-	// Position attribute
-	attributeDescriptions[0].binding = 0;
-	attributeDescriptions[0].location = 0;
-	attributeDescriptions[0].format = VK_FORMAT_R32G32B32_SFLOAT;
-	attributeDescriptions[0].offset = offsetof(Vertex, position);
-	
-	// Tex coord attribute
-	attributeDescriptions[1].binding = 0;
-	attributeDescriptions[1].location = 1;
-	attributeDescriptions[1].format = VK_FORMAT_R32G32_SFLOAT;
-	attributeDescriptions[1].offset = offsetof(Vertex, texCoord);
-
-	return attributeDescriptions;
+	PackedVertex packed{};
+
+	for (int i = 0; i < 3; i++)
+	{
+		// Flat axes, e.g. z of a quad, have no extent and decode to the bounds minimum
+		float normalized = bounds.extent[i] > 0.0f ? (vertex.position[i] - bounds.min[i]) / bounds.extent[i] : 0.0f;
+		packed.position.value[i] = PackUnorm16(normalized);
+	}
+	packed.position.value[3] = vertex.tangent.w < 0.0f ? 0 : 65535;
+
+	glm::vec2 normal = OctahedralEncode(glm::normalize(vertex.normal));
+	glm::vec2 tangent = OctahedralEncode(glm::normalize(glm::vec3(vertex.tangent)));
+
+	packed.normalTangent.value[0] = PackSnorm8(normal.x);
+	packed.normalTangent.value[1] = PackSnorm8(normal.y);
+	packed.normalTangent.value[2] = PackSnorm8(tangent.x);
+	packed.normalTangent.value[3] = PackSnorm8(tangent.y);
+
+	packed.texCoord.value[0] = glm::packHalf1x16(vertex.texCoord.x);
+	packed.texCoord.value[1] = glm::packHalf1x16(vertex.texCoord.y);
+
+	return packed;
 }
\ No newline at end of file
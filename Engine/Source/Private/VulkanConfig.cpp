@@ -1,6 +1,7 @@
 #include <VulkanConfig.h>
 
 #include <iostream>
+#include <cstring>
 
 #include <volk.h>
 
@@ -8,6 +9,9 @@ namespace VulkanConfig
 {
 	int MAX_FRAMES_IN_FLIGHT = 2;
 
+	const int MIN_SUPPORTED_FRAMES_IN_FLIGHT = 1;
+	const int MAX_SUPPORTED_FRAMES_IN_FLIGHT = 4;
+
 #ifdef NDEBUG
 	bool enableValidationLayers = false;
 #else
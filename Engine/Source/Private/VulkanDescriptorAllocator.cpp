@@ -0,0 +1,254 @@
+#include <VulkanDescriptorAllocator.h>
+
+#include <iostream>
+#include <array>
+#include <algorithm>
+#include <functional>
+
+#include <VulkanDevice.h>
+
+using namespace VulkanRenderer;
+
+namespace
+{
+	// Descriptors reserved per set in each pool, sized after the mesh layout (1 uniform buffer, 3 samplers).
+	// Storage descriptors are used by the cluster culling sets and the depth pyramid levels.
+	struct PoolSizeRatio
+	{
+		VkDescriptorType type;
+		float ratio;
+	};
+
+	constexpr std::array<PoolSizeRatio, 4> poolSizeRatios =
+	{{
+		{VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1.0f},
+		{VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 3.0f},
+		{VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 2.0f},
+		{VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1.0f}
+	}};
+
+	constexpr uint32_t maxSetsPerPool = 4096;
+
+	template<typename T>
+	void HashCombine(size_t& seed, const T& value)
+	{
+		seed ^= std::hash<T>()(value) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+	}
+}
+
+void VulkanRenderer::WriteDescriptorSet(VkDevice device, VkDescriptorSet descriptorSet, const std::vector<DescriptorBinding>& bindings)
+{
+	std::vector<VkWriteDescriptorSet> descriptorWrites(bindings.size());
+	for (size_t i = 0; i < bindings.size(); i++)
+	{
+		const DescriptorBinding& binding = bindings[i];
+
+		VkWriteDescriptorSet& write = descriptorWrites[i];
+		write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		write.dstSet = descriptorSet;
+		write.dstBinding = binding.binding;
+		write.dstArrayElement = 0;
+		write.descriptorType = binding.type;
+		write.descriptorCount = 1;
+
+		if (binding.imageInfo.imageView != VK_NULL_HANDLE || binding.imageInfo.sampler != VK_NULL_HANDLE)
+			write.pImageInfo = &binding.imageInfo;
+		else
+			write.pBufferInfo = &binding.bufferInfo;
+	}
+
+	vkUpdateDescriptorSets(device, static_cast<uint32_t>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
+}
+
+DescriptorBinding DescriptorBinding::Buffer(uint32_t binding, VkDescriptorType type, VkBuffer buffer, VkDeviceSize offset, VkDeviceSize range)
+{
+	DescriptorBinding result{};
+	result.binding = binding;
+	result.type = type;
+	result.bufferInfo.buffer = buffer;
+	result.bufferInfo.offset = offset;
+	result.bufferInfo.range = range;
+	return result;
+}
+
+DescriptorBinding DescriptorBinding::Image(uint32_t binding, VkDescriptorType type, VkImageView imageView, VkSampler sampler, VkImageLayout imageLayout)
+{
+	DescriptorBinding result{};
+	result.binding = binding;
+	result.type = type;
+	result.imageInfo.imageView = imageView;
+	result.imageInfo.sampler = sampler;
+	result.imageInfo.imageLayout = imageLayout;
+	return result;
+}
+
+bool VulkanDescriptorAllocator::CacheKey::operator==(const CacheKey& other) const
+{
+	if (layout != other.layout || bindings.size() != other.bindings.size())
+		return false;
+
+	for (size_t i = 0; i < bindings.size(); i++)
+	{
+		const DescriptorBinding& a = bindings[i];
+		const DescriptorBinding& b = other.bindings[i];
+
+		if (a.binding != b.binding || a.type != b.type ||
+			a.bufferInfo.buffer != b.bufferInfo.buffer || a.bufferInfo.offset != b.bufferInfo.offset || a.bufferInfo.range != b.bufferInfo.range ||
+			a.imageInfo.imageView != b.imageInfo.imageView || a.imageInfo.sampler != b.imageInfo.sampler || a.imageInfo.imageLayout != b.imageInfo.imageLayout)
+			return false;
+	}
+	return true;
+}
+
+size_t VulkanDescriptorAllocator::CacheKeyHash::operator()(const CacheKey& key) const
+{
+	size_t seed = 0;
+	HashCombine(seed, key.layout);
+
+	for (const DescriptorBinding& binding : key.bindings)
+	{
+		HashCombine(seed, binding.binding);
+		HashCombine(seed, static_cast<uint32_t>(binding.type));
+		HashCombine(seed, binding.bufferInfo.buffer);
+		HashCombine(seed, binding.bufferInfo.offset);
+		HashCombine(seed, binding.bufferInfo.range);
+		HashCombine(seed, binding.imageInfo.imageView);
+		HashCombine(seed, binding.imageInfo.sampler);
+		HashCombine(seed, static_cast<uint32_t>(binding.imageInfo.imageLayout));
+	}
+	return seed;
+}
+
+VulkanDescriptorAllocator::VulkanDescriptorAllocator(VulkanDevice* device, uint32_t initialSetsPerPool)
+	: device(device), setsPerPool(initialSetsPerPool)
+{
+
+}
+
+VulkanDescriptorAllocator::~VulkanDescriptorAllocator()
+{
+	VkDevice logicalDevice = device->GetLogical();
+
+	for (VkDescriptorPool pool : usedPools)
+		vkDestroyDescriptorPool(logicalDevice, pool, nullptr);
+
+	for (VkDescriptorPool pool : freePools)
+		vkDestroyDescriptorPool(logicalDevice, pool, nullptr);
+}
+
+size_t VulkanDescriptorAllocator::GetPoolCount() const
+{
+	return usedPools.size() + freePools.size();
+}
+
+size_t VulkanDescriptorAllocator::GetCachedSetCount() const
+{
+	return setCache.size();
+}
+
+bool VulkanDescriptorAllocator::Allocate(VkDescriptorSetLayout layout, VkDescriptorSet* descriptorSet)
+{
+	if (currentPool == VK_NULL_HANDLE)
+	{
+		currentPool = GrabPool();
+		usedPools.push_back(currentPool);
+	}
+
+	VkDescriptorSetAllocateInfo allocInfo{};
+	allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	allocInfo.descriptorPool = currentPool;
+	allocInfo.descriptorSetCount = 1;
+	allocInfo.pSetLayouts = &layout;
+
+	VkResult result = vkAllocateDescriptorSets(device->GetLogical(), &allocInfo, descriptorSet);
+
+	// Current pool is exhausted, chain a new one and retry once
+	if (result == VK_ERROR_OUT_OF_POOL_MEMORY || result == VK_ERROR_FRAGMENTED_POOL)
+	{
+		currentPool = GrabPool();
+		usedPools.push_back(currentPool);
+
+		allocInfo.descriptorPool = currentPool;
+		result = vkAllocateDescriptorSets(device->GetLogical(), &allocInfo, descriptorSet);
+	}
+
+	if (result != VK_SUCCESS)
+	{
+		std::cerr << "Failed to allocate descriptor set" << std::endl;
+		return false;
+	}
+	return true;
+}
+
+VkDescriptorSet VulkanDescriptorAllocator::GetOrCreate(VkDescriptorSetLayout layout, const std::vector<DescriptorBinding>& bindings)
+{
+	CacheKey key{layout, bindings};
+
+	auto it = setCache.find(key);
+	if (it != setCache.end())
+		return it->second;
+
+	VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
+	if (!Allocate(layout, &descriptorSet))
+		return VK_NULL_HANDLE;
+
+	WriteDescriptorSet(device->GetLogical(), descriptorSet, bindings);
+
+	setCache.emplace(std::move(key), descriptorSet);
+	return descriptorSet;
+}
+
+void VulkanDescriptorAllocator::ResetPools()
+{
+	VkDevice logicalDevice = device->GetLogical();
+
+	for (VkDescriptorPool pool : usedPools)
+	{
+		vkResetDescriptorPool(logicalDevice, pool, 0);
+		freePools.push_back(pool);
+	}
+
+	usedPools.clear();
+	setCache.clear();
+	currentPool = VK_NULL_HANDLE;
+}
+
+VkDescriptorPool VulkanDescriptorAllocator::GrabPool()
+{
+	if (!freePools.empty())
+	{
+		VkDescriptorPool pool = freePools.back();
+		freePools.pop_back();
+		return pool;
+	}
+
+	VkDescriptorPool pool = CreatePool(setsPerPool);
+
+	// Grow geometrically so the number of pools stays logarithmic in the number of sets
+	setsPerPool = std::min(setsPerPool * 2, maxSetsPerPool);
+
+	return pool;
+}
+
+VkDescriptorPool VulkanDescriptorAllocator::CreatePool(uint32_t setCount)
+{
+	std::array<VkDescriptorPoolSize, poolSizeRatios.size()> poolSizes{};
+	for (size_t i = 0; i < poolSizeRatios.size(); i++)
+	{
+		poolSizes[i].type = poolSizeRatios[i].type;
+		poolSizes[i].descriptorCount = static_cast<uint32_t>(poolSizeRatios[i].ratio * setCount);
+	}
+
+	VkDescriptorPoolCreateInfo poolInfo{};
+	poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+	poolInfo.pPoolSizes = poolSizes.data();
+	poolInfo.maxSets = setCount;
+
+	VkDescriptorPool pool = VK_NULL_HANDLE;
+	if (vkCreateDescriptorPool(device->GetLogical(), &poolInfo, nullptr, &pool) != VK_SUCCESS)
+	{
+		std::cerr << "Failed to create descriptor pool" << std::endl;
+	}
+	return pool;
+}
\ No newline at end of file
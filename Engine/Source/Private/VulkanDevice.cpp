@@ -1,10 +1,12 @@
 #include <VulkanDevice.h>
 
 #include <iostream>
+#include <algorithm>
 #include <map>
 #include <set>
 
 #include <VulkanConfig.h>
+#include <VulkanStagingRing.h>
 
 namespace VulkanRenderer
 {
@@ -13,13 +15,27 @@ namespace VulkanRenderer
 	{
 		SelectPhysicalDevice();
 		CreateLogicalDevice();
+		DetectUploadMemory();
 		CreateCommandPool();
 		CreateCommandBuffers();
+		CreateUploadTimeline();
+
+		// Holds a few 2K RGBA textures at once, larger uploads get a buffer of their own
+		stagingRing = std::make_unique<VulkanStagingRing>(this, 64ull * 1024 * 1024);
 	}
 
 	VulkanDevice::~VulkanDevice()
 	{
+		// The device is idle by now, every upload has completed
+		for (RetiredUpload& retired : retiredUploads)
+			retired.release();
+		retiredUploads.clear();
+
+		stagingRing.reset();
+
+		vkDestroySemaphore(logicaldevice, uploadTimeline, nullptr);
 		vkDestroyCommandPool(logicaldevice, commandPool, nullptr);
+		vkDestroyCommandPool(logicaldevice, singleTimeCommandPool, nullptr);
 		vkDestroyDevice(logicaldevice, nullptr);
 	}
 
@@ -72,16 +88,118 @@ namespace VulkanRenderer
 			queueCreateInfos.push_back(queueCreateInfo);
 		}
 
+		VkPhysicalDeviceFeatures supportedFeatures{};
+		vkGetPhysicalDeviceFeatures(physicalDevice, &supportedFeatures);
+		samplerAnisotropyEnabled = supportedFeatures.samplerAnisotropy == VK_TRUE;
+
 		VkPhysicalDeviceFeatures deviceFeatures{};
-		deviceFeatures.samplerAnisotropy = VK_TRUE;
+		deviceFeatures.samplerAnisotropy = samplerAnisotropyEnabled ? VK_TRUE : VK_FALSE;
+
+		// Timeline semaphores drive frame pacing and upload/compute dependencies
+		VkPhysicalDeviceVulkan12Features vulkan12Features{};
+		vulkan12Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+		vulkan12Features.timelineSemaphore = VK_TRUE;
+
+		// Dynamic rendering and synchronization2 are only enabled on 1.3 devices that report them
+		VkPhysicalDeviceProperties deviceProperties;
+		vkGetPhysicalDeviceProperties(physicalDevice, &deviceProperties);
+
+		VkPhysicalDeviceVulkan13Features supported13Features{};
+		supported13Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_3_FEATURES;
+
+		if (deviceProperties.apiVersion >= VK_API_VERSION_1_3)
+		{
+			VkPhysicalDeviceFeatures2 supportedFeatures2{};
+			supportedFeatures2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+			supportedFeatures2.pNext = &supported13Features;
+			vkGetPhysicalDeviceFeatures2(physicalDevice, &supportedFeatures2);
+		}
+
+		dynamicRenderingEnabled = supported13Features.dynamicRendering == VK_TRUE;
+		synchronization2Enabled = supported13Features.synchronization2 == VK_TRUE;
+
+		VkPhysicalDeviceVulkan13Features vulkan13Features{};
+		vulkan13Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_3_FEATURES;
+		vulkan13Features.dynamicRendering = dynamicRenderingEnabled ? VK_TRUE : VK_FALSE;
+		vulkan13Features.synchronization2 = synchronization2Enabled ? VK_TRUE : VK_FALSE;
+
+		void** featureChainTail = &vulkan12Features.pNext;
+
+		if (deviceProperties.apiVersion >= VK_API_VERSION_1_3)
+		{
+			*featureChainTail = &vulkan13Features;
+			featureChainTail = &vulkan13Features.pNext;
+		}
+
+		std::vector<const char*> deviceExtensions = GetRequiredDeviceExtensions(surface);
+
+		// Present wait is optional, latency falls back to CPU timestamps without it
+		VkPhysicalDevicePresentIdFeaturesKHR presentIdFeatures{};
+		presentIdFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_ID_FEATURES_KHR;
+
+		VkPhysicalDevicePresentWaitFeaturesKHR presentWaitFeatures{};
+		presentWaitFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_WAIT_FEATURES_KHR;
+
+		if (surface != VK_NULL_HANDLE &&
+			IsDeviceExtensionSupported(physicalDevice, VK_KHR_PRESENT_ID_EXTENSION_NAME) &&
+			IsDeviceExtensionSupported(physicalDevice, VK_KHR_PRESENT_WAIT_EXTENSION_NAME))
+		{
+			presentIdFeatures.pNext = &presentWaitFeatures;
+
+			VkPhysicalDeviceFeatures2 supportedFeatures2{};
+			supportedFeatures2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+			supportedFeatures2.pNext = &presentIdFeatures;
+			vkGetPhysicalDeviceFeatures2(physicalDevice, &supportedFeatures2);
+
+			presentWaitEnabled = presentIdFeatures.presentId == VK_TRUE && presentWaitFeatures.presentWait == VK_TRUE;
+			presentWaitFeatures.pNext = nullptr;
+		}
+
+		if (presentWaitEnabled)
+		{
+			deviceExtensions.push_back(VK_KHR_PRESENT_ID_EXTENSION_NAME);
+			deviceExtensions.push_back(VK_KHR_PRESENT_WAIT_EXTENSION_NAME);
+
+			*featureChainTail = &presentIdFeatures;
+			featureChainTail = &presentWaitFeatures.pNext;
+		}
+
+		// Mesh shaders are optional, large meshes are culled per cluster in a compute pass without them
+		VkPhysicalDeviceMeshShaderFeaturesEXT meshShaderFeatures{};
+		meshShaderFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MESH_SHADER_FEATURES_EXT;
+
+		if (IsDeviceExtensionSupported(physicalDevice, VK_EXT_MESH_SHADER_EXTENSION_NAME))
+		{
+			VkPhysicalDeviceFeatures2 supportedFeatures2{};
+			supportedFeatures2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+			supportedFeatures2.pNext = &meshShaderFeatures;
+			vkGetPhysicalDeviceFeatures2(physicalDevice, &supportedFeatures2);
+
+			meshShaderEnabled = meshShaderFeatures.taskShader == VK_TRUE && meshShaderFeatures.meshShader == VK_TRUE;
+		}
+
+		if (meshShaderEnabled)
+		{
+			deviceExtensions.push_back(VK_EXT_MESH_SHADER_EXTENSION_NAME);
+
+			// Only the two stages are used, the query, multiview and shading rate features stay off
+			meshShaderFeatures = VkPhysicalDeviceMeshShaderFeaturesEXT{};
+			meshShaderFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MESH_SHADER_FEATURES_EXT;
+			meshShaderFeatures.taskShader = VK_TRUE;
+			meshShaderFeatures.meshShader = VK_TRUE;
+
+			*featureChainTail = &meshShaderFeatures;
+			featureChainTail = &meshShaderFeatures.pNext;
+		}
 
 		VkDeviceCreateInfo createInfo{};
 		createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+		createInfo.pNext = &vulkan12Features;
 		createInfo.queueCreateInfoCount = static_cast<uint32_t>(queueCreateInfos.size());
 		createInfo.pQueueCreateInfos = queueCreateInfos.data();
 		createInfo.pEnabledFeatures = &deviceFeatures;
-		createInfo.enabledExtensionCount = static_cast<uint32_t>(VulkanConfig::deviceExtensions.size());
-		createInfo.ppEnabledExtensionNames = VulkanConfig::deviceExtensions.data();
+		createInfo.enabledExtensionCount = static_cast<uint32_t>(deviceExtensions.size());
+		createInfo.ppEnabledExtensionNames = deviceExtensions.data();
 
 		if (VulkanConfig::enableValidationLayers)
 		{
@@ -116,6 +234,21 @@ namespace VulkanRenderer
 		{
 			std::cerr << "Failed to create command pool" << std::endl;
 		}
+
+		poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+
+		if (vkCreateCommandPool(logicaldevice, &poolInfo, nullptr, &singleTimeCommandPool) != VK_SUCCESS)
+		{
+			std::cerr << "Failed to create single time command pool" << std::endl;
+		}
+	}
+
+	void VulkanDevice::RecreateCommandBuffers()
+	{
+		if (!commandBuffers.empty())
+			vkFreeCommandBuffers(logicaldevice, commandPool, static_cast<uint32_t>(commandBuffers.size()), commandBuffers.data());
+
+		CreateCommandBuffers();
 	}
 
 	void VulkanDevice::CreateCommandBuffers()
@@ -134,6 +267,23 @@ namespace VulkanRenderer
 		}
 	}
 
+	void VulkanDevice::CreateUploadTimeline()
+	{
+		VkSemaphoreTypeCreateInfo typeInfo{};
+		typeInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+		typeInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+		typeInfo.initialValue = 0;
+
+		VkSemaphoreCreateInfo semaphoreInfo{};
+		semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+		semaphoreInfo.pNext = &typeInfo;
+
+		if (vkCreateSemaphore(logicaldevice, &semaphoreInfo, nullptr, &uploadTimeline) != VK_SUCCESS)
+		{
+			std::cerr << "Failed to create upload timeline semaphore" << std::endl;
+		}
+	}
+
 	uint32_t VulkanDevice::FindMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags propertyFlags)
 	{
 		VkPhysicalDeviceMemoryProperties memoryProperties;
@@ -149,14 +299,71 @@ namespace VulkanRenderer
 		return -1;
 	}
 
+	VkMemoryPropertyFlags VulkanDevice::GetDynamicMemoryProperties() const
+	{
+		VkMemoryPropertyFlags propertyFlags = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+
+		if (directUploads)
+			propertyFlags |= VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+
+		return propertyFlags;
+	}
+
+	void VulkanDevice::DetectUploadMemory()
+	{
+		VkPhysicalDeviceMemoryProperties memoryProperties;
+		vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memoryProperties);
+
+		const VkMemoryPropertyFlags directFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+
+		bool hasDeviceLocal = false;
+		bool allDeviceLocalHostVisible = true;
+
+		for (uint32_t i = 0; i < memoryProperties.memoryTypeCount; i++)
+		{
+			const VkMemoryType& memoryType = memoryProperties.memoryTypes[i];
+
+			if (!(memoryType.propertyFlags & VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT))
+				continue;
+
+			hasDeviceLocal = true;
+
+			if ((memoryType.propertyFlags & directFlags) != directFlags)
+			{
+				allDeviceLocalHostVisible = false;
+				continue;
+			}
+
+			hostVisibleDeviceLocalHeapSize = std::max(hostVisibleDeviceLocalHeapSize, memoryProperties.memoryHeaps[memoryType.heapIndex].size);
+		}
+
+		// Integrated GPUs may also expose a device local type that is not host visible, their heaps are system
+		// memory either way, so the device type decides before the memory types do
+		VkPhysicalDeviceProperties deviceProperties;
+		vkGetPhysicalDeviceProperties(physicalDevice, &deviceProperties);
+
+		bool integrated = deviceProperties.deviceType == VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU || deviceProperties.deviceType == VK_PHYSICAL_DEVICE_TYPE_CPU;
+		unifiedMemory = (integrated && hostVisibleDeviceLocalHeapSize > 0) || (hasDeviceLocal && allDeviceLocalHostVisible);
+
+		// Anything past the legacy 256 MiB window means the BAR was resized, the window alone is left to the driver
+		resizableBarEnabled = !unifiedMemory && hostVisibleDeviceLocalHeapSize > 256ull * 1024 * 1024;
+
+		directUploads = unifiedMemory || resizableBarEnabled;
+	}
+
 	VkCommandBuffer VulkanDevice::BeginSingleTimeCommands() const
 	{
 		VkCommandBufferAllocateInfo allocateInfo{};
 		allocateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
 		allocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-		allocateInfo.commandPool = commandPool;
+		allocateInfo.commandPool = singleTimeCommandPool;
 		allocateInfo.commandBufferCount = 1;
 
+		// The pool stays locked while recording, a pool's command buffers may only be used by one thread at a time
+		singleTimeCommandPoolMutex.lock();
+
+		FreeCompletedCommandBuffers();
+
 		VkCommandBuffer commandBuffer;
 		vkAllocateCommandBuffers(logicaldevice, &allocateInfo, &commandBuffer);
 
@@ -169,19 +376,126 @@ namespace VulkanRenderer
 		return commandBuffer;
 	}
 
-	void VulkanDevice::EndSingleTimeCommands(VkCommandBuffer commandBuffer) const
+	uint64_t VulkanDevice::EndSingleTimeCommands(VkCommandBuffer commandBuffer) const
 	{
 		vkEndCommandBuffer(commandBuffer);
 
+		VkTimelineSemaphoreSubmitInfo timelineInfo{};
+		timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+		timelineInfo.signalSemaphoreValueCount = 1;
+
 		VkSubmitInfo submitInfo{};
 		submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+		submitInfo.pNext = &timelineInfo;
 		submitInfo.commandBufferCount = 1;
 		submitInfo.pCommandBuffers = &commandBuffer;
+		submitInfo.signalSemaphoreCount = 1;
+		submitInfo.pSignalSemaphores = &uploadTimeline;
 
-		vkQueueSubmit(graphicsQueue, 1, &submitInfo, VK_NULL_HANDLE);
-		vkQueueWaitIdle(graphicsQueue);
+		// Values are taken under the queue mutex so they are signalled in submission order
+		uint64_t signalValue;
+		{
+			std::lock_guard<std::mutex> lock(queueMutex);
+
+			signalValue = uploadValue + 1;
+			timelineInfo.pSignalSemaphoreValues = &signalValue;
+
+			if (vkQueueSubmit(graphicsQueue, 1, &submitInfo, VK_NULL_HANDLE) == VK_SUCCESS)
+			{
+				uploadValue = signalValue;
+			}
+			else
+			{
+				std::cerr << "Failed to submit single time commands" << std::endl;
+				signalValue = uploadValue;
+			}
+		}
+
+		pendingUploads.push_back({signalValue, commandBuffer});
+		singleTimeCommandPoolMutex.unlock();
 
-		vkFreeCommandBuffers(logicaldevice, commandPool, 1, &commandBuffer);
+		return signalValue;
+	}
+
+	void VulkanDevice::RetireUpload(uint64_t value, std::function<void()> release)
+	{
+		std::lock_guard<std::mutex> lock(retiredUploadsMutex);
+		retiredUploads.push_back({value, std::move(release)});
+	}
+
+	void VulkanDevice::ReleaseCompletedUploads()
+	{
+		std::lock_guard<std::mutex> lock(retiredUploadsMutex);
+		if (retiredUploads.empty())
+			return;
+
+		uint64_t completedValue = GetCompletedUploadValue();
+
+		for (auto it = retiredUploads.begin(); it != retiredUploads.end();)
+		{
+			if (it->value <= completedValue)
+			{
+				it->release();
+				it = retiredUploads.erase(it);
+			}
+			else
+			{
+				++it;
+			}
+		}
+	}
+
+	void VulkanDevice::WaitForUploads() const
+	{
+		uint64_t value = uploadValue;
+		if (value == 0)
+			return;
+
+		VkSemaphoreWaitInfo waitInfo{};
+		waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+		waitInfo.semaphoreCount = 1;
+		waitInfo.pSemaphores = &uploadTimeline;
+		waitInfo.pValues = &value;
+
+		vkWaitSemaphores(logicaldevice, &waitInfo, UINT64_MAX);
+	}
+
+	uint64_t VulkanDevice::GetSubmittedUploadValue() const
+	{
+		return uploadValue;
+	}
+
+	VkSemaphore VulkanDevice::GetUploadTimeline() const
+	{
+		return uploadTimeline;
+	}
+
+	uint64_t VulkanDevice::GetCompletedUploadValue() const
+	{
+		uint64_t completedValue = 0;
+		vkGetSemaphoreCounterValue(logicaldevice, uploadTimeline, &completedValue);
+		return completedValue;
+	}
+
+	void VulkanDevice::FreeCompletedCommandBuffers() const
+	{
+		if (pendingUploads.empty())
+			return;
+
+		uint64_t completedValue = GetCompletedUploadValue();
+
+		for (auto it = pendingUploads.begin(); it != pendingUploads.end();)
+		{
+			if (it->value <= completedValue)
+			{
+				vkFreeCommandBuffers(logicaldevice, singleTimeCommandPool, 1, &it->commandBuffer);
+				it = pendingUploads.erase(it);
+			}
+			else
+			{
+				++it;
+			}
+		}
 	}
 
 	VkDevice VulkanDevice::GetLogical() const
@@ -193,4 +507,9 @@ namespace VulkanRenderer
 	{
 		return physicalDevice;
 	}
+
+	VulkanStagingRing* VulkanDevice::GetStagingRing() const
+	{
+		return stagingRing.get();
+	}
 }
\ No newline at end of file
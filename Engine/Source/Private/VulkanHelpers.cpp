@@ -1,6 +1,8 @@
 #include <VulkanHelpers.h>
 
 #include <iostream>
+#include <cstring>
+#include <limits>
 #include <algorithm>
 #include <set>
 #include <string>
@@ -17,7 +19,22 @@ namespace VulkanRenderer
 		return graphicsFamily.has_value() && presentFamily.has_value();
 	}
 
-	bool CheckDeviceExtensionSupport(VkPhysicalDevice device)
+	std::vector<const char*> GetRequiredDeviceExtensions(VkSurfaceKHR surface)
+	{
+		std::vector<const char*> extensions;
+
+		for (const char* extension : VulkanConfig::deviceExtensions)
+		{
+			// Headless devices never create a swap chain
+			if (surface == VK_NULL_HANDLE && strcmp(extension, VK_KHR_SWAPCHAIN_EXTENSION_NAME) == 0)
+				continue;
+
+			extensions.push_back(extension);
+		}
+		return extensions;
+	}
+
+	bool CheckDeviceExtensionSupport(VkPhysicalDevice device, VkSurfaceKHR surface)
 	{
 		uint32_t extensionCount;
 		vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, nullptr);
@@ -25,7 +42,8 @@ namespace VulkanRenderer
 		std::vector<VkExtensionProperties> availableExtensions(extensionCount);
 		vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, availableExtensions.data());
 
-		std::set<std::string> requiredExtensions(VulkanConfig::deviceExtensions.begin(), VulkanConfig::deviceExtensions.end());
+		std::vector<const char*> deviceExtensions = GetRequiredDeviceExtensions(surface);
+		std::set<std::string> requiredExtensions(deviceExtensions.begin(), deviceExtensions.end());
 
 		for (const auto& extension : availableExtensions)
 			requiredExtensions.erase(extension.extensionName);
@@ -33,6 +51,20 @@ namespace VulkanRenderer
 		return requiredExtensions.empty();
 	}
 
+	bool IsDeviceExtensionSupported(VkPhysicalDevice device, const char* extensionName)
+	{
+		uint32_t extensionCount;
+		vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, nullptr);
+
+		std::vector<VkExtensionProperties> availableExtensions(extensionCount);
+		vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, availableExtensions.data());
+
+		return std::any_of(availableExtensions.begin(), availableExtensions.end(), [extensionName](const VkExtensionProperties& extension)
+		{
+			return strcmp(extension.extensionName, extensionName) == 0;
+		});
+	}
+
 	QueueFamilyIndices FindQueueFamilies(VkPhysicalDevice device, VkSurfaceKHR surface)
 	{
 		QueueFamilyIndices indices;
@@ -50,11 +82,16 @@ namespace VulkanRenderer
 				indices.graphicsFamily = i;
 
 			VkBool32 presentSupport = false;
-			vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface, &presentSupport);
+			if (surface != VK_NULL_HANDLE)
+				vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface, &presentSupport);
 
 			if (presentSupport)
 				indices.presentFamily = i;
 
+			// Without a surface nothing is presented, the graphics queue stands in for the present queue
+			if (surface == VK_NULL_HANDLE)
+				indices.presentFamily = indices.graphicsFamily;
+
 			if (indices.IsComplete())
 				break;
 
@@ -137,14 +174,29 @@ namespace VulkanRenderer
 		if (!indices.IsComplete())
 			return 0;
 
-		if (!CheckDeviceExtensionSupport(device))
+		if (!CheckDeviceExtensionSupport(device, surface))
 			return 0;
 
-		SwapChainSupportDetails swapChainSupport = QuerySwapChainSupport(device, surface);
-		if (swapChainSupport.formats.empty() || swapChainSupport.presentModes.empty())
-			return 0;
+		if (surface != VK_NULL_HANDLE)
+		{
+			SwapChainSupportDetails swapChainSupport = QuerySwapChainSupport(device, surface);
+			if (swapChainSupport.formats.empty() || swapChainSupport.presentModes.empty())
+				return 0;
+		}
+
+		// Anisotropic filtering is used when available, CPU implementations may lack it
+		if (deviceFeatures.samplerAnisotropy)
+			score += 100;
 
-		if (!deviceFeatures.samplerAnisotropy)
+		VkPhysicalDeviceVulkan12Features vulkan12Features{};
+		vulkan12Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+
+		VkPhysicalDeviceFeatures2 deviceFeatures2{};
+		deviceFeatures2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+		deviceFeatures2.pNext = &vulkan12Features;
+		vkGetPhysicalDeviceFeatures2(device, &deviceFeatures2);
+
+		if (!vulkan12Features.timelineSemaphore)
 			return 0;
 
 		return score;
@@ -168,6 +220,7 @@ namespace VulkanRenderer
 		}
 
 		std::cerr << "Failed to find supported format" << std::endl;
+		return VK_FORMAT_UNDEFINED;
 	}
 
 	VkFormat FindDepthFormat(VkPhysicalDevice device)
@@ -185,31 +238,184 @@ namespace VulkanRenderer
 	{
 		return format == VK_FORMAT_D32_SFLOAT_S8_UINT || format == VK_FORMAT_D24_UNORM_S8_UINT;
 	}
+
+	VkImageAspectFlags GetImageAspectFlags(VkFormat format)
+	{
+		switch (format)
+		{
+		case VK_FORMAT_D16_UNORM:
+		case VK_FORMAT_D32_SFLOAT:
+			return VK_IMAGE_ASPECT_DEPTH_BIT;
+		case VK_FORMAT_D16_UNORM_S8_UINT:
+		case VK_FORMAT_D24_UNORM_S8_UINT:
+		case VK_FORMAT_D32_SFLOAT_S8_UINT:
+			return VK_IMAGE_ASPECT_DEPTH_BIT | VK_IMAGE_ASPECT_STENCIL_BIT;
+		default:
+			return VK_IMAGE_ASPECT_COLOR_BIT;
+		}
+	}
+
+	ImageLayoutAccess GetLayoutAccess(VkImageLayout layout)
+	{
+		switch (layout)
+		{
+		case VK_IMAGE_LAYOUT_UNDEFINED:
+			return {VK_PIPELINE_STAGE_2_NONE, VK_ACCESS_2_NONE};
+		case VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL:
+			return {VK_PIPELINE_STAGE_2_COPY_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT};
+		case VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL:
+			return {VK_PIPELINE_STAGE_2_COPY_BIT, VK_ACCESS_2_TRANSFER_READ_BIT};
+		case VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL:
+			return {VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT, VK_ACCESS_2_SHADER_SAMPLED_READ_BIT};
+		case VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL:
+			return {VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_2_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT};
+		case VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL:
+			return {VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT, VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT};
+		case VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL:
+			return {VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT, VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_2_SHADER_SAMPLED_READ_BIT};
+		case VK_IMAGE_LAYOUT_PRESENT_SRC_KHR:
+			return {VK_PIPELINE_STAGE_2_NONE, VK_ACCESS_2_NONE};
+		default:
+			return {VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, VK_ACCESS_2_MEMORY_READ_BIT | VK_ACCESS_2_MEMORY_WRITE_BIT};
+		}
+	}
+
+	namespace
+	{
+		// The synchronization2 stages that have no legacy bit fold into the legacy stage containing them
+		VkPipelineStageFlags ToLegacyStageMask(VkPipelineStageFlags2 stageMask, VkPipelineStageFlags noneStage)
+		{
+			if (stageMask == VK_PIPELINE_STAGE_2_NONE)
+				return noneStage;
+
+			VkPipelineStageFlags legacyMask = static_cast<VkPipelineStageFlags>(stageMask & 0xFFFFFFFFull);
+
+			if (stageMask & (VK_PIPELINE_STAGE_2_COPY_BIT | VK_PIPELINE_STAGE_2_RESOLVE_BIT | VK_PIPELINE_STAGE_2_BLIT_BIT | VK_PIPELINE_STAGE_2_CLEAR_BIT))
+				legacyMask |= VK_PIPELINE_STAGE_TRANSFER_BIT;
+			if (stageMask & (VK_PIPELINE_STAGE_2_INDEX_INPUT_BIT | VK_PIPELINE_STAGE_2_VERTEX_ATTRIBUTE_INPUT_BIT))
+				legacyMask |= VK_PIPELINE_STAGE_VERTEX_INPUT_BIT;
+			if (stageMask & VK_PIPELINE_STAGE_2_PRE_RASTERIZATION_SHADERS_BIT)
+				legacyMask |= VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_TESSELLATION_CONTROL_SHADER_BIT | VK_PIPELINE_STAGE_TESSELLATION_EVALUATION_SHADER_BIT | VK_PIPELINE_STAGE_GEOMETRY_SHADER_BIT;
+
+			return legacyMask;
+		}
+
+		VkAccessFlags ToLegacyAccessMask(VkAccessFlags2 accessMask)
+		{
+			VkAccessFlags legacyMask = static_cast<VkAccessFlags>(accessMask & 0xFFFFFFFFull);
+
+			if (accessMask & (VK_ACCESS_2_SHADER_SAMPLED_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_READ_BIT))
+				legacyMask |= VK_ACCESS_SHADER_READ_BIT;
+			if (accessMask & VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT)
+				legacyMask |= VK_ACCESS_SHADER_WRITE_BIT;
+
+			return legacyMask;
+		}
+	}
+
+	void RecordPipelineBarrier(VulkanDevice* device, VkCommandBuffer commandBuffer, const std::vector<VkImageMemoryBarrier2>& imageBarriers, const std::vector<VkBufferMemoryBarrier2>& bufferBarriers)
+	{
+		if (imageBarriers.empty() && bufferBarriers.empty())
+			return;
+
+		if (device->synchronization2Enabled)
+		{
+			VkDependencyInfo dependencyInfo{};
+			dependencyInfo.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
+			dependencyInfo.bufferMemoryBarrierCount = static_cast<uint32_t>(bufferBarriers.size());
+			dependencyInfo.pBufferMemoryBarriers = bufferBarriers.data();
+			dependencyInfo.imageMemoryBarrierCount = static_cast<uint32_t>(imageBarriers.size());
+			dependencyInfo.pImageMemoryBarriers = imageBarriers.data();
+
+			vkCmdPipelineBarrier2(commandBuffer, &dependencyInfo);
+			return;
+		}
+
+		// Legacy barriers share one pair of stage masks, so every barrier waits on the union of the sources
+		VkPipelineStageFlags2 srcStageMask = VK_PIPELINE_STAGE_2_NONE;
+		VkPipelineStageFlags2 dstStageMask = VK_PIPELINE_STAGE_2_NONE;
+
+		std::vector<VkImageMemoryBarrier> legacyImageBarriers;
+		legacyImageBarriers.reserve(imageBarriers.size());
+
+		for (const VkImageMemoryBarrier2& barrier : imageBarriers)
+		{
+			VkImageMemoryBarrier legacyBarrier{};
+			legacyBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+			legacyBarrier.srcAccessMask = ToLegacyAccessMask(barrier.srcAccessMask);
+			legacyBarrier.dstAccessMask = ToLegacyAccessMask(barrier.dstAccessMask);
+			legacyBarrier.oldLayout = barrier.oldLayout;
+			legacyBarrier.newLayout = barrier.newLayout;
+			legacyBarrier.srcQueueFamilyIndex = barrier.srcQueueFamilyIndex;
+			legacyBarrier.dstQueueFamilyIndex = barrier.dstQueueFamilyIndex;
+			legacyBarrier.image = barrier.image;
+			legacyBarrier.subresourceRange = barrier.subresourceRange;
+			legacyImageBarriers.push_back(legacyBarrier);
+
+			srcStageMask |= barrier.srcStageMask;
+			dstStageMask |= barrier.dstStageMask;
+		}
+
+		std::vector<VkBufferMemoryBarrier> legacyBufferBarriers;
+		legacyBufferBarriers.reserve(bufferBarriers.size());
+
+		for (const VkBufferMemoryBarrier2& barrier : bufferBarriers)
+		{
+			VkBufferMemoryBarrier legacyBarrier{};
+			legacyBarrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+			legacyBarrier.srcAccessMask = ToLegacyAccessMask(barrier.srcAccessMask);
+			legacyBarrier.dstAccessMask = ToLegacyAccessMask(barrier.dstAccessMask);
+			legacyBarrier.srcQueueFamilyIndex = barrier.srcQueueFamilyIndex;
+			legacyBarrier.dstQueueFamilyIndex = barrier.dstQueueFamilyIndex;
+			legacyBarrier.buffer = barrier.buffer;
+			legacyBarrier.offset = barrier.offset;
+			legacyBarrier.size = barrier.size;
+			legacyBufferBarriers.push_back(legacyBarrier);
+
+			srcStageMask |= barrier.srcStageMask;
+			dstStageMask |= barrier.dstStageMask;
+		}
+
+		vkCmdPipelineBarrier
+		(
+			commandBuffer,
+			ToLegacyStageMask(srcStageMask, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT), ToLegacyStageMask(dstStageMask, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT),
+			0,
+			0, nullptr,
+			static_cast<uint32_t>(legacyBufferBarriers.size()), legacyBufferBarriers.data(),
+			static_cast<uint32_t>(legacyImageBarriers.size()), legacyImageBarriers.data()
+		);
+	}
 	
-	void CopyBuffer(VulkanDevice* device, VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size)
+	uint64_t CopyBuffer(VulkanDevice* device, VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size, VkDeviceSize srcOffset)
 	{
 		VkCommandBuffer commandBuffer = device->BeginSingleTimeCommands();
 
 		VkBufferCopy copyRegion{};
-		copyRegion.srcOffset = 0;
+		copyRegion.srcOffset = srcOffset;
 		copyRegion.dstOffset = 0;
 		copyRegion.size = size;
 		vkCmdCopyBuffer(commandBuffer, srcBuffer, dstBuffer, 1, &copyRegion);
 
-		device->EndSingleTimeCommands(commandBuffer);
+		return device->EndSingleTimeCommands(commandBuffer);
 	}
 
-	void CopyBufferToImage(VulkanDevice* device, VkBuffer buffer, VkImage image, uint32_t width, uint32_t height)
+	uint64_t CopyBufferToImage(VulkanDevice* device, VkBuffer buffer, VkImage image, uint32_t width, uint32_t height)
 	{
 		VkCommandBuffer commandBuffer = device->BeginSingleTimeCommands();
+		RecordCopyBufferToImage(commandBuffer, buffer, image, width, height);
+		return device->EndSingleTimeCommands(commandBuffer);
+	}
 
+	void RecordCopyBufferToImage(VkCommandBuffer commandBuffer, VkBuffer buffer, VkImage image, uint32_t width, uint32_t height, VkDeviceSize bufferOffset, uint32_t mipLevel)
+	{
 		VkBufferImageCopy region{};
-		region.bufferOffset = 0;
+		region.bufferOffset = bufferOffset;
 		region.bufferRowLength = 0;
 		region.bufferImageHeight = 0;
 
 		region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-		region.imageSubresource.mipLevel = 0;
+		region.imageSubresource.mipLevel = mipLevel;
 		region.imageSubresource.baseArrayLayer = 0;
 		region.imageSubresource.layerCount = 1;
 
@@ -217,7 +423,5 @@ namespace VulkanRenderer
 		region.imageExtent = { width, height, 1 };
 
 		vkCmdCopyBufferToImage(commandBuffer, buffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
-
-		device->EndSingleTimeCommands(commandBuffer);
 	}
 }
\ No newline at end of file
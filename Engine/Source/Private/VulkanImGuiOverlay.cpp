@@ -2,15 +2,56 @@
 
 #include <vector>
 #include <iostream>
+#include <cstring>
 
 #include <VulkanInstance.h>
 #include <VulkanDevice.h>
 #include <VulkanSwapChain.h>
 #include <VulkanRenderPass.h>
 #include <ImGuiDescriptorPool.h>
+#include <FileSystem.h>
 
 namespace VulkanRenderer
 {
+	ImGuiDrawSnapshot::~ImGuiDrawSnapshot()
+	{
+		Clear();
+	}
+
+	void ImGuiDrawSnapshot::Capture(const ImDrawData* source)
+	{
+		Clear();
+
+		if (!source || !source->Valid)
+			return;
+
+		// The lists themselves are reused by ImGui every frame, only their output buffers are copied
+		drawData = *source;
+		for (ImDrawList*& list : drawData.CmdLists)
+		{
+			list = list->CloneOutput();
+		}
+		valid = true;
+	}
+
+	void ImGuiDrawSnapshot::Clear()
+	{
+		if (!valid)
+			return;
+
+		for (ImDrawList* list : drawData.CmdLists)
+		{
+			IM_DELETE(list);
+		}
+		drawData.Clear();
+		valid = false;
+	}
+
+	ImDrawData* ImGuiDrawSnapshot::Get()
+	{
+		return valid ? &drawData : nullptr;
+	}
+
 	VulkanImGuiOverlay::VulkanImGuiOverlay(VulkanInstance* instance, VulkanDevice* device, VulkanSwapChain* swapChain, VulkanRenderPass* renderPass, GLFWwindow* glfwWindow)
 		: glfwWindow(glfwWindow)
 	{
@@ -21,7 +62,14 @@ namespace VulkanRenderer
 		ImGuiIO& imGuiIO = ImGui::GetIO(); (void)imGuiIO;
 		imGuiIO.ConfigFlags |= ImGuiConfigFlags_NavEnableKeyboard;
 		
-		imGuiIO.Fonts->AddFontFromFileTTF("Assets/Fonts/RobotoFlex-Regular.ttf", 16.0f);
+		// The atlas takes ownership of the font data and frees it with ImGui's allocator
+		FileData font;
+		if (FileSystem::ReadFile("Assets/Fonts/RobotoFlex-Regular.ttf", font))
+		{
+			void* fontData = IM_ALLOC(font.GetSize());
+			memcpy(fontData, font.GetData(), font.GetSize());
+			imGuiIO.Fonts->AddFontFromMemoryTTF(fontData, static_cast<int>(font.GetSize()), 16.0f);
+		}
 		
 		ImGui_ImplGlfw_InitForVulkan(glfwWindow, true);
 
@@ -34,6 +82,13 @@ namespace VulkanRenderer
 		imGuiInitInfo.Queue = device->graphicsQueue;
 		imGuiInitInfo.DescriptorPool = descriptorPool->Get();
 		imGuiInitInfo.RenderPass = renderPass->Get();
+
+		// Without a render pass ImGui builds its pipeline from the attachment formats instead
+		if (renderPass->Get() == VK_NULL_HANDLE)
+		{
+			imGuiInitInfo.UseDynamicRendering = true;
+			imGuiInitInfo.PipelineRenderingCreateInfo = renderPass->GetPipelineRenderingInfo();
+		}
 		imGuiInitInfo.Subpass = 0;
 		imGuiInitInfo.MinImageCount = swapChain->GetMinImageCount();
 		imGuiInitInfo.ImageCount = swapChain->GetImageCount();
@@ -94,7 +149,7 @@ namespace VulkanRenderer
 		//colors[ImGuiCol_TabDimmedSelectedOverline] = colors[ImGuiCol_TabSelectedOverline];
 	}
 	
-	void VulkanImGuiOverlay::Draw(VkCommandBuffer commandBuffer)
+	void VulkanImGuiOverlay::Render(ImGuiDrawSnapshot& snapshot)
 	{
 		//ImGui::BeginMainMenuBar();
 		//if (ImGui::BeginMenu("File"))
@@ -106,6 +161,12 @@ namespace VulkanRenderer
 		//ImGui::EndMainMenuBar();
 		
 		ImGui::Render();
-		ImGui_ImplVulkan_RenderDrawData(ImGui::GetDrawData(), commandBuffer);
+		snapshot.Capture(ImGui::GetDrawData());
+	}
+
+	void VulkanImGuiOverlay::Draw(VkCommandBuffer commandBuffer, ImDrawData* drawData)
+	{
+		if (drawData)
+			ImGui_ImplVulkan_RenderDrawData(drawData, commandBuffer);
 	}
 }
\ No newline at end of file
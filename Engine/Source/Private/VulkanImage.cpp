@@ -7,8 +7,8 @@
 
 using namespace VulkanRenderer;
 
-VulkanImage::VulkanImage(VulkanDevice* device, uint32_t width, uint32_t height, VkFormat format, VkImageUsageFlags usageFlags, VkMemoryPropertyFlags propertyFlags, VkImageAspectFlags aspectFlags)
-	: device(device), format(format), ownsImage(true)
+VulkanImage::VulkanImage(VulkanDevice* device, uint32_t width, uint32_t height, VkFormat format, VkImageUsageFlags usageFlags, VkMemoryPropertyFlags propertyFlags, VkImageAspectFlags aspectFlags, uint32_t mipLevels)
+	: device(device), format(format), mipLevels(mipLevels), ownsImage(true)
 {
 	CreateImage(width, height, format, VK_IMAGE_TILING_OPTIMAL, usageFlags, propertyFlags, image, memory);
 	CreateImageView(aspectFlags);
@@ -46,6 +46,11 @@ VkImageView VulkanImage::GetImageView() const
 	return imageView;
 }
 
+uint32_t VulkanImage::GetMipLevels() const
+{
+	return mipLevels;
+}
+
 void VulkanImage::CreateImage(uint32_t width, uint32_t height, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usageFlags, VkMemoryPropertyFlags propertyFlags, VkImage& image, VkDeviceMemory& imageMemory)
 {
 	VkDevice logicalDevice = device->GetLogical();
@@ -56,7 +61,7 @@ void VulkanImage::CreateImage(uint32_t width, uint32_t height, VkFormat format,
 	imageInfo.extent.width = width;
 	imageInfo.extent.height = height;
 	imageInfo.extent.depth = 1;
-	imageInfo.mipLevels = 1;
+	imageInfo.mipLevels = mipLevels;
 	imageInfo.arrayLayers = 1;
 	imageInfo.format = format;
 	imageInfo.tiling = tiling;
@@ -103,7 +108,7 @@ void VulkanImage::CreateImageView(VkImageAspectFlags aspectFlags)
 
 	viewInfo.subresourceRange.aspectMask = aspectFlags;
 	viewInfo.subresourceRange.baseMipLevel = 0;
-	viewInfo.subresourceRange.levelCount = 1;
+	viewInfo.subresourceRange.levelCount = mipLevels;
 	viewInfo.subresourceRange.baseArrayLayer = 0;
 	viewInfo.subresourceRange.layerCount = 1;
 	
@@ -114,80 +119,34 @@ void VulkanImage::CreateImageView(VkImageAspectFlags aspectFlags)
 void VulkanImage::TransitionImageLayout(VkImageLayout newLayout)
 {
 	VkCommandBuffer commandBuffer = device->BeginSingleTimeCommands();
+	RecordLayoutTransition(commandBuffer, newLayout);
+	device->EndSingleTimeCommands(commandBuffer);
+}
 
-	VkImageMemoryBarrier memoryBarrier{};
-	memoryBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+void VulkanImage::RecordLayoutTransition(VkCommandBuffer commandBuffer, VkImageLayout newLayout)
+{
+	// Stages and accesses come from the layouts themselves, the previous contents are kept unless the old layout is undefined
+	ImageLayoutAccess source = GetLayoutAccess(currentLayout);
+	ImageLayoutAccess destination = GetLayoutAccess(newLayout);
+
+	VkImageMemoryBarrier2 memoryBarrier{};
+	memoryBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2;
+	memoryBarrier.srcStageMask = source.stageMask;
+	memoryBarrier.srcAccessMask = source.accessMask;
+	memoryBarrier.dstStageMask = destination.stageMask;
+	memoryBarrier.dstAccessMask = destination.accessMask;
 	memoryBarrier.oldLayout = currentLayout;
 	memoryBarrier.newLayout = newLayout;
 	memoryBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
 	memoryBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
 	memoryBarrier.image = image;
+	memoryBarrier.subresourceRange.aspectMask = GetImageAspectFlags(format);
 	memoryBarrier.subresourceRange.baseMipLevel = 0;
-	memoryBarrier.subresourceRange.levelCount = 1;
+	memoryBarrier.subresourceRange.levelCount = mipLevels;
 	memoryBarrier.subresourceRange.baseArrayLayer = 0;
 	memoryBarrier.subresourceRange.layerCount = 1;
 
-	memoryBarrier.srcAccessMask = 0;
-	memoryBarrier.dstAccessMask = 0;
-
-	VkPipelineStageFlags sourceStageFlags;
-	VkPipelineStageFlags destinationStageFlags;
-	
-	if (newLayout == VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL)
-	{
-		memoryBarrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT;
-
-		if (HasStencilComponent(format))
-		{
-			memoryBarrier.subresourceRange.aspectMask |= VK_IMAGE_ASPECT_STENCIL_BIT;
-		}
-	}
-	else
-	{
-		memoryBarrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-	}
-
-	if (currentLayout == VK_IMAGE_LAYOUT_UNDEFINED && newLayout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL)
-	{
-		memoryBarrier.srcAccessMask = 0;
-		memoryBarrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-
-		sourceStageFlags = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
-		destinationStageFlags = VK_PIPELINE_STAGE_TRANSFER_BIT;
-	}
-	else if (currentLayout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL && newLayout == VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL)
-	{
-		memoryBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-		memoryBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
-
-		sourceStageFlags = VK_PIPELINE_STAGE_TRANSFER_BIT;
-		destinationStageFlags = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
-	}
-	else if (currentLayout == VK_IMAGE_LAYOUT_UNDEFINED && newLayout == VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL)
-	{
-		memoryBarrier.srcAccessMask = 0;
-		memoryBarrier.dstAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
-
-		sourceStageFlags = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
-		destinationStageFlags = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
-	}
-	else
-	{
-		std::cerr << "Unsupported layout transition" << std::endl;
-		return;
-	}
-
 	currentLayout = newLayout;
 
-	vkCmdPipelineBarrier
-	(
-		commandBuffer,
-		sourceStageFlags, destinationStageFlags,
-		0,
-		0, nullptr,
-		0, nullptr,
-		1, &memoryBarrier
-	);
-
-	device->EndSingleTimeCommands(commandBuffer);
+	RecordPipelineBarrier(device, commandBuffer, { memoryBarrier });
 }
\ No newline at end of file
@@ -0,0 +1,99 @@
+#include <VulkanOffscreenTarget.h>
+
+#include <iostream>
+#include <cstring>
+
+#include <VulkanDevice.h>
+#include <VulkanImage.h>
+#include <VulkanBuffer.h>
+#include <ImageWriter.h>
+
+using namespace VulkanRenderer;
+
+VulkanOffscreenTarget::VulkanOffscreenTarget(VulkanDevice* device, VkExtent2D extent)
+	: extent(extent), device(device)
+{
+	colorImage = new VulkanImage(device, extent.width, extent.height, colorFormat, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, VK_IMAGE_ASPECT_COLOR_BIT);
+
+	VkDeviceSize readbackSize = static_cast<VkDeviceSize>(extent.width) * extent.height * 4;
+	readbackBuffer = new VulkanBuffer(device, readbackSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+
+	if (vkMapMemory(device->GetLogical(), readbackBuffer->GetMemory(), 0, readbackSize, 0, &mappedData) != VK_SUCCESS)
+	{
+		std::cerr << "Failed to map readback buffer memory" << std::endl;
+	}
+}
+
+VulkanOffscreenTarget::~VulkanOffscreenTarget()
+{
+	VkDevice logicalDevice = device->GetLogical();
+
+	if (mappedData)
+		vkUnmapMemory(logicalDevice, readbackBuffer->GetMemory());
+
+	delete readbackBuffer;
+	delete colorImage;
+}
+
+VkImage VulkanOffscreenTarget::GetColorImage() const
+{
+	return colorImage->Get();
+}
+
+VkImageView VulkanOffscreenTarget::GetColorImageView() const
+{
+	return colorImage->GetImageView();
+}
+
+VkFormat VulkanOffscreenTarget::GetColorFormat() const
+{
+	return colorFormat;
+}
+
+void VulkanOffscreenTarget::RecordReadback(VkCommandBuffer commandBuffer)
+{
+	VkBufferImageCopy region{};
+	region.bufferOffset = 0;
+	region.bufferRowLength = 0;
+	region.bufferImageHeight = 0;
+	region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	region.imageSubresource.mipLevel = 0;
+	region.imageSubresource.baseArrayLayer = 0;
+	region.imageSubresource.layerCount = 1;
+	region.imageOffset = { 0, 0, 0 };
+	region.imageExtent = { extent.width, extent.height, 1 };
+
+	vkCmdCopyImageToBuffer(commandBuffer, colorImage->Get(), VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, readbackBuffer->Get(), 1, &region);
+
+	// Make the copy visible to host reads once the frame's timeline value is reached
+	VkBufferMemoryBarrier2 memoryBarrier{};
+	memoryBarrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER_2;
+	memoryBarrier.srcStageMask = VK_PIPELINE_STAGE_2_COPY_BIT;
+	memoryBarrier.srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT;
+	memoryBarrier.dstStageMask = VK_PIPELINE_STAGE_2_HOST_BIT;
+	memoryBarrier.dstAccessMask = VK_ACCESS_2_HOST_READ_BIT;
+	memoryBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	memoryBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	memoryBarrier.buffer = readbackBuffer->Get();
+	memoryBarrier.offset = 0;
+	memoryBarrier.size = VK_WHOLE_SIZE;
+
+	RecordPipelineBarrier(device, commandBuffer, {}, { memoryBarrier });
+}
+
+const std::vector<uint8_t>& VulkanOffscreenTarget::ReadPixels()
+{
+	size_t size = static_cast<size_t>(extent.width) * extent.height * 4;
+	pixels.resize(size);
+
+	if (mappedData)
+		memcpy(pixels.data(), mappedData, size);
+
+	return pixels;
+}
+
+bool VulkanOffscreenTarget::WritePng(const std::string& path)
+{
+	const std::vector<uint8_t>& frame = ReadPixels();
+	return VulkanRenderer::WritePng(path, extent.width, extent.height, frame.data());
+}
\ No newline at end of file
@@ -2,35 +2,104 @@
 
 #include <iostream>
 #include <array>
+#include <cstddef>
 
 #include <glm/glm.hpp>
 
 #include <Shader.h>
 #include <Vertex.h>
-#include <Mesh.h>
 #include <Camera.h>
+#include <DrawList.h>
 #include <VulkanDevice.h>
-#include <VulkanSwapChain.h>
 #include <VulkanRenderPass.h>
 #include <VulkanImGuiOverlay.h>
+#include <VulkanSync.h>
+#include <Profiler.h>
+#include <FramePacer.h>
+#include <TextureStreamer.h>
+#include <VulkanConfig.h>
+#include <VulkanHelpers.h>
+#include <VulkanBuffer.h>
 
 using namespace VulkanRenderer;
 
-VulkanPipeline::VulkanPipeline(VulkanDevice* device, VulkanSwapChain* swapChain, VulkanRenderPass* renderPass)
-	: device(device), swapChain(swapChain), renderPass(renderPass)
+namespace
+{
+	// Meshlets culled by one task shader workgroup, matches Meshlet.task
+	constexpr uint32_t meshletTaskGroupSize = 32;
+
+	// Stages that read the camera, the model matrix and the mesh clusters besides the vertex shader
+	VkShaderStageFlags GetClusterShaderStages(const VulkanDevice* device)
+	{
+		VkShaderStageFlags stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+		if (device->meshShaderEnabled)
+			stageFlags |= VK_SHADER_STAGE_TASK_BIT_EXT | VK_SHADER_STAGE_MESH_BIT_EXT;
+		return stageFlags;
+	}
+
+	VkBufferMemoryBarrier2 MakeBufferBarrier(VkBuffer buffer, VkPipelineStageFlags2 srcStageMask, VkAccessFlags2 srcAccessMask, VkPipelineStageFlags2 dstStageMask, VkAccessFlags2 dstAccessMask)
+	{
+		VkBufferMemoryBarrier2 barrier{};
+		barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER_2;
+		barrier.srcStageMask = srcStageMask;
+		barrier.srcAccessMask = srcAccessMask;
+		barrier.dstStageMask = dstStageMask;
+		barrier.dstAccessMask = dstAccessMask;
+		barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.buffer = buffer;
+		barrier.offset = 0;
+		barrier.size = VK_WHOLE_SIZE;
+		return barrier;
+	}
+
+	// The selected level of detail, or for a static batch the runs of its visible ranges, with the buffers bound
+	void RecordIndexedDraws(VkCommandBuffer commandBuffer, Mesh* mesh, const DrawItem& draw, const DrawList& drawList)
+	{
+		if (draw.rangeCount == 0)
+		{
+			const MeshLod& meshLod = mesh->GetLod(draw.lod);
+			vkCmdDrawIndexed(commandBuffer, meshLod.indexCount, 1, meshLod.indexOffset, 0, 0);
+			return;
+		}
+
+		const std::vector<DrawRange>& ranges = drawList.GetRanges();
+		for (uint32_t i = draw.firstRange; i < draw.firstRange + draw.rangeCount; i++)
+		{
+			vkCmdDrawIndexed(commandBuffer, ranges[i].indexCount, 1, ranges[i].firstIndex, 0, 0);
+		}
+	}
+}
+
+VulkanPipeline::VulkanPipeline(VulkanDevice* device, VulkanRenderPass* renderPass)
+	: device(device), renderPass(renderPass)
 {
 	CreateCameraDescriptorSetLayout();
 	CreateMeshDescriptorSetLayout();
-	CreateGraphicsPipeline();
+	CreateClusterDescriptorSetLayouts();
+	CreateGraphicsPipelines();
+	CreateClusterCullPipeline();
 }
 
 VulkanPipeline::~VulkanPipeline()
 {
-	vkDestroyPipeline(device->GetLogical(), pipeline, nullptr);
+	for (VkPipeline pipeline : pipelines)
+	{
+		vkDestroyPipeline(device->GetLogical(), pipeline, nullptr);
+	}
+	vkDestroyPipeline(device->GetLogical(), prepassedOpaquePipeline, nullptr);
+	vkDestroyPipeline(device->GetLogical(), depthPrepassPipeline, nullptr);
+	for (VkPipeline pipeline : meshletPipelines)
+	{
+		vkDestroyPipeline(device->GetLogical(), pipeline, nullptr);
+	}
+	vkDestroyPipeline(device->GetLogical(), clusterCullPipeline, nullptr);
 	vkDestroyPipelineLayout(device->GetLogical(), pipelineLayout, nullptr);
 
 	vkDestroyDescriptorSetLayout(device->GetLogical(), cameraDescriptorSetLayout, nullptr);
 	vkDestroyDescriptorSetLayout(device->GetLogical(), meshDescriptorSetLayout, nullptr);
+	vkDestroyDescriptorSetLayout(device->GetLogical(), clusterDescriptorSetLayout, nullptr);
+	vkDestroyDescriptorSetLayout(device->GetLogical(), occlusionDescriptorSetLayout, nullptr);
 }
 
 void VulkanPipeline::SetImGuiOverlay(VulkanImGuiOverlay* overlay)
@@ -38,6 +107,26 @@ void VulkanPipeline::SetImGuiOverlay(VulkanImGuiOverlay* overlay)
 	imGuiOverlay = overlay;
 }
 
+void VulkanPipeline::SetSync(VulkanSync* frameSync)
+{
+	sync = frameSync;
+}
+
+void VulkanPipeline::SetProfiler(Profiler* frameProfiler)
+{
+	profiler = frameProfiler;
+}
+
+void VulkanPipeline::SetFramePacer(FramePacer* pacer)
+{
+	framePacer = pacer;
+}
+
+void VulkanPipeline::SetTextureStreamer(TextureStreamer* streamer)
+{
+	textureStreamer = streamer;
+}
+
 VkDescriptorSetLayout VulkanPipeline::GetCameraDescriptorSetLayout() const
 {
 	return cameraDescriptorSetLayout;
@@ -48,6 +137,16 @@ VkDescriptorSetLayout VulkanPipeline::GetMeshDescriptorSetLayout() const
 	return meshDescriptorSetLayout;
 }
 
+VkDescriptorSetLayout VulkanPipeline::GetClusterDescriptorSetLayout() const
+{
+	return clusterDescriptorSetLayout;
+}
+
+VkDescriptorSetLayout VulkanPipeline::GetOcclusionDescriptorSetLayout() const
+{
+	return occlusionDescriptorSetLayout;
+}
+
 void VulkanPipeline::CreateCameraDescriptorSetLayout()
 {
 	VkDescriptorSetLayoutBinding uboLayoutBinding{};
@@ -55,7 +154,7 @@ void VulkanPipeline::CreateCameraDescriptorSetLayout()
 	uboLayoutBinding.descriptorCount = 1;
 	uboLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
 	uboLayoutBinding.pImmutableSamplers = nullptr;
-	uboLayoutBinding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+	uboLayoutBinding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT | GetClusterShaderStages(device);
 
 	VkDescriptorSetLayoutCreateInfo layoutInfo{};
 	layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
@@ -75,7 +174,7 @@ void VulkanPipeline::CreateMeshDescriptorSetLayout()
 	uboBinding.descriptorCount = 1;
 	uboBinding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
 	uboBinding.pImmutableSamplers = nullptr;
-	uboBinding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+	uboBinding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT | GetClusterShaderStages(device);
 
 	VkDescriptorSetLayoutBinding baseColorBinding{};
 	baseColorBinding.binding = 1;
@@ -110,7 +209,49 @@ void VulkanPipeline::CreateMeshDescriptorSetLayout()
 	}
 }
 
-void VulkanPipeline::CreateGraphicsPipeline()
+void VulkanPipeline::CreateClusterDescriptorSetLayouts()
+{
+	// Meshlets, meshlet vertices, meshlet triangles, mesh vertices, culled indices and the indirect draw, see Mesh
+	std::array<VkDescriptorSetLayoutBinding, 6> clusterBindings{};
+	for (uint32_t i = 0; i < clusterBindings.size(); i++)
+	{
+		clusterBindings[i].binding = i;
+		clusterBindings[i].descriptorCount = 1;
+		clusterBindings[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		clusterBindings[i].pImmutableSamplers = nullptr;
+		clusterBindings[i].stageFlags = GetClusterShaderStages(device);
+	}
+
+	VkDescriptorSetLayoutCreateInfo layoutInfo{};
+	layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	layoutInfo.bindingCount = static_cast<uint32_t>(clusterBindings.size());
+	layoutInfo.pBindings = clusterBindings.data();
+
+	if (vkCreateDescriptorSetLayout(device->GetLogical(), &layoutInfo, nullptr, &clusterDescriptorSetLayout) != VK_SUCCESS)
+	{
+		std::cerr << "Failed to create cluster descriptor set layout" << std::endl;
+	}
+
+	// Depth pyramid, tested by whichever stage culls the meshlets
+	VkDescriptorSetLayoutBinding depthPyramidBinding{};
+	depthPyramidBinding.binding = 0;
+	depthPyramidBinding.descriptorCount = 1;
+	depthPyramidBinding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	depthPyramidBinding.pImmutableSamplers = nullptr;
+	depthPyramidBinding.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	if (device->meshShaderEnabled)
+		depthPyramidBinding.stageFlags |= VK_SHADER_STAGE_TASK_BIT_EXT;
+
+	layoutInfo.bindingCount = 1;
+	layoutInfo.pBindings = &depthPyramidBinding;
+
+	if (vkCreateDescriptorSetLayout(device->GetLogical(), &layoutInfo, nullptr, &occlusionDescriptorSetLayout) != VK_SUCCESS)
+	{
+		std::cerr << "Failed to create occlusion descriptor set layout" << std::endl;
+	}
+}
+
+void VulkanPipeline::CreateGraphicsPipelines()
 {
 	Shader vertShader(device->GetLogical(), "Assets/Shaders/Vert.spv", VK_SHADER_STAGE_VERTEX_BIT);
 	Shader fragShader(device->GetLogical(), "Assets/Shaders/Frag.spv", VK_SHADER_STAGE_FRAGMENT_BIT);
@@ -121,6 +262,22 @@ void VulkanPipeline::CreateGraphicsPipeline()
 		fragShader.GetStageCreateInfo()
 	};
 
+	// The fragment shader's alpha test is a specialization constant, only the alpha-tested pipeline discards
+	VkSpecializationMapEntry alphaTestEntry{};
+	alphaTestEntry.constantID = 0;
+	alphaTestEntry.offset = 0;
+	alphaTestEntry.size = sizeof(VkBool32);
+
+	VkBool32 alphaTest = VK_FALSE;
+
+	VkSpecializationInfo specializationInfo{};
+	specializationInfo.mapEntryCount = 1;
+	specializationInfo.pMapEntries = &alphaTestEntry;
+	specializationInfo.dataSize = sizeof(alphaTest);
+	specializationInfo.pData = &alphaTest;
+
+	shaderStages[1].pSpecializationInfo = &specializationInfo;
+
 	std::vector<VkDynamicState> dynamicStates =
 	{
 		VK_DYNAMIC_STATE_VIEWPORT,
@@ -132,8 +289,8 @@ void VulkanPipeline::CreateGraphicsPipeline()
 	dynamicStateInfo.dynamicStateCount = static_cast<uint32_t>(dynamicStates.size());
 	dynamicStateInfo.pDynamicStates = dynamicStates.data();
 
-	auto bindingDescription = Vertex::GetBindingDescription();
-	auto attributeDescriptions = Vertex::GetAttributeDescriptions();
+	constexpr auto bindingDescription = VertexLayout<PackedVertex>::GetBindingDescription();
+	constexpr auto attributeDescriptions = VertexLayout<PackedVertex>::GetAttributeDescriptions();
 
 	VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
 	vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
@@ -188,7 +345,7 @@ void VulkanPipeline::CreateGraphicsPipeline()
 
 	VkPipelineColorBlendAttachmentState colorBlendAttachmentState{};
 	colorBlendAttachmentState.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
-	colorBlendAttachmentState.blendEnable = VK_TRUE;
+	colorBlendAttachmentState.blendEnable = VK_FALSE;
 	colorBlendAttachmentState.srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA;
 	colorBlendAttachmentState.dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
 	colorBlendAttachmentState.colorBlendOp = VK_BLEND_OP_ADD;
@@ -207,7 +364,7 @@ void VulkanPipeline::CreateGraphicsPipeline()
 	colorBlendStateInfo.blendConstants[2] = 0.0f;
 	colorBlendStateInfo.blendConstants[3] = 0.0f;
 
-	std::array<VkDescriptorSetLayout, 2> descriptorSetLayouts = { cameraDescriptorSetLayout, meshDescriptorSetLayout };
+	std::array<VkDescriptorSetLayout, 4> descriptorSetLayouts = { cameraDescriptorSetLayout, meshDescriptorSetLayout, clusterDescriptorSetLayout, occlusionDescriptorSetLayout };
 	
 	VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
 	pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
@@ -235,81 +392,338 @@ void VulkanPipeline::CreateGraphicsPipeline()
 	pipelineInfo.layout = pipelineLayout;
 	pipelineInfo.renderPass = renderPass->Get();
 	pipelineInfo.subpass = 0;
+
+	VkPipelineRenderingCreateInfo renderingInfo = renderPass->GetPipelineRenderingInfo();
+	if (renderPass->Get() == VK_NULL_HANDLE)
+		pipelineInfo.pNext = &renderingInfo;
 	pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
 	pipelineInfo.basePipelineIndex = -1;
 
-	if (vkCreateGraphicsPipelines(device->GetLogical(), VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &pipeline) != VK_SUCCESS)
+	for (uint32_t i = 0; i < BlendModeCount; i++)
+	{
+		BlendMode blendMode = static_cast<BlendMode>(i);
+
+		// Opaque pipelines skip blending so early depth rejection and the blend units are not wasted on them
+		alphaTest = blendMode == BlendMode::AlphaTest ? VK_TRUE : VK_FALSE;
+		colorBlendAttachmentState.blendEnable = blendMode == BlendMode::Transparent ? VK_TRUE : VK_FALSE;
+		depthStencilInfo.depthWriteEnable = blendMode == BlendMode::Transparent ? VK_FALSE : VK_TRUE;
+
+		if (vkCreateGraphicsPipelines(device->GetLogical(), VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &pipelines[i]) != VK_SUCCESS)
+		{
+			std::cerr << "Failed to create graphics pipeline" << std::endl;
+		}
+	}
+
+	if (device->meshShaderEnabled)
+	{
+		Shader taskShader(device->GetLogical(), "Assets/Shaders/MeshletTask.spv", VK_SHADER_STAGE_TASK_BIT_EXT);
+		Shader meshShader(device->GetLogical(), "Assets/Shaders/MeshletMesh.spv", VK_SHADER_STAGE_MESH_BIT_EXT);
+
+		VkPipelineShaderStageCreateInfo meshletShaderStages[] =
+		{
+			taskShader.GetStageCreateInfo(),
+			meshShader.GetStageCreateInfo(),
+			fragShader.GetStageCreateInfo()
+		};
+		meshletShaderStages[2].pSpecializationInfo = &specializationInfo;
+
+		// The mesh shader fetches and assembles its own vertices
+		pipelineInfo.stageCount = 3;
+		pipelineInfo.pStages = meshletShaderStages;
+		pipelineInfo.pVertexInputState = nullptr;
+		pipelineInfo.pInputAssemblyState = nullptr;
+
+		for (BlendMode blendMode : { BlendMode::Opaque, BlendMode::AlphaTest })
+		{
+			alphaTest = blendMode == BlendMode::AlphaTest ? VK_TRUE : VK_FALSE;
+			colorBlendAttachmentState.blendEnable = VK_FALSE;
+			depthStencilInfo.depthWriteEnable = VK_TRUE;
+
+			if (vkCreateGraphicsPipelines(device->GetLogical(), VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &meshletPipelines[static_cast<uint32_t>(blendMode)]) != VK_SUCCESS)
+			{
+				std::cerr << "Failed to create meshlet pipeline" << std::endl;
+			}
+		}
+
+		pipelineInfo.stageCount = 2;
+		pipelineInfo.pStages = shaderStages;
+		pipelineInfo.pVertexInputState = &vertexInputInfo;
+		pipelineInfo.pInputAssemblyState = &inputAssemblyInfo;
+	}
+
+	// Depth is already resolved, only the visible surface passes the EQUAL test
+	alphaTest = VK_FALSE;
+	colorBlendAttachmentState.blendEnable = VK_FALSE;
+	depthStencilInfo.depthWriteEnable = VK_FALSE;
+	depthStencilInfo.depthCompareOp = VK_COMPARE_OP_EQUAL;
+
+	if (vkCreateGraphicsPipelines(device->GetLogical(), VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &prepassedOpaquePipeline) != VK_SUCCESS)
+	{
+		std::cerr << "Failed to create prepassed opaque pipeline" << std::endl;
+	}
+
+	Shader depthVertShader(device->GetLogical(), "Assets/Shaders/DepthVert.spv", VK_SHADER_STAGE_VERTEX_BIT);
+	VkPipelineShaderStageCreateInfo depthShaderStage = depthVertShader.GetStageCreateInfo();
+
+	constexpr auto positionBindingDescription = VertexLayout<PositionVertex>::GetBindingDescription();
+	constexpr auto positionAttributeDescriptions = VertexLayout<PositionVertex>::GetAttributeDescriptions();
+
+	vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(positionAttributeDescriptions.size());
+	vertexInputInfo.pVertexBindingDescriptions = &positionBindingDescription;
+	vertexInputInfo.pVertexAttributeDescriptions = positionAttributeDescriptions.data();
+
+	// The render pass still has a color attachment, it is left untouched
+	colorBlendAttachmentState.colorWriteMask = 0;
+	depthStencilInfo.depthWriteEnable = VK_TRUE;
+	depthStencilInfo.depthCompareOp = VK_COMPARE_OP_LESS;
+
+	pipelineInfo.stageCount = 1;
+	pipelineInfo.pStages = &depthShaderStage;
+
+	if (vkCreateGraphicsPipelines(device->GetLogical(), VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &depthPrepassPipeline) != VK_SUCCESS)
 	{
-		std::cerr << "Failed to create graphics pipeline" << std::endl;
+		std::cerr << "Failed to create depth prepass pipeline" << std::endl;
 	}
 }
 
-void VulkanPipeline::RecordCommandBuffer(VkCommandBuffer commandBuffer, uint32_t imageIndex, uint32_t currentFrame, const std::vector<std::unique_ptr<Mesh>>& meshes, Camera* camera)
+void VulkanPipeline::CreateClusterCullPipeline()
 {
-	VkCommandBufferBeginInfo beginInfo{};
-	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
-	beginInfo.pInheritanceInfo = nullptr;
-	
-	if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS)
-	{
-		std::cerr << "Failed to begin recording command buffer" << std::endl;
+	// The task shader culls when mesh shaders are supported
+	if (device->meshShaderEnabled)
 		return;
+
+	Shader computeShader(device->GetLogical(), "Assets/Shaders/MeshletCull.spv", VK_SHADER_STAGE_COMPUTE_BIT);
+
+	VkComputePipelineCreateInfo pipelineInfo{};
+	pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+	pipelineInfo.stage = computeShader.GetStageCreateInfo();
+	pipelineInfo.layout = pipelineLayout;
+
+	if (vkCreateComputePipelines(device->GetLogical(), VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &clusterCullPipeline) != VK_SUCCESS)
+	{
+		std::cerr << "Failed to create cluster cull pipeline" << std::endl;
 	}
-	
-	VkRenderPassBeginInfo renderPassInfo{};
-	renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-	renderPassInfo.renderPass = renderPass->Get();
-	renderPassInfo.framebuffer = swapChain->framebuffers[imageIndex];
-	renderPassInfo.renderArea.offset = { 0, 0 };
-	renderPassInfo.renderArea.extent = swapChain->extent;
-
-	std::array<VkClearValue, 2> clearValues{};
-	clearValues[0].color = { { 0.0f, 0.0f, 0.0f } };
-	clearValues[1].depthStencil = { 1.0f, 0 };
-
-	renderPassInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
-	renderPassInfo.pClearValues = clearValues.data();
-	
-	vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
-	
-	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+}
 
+void VulkanPipeline::RecordCommandBuffer(VkCommandBuffer commandBuffer, VkExtent2D extent, uint32_t currentFrame, const std::vector<Mesh*>& meshes, const DrawList& drawList, Camera* camera, VkDescriptorSet occlusionDescriptorSet, ImDrawData* uiDrawData)
+{
 	VkViewport viewport{};
 	viewport.x = 0.0f;
 	viewport.y = 0.0f;
-	viewport.width = static_cast<float>(swapChain->extent.width);
-	viewport.height = static_cast<float>(swapChain->extent.height);
+	viewport.width = static_cast<float>(extent.width);
+	viewport.height = static_cast<float>(extent.height);
 	viewport.minDepth = 0.0f;
 	viewport.maxDepth = 1.0f;
 	vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
 	
 	VkRect2D scissor{};
 	scissor.offset = { 0, 0 };
-	scissor.extent = swapChain->extent;
+	scissor.extent = extent;
 	vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
 	
-	// Render each mesh
-	for (const std::unique_ptr<Mesh>& mesh : meshes)
+	// Every pipeline shares the layout, so the camera set stays bound across pipeline changes
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &camera->descriptorSets[currentFrame], 0, nullptr);
+
+	VkPipeline boundPipeline = VK_NULL_HANDLE;
+
+	const std::vector<DrawItem>& depthPrepassDraws = drawList.GetDepthPrepass();
+	if (!depthPrepassDraws.empty())
 	{
-		VkBuffer vertexBuffers[] = { mesh->vertexBuffer->Get() };
-		VkDeviceSize offsets[] = { 0 };
-		
-		// Bind vertex and index buffers of mesh
-		vkCmdBindVertexBuffers(commandBuffer, 0, 1, vertexBuffers, offsets);
-		vkCmdBindIndexBuffer(commandBuffer, mesh->indexBuffer->Get(), 0, VK_INDEX_TYPE_UINT16);
-		
-		// Bind camera (view & proj matrices) and mesh (model matrix) descriptor sets
-		std::array<VkDescriptorSet, 2> descriptorSets = {camera->descriptorSets[currentFrame], mesh->descriptorSets[currentFrame]};
-		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, static_cast<uint32_t>(descriptorSets.size()), descriptorSets.data(), 0, nullptr);
-		
-		// Draw the mesh
-		vkCmdDrawIndexed(commandBuffer, static_cast<uint32_t>(mesh->GetIndicesSize()), 1, 0, 0, 0);
+		if (profiler)
+			profiler->BeginGpuScope(commandBuffer, "Depth prepass");
+
+		vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, depthPrepassPipeline);
+		boundPipeline = depthPrepassPipeline;
+
+		for (const DrawItem& draw : depthPrepassDraws)
+		{
+			RecordDepthDraw(commandBuffer, currentFrame, meshes[draw.meshIndex], draw, drawList);
+		}
+
+		if (profiler)
+			profiler->EndGpuScope(commandBuffer);
+	}
+
+	const std::vector<DrawItem>& clusteredDraws = drawList.GetClustered();
+	if (!clusteredDraws.empty())
+	{
+		if (profiler)
+			profiler->BeginGpuScope(commandBuffer, "Clusters");
+
+		// Only the task shader tests the depth pyramid during rendering
+		if (device->meshShaderEnabled)
+			vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 3, 1, &occlusionDescriptorSet, 0, nullptr);
+
+		for (const DrawItem& draw : clusteredDraws)
+		{
+			RecordClusteredDraw(commandBuffer, currentFrame, meshes[draw.meshIndex], boundPipeline);
+		}
+
+		if (profiler)
+			profiler->EndGpuScope(commandBuffer);
+	}
+
+	if (profiler)
+		profiler->BeginGpuScope(commandBuffer, "Opaque");
+
+	for (const DrawItem& draw : drawList.GetOpaque())
+	{
+		Mesh* mesh = meshes[draw.meshIndex];
+
+		VkPipeline meshPipeline = pipelines[static_cast<uint32_t>(mesh->blendMode)];
+		if (!depthPrepassDraws.empty() && mesh->blendMode == BlendMode::Opaque)
+			meshPipeline = prepassedOpaquePipeline;
+
+		RecordDraw(commandBuffer, currentFrame, mesh, draw, drawList, meshPipeline, boundPipeline);
+	}
+
+	if (profiler)
+	{
+		profiler->EndGpuScope(commandBuffer);
+		profiler->BeginGpuScope(commandBuffer, "Transparent");
+	}
+
+	for (const DrawItem& draw : drawList.GetTransparent())
+	{
+		RecordDraw(commandBuffer, currentFrame, meshes[draw.meshIndex], draw, drawList, pipelines[static_cast<uint32_t>(BlendMode::Transparent)], boundPipeline);
+	}
+
+	if (profiler)
+		profiler->EndGpuScope(commandBuffer);
+
+	if (imGuiOverlay && uiDrawData)
+	{
+		if (profiler)
+			profiler->BeginGpuScope(commandBuffer, "ImGui");
+
+		imGuiOverlay->Draw(commandBuffer, uiDrawData);
+
+		if (profiler)
+			profiler->EndGpuScope(commandBuffer);
+	}
+}
+
+void VulkanPipeline::RecordDraw(VkCommandBuffer commandBuffer, uint32_t currentFrame, Mesh* mesh, const DrawItem& draw, const DrawList& drawList, VkPipeline meshPipeline, VkPipeline& boundPipeline)
+{
+	if (meshPipeline != boundPipeline)
+	{
+		vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, meshPipeline);
+		boundPipeline = meshPipeline;
 	}
+
+	VkBuffer vertexBuffers[] = { mesh->vertexBuffer->Get() };
+	VkDeviceSize offsets[] = { 0 };
+	
+	// Bind vertex and index buffers of mesh
+	vkCmdBindVertexBuffers(commandBuffer, 0, 1, vertexBuffers, offsets);
+	vkCmdBindIndexBuffer(commandBuffer, mesh->indexBuffer->Get(), 0, mesh->GetIndexType());
 	
-	// If Dear ImGui overlay exists, draw UI representing objects in the scene
+	// Bind mesh (model matrix and textures) descriptor set
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 1, 1, &mesh->descriptorSets[currentFrame], 0, nullptr);
+	
+	// Draw the mesh at the selected level of detail
+	RecordIndexedDraws(commandBuffer, mesh, draw, drawList);
+}
+
+void VulkanPipeline::RecordDepthDraw(VkCommandBuffer commandBuffer, uint32_t currentFrame, Mesh* mesh, const DrawItem& draw, const DrawList& drawList)
+{
+	VkBuffer vertexBuffers[] = { mesh->positionBuffer->Get() };
+	VkDeviceSize offsets[] = { 0 };
+
+	vkCmdBindVertexBuffers(commandBuffer, 0, 1, vertexBuffers, offsets);
+	vkCmdBindIndexBuffer(commandBuffer, mesh->indexBuffer->Get(), 0, mesh->GetIndexType());
+
+	// Only the model matrix is read, the textures in the set are ignored
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 1, 1, &mesh->descriptorSets[currentFrame], 0, nullptr);
+
+	// Same level and ranges as the shading draw, the EQUAL test needs identical triangles
+	RecordIndexedDraws(commandBuffer, mesh, draw, drawList);
+}
+
+void VulkanPipeline::RecordClusteredDraw(VkCommandBuffer commandBuffer, uint32_t currentFrame, Mesh* mesh, VkPipeline& boundPipeline)
+{
+	VkPipeline meshPipeline = device->meshShaderEnabled ? meshletPipelines[static_cast<uint32_t>(mesh->blendMode)] : pipelines[static_cast<uint32_t>(mesh->blendMode)];
+	if (meshPipeline != boundPipeline)
+	{
+		vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, meshPipeline);
+		boundPipeline = meshPipeline;
+	}
+
+	if (device->meshShaderEnabled)
+	{
+		std::array<VkDescriptorSet, 2> descriptorSets = { mesh->descriptorSets[currentFrame], mesh->clusterDescriptorSet };
+		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 1, static_cast<uint32_t>(descriptorSets.size()), descriptorSets.data(), 0, nullptr);
+
+		uint32_t taskGroupCount = (mesh->GetMeshletCount() + meshletTaskGroupSize - 1) / meshletTaskGroupSize;
+		vkCmdDrawMeshTasksEXT(commandBuffer, taskGroupCount, 1, 1);
+		return;
+	}
+
+	VkBuffer vertexBuffers[] = { mesh->vertexBuffer->Get() };
+	VkDeviceSize offsets[] = { 0 };
+
+	// The cluster cull pass wrote the visible triangles and their count earlier in the frame
+	vkCmdBindVertexBuffers(commandBuffer, 0, 1, vertexBuffers, offsets);
+	vkCmdBindIndexBuffer(commandBuffer, mesh->culledIndexBuffer->Get(), 0, VK_INDEX_TYPE_UINT32);
+
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 1, 1, &mesh->descriptorSets[currentFrame], 0, nullptr);
+
+	vkCmdDrawIndexedIndirect(commandBuffer, mesh->drawCommandBuffer->Get(), 0, 1, sizeof(VkDrawIndexedIndirectCommand));
+}
+
+void VulkanPipeline::RecordClusterCulling(VkCommandBuffer commandBuffer, uint32_t currentFrame, const std::vector<Mesh*>& meshes, const DrawList& drawList, Camera* camera, VkDescriptorSet occlusionDescriptorSet)
+{
+	const std::vector<DrawItem>& clusteredDraws = drawList.GetClustered();
+	if (clusteredDraws.empty() || clusterCullPipeline == VK_NULL_HANDLE)
+		return;
+
+	// The previous frame may still be drawing from these buffers
+	std::vector<VkBufferMemoryBarrier2> barriers;
+	for (const DrawItem& draw : clusteredDraws)
+	{
+		Mesh* mesh = meshes[draw.meshIndex];
+		barriers.push_back(MakeBufferBarrier(mesh->drawCommandBuffer->Get(), VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT, VK_ACCESS_2_NONE, VK_PIPELINE_STAGE_2_CLEAR_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT));
+		barriers.push_back(MakeBufferBarrier(mesh->culledIndexBuffer->Get(), VK_PIPELINE_STAGE_2_INDEX_INPUT_BIT, VK_ACCESS_2_NONE, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT));
+	}
+	RecordPipelineBarrier(device, commandBuffer, {}, barriers);
+
+	// Every draw starts with no indices, culling appends the visible meshlets' triangles
+	barriers.clear();
+	for (const DrawItem& draw : clusteredDraws)
+	{
+		Mesh* mesh = meshes[draw.meshIndex];
+		vkCmdFillBuffer(commandBuffer, mesh->drawCommandBuffer->Get(), offsetof(VkDrawIndexedIndirectCommand, indexCount), sizeof(uint32_t), 0);
+		barriers.push_back(MakeBufferBarrier(mesh->drawCommandBuffer->Get(), VK_PIPELINE_STAGE_2_CLEAR_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT));
+	}
+	RecordPipelineBarrier(device, commandBuffer, {}, barriers);
+
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, clusterCullPipeline);
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipelineLayout, 0, 1, &camera->descriptorSets[currentFrame], 0, nullptr);
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipelineLayout, 3, 1, &occlusionDescriptorSet, 0, nullptr);
+
+	barriers.clear();
+	for (const DrawItem& draw : clusteredDraws)
+	{
+		Mesh* mesh = meshes[draw.meshIndex];
+
+		std::array<VkDescriptorSet, 2> descriptorSets = { mesh->descriptorSets[currentFrame], mesh->clusterDescriptorSet };
+		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipelineLayout, 1, static_cast<uint32_t>(descriptorSets.size()), descriptorSets.data(), 0, nullptr);
+
+		vkCmdDispatch(commandBuffer, mesh->GetMeshletCount(), 1, 1);
+
+		barriers.push_back(MakeBufferBarrier(mesh->drawCommandBuffer->Get(), VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT, VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT, VK_ACCESS_2_INDIRECT_COMMAND_READ_BIT));
+		barriers.push_back(MakeBufferBarrier(mesh->culledIndexBuffer->Get(), VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT, VK_PIPELINE_STAGE_2_INDEX_INPUT_BIT, VK_ACCESS_2_INDEX_READ_BIT));
+	}
+	RecordPipelineBarrier(device, commandBuffer, {}, barriers);
+}
+
+void VulkanPipeline::BuildUI(Camera* camera, const std::vector<std::unique_ptr<Mesh>>& meshes)
+{
+	// If Dear ImGui overlay exists, build UI representing objects in the scene
 	if (imGuiOverlay)
 	{
+		ProfileScope uiScope(profiler, "Build UI");
+
 		imGuiOverlay->NewFrame();
 		
 		// Begin scene UI window
@@ -318,6 +732,50 @@ void VulkanPipeline::RecordCommandBuffer(VkCommandBuffer commandBuffer, uint32_t
 		// Reduce frame padding for drag UI boxes
 		ImGui::PushStyleVar(ImGuiStyleVar_FramePadding, ImVec2(2.0f, 2.0f));
 
+		if (sync && ImGui::TreeNode("Frame Pacing"))
+		{
+			FrameTimings timings = sync->GetPublishedTimings();
+
+			ImGui::Text("Frame interval: %.2f ms", timings.frameIntervalMs);
+			ImGui::Text("Frame slot wait: %.2f ms", timings.frameWaitMs);
+			ImGui::Text("Acquire: %.2f ms", timings.acquireMs);
+			ImGui::Text("Submit: %.2f ms", timings.submitMs);
+			ImGui::Text("Present: %.2f ms", timings.presentMs);
+
+			// Fewer frames in flight lowers latency, more frames in flight raises throughput
+			ImGui::SliderInt("Frames in flight", &sync->requestedFramesInFlight, VulkanConfig::MIN_SUPPORTED_FRAMES_IN_FLIGHT, VulkanConfig::MAX_SUPPORTED_FRAMES_IN_FLIGHT);
+
+			if (framePacer)
+				framePacer->DrawImGui();
+
+			ImGui::TreePop();
+		}
+
+		if (ImGui::TreeNode("Rendering"))
+		{
+			ImGui::Checkbox("Depth prepass", &depthPrepass);
+			ImGui::Checkbox("Cluster culling", &clusterCulling);
+			ImGui::SliderFloat("LOD error (px)", &lodErrorThreshold, 0.0f, 8.0f, "%.1f");
+			ImGui::SliderFloat("HLOD distance", &hlodDistance, 0.0f, 200.0f, "%.0f");
+			ImGui::Text("Clusters: %s", device->meshShaderEnabled ? "task and mesh shaders" : "compute culled indirect draws");
+
+			ImGui::TreePop();
+		}
+
+		if (textureStreamer && ImGui::TreeNode("Texture Streaming"))
+		{
+			textureStreamer->DrawImGui();
+
+			ImGui::TreePop();
+		}
+
+		if (profiler && ImGui::TreeNode("Profiler"))
+		{
+			profiler->DrawImGui();
+
+			ImGui::TreePop();
+		}
+
 		if (ImGui::TreeNode("Camera"))
 		{
 			ImGui::DragFloat3("Position", &camera->transform.position[0], 0.01f, 0.0f, 0.0f, "%.2f");
@@ -354,6 +812,18 @@ void VulkanPipeline::RecordCommandBuffer(VkCommandBuffer commandBuffer, uint32_t
 				}
 				ImGui::DragFloat3("Scale", &mesh->transform.scale[0], 0.01f, 0.0f, 0.0f, "%.2f");
 
+				const MeshOptimizationStats& stats = mesh->optimizationStats;
+				ImGui::Text("Triangles: %zu, %s indices", mesh->GetIndicesSize() / 3, mesh->GetIndexType() == VK_INDEX_TYPE_UINT16 ? "16-bit" : "32-bit");
+				ImGui::Text("Vertices: %zu -> %zu", stats.vertexCountBefore, stats.vertexCountAfter);
+				ImGui::Text("ACMR: %.3f -> %.3f", stats.acmrBefore, stats.acmrAfter);
+				if (mesh->HasMeshlets())
+					ImGui::Text("Meshlets: %u", mesh->GetMeshletCount());
+				if (mesh->IsStaticBatch())
+					ImGui::Text("Static batch: %zu meshes", mesh->GetRanges().size());
+
+				uint32_t lod = mesh->GetSelectedLod();
+				ImGui::Text("LOD: %u of %u, %u triangles", lod, mesh->GetLodCount(), mesh->GetLod(lod).indexCount / 3);
+
 				ImGui::TreePop();
 			}
 			i++;
@@ -364,14 +834,5 @@ void VulkanPipeline::RecordCommandBuffer(VkCommandBuffer commandBuffer, uint32_t
 
 		// End scene UI window
 		ImGui::End();
-
-		imGuiOverlay->Draw(commandBuffer);
-	}
-	
-	vkCmdEndRenderPass(commandBuffer);
-
-	if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS)
-	{
-		std::cerr << "Failed to record command buffer" << std::endl;
 	}
 }
\ No newline at end of file
@@ -7,15 +7,17 @@
 
 using namespace VulkanRenderer;
 
-VulkanRenderPass::VulkanRenderPass(VulkanDevice* device, VkFormat swapChainImageFormat)
-	: device(device)
+VulkanRenderPass::VulkanRenderPass(VulkanDevice* device, VkFormat colorFormat)
+	: colorFormat(colorFormat), depthFormat(FindDepthFormat(device->GetPhysical())), device(device)
 {
-	CreateRenderPass(swapChainImageFormat);
+	if (!device->dynamicRenderingEnabled)
+		CreateRenderPass();
 }
 
 VulkanRenderPass::~VulkanRenderPass()
 {
-	vkDestroyRenderPass(device->GetLogical(), renderPass, nullptr);
+	if (renderPass != VK_NULL_HANDLE)
+		vkDestroyRenderPass(device->GetLogical(), renderPass, nullptr);
 }
 
 VkRenderPass VulkanRenderPass::Get() const
@@ -23,30 +25,50 @@ VkRenderPass VulkanRenderPass::Get() const
 	return renderPass;
 }
 
-void VulkanRenderPass::CreateRenderPass(VkFormat swapChainImageFormat)
+VkFormat VulkanRenderPass::GetColorFormat() const
+{
+	return colorFormat;
+}
+
+VkFormat VulkanRenderPass::GetDepthFormat() const
+{
+	return depthFormat;
+}
+
+VkPipelineRenderingCreateInfo VulkanRenderPass::GetPipelineRenderingInfo() const
+{
+	VkPipelineRenderingCreateInfo renderingInfo{};
+	renderingInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO;
+	renderingInfo.colorAttachmentCount = 1;
+	renderingInfo.pColorAttachmentFormats = &colorFormat;
+	renderingInfo.depthAttachmentFormat = depthFormat;
+	return renderingInfo;
+}
+
+void VulkanRenderPass::CreateRenderPass()
 {
 	VkAttachmentDescription colorAttachment{};
-	colorAttachment.format = swapChainImageFormat;
+	colorAttachment.format = colorFormat;
 	colorAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
 	colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
 	colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
 	colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
 	colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-	colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-	colorAttachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+	colorAttachment.initialLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+	colorAttachment.finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
 
 	VkAttachmentReference colorAttachmentRef{};
 	colorAttachmentRef.attachment = 0;
 	colorAttachmentRef.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
 
 	VkAttachmentDescription depthAttachment{};
-	depthAttachment.format = FindDepthFormat(device->GetPhysical());
+	depthAttachment.format = depthFormat;
 	depthAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
 	depthAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
 	depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
 	depthAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
 	depthAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-	depthAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	depthAttachment.initialLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
 	depthAttachment.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
 
 	VkAttachmentReference depthAttachmentRef{};
@@ -59,14 +81,6 @@ void VulkanRenderPass::CreateRenderPass(VkFormat swapChainImageFormat)
 	subpass.pColorAttachments = &colorAttachmentRef;
 	subpass.pDepthStencilAttachment = &depthAttachmentRef;
 
-	VkSubpassDependency dependency{};
-	dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
-	dependency.dstSubpass = 0;
-	dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
-	dependency.srcAccessMask = 0;
-	dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
-	dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
-
 	std::array<VkAttachmentDescription, 2> attachments = { colorAttachment, depthAttachment };
 	VkRenderPassCreateInfo renderPassInfo{};
 	renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
@@ -74,8 +88,6 @@ void VulkanRenderPass::CreateRenderPass(VkFormat swapChainImageFormat)
 	renderPassInfo.pAttachments = attachments.data();
 	renderPassInfo.subpassCount = 1;
 	renderPassInfo.pSubpasses = &subpass;
-	renderPassInfo.dependencyCount = 1;
-	renderPassInfo.pDependencies = &dependency;
 
 	if (vkCreateRenderPass(device->GetLogical(), &renderPassInfo, nullptr, &renderPass) != VK_SUCCESS)
 	{
@@ -0,0 +1,117 @@
+#include <VulkanStagingRing.h>
+
+#include <iostream>
+#include <algorithm>
+
+#include <VulkanDevice.h>
+#include <VulkanBuffer.h>
+
+namespace VulkanRenderer
+{
+	VulkanStagingRing::VulkanStagingRing(VulkanDevice* device, VkDeviceSize size)
+		: device(device), capacity(size)
+	{
+		buffer = new VulkanBuffer(device, capacity, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+
+		void* data;
+		if (vkMapMemory(device->GetLogical(), buffer->GetMemory(), 0, VK_WHOLE_SIZE, 0, &data) != VK_SUCCESS)
+		{
+			std::cerr << "Failed to map staging ring" << std::endl;
+			capacity = 0;
+			return;
+		}
+		mapped = static_cast<uint8_t*>(data);
+	}
+
+	VulkanStagingRing::~VulkanStagingRing()
+	{
+		if (mapped)
+			vkUnmapMemory(device->GetLogical(), buffer->GetMemory());
+		delete buffer;
+	}
+
+	StagingAllocation VulkanStagingRing::Allocate(VkDeviceSize size)
+	{
+		StagingAllocation allocation;
+		allocation.size = size;
+
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+
+			// Live slots run from the oldest one's begin up to head, wrapping around the end at most once
+			VkDeviceSize tail = slots.empty() ? 0 : slots.front().begin;
+			if (slots.empty())
+				head = 0;
+
+			// Empty uploads still take a byte, so a live slot never leaves head equal to its begin
+			VkDeviceSize slotSize = std::max<VkDeviceSize>(size, 1);
+
+			bool wrapped = !slots.empty() && head <= tail;
+			VkDeviceSize offset = (head + Alignment - 1) & ~(Alignment - 1);
+
+			bool fits;
+			if (wrapped)
+			{
+				fits = offset + slotSize <= tail;
+			}
+			else
+			{
+				fits = offset + slotSize <= capacity;
+
+				// The end of the buffer is skipped, it is free again once the slots before it are released
+				if (!fits && slotSize <= tail)
+				{
+					offset = 0;
+					fits = true;
+				}
+			}
+
+			if (fits)
+			{
+				allocation.id = nextId++;
+				allocation.buffer = buffer->Get();
+				allocation.offset = offset;
+				allocation.data = mapped + offset;
+
+				slots.push_back({allocation.id, offset, false});
+				head = offset + slotSize;
+				return allocation;
+			}
+		}
+
+		allocation.dedicatedBuffer = new VulkanBuffer(device, std::max<VkDeviceSize>(size, 1), VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+		allocation.buffer = allocation.dedicatedBuffer->Get();
+
+		void* data;
+		vkMapMemory(device->GetLogical(), allocation.dedicatedBuffer->GetMemory(), 0, VK_WHOLE_SIZE, 0, &data);
+		allocation.data = static_cast<uint8_t*>(data);
+		return allocation;
+	}
+
+	void VulkanStagingRing::Release(const StagingAllocation& allocation)
+	{
+		if (allocation.dedicatedBuffer)
+		{
+			vkUnmapMemory(device->GetLogical(), allocation.dedicatedBuffer->GetMemory());
+			delete allocation.dedicatedBuffer;
+			return;
+		}
+
+		std::lock_guard<std::mutex> lock(mutex);
+
+		for (Slot& slot : slots)
+		{
+			if (slot.id == allocation.id)
+			{
+				slot.released = true;
+				break;
+			}
+		}
+
+		// Space is only reclaimed from the oldest slot on, later slots released early wait for it
+		while (!slots.empty() && slots.front().released)
+		{
+			slots.pop_front();
+		}
+	}
+}
\ No newline at end of file
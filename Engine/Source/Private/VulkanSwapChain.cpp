@@ -1,20 +1,24 @@
 #include <VulkanSwapChain.h>
 
 #include <iostream>
+#include <limits>
 #include <algorithm>
 #include <vector>
-#include <array>
 
 #include <VulkanHelpers.h>
 #include <VulkanImage.h>
+#include <VulkanSync.h>
 
 using namespace VulkanRenderer;
 
-VulkanSwapChain::VulkanSwapChain(VulkanDevice* device, VkSurfaceKHR surface, GLFWwindow* window)
-	: device(device), surface(surface), window(window)
+VulkanSwapChain::VulkanSwapChain(VulkanDevice* device, VkSurfaceKHR surface, GLFWwindow* window, VkPresentModeKHR preferredPresentMode)
+	: preferredPresentMode(preferredPresentMode), device(device), surface(surface), window(window)
 {
+	int width, height;
+	glfwGetFramebufferSize(window, &width, &height);
+	framebufferExtent = {static_cast<uint32_t>(width), static_cast<uint32_t>(height)};
+
 	CreateSwapChain();
-	CreateDepthResources();
 }
 
 VulkanSwapChain::~VulkanSwapChain()
@@ -37,6 +41,16 @@ uint32_t VulkanSwapChain::GetMinImageCount() const
 	return minImageCount;
 }
 
+VkImage VulkanSwapChain::GetImage(uint32_t index) const
+{
+	return images[index]->Get();
+}
+
+VkImageView VulkanSwapChain::GetImageView(uint32_t index) const
+{
+	return images[index]->GetImageView();
+}
+
 void VulkanSwapChain::CreateSwapChain()
 {
 	VkDevice logicalDevice = device->GetLogical();
@@ -45,9 +59,15 @@ void VulkanSwapChain::CreateSwapChain()
 	SwapChainSupportDetails supportDetails = QuerySwapChainSupport(physicalDevice, surface);
 	
 	surfaceFormat = ChooseSwapSurfaceFormat(supportDetails.formats);
+	supportedPresentModes = supportDetails.presentModes;
 	presentMode = ChooseSwapPresentMode(supportDetails.presentModes);
 	
-	extent = ChooseSwapExtent(supportDetails.capabilities);
+	// A minimized window has nothing to present to, the current chain is kept until it has an area again
+	VkExtent2D newExtent = ChooseSwapExtent(supportDetails.capabilities);
+	if (newExtent.width == 0 || newExtent.height == 0)
+		return;
+
+	extent = newExtent;
 	
 	minImageCount = supportDetails.capabilities.minImageCount;
 	imageCount = minImageCount + 1;
@@ -85,13 +105,16 @@ void VulkanSwapChain::CreateSwapChain()
 	createInfo.presentMode = presentMode;
 	createInfo.clipped = VK_TRUE;
 
-	createInfo.oldSwapchain = VK_NULL_HANDLE;
+	// Handing over the current chain lets the driver reuse its resources and keeps queued presents valid
+	createInfo.oldSwapchain = swapChain;
 
-	if (vkCreateSwapchainKHR(logicalDevice, &createInfo, nullptr, &swapChain) != VK_SUCCESS)
+	VkSwapchainKHR newSwapChain = VK_NULL_HANDLE;
+	if (vkCreateSwapchainKHR(logicalDevice, &createInfo, nullptr, &newSwapChain) != VK_SUCCESS)
 	{
 		std::cerr << "Failed to create swap chain" << std::endl;
 		return;
 	}
+	swapChain = newSwapChain;
 
 	vkGetSwapchainImagesKHR(logicalDevice, swapChain, &imageCount, nullptr);
 	
@@ -107,54 +130,37 @@ void VulkanSwapChain::CreateSwapChain()
 	imageFormat = surfaceFormat.format;
 }
 
-void VulkanSwapChain::CleanupSwapChain()
+bool VulkanSwapChain::RecreateSwapChain(VulkanSync* sync)
 {
-	VkDevice logicalDevice = device->GetLogical();
+	VkSwapchainKHR oldSwapChain = swapChain;
+	std::vector<VulkanImage*> oldImages = images;
 
-	delete depthImage;
+	CreateSwapChain();
 
-	for (VkFramebuffer framebuffer : framebuffers)
-		vkDestroyFramebuffer(logicalDevice, framebuffer, nullptr);
+	if (swapChain == oldSwapChain)
+		return false;
 
-	for (VulkanImage* image : images)
-		delete image;
+	// The last frame rendered into the old chain may still be presenting, so it is released one frame later
+	VkDevice logicalDevice = device->GetLogical();
+	sync->Retire(sync->GetSubmittedFrameValue() + 1, [logicalDevice, oldSwapChain, oldImages]()
+	{
+		for (VulkanImage* image : oldImages)
+			delete image;
 
-	vkDestroySwapchainKHR(logicalDevice, swapChain, nullptr);
-}
+		vkDestroySwapchainKHR(logicalDevice, oldSwapChain, nullptr);
+	});
 
-void VulkanSwapChain::CreateDepthResources()
-{
-	VkFormat depthFormat = FindDepthFormat(device->GetPhysical());
-	depthImage = new VulkanImage(device, extent.width, extent.height, depthFormat, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, VK_IMAGE_ASPECT_DEPTH_BIT);
-	depthImage->TransitionImageLayout(VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL);
+	return true;
 }
 
-void VulkanSwapChain::CreateFramebuffers(VkRenderPass renderPass)
+void VulkanSwapChain::CleanupSwapChain()
 {
-	framebuffers.resize(images.size());
+	VkDevice logicalDevice = device->GetLogical();
 
-	for (size_t i = 0; i < images.size(); i++)
-	{
-		std::array<VkImageView, 2> attachments =
-		{
-			images[i]->GetImageView(),
-			depthImage->GetImageView()
-		};
-
-		VkFramebufferCreateInfo framebufferInfo{};
-		framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
-		framebufferInfo.renderPass = renderPass;
-		framebufferInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
-		framebufferInfo.pAttachments = attachments.data();
-		framebufferInfo.width = extent.width;
-		framebufferInfo.height = extent.height;
-		framebufferInfo.layers = 1;
-
-		if (vkCreateFramebuffer(device->GetLogical(), &framebufferInfo, nullptr, &framebuffers[i]) != VK_SUCCESS)
-		{
-			std::cerr << "Failed to create framebuffers" << std::endl;
-		}
-	}
+	for (VulkanImage* image : images)
+		delete image;
+
+	vkDestroySwapchainKHR(logicalDevice, swapChain, nullptr);
 }
 
 VkSurfaceFormatKHR VulkanSwapChain::ChooseSwapSurfaceFormat(const std::vector<VkSurfaceFormatKHR>& availableFormats)
@@ -171,9 +177,10 @@ VkSurfaceFormatKHR VulkanSwapChain::ChooseSwapSurfaceFormat(const std::vector<Vk
 
 VkPresentModeKHR VulkanSwapChain::ChooseSwapPresentMode(const std::vector<VkPresentModeKHR>& availablePresentModes)
 {
+	// FIFO is the only mode every surface has to support
 	for (const auto& availablePresentMode : availablePresentModes)
 	{
-		if (availablePresentMode == VK_PRESENT_MODE_MAILBOX_KHR)
+		if (availablePresentMode == preferredPresentMode)
 		{
 			return availablePresentMode;
 		}
@@ -186,10 +193,7 @@ VkExtent2D VulkanSwapChain::ChooseSwapExtent(const VkSurfaceCapabilitiesKHR& cap
 	if (capabilities.currentExtent.width != std::numeric_limits<uint32_t>::max())
 		return capabilities.currentExtent;
 
-	int width, height;
-	glfwGetFramebufferSize(window, &width, &height);
-
-	VkExtent2D actualExtent = {static_cast<uint32_t>(width), static_cast<uint32_t>(height)};
+	VkExtent2D actualExtent = framebufferExtent;
 
 	actualExtent.width = std::clamp(actualExtent.width, capabilities.minImageExtent.width, capabilities.maxImageExtent.width);
 	actualExtent.height = std::clamp(actualExtent.height, capabilities.minImageExtent.height, capabilities.maxImageExtent.height);
@@ -1,15 +1,21 @@
 #include <VulkanSync.h>
 
 #include <iostream>
+#include <algorithm>
 
 #include <VulkanConfig.h>
 
 using namespace VulkanRenderer;
 
-VulkanSync::VulkanSync(VkDevice logicalDevice)
-	: logicalDevice(logicalDevice)
+void FrameTimings::Smooth(double& value, double sampleMs)
 {
-	CreateSyncObjects();
+	value = value == 0.0 ? sampleMs : value * 0.9 + sampleMs * 0.1;
+}
+
+VulkanSync::VulkanSync(VkDevice logicalDevice, uint32_t swapChainImageCount)
+	: requestedFramesInFlight(VulkanConfig::MAX_FRAMES_IN_FLIGHT), logicalDevice(logicalDevice)
+{
+	CreateSyncObjects(swapChainImageCount);
 }
 
 VulkanSync::~VulkanSync()
@@ -17,28 +23,77 @@ VulkanSync::~VulkanSync()
 	CleanupSyncObjects();
 }
 
-void VulkanSync::CreateSyncObjects()
+VkSemaphore VulkanSync::CreateTimelineSemaphore()
+{
+	VkSemaphoreTypeCreateInfo typeInfo{};
+	typeInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+	typeInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+	typeInfo.initialValue = 0;
+
+	VkSemaphoreCreateInfo semaphoreInfo{};
+	semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+	semaphoreInfo.pNext = &typeInfo;
+
+	VkSemaphore semaphore = VK_NULL_HANDLE;
+	if (vkCreateSemaphore(logicalDevice, &semaphoreInfo, nullptr, &semaphore) != VK_SUCCESS)
+	{
+		std::cerr << "Failed to create timeline semaphore" << std::endl;
+	}
+	return semaphore;
+}
+
+void VulkanSync::CreateSyncObjects(uint32_t swapChainImageCount)
+{
+	frameTimeline = CreateTimelineSemaphore();
+	frameValue = 0;
+
+	frameSlotValues.assign(VulkanConfig::MAX_FRAMES_IN_FLIGHT, 0);
+	pendingWaits.clear();
+
+	RecreateSwapChainSemaphores(swapChainImageCount);
+}
+
+void VulkanSync::RecreateSwapChainSemaphores(uint32_t swapChainImageCount)
 {
-	imageAvailableSemaphores.resize(VulkanConfig::MAX_FRAMES_IN_FLIGHT);
-	renderFinishedSemaphores.resize(VulkanConfig::MAX_FRAMES_IN_FLIGHT);
-	inFlightFences.resize(VulkanConfig::MAX_FRAMES_IN_FLIGHT);
+	// Present semaphores of the old swap chain are released one frame after the last present that waited on them
+	if (!renderFinishedSemaphores.empty())
+	{
+		VkDevice device = logicalDevice;
+		Retire(frameValue + 1, [device, semaphores = renderFinishedSemaphores]()
+		{
+			for (VkSemaphore semaphore : semaphores)
+				vkDestroySemaphore(device, semaphore, nullptr);
+		});
+	}
+
+	// Acquire semaphores are indexed by frame slot, present semaphores by swap chain image so a
+	// semaphore is never re-signalled while the presentation engine may still be waiting on it.
+	// The engine submits every frame whose acquire succeeded, suboptimal ones included, and that submit
+	// waits on the acquire semaphore. So acquire semaphores are unsignalled here and are kept as they are.
+	renderFinishedSemaphores.assign(swapChainImageCount, VK_NULL_HANDLE);
 
 	VkSemaphoreCreateInfo semaphoreInfo{};
 	semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
 
-	VkFenceCreateInfo fenceInfo{};
-	fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
-	fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
+	if (imageAvailableSemaphores.size() != static_cast<size_t>(VulkanConfig::MAX_FRAMES_IN_FLIGHT))
+	{
+		imageAvailableSemaphores.assign(VulkanConfig::MAX_FRAMES_IN_FLIGHT, VK_NULL_HANDLE);
+
+		for (VkSemaphore& semaphore : imageAvailableSemaphores)
+		{
+			if (vkCreateSemaphore(logicalDevice, &semaphoreInfo, nullptr, &semaphore) != VK_SUCCESS)
+			{
+				std::cerr << "Failed to create semaphores" << std::endl;
+				return;
+			}
+		}
+	}
 
-	for (size_t i = 0; i < VulkanConfig::MAX_FRAMES_IN_FLIGHT; i++)
+	for (VkSemaphore& semaphore : renderFinishedSemaphores)
 	{
-		if (
-			vkCreateSemaphore(logicalDevice, &semaphoreInfo, nullptr, &imageAvailableSemaphores[i]) != VK_SUCCESS ||
-			vkCreateSemaphore(logicalDevice, &semaphoreInfo, nullptr, &renderFinishedSemaphores[i]) != VK_SUCCESS ||
-			vkCreateFence(logicalDevice, &fenceInfo, nullptr, &inFlightFences[i]) != VK_SUCCESS
-			)
+		if (vkCreateSemaphore(logicalDevice, &semaphoreInfo, nullptr, &semaphore) != VK_SUCCESS)
 		{
-			std::cerr << "Failed to create semaphores and fence" << std::endl;
+			std::cerr << "Failed to create semaphores" << std::endl;
 			return;
 		}
 	}
@@ -46,14 +101,191 @@ void VulkanSync::CreateSyncObjects()
 
 void VulkanSync::CleanupSyncObjects()
 {
-	for (size_t i = 0; i < VulkanConfig::MAX_FRAMES_IN_FLIGHT; i++)
+	// Callers wait for the device to go idle first, so everything retired can go
+	for (RetiredResource& retired : retiredResources)
+		retired.destroy();
+	retiredResources.clear();
+
+	for (VkSemaphore semaphore : imageAvailableSemaphores)
+		vkDestroySemaphore(logicalDevice, semaphore, nullptr);
+	for (VkSemaphore semaphore : renderFinishedSemaphores)
+		vkDestroySemaphore(logicalDevice, semaphore, nullptr);
+
+	vkDestroySemaphore(logicalDevice, frameTimeline, nullptr);
+
+	imageAvailableSemaphores.clear();
+	renderFinishedSemaphores.clear();
+	frameSlotValues.clear();
+	pendingWaits.clear();
+
+	frameTimeline = VK_NULL_HANDLE;
+}
+
+void VulkanSync::WaitForFrameSlot(uint32_t frameIndex)
+{
+	uint64_t value = frameSlotValues[frameIndex];
+	if (value == 0)
+		return;
+
+	auto start = std::chrono::steady_clock::now();
+
+	VkSemaphoreWaitInfo waitInfo{};
+	waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+	waitInfo.semaphoreCount = 1;
+	waitInfo.pSemaphores = &frameTimeline;
+	waitInfo.pValues = &value;
+
+	vkWaitSemaphores(logicalDevice, &waitInfo, UINT64_MAX);
+
+	std::chrono::duration<double, std::milli> waited = std::chrono::steady_clock::now() - start;
+	FrameTimings::Smooth(timings.frameWaitMs, waited.count());
+}
+
+void VulkanSync::WaitForAllFrames()
+{
+	if (frameValue == 0)
+		return;
+
+	VkSemaphoreWaitInfo waitInfo{};
+	waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+	waitInfo.semaphoreCount = 1;
+	waitInfo.pSemaphores = &frameTimeline;
+	waitInfo.pValues = &frameValue;
+
+	vkWaitSemaphores(logicalDevice, &waitInfo, UINT64_MAX);
+}
+
+uint64_t VulkanSync::GetSubmittedFrameValue() const
+{
+	return frameValue;
+}
+
+void VulkanSync::Retire(uint64_t value, std::function<void()> destroy)
+{
+	retiredResources.push_back({value, std::move(destroy)});
+}
+
+void VulkanSync::ReleaseRetired()
+{
+	if (retiredResources.empty())
+		return;
+
+	uint64_t completedValue = 0;
+	vkGetSemaphoreCounterValue(logicalDevice, frameTimeline, &completedValue);
+
+	for (auto it = retiredResources.begin(); it != retiredResources.end();)
 	{
-		vkDestroySemaphore(logicalDevice, renderFinishedSemaphores[i], nullptr);
-		vkDestroySemaphore(logicalDevice, imageAvailableSemaphores[i], nullptr);
-		vkDestroyFence(logicalDevice, inFlightFences[i], nullptr);
+		if (it->frameValue <= completedValue)
+		{
+			it->destroy();
+			it = retiredResources.erase(it);
+		}
+		else
+		{
+			++it;
+		}
 	}
+}
 
-	renderFinishedSemaphores.clear();
-	imageAvailableSemaphores.clear();
-	inFlightFences.clear();
+void VulkanSync::AddTimelineWait(VkSemaphore timeline, uint64_t value, VkPipelineStageFlags stageMask)
+{
+	for (TimelineWait& wait : pendingWaits)
+	{
+		if (wait.semaphore == timeline)
+		{
+			wait.value = std::max(wait.value, value);
+			wait.stageMask |= stageMask;
+			return;
+		}
+	}
+
+	pendingWaits.push_back({ timeline, value, stageMask });
+}
+
+VkResult VulkanSync::SubmitFrame(VkQueue queue, VkCommandBuffer commandBuffer, uint32_t frameIndex, VkSemaphore waitSemaphore, VkSemaphore signalSemaphore)
+{
+	// Binary semaphores ignore their value entry, it only keeps the arrays parallel
+	std::vector<VkSemaphore> waitSemaphores;
+	std::vector<uint64_t> waitValues;
+	std::vector<VkPipelineStageFlags> waitStages;
+
+	if (waitSemaphore != VK_NULL_HANDLE)
+	{
+		waitSemaphores.push_back(waitSemaphore);
+		waitValues.push_back(0);
+		waitStages.push_back(VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT);
+	}
+
+	for (const TimelineWait& wait : pendingWaits)
+	{
+		waitSemaphores.push_back(wait.semaphore);
+		waitValues.push_back(wait.value);
+		waitStages.push_back(wait.stageMask);
+	}
+
+	uint64_t signalValue = frameValue + 1;
+
+	std::vector<VkSemaphore> signalSemaphores = { frameTimeline };
+	std::vector<uint64_t> signalValues = { signalValue };
+
+	if (signalSemaphore != VK_NULL_HANDLE)
+	{
+		signalSemaphores.push_back(signalSemaphore);
+		signalValues.push_back(0);
+	}
+
+	VkTimelineSemaphoreSubmitInfo timelineInfo{};
+	timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+	timelineInfo.waitSemaphoreValueCount = static_cast<uint32_t>(waitValues.size());
+	timelineInfo.pWaitSemaphoreValues = waitValues.data();
+	timelineInfo.signalSemaphoreValueCount = static_cast<uint32_t>(signalValues.size());
+	timelineInfo.pSignalSemaphoreValues = signalValues.data();
+
+	VkSubmitInfo submitInfo{};
+	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	submitInfo.pNext = &timelineInfo;
+	submitInfo.waitSemaphoreCount = static_cast<uint32_t>(waitSemaphores.size());
+	submitInfo.pWaitSemaphores = waitSemaphores.data();
+	submitInfo.pWaitDstStageMask = waitStages.data();
+	submitInfo.commandBufferCount = 1;
+	submitInfo.pCommandBuffers = &commandBuffer;
+	submitInfo.signalSemaphoreCount = static_cast<uint32_t>(signalSemaphores.size());
+	submitInfo.pSignalSemaphores = signalSemaphores.data();
+
+	auto start = std::chrono::steady_clock::now();
+	VkResult result = vkQueueSubmit(queue, 1, &submitInfo, VK_NULL_HANDLE);
+	std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+	FrameTimings::Smooth(timings.submitMs, elapsed.count());
+
+	if (result == VK_SUCCESS)
+	{
+		frameValue = signalValue;
+		frameSlotValues[frameIndex] = signalValue;
+		pendingWaits.clear();
+	}
+	return result;
+}
+
+void VulkanSync::MarkPresented()
+{
+	auto now = std::chrono::steady_clock::now();
+
+	if (lastPresentTime.time_since_epoch().count() != 0)
+	{
+		std::chrono::duration<double, std::milli> interval = now - lastPresentTime;
+		FrameTimings::Smooth(timings.frameIntervalMs, interval.count());
+	}
+	lastPresentTime = now;
+}
+
+void VulkanSync::PublishTimings()
+{
+	std::lock_guard<std::mutex> lock(publishedTimingsMutex);
+	publishedTimings = timings;
+}
+
+FrameTimings VulkanSync::GetPublishedTimings() const
+{
+	std::lock_guard<std::mutex> lock(publishedTimingsMutex);
+	return publishedTimings;
 }
\ No newline at end of file
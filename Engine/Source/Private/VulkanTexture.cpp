@@ -1,24 +1,33 @@
 #include <VulkanTexture.h>
 
 #include <iostream>
+#include <algorithm>
 
 #include <VulkanDevice.h>
 #include <VulkanImage.h>
-#include <VulkanBuffer.h>
-
-#include <stb_image.h>
+#include <FileSystem.h>
+#include <VulkanStagingRing.h>
+#include <StbImageLoader.h>
+#include <MipChain.h>
+#include <TextureStreamer.h>
 
 using namespace VulkanRenderer;
 
-VulkanTexture::VulkanTexture(VulkanDevice* device, const std::string& path)
-	: device(device)
+VulkanTexture::VulkanTexture(VulkanDevice* device, const std::string& path, TextureStreamer* streamer)
+	: device(device), streamer(streamer), path(path)
 {
-	CreateTextureImage(path);
+	CreateTextureImage();
 	CreateTextureSampler();
+
+	if (streamer && image)
+		streamer->Register(this);
 }
 
 VulkanTexture::~VulkanTexture()
 {
+	if (streamer && image)
+		streamer->Unregister(this);
+
 	vkDestroySampler(device->GetLogical(), sampler, nullptr);
 	delete image;
 }
@@ -33,34 +42,77 @@ VkSampler VulkanTexture::GetSampler() const
 	return sampler;
 }
 
-void VulkanTexture::CreateTextureImage(const std::string& path)
+uint64_t VulkanTexture::GetVersion() const
 {
-	stbi_set_flip_vertically_on_load(true);
+	return version;
+}
+
+void VulkanTexture::CreateTextureImage()
+{
+	FileData file;
+	if (!FileSystem::ReadFile(path, file))
+		return;
+
+	if (!GetImageSize(file.GetData(), file.GetSize(), width, height))
+	{
+		std::cerr << "Failed to load texture image" << std::endl;
+		return;
+	}
+
+	mipLevels = GetMipLevelCount(width, height);
+	residentMip = streamer ? TextureStreamer::GetTailMip(width, height) : 0;
+
+	size_t pixelsSize = GetMipLevelSize(width, height, 0);
+	size_t chainSize = GetMipChainSize(width, height, residentMip);
 
-	int width, height, channels;
-	stbi_uc* pixels = stbi_load(path.c_str(), &width, &height, &channels, STBI_rgb_alpha);
-	VkDeviceSize imageSize = width * height * 4;
+	device->ReleaseCompletedUploads();
 
-	if (!pixels)
+	VulkanStagingRing* stagingRing = device->GetStagingRing();
+	StagingAllocation staging = stagingRing->Allocate(std::max(chainSize, pixelsSize + DecodeImageSlack));
+
+	// Decoded straight into mapped staging memory, the levels kept are then filtered in place over the pixels
+	if (!DecodeImage(file.GetData(), file.GetSize(), staging.data, static_cast<size_t>(staging.size)))
 	{
 		std::cerr << "Failed to load texture image" << std::endl;
+		stagingRing->Release(staging);
 		return;
 	}
 
-	VulkanBuffer stagingBuffer(device, imageSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+	BuildMipChain(staging.data, width, height, residentMip, staging.data);
+
+	image = CreateMipImage(residentMip);
+
+	// Transitions and every level's copy go into one submit
+	VkCommandBuffer commandBuffer = device->BeginSingleTimeCommands();
+	RecordMipUploads(commandBuffer, image, staging.buffer, staging.offset, residentMip);
+	uint64_t uploadValue = device->EndSingleTimeCommands(commandBuffer);
+
+	// Frames wait for the upload before sampling, the staging memory goes back once it completes
+	device->RetireUpload(uploadValue, [stagingRing, staging]()
+	{
+		stagingRing->Release(staging);
+	});
+}
+
+VulkanImage* VulkanTexture::CreateMipImage(uint32_t firstMip) const
+{
+	// Transfer source so the streamer can copy the coarser levels into a smaller image when evicting
+	VkImageUsageFlags usageFlags = VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
 
-	void* data;
-	vkMapMemory(device->GetLogical(), stagingBuffer.GetMemory(), 0, imageSize, 0, &data);
-	memcpy(data, pixels, static_cast<size_t>(imageSize));
-	vkUnmapMemory(device->GetLogical(), stagingBuffer.GetMemory());
+	return new VulkanImage(device, GetMipExtent(width, firstMip), GetMipExtent(height, firstMip), VK_FORMAT_R8G8B8A8_SRGB, usageFlags, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, VK_IMAGE_ASPECT_COLOR_BIT, mipLevels - firstMip);
+}
 
-	stbi_image_free(pixels);
+void VulkanTexture::RecordMipUploads(VkCommandBuffer commandBuffer, VulkanImage* target, VkBuffer buffer, VkDeviceSize offset, uint32_t firstMip) const
+{
+	target->RecordLayoutTransition(commandBuffer, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
 
-	image = new VulkanImage(device, width, height, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, VK_IMAGE_ASPECT_COLOR_BIT);
-	
-	image->TransitionImageLayout(VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
-	CopyBufferToImage(device, stagingBuffer.Get(), image->Get(), static_cast<uint32_t>(width), static_cast<uint32_t>(height));
-	image->TransitionImageLayout(VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+	for (uint32_t level = firstMip; level < mipLevels; level++)
+	{
+		RecordCopyBufferToImage(commandBuffer, buffer, target->Get(), GetMipExtent(width, level), GetMipExtent(height, level), offset, level - firstMip);
+		offset += GetMipLevelSize(width, height, level);
+	}
+
+	target->RecordLayoutTransition(commandBuffer, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
 }
 
 void VulkanTexture::CreateTextureSampler()
@@ -75,8 +127,8 @@ void VulkanTexture::CreateTextureSampler()
 	samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_REPEAT;
 	samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_REPEAT;
 	samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_REPEAT;
-	samplerInfo.anisotropyEnable = VK_TRUE;
-	samplerInfo.maxAnisotropy = deviceProperties.limits.maxSamplerAnisotropy;
+	samplerInfo.anisotropyEnable = device->samplerAnisotropyEnabled ? VK_TRUE : VK_FALSE;
+	samplerInfo.maxAnisotropy = device->samplerAnisotropyEnabled ? deviceProperties.limits.maxSamplerAnisotropy : 1.0f;
 	samplerInfo.borderColor = VK_BORDER_COLOR_INT_OPAQUE_BLACK;
 	samplerInfo.unnormalizedCoordinates = VK_FALSE;
 	samplerInfo.compareEnable = VK_FALSE;
@@ -84,7 +136,9 @@ void VulkanTexture::CreateTextureSampler()
 	samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
 	samplerInfo.mipLodBias = 0.0f;
 	samplerInfo.minLod = 0.0f;
-	samplerInfo.maxLod = 0.0f;
+
+	// Level 0 is the finest resident level, so a streamed texture samples its best level without a new sampler
+	samplerInfo.maxLod = VK_LOD_CLAMP_NONE;
 
 	if (vkCreateSampler(device->GetLogical(), &samplerInfo, nullptr, &sampler) != VK_SUCCESS)
 	{
@@ -0,0 +1,131 @@
+#include <VulkanUpload.h>
+
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <chrono>
+#include <cstring>
+#include <iterator>
+
+#include <VulkanDevice.h>
+#include <VulkanBuffer.h>
+#include <VulkanStagingRing.h>
+
+namespace VulkanRenderer
+{
+	namespace
+	{
+		VulkanBuffer* CreateDirectBuffer(VulkanDevice* device, const void* data, VkDeviceSize size, VkBufferUsageFlags usageFlags)
+		{
+			VulkanBuffer* buffer = new VulkanBuffer(device, size, usageFlags, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+
+			void* mapped;
+			if (vkMapMemory(device->GetLogical(), buffer->GetMemory(), 0, size, 0, &mapped) != VK_SUCCESS)
+			{
+				std::cerr << "Failed to map device local buffer" << std::endl;
+				return buffer;
+			}
+
+			// Write combined on discrete GPUs, one sequential copy and never a read back
+			memcpy(mapped, data, (size_t)size);
+			vkUnmapMemory(device->GetLogical(), buffer->GetMemory());
+
+			return buffer;
+		}
+
+		VulkanBuffer* CreateStagedBuffer(VulkanDevice* device, const void* data, VkDeviceSize size, VkBufferUsageFlags usageFlags)
+		{
+			VulkanBuffer* buffer = new VulkanBuffer(device, size, usageFlags, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+			// Slots of uploads that have since completed go back first, so a burst of loads keeps reusing the ring
+			device->ReleaseCompletedUploads();
+
+			VulkanStagingRing* stagingRing = device->GetStagingRing();
+			StagingAllocation staging = stagingRing->Allocate(size);
+			memcpy(staging.data, data, (size_t)size);
+
+			// The copy is not waited on, the slot goes back once the upload timeline passes it
+			uint64_t uploadValue = CopyBuffer(device, staging.buffer, buffer->Get(), size, staging.offset);
+			device->RetireUpload(uploadValue, [stagingRing, staging]()
+			{
+				stagingRing->Release(staging);
+			});
+
+			return buffer;
+		}
+
+		// Milliseconds per upload, the buffer is created and destroyed every iteration like a streamed mesh would be
+		double TimeUploads(VulkanDevice* device, const void* data, VkDeviceSize size, UploadPath path, uint32_t iterations)
+		{
+			auto start = std::chrono::steady_clock::now();
+
+			for (uint32_t i = 0; i < iterations; i++)
+			{
+				VulkanBuffer* buffer = CreateDeviceLocalBuffer(device, data, size, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, path);
+
+				// Uploads do not block, so the copy is waited on before the buffer goes
+				device->WaitForUploads();
+				delete buffer;
+			}
+
+			std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+			return elapsed.count() / iterations;
+		}
+	}
+
+	VulkanBuffer* CreateDeviceLocalBuffer(VulkanDevice* device, const void* data, VkDeviceSize size, VkBufferUsageFlags usageFlags, UploadPath path)
+	{
+		usageFlags |= VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+
+		if (!data)
+			return new VulkanBuffer(device, size, usageFlags, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+		if (path == UploadPath::Automatic)
+			path = device->directUploads ? UploadPath::Direct : UploadPath::Staged;
+
+		if (path == UploadPath::Direct)
+			return CreateDirectBuffer(device, data, size, usageFlags);
+
+		return CreateStagedBuffer(device, data, size, usageFlags);
+	}
+
+	void RunUploadBenchmark(VulkanDevice* device)
+	{
+		// Up to half the staging ring, larger uploads would measure dedicated staging buffers instead
+		const VkDeviceSize sizes[] = { 64ull * 1024, 1024ull * 1024, 8ull * 1024 * 1024, 32ull * 1024 * 1024 };
+		const uint32_t iterations = 16;
+
+		std::vector<uint8_t> data(sizes[std::size(sizes) - 1]);
+		for (size_t i = 0; i < data.size(); i++)
+			data[i] = static_cast<uint8_t>(i * 2654435761u >> 24);
+
+		bool directSupported = device->hostVisibleDeviceLocalHeapSize > 0;
+
+		std::cout << "Upload benchmark: " << (device->unifiedMemory ? "unified memory" : device->resizableBarEnabled ? "resizable BAR" : directSupported ? "256 MiB BAR" : "no host visible device memory")
+			<< ", " << (device->hostVisibleDeviceLocalHeapSize >> 20) << " MiB host visible device local, automatic path is "
+			<< (device->directUploads ? "direct" : "staged") << std::endl;
+
+		std::cout << std::fixed << std::setprecision(3);
+
+		for (VkDeviceSize size : sizes)
+		{
+			// Warms up memory type selection and the staging ring before anything is timed
+			TimeUploads(device, data.data(), size, UploadPath::Staged, 1);
+			double stagedMs = TimeUploads(device, data.data(), size, UploadPath::Staged, iterations);
+
+			std::cout << "  " << std::setw(6) << (size >> 10) << " KiB: staged " << stagedMs << " ms (" << size / (stagedMs * 1.0e6) << " GB/s)";
+
+			if (directSupported)
+			{
+				TimeUploads(device, data.data(), size, UploadPath::Direct, 1);
+				double directMs = TimeUploads(device, data.data(), size, UploadPath::Direct, iterations);
+
+				std::cout << ", direct " << directMs << " ms (" << size / (directMs * 1.0e6) << " GB/s), " << stagedMs / directMs << "x";
+			}
+
+			std::cout << std::endl;
+		}
+
+		std::cout << std::defaultfloat;
+	}
+}
\ No newline at end of file
@@ -9,10 +9,12 @@
 
 #include <VulkanUniformBuffer.h>
 #include <Transform.h>
+#include <CameraUBO.h>
 
 namespace VulkanRenderer
 {
 	class VulkanDevice;
+	class VulkanDescriptorAllocator;
 
 	class Camera
 	{
@@ -20,9 +22,17 @@ namespace VulkanRenderer
 		Camera(VulkanDevice* device, VkDescriptorSetLayout descriptorSetLayout);
 		~Camera();
 
-		void CreateDescriptorSets(VkDescriptorPool descriptorPool);
+		void CreateDescriptorSets(VulkanDescriptorAllocator* descriptorAllocator);
 
-		void UpdateUniformBuffer(uint32_t currentImage, VkExtent2D swapChainExtent);
+		// Rebuilds per-frame uniform buffers and descriptor sets after the frames in flight count changed
+		void RecreateFrameResources(VulkanDescriptorAllocator* descriptorAllocator);
+
+		// Built from the transform on the main thread, written into the frame's buffer on the render thread
+		CameraUBO BuildUniformData(VkExtent2D swapChainExtent) const;
+		void WriteUniformBuffer(uint32_t currentImage, const CameraUBO& ubo);
+
+		// Height in pixels of something one unit tall at distance one, converts view space sizes to screen space
+		float GetPixelsPerUnit(VkExtent2D swapChainExtent) const;
 
 		std::vector<VkDescriptorSet> descriptorSets;
 
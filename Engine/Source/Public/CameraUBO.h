@@ -8,5 +8,11 @@ namespace VulkanRenderer
 	{
 		alignas(16) glm::mat4 view;
 		alignas(16) glm::mat4 proj;
+
+		// Cluster culling only, see Culling.glsl
+		alignas(16) glm::vec4 position;				// World space, w unused
+		alignas(16) glm::vec4 frustumPlanes[6];		// World space, a point is inside when dot(xyz, point) + w >= 0 for all
+		alignas(16) glm::mat4 occlusionViewProj;	// The depth pyramid was built with it, filled in on the render thread
+		alignas(16) glm::uvec4 cullFlags;			// x: 1 when the depth pyramid can be tested against
 	};
 }
\ No newline at end of file
@@ -0,0 +1,16 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+namespace VulkanRenderer
+{
+	// A byte-oriented LZ77 codec in the style of LZ4: runs of literals alternate with matches of at least four bytes
+	// up to 64 KiB back. It compresses far less than deflate but decompresses at memory speed, which is what asset
+	// loading needs. Compressed data does not record its decompressed size, the caller stores it.
+	std::vector<uint8_t> LzCompress(const uint8_t* data, size_t size);
+
+	// Fails on malformed input instead of reading or writing out of bounds, and unless exactly dstSize bytes come out
+	bool LzDecompress(const uint8_t* src, size_t srcSize, uint8_t* dst, size_t dstSize);
+}
\ No newline at end of file
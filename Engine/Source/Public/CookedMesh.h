@@ -0,0 +1,161 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <cstdint>
+
+#include <volk.h>
+
+#include <Mesh.h>
+#include <FileSystem.h>
+#include <DerivedDataCache.h>
+
+namespace VulkanRenderer
+{
+	// "VRMF" read as a little-endian uint32
+	constexpr uint32_t CookedMeshMagic = 0x464D5256;
+
+	// Bumped whenever the file layout or any stream in it changes, files of other versions have to be cooked again
+	constexpr uint32_t CookedMeshVersion = 1;
+
+	// Bumped whenever CookMesh gives different output for the same MeshInfo, e.g. a simplifier change, so cached
+	// cooks are redone
+	constexpr uint32_t CookMeshVersion = 1;
+
+	// Sections start on this boundary so their arrays can be read in place from a mapping
+	constexpr uint64_t CookedMeshAlignment = 64;
+
+	enum class CookedMeshSection : uint32_t
+	{
+		Vertices,			// PackedVertex
+		Positions,			// PositionVertex
+		Indices,			// 16 or 32-bit by the header's index type, every level of detail one after another
+		Lods,				// MeshLod
+		Ranges,				// MeshRange, static batches only
+		Meshlets,			// Meshlet
+		MeshletVertices,	// uint32_t
+		MeshletTriangles,	// uint32_t
+		Strings,			// Base color, roughness and metallic texture paths, each null terminated
+		Count
+	};
+
+	struct CookedMeshSectionRange
+	{
+		uint64_t offset;
+		uint64_t size;
+	};
+
+	// At the start of the file, little-endian. Each section is a plain array of its element type.
+	struct CookedMeshHeader
+	{
+		uint32_t magic;
+		uint32_t version;
+		uint32_t indexType;		// VkIndexType
+		uint32_t blendMode;
+
+		glm::vec3 boundsMin;
+		glm::vec3 boundsExtent;
+
+		float acmrBefore;
+		float acmrAfter;
+		uint64_t vertexCountBefore;
+		uint64_t vertexCountAfter;
+
+		CookedMeshSectionRange sections[static_cast<uint32_t>(CookedMeshSection::Count)];
+	};
+
+	static_assert(sizeof(CookedMeshHeader) == 208, "CookedMeshHeader is part of the file format");
+
+	// An array of cooked mesh data, in a CookedMeshData or straight in a mapped file
+	template<typename T>
+	struct CookedSpan
+	{
+		const T* data = nullptr;
+		size_t count = 0;
+
+		size_t GetSize() const
+		{
+			return count * sizeof(T);
+		}
+	};
+
+	// Every stream a mesh uploads, already in the layout the GPU reads
+	struct CookedMeshView
+	{
+		CookedSpan<PackedVertex> vertices;
+		CookedSpan<PositionVertex> positions;
+
+		// Raw 16 or 32-bit indices
+		CookedSpan<uint8_t> indices;
+		VkIndexType indexType = VK_INDEX_TYPE_UINT32;
+
+		CookedSpan<MeshLod> lods;
+		CookedSpan<MeshRange> ranges;
+
+		CookedSpan<Meshlet> meshlets;
+		CookedSpan<uint32_t> meshletVertices;
+		CookedSpan<uint32_t> meshletTriangles;
+
+		VertexBounds bounds;
+		MeshOptimizationStats optimizationStats;
+
+		BlendMode blendMode = BlendMode::Opaque;
+		std::string baseColorPath;
+		std::string roughnessPath;
+		std::string metallicPath;
+	};
+
+	// A mesh cooked in memory, owns the streams its view points at
+	struct CookedMeshData
+	{
+		std::vector<PackedVertex> vertices;
+		std::vector<PositionVertex> positions;
+		std::vector<uint8_t> indices;
+		VkIndexType indexType = VK_INDEX_TYPE_UINT32;
+		std::vector<MeshLod> lods;
+		std::vector<MeshRange> ranges;
+		MeshletData meshletData;
+
+		VertexBounds bounds;
+		MeshOptimizationStats optimizationStats;
+
+		BlendMode blendMode = BlendMode::Opaque;
+		std::string baseColorPath;
+		std::string roughnessPath;
+		std::string metallicPath;
+
+		CookedMeshView GetView() const;
+	};
+
+	// Everything done to a mesh before upload: optimization, meshlets, levels of detail, vertex quantization and
+	// index narrowing. Meshes built from a MeshInfo run it on every launch, the Cooker runs it once.
+	CookedMeshData CookMesh(const MeshInfo& info);
+
+	// The file WriteCookedMesh writes, in memory
+	std::vector<uint8_t> SerializeCookedMesh(const CookedMeshView& mesh);
+	bool WriteCookedMesh(const std::string& path, const CookedMeshView& mesh);
+
+	// Everything CookMesh reads, with both versions
+	DerivedDataKey GetCookedMeshKey(const MeshInfo& info);
+
+	// A cooked mesh file read through the file system, in place from a mapping unless its pak entry is compressed.
+	// Nothing is parsed beyond the header, the view points into the file's data and stays valid as long as it.
+	class CookedMeshFile
+	{
+	public:
+		// Checks the header and that every section is aligned and lies within the file
+		bool Open(const std::string& path);
+
+		// Reads the cook of the mesh from the cache, or cooks it in memory and stores it on a miss
+		bool Open(const MeshInfo& info, DerivedDataCache& cache);
+
+		const CookedMeshView& GetView() const;
+
+	private:
+		FileData file;
+		CookedMeshView view;
+
+		// Checks the header and sections of the file's data, the path is for errors only
+		bool Parse(const std::string& path);
+	};
+}
\ No newline at end of file
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include <volk.h>
+
+namespace VulkanRenderer
+{
+	class VulkanDevice;
+	class VulkanDescriptorAllocator;
+
+	// Hierarchical depth for occlusion culling: every texel holds the farthest depth of the area it covers, so a
+	// bound whose nearest depth is behind it is hidden. Built at the end of a frame and tested by the next one.
+	class DepthPyramid
+	{
+	public:
+		// Level 0 is the largest power of two that fits in the depth extent, so every level halves exactly
+		DepthPyramid(VulkanDevice* device, VkExtent2D depthExtent);
+		~DepthPyramid();
+
+		DepthPyramid(const DepthPyramid&) = delete;
+		DepthPyramid& operator=(const DepthPyramid&) = delete;
+
+		// Reduces the depth image into every level. The depth image must be in the shader read only layout and
+		// the pyramid in the general layout, the per level barriers are recorded here.
+		void Record(VkCommandBuffer commandBuffer, VkImageView depthView, const glm::mat4& viewProjection, VulkanDescriptorAllocator* frameDescriptorAllocator);
+
+		// Contents are undefined until the first Record, and again after Invalidate
+		bool IsValid() const;
+		void Invalidate();
+
+		// The view projection of the depth the pyramid was last built from
+		const glm::mat4& GetViewProjection() const;
+
+		VkImage GetImage() const;
+		VkImageView GetImageView() const;
+		VkSampler GetSampler() const;
+		VkExtent2D GetExtent() const;
+
+		static constexpr VkFormat format = VK_FORMAT_R32_SFLOAT;
+
+	private:
+		void CreateImage();
+		void CreateSampler();
+		void CreatePipeline();
+
+		VulkanDevice* device;
+
+		VkExtent2D extent{};
+		uint32_t mipLevels = 1;
+
+		VkImage image = VK_NULL_HANDLE;
+		VkDeviceMemory memory = VK_NULL_HANDLE;
+
+		// Every level for sampling, one view per level for storage writes and reading the previous level
+		VkImageView imageView = VK_NULL_HANDLE;
+		std::vector<VkImageView> mipViews;
+
+		VkSampler sampler = VK_NULL_HANDLE;
+
+		VkDescriptorSetLayout descriptorSetLayout = VK_NULL_HANDLE;
+		VkPipelineLayout pipelineLayout = VK_NULL_HANDLE;
+		VkPipeline pipeline = VK_NULL_HANDLE;
+
+		bool valid = false;
+		glm::mat4 viewProjection{1.0f};
+	};
+}
\ No newline at end of file
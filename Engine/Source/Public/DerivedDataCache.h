@@ -0,0 +1,105 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <cstdint>
+#include <type_traits>
+
+#include <FileSystem.h>
+
+namespace VulkanRenderer
+{
+	// A 128-bit hash of everything an output is derived from: the kind of processing and its version, the source
+	// bytes and the processing parameters. Any change to one of them gives a different key.
+	class DerivedDataKey
+	{
+	public:
+		// Bump the version whenever the processing produces different output for the same input
+		DerivedDataKey(const char* kind, uint32_t version);
+
+		DerivedDataKey& Add(const void* data, size_t size);
+
+		// Length prefixed, so consecutive strings cannot run into each other
+		DerivedDataKey& Add(const std::string& value);
+
+		template<typename T>
+		DerivedDataKey& Add(const std::vector<T>& values)
+		{
+			static_assert(std::is_trivially_copyable_v<T>, "Only plain data without padding can be hashed as bytes");
+			uint64_t count = values.size();
+			Add(&count, sizeof(count));
+			return Add(values.data(), values.size() * sizeof(T));
+		}
+
+		template<typename T>
+		DerivedDataKey& AddValue(const T& value)
+		{
+			static_assert(std::is_trivially_copyable_v<T>, "Only plain data without padding can be hashed as bytes");
+			return Add(&value, sizeof(value));
+		}
+
+		// 32 hex digits
+		std::string ToString() const;
+
+		bool operator==(const DerivedDataKey& other) const;
+
+	private:
+		friend class DerivedDataCache;
+
+		uint64_t hash[2];
+	};
+
+	struct DerivedDataCacheStats
+	{
+		uint64_t hits = 0;
+		uint64_t misses = 0;
+		uint64_t writes = 0;
+		uint64_t evictions = 0;
+
+		// Bytes on disk as of the last scan plus what was written since
+		uint64_t size = 0;
+	};
+
+	// Processed assets on local disk, addressed by their DerivedDataKey, so unchanged sources are never processed
+	// twice. Entries are written to a temporary file and renamed into place, readers see a whole entry or none,
+	// and each carries a trailer with its key and a checksum that is verified on every hit. Once the cache grows
+	// past its size the least recently used entries are evicted, hits refresh an entry's modification time.
+	// Safe to share between threads and processes.
+	class DerivedDataCache
+	{
+	public:
+		DerivedDataCache(const std::string& directory, uint64_t maxSize);
+
+		DerivedDataCache(const DerivedDataCache&) = delete;
+		DerivedDataCache& operator=(const DerivedDataCache&) = delete;
+
+		// Maps the entry, the data is exactly what was put
+		bool Get(const DerivedDataKey& key, FileData& data);
+		bool Put(const DerivedDataKey& key, const uint8_t* data, size_t size);
+
+		// Evicts least recently used entries until the cache is under its size again
+		void Trim();
+
+		DerivedDataCacheStats GetStats() const;
+
+		// One line of hits, misses, writes and evictions for logs
+		std::string GetReport() const;
+
+	private:
+		std::string GetEntryPath(const DerivedDataKey& key) const;
+
+		std::string directory;
+		uint64_t maxSize;
+
+		std::atomic<uint64_t> hits = 0;
+		std::atomic<uint64_t> misses = 0;
+		std::atomic<uint64_t> writes = 0;
+		std::atomic<uint64_t> evictions = 0;
+
+		// Guards cacheSize and keeps trims from running twice at once
+		mutable std::mutex sizeMutex;
+		uint64_t cacheSize = 0;
+	};
+}
\ No newline at end of file
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+
+#include <glm/glm.hpp>
+
+#include <MeshUBO.h>
+#include <CameraUBO.h>
+
+namespace VulkanRenderer
+{
+	class Mesh;
+
+	// Consecutive visible ranges of a static batch, drawn with one indexed draw
+	struct DrawRange
+	{
+		uint32_t firstIndex;
+		uint32_t indexCount;
+	};
+
+	struct DrawItem
+	{
+		uint64_t sortKey;
+		uint32_t meshIndex;
+
+		// Level of detail to draw, see Mesh::SelectLod
+		uint32_t lod;
+
+		// Static batches only: the draw list's ranges to draw instead of the whole level, see GetRanges
+		uint32_t firstRange = 0;
+		uint32_t rangeCount = 0;
+	};
+
+	// A frame's draws split into clustered, opaque and transparent buckets, each radix sorted by a 64-bit key.
+	// Opaque and clustered keys (high to low): pipeline | coarse view depth, front to back | material | mesh index.
+	// Transparent keys: view depth, back to front | mesh index.
+	// Depth prepass keys: view depth, front to back | mesh index.
+	class DrawList
+	{
+	public:
+		// Mesh indices refer to the given meshes, which are bucketed by blend mode and sorted by view depth.
+		// meshLods holds the level of detail selected for each mesh. Static batches are culled range by range
+		// against the camera's frustum and left out when no range is visible.
+		void Build(const std::vector<Mesh*>& meshes, const std::vector<MeshUBO>& meshUniforms, const std::vector<uint32_t>& meshLods, const CameraUBO& cameraUniforms, bool useDepthPrepass, bool useClusterCulling);
+
+		// Opaque and alpha-tested meshes with meshlets at full resolution, culled per cluster and keyed like opaque
+		// draws. Empty when cluster culling is off, these draws write their own depth and never take part in the prepass.
+		const std::vector<DrawItem>& GetClustered() const;
+
+		// Opaque and alpha-tested draws, grouped by pipeline
+		const std::vector<DrawItem>& GetOpaque() const;
+		const std::vector<DrawItem>& GetTransparent() const;
+
+		// Opaque draws that lay down depth before shading, empty when the prepass is off. Alpha-tested meshes
+		// are left out since their coverage depends on the texture.
+		const std::vector<DrawItem>& GetDepthPrepass() const;
+
+		// Visible runs of every static batch drawn this frame, shared by its shading and depth prepass draws
+		const std::vector<DrawRange>& GetRanges() const;
+
+	private:
+		std::vector<DrawItem> clustered;
+		std::vector<DrawItem> opaque;
+		std::vector<DrawItem> transparent;
+		std::vector<DrawItem> depthPrepass;
+		std::vector<DrawRange> ranges;
+
+		// Ping-pong buffer for the radix sort, kept to avoid reallocating every frame
+		std::vector<DrawItem> scratch;
+	};
+
+	// Stable LSD radix sort on 8-bit digits, digits that are equal across all items are skipped
+	void RadixSortDrawItems(std::vector<DrawItem>& items, std::vector<DrawItem>& scratch);
+}
\ No newline at end of file
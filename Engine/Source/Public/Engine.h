@@ -2,11 +2,16 @@
 
 #include <vector>
 #include <memory>
+#include <string>
+#include <functional>
+#include <atomic>
 
 #include <volk.h>
 
 #include <Camera.h>
 #include <Mesh.h>
+#include <RenderGraph.h>
+#include <Hlod.h>
 
 namespace VulkanRenderer
 {
@@ -16,29 +21,148 @@ namespace VulkanRenderer
 	class VulkanSwapChain;
 	class VulkanRenderPass;
 	class VulkanPipeline;
-	class VulkanDescriptorPool;
+	class VulkanDescriptorAllocator;
 	class VulkanSync;
 	class VulkanImGuiOverlay;
+	class VulkanOffscreenTarget;
+	class Profiler;
+	class FramePacer;
+	class DepthPyramid;
+	class DerivedDataCache;
+	class TextureStreamer;
+	class RenderThread;
+	struct FramePacket;
+
+	struct EngineSettings
+	{
+		// Render into offscreen images without GLFW, a surface or a swap chain
+		bool headless = false;
+
+		// Offscreen target size, the window size is used otherwise
+		uint32_t width = 1280;
+		uint32_t height = 720;
+
+		// Stop after this many frames, 0 runs until the window is closed (headless runs default to 1)
+		uint32_t frameCount = 0;
+
+		// Headless only: directory to write every frame to as frame_NNNN.png, empty to skip
+		std::string outputDirectory;
+
+		// Headless only: receives every frame as tightly packed RGBA8 pixels
+		std::function<void(uint32_t frameNumber, const std::vector<uint8_t>& pixels, uint32_t width, uint32_t height)> onFrameReadback;
+
+		// Writes the profiler history as Chrome trace JSON on exit, empty to skip
+		std::string traceOutputPath;
+
+		// Draw opaque depth first so opaque fragments are shaded once, pays off in high overdraw scenes
+		bool depthPrepass = false;
+
+		// Cull large meshes per meshlet with task and mesh shaders when supported, a compute pass otherwise
+		bool clusterCulling = true;
+
+		// Draw simplified levels of detail whose error stays below this many pixels, 0 keeps full resolution
+		float lodErrorThreshold = 1.0f;
+
+		// Groups whose nearest point is farther than this draw their merged HLOD proxy, 0 always draws the members
+		float hlodDistance = 50.0f;
+
+		// Static buffers are written straight into device memory when the device has unified memory or a resizable
+		// BAR, staged otherwise. False stages every upload.
+		bool directUploads = true;
+
+		// Times staged against direct buffer uploads after device creation and prints the results
+		bool uploadBenchmark = false;
+
+		// Textures load their mip tail and stream finer levels in by their size on screen, see TextureStreamer.h.
+		// False loads every level up front.
+		bool textureStreaming = true;
+
+		// Bytes of texture levels kept resident while streaming, tails included
+		uint64_t textureStreamingBudget = 512ull * 1024 * 1024;
+
+		// Pak archives mounted on startup, later ones take precedence over earlier ones and all over loose files
+		std::vector<std::string> pakPaths;
+
+		// Meshes added from a MeshInfo are cooked through a derived data cache here, so unchanged meshes are cooked
+		// once instead of on every launch. Empty cooks them every time.
+		std::string derivedDataCacheDirectory;
+
+		// The least recently used cache entries are evicted past this many bytes
+		uint64_t derivedDataCacheSize = 1024ull * 1024 * 1024;
+
+		// Cooked mesh files added to the scene on startup, see CookedMesh.h
+		std::vector<std::string> cookedMeshPaths;
+
+		// Merges the static demo meshes per material on startup, see StaticBatch.h
+		bool staticBatching = false;
+
+		// Builds HLOD proxies for the static demo meshes on startup and writes their atlases here, empty to skip
+		std::string hlodDirectory;
+
+		// Windowed only: used when the surface supports it, FIFO otherwise
+		VkPresentModeKHR presentMode = VK_PRESENT_MODE_MAILBOX_KHR;
+
+		// Windowed only: caps the frame rate, 0 renders as fast as the present mode allows
+		float fpsLimit = 0.0f;
+
+		// Windowed only: draw frames only when input arrives or the camera or a mesh moves, idle otherwise
+		bool renderOnDemand = false;
+	};
 
 	class Engine
 	{
 	public:
-		Engine();
+		Engine(const EngineSettings& settings = EngineSettings());
 		~Engine();
 
 		void Run();
 
-		bool framebufferResized = false;
+		// Creates a mesh and its descriptor sets, can be called at any time to stream meshes into the scene
+		Mesh* AddMesh(const MeshInfo& info);
+
+		// Adds a mesh written by the Cooker, null when the file cannot be loaded
+		Mesh* LoadMesh(const std::string& path);
+
+		// Creates the mesh of a proxy built by BuildHlodProxies, drawn instead of the members (its sources, in order)
+		// once the group is farther away than the HLOD distance
+		Mesh* AddHlod(const HlodProxy& proxy, const std::vector<Mesh*>& members);
+
+		// Changes the number of frames the CPU may record ahead of the GPU (1-4), resizing per-frame resources.
+		// Main thread only, the render thread is parked until the change is done.
+		void SetFramesInFlight(int count);
+
+		// Makes the next frames draw when rendering on demand, called for input and any external change
+		void RequestRedraw();
+
+		// Set by the window callbacks on the main thread, consumed by the render thread
+		std::atomic<bool> framebufferResized = false;
 
 	private:
 		std::unique_ptr<GlfwWindow> glfwWindow;
 		std::unique_ptr<VulkanInstance> instance;
 		std::unique_ptr<VulkanDevice> device;
 		std::unique_ptr<VulkanSwapChain> swapChain;
+		std::unique_ptr<VulkanOffscreenTarget> offscreenTarget;
 		std::unique_ptr<VulkanRenderPass> renderPass;
 		std::unique_ptr<VulkanPipeline> pipeline;
-		std::unique_ptr<VulkanDescriptorPool> descriptorPool;
+		std::unique_ptr<RenderGraph> renderGraph;
+		std::unique_ptr<VulkanDescriptorAllocator> descriptorAllocator;
+		std::vector<std::unique_ptr<VulkanDescriptorAllocator>> frameDescriptorAllocators;
 		std::unique_ptr<VulkanSync> sync;
+		std::unique_ptr<Profiler> profiler;
+		std::unique_ptr<FramePacer> framePacer;
+
+		// Null without a cache directory
+		std::unique_ptr<DerivedDataCache> derivedDataCache;
+
+		// Null without texture streaming, outlives the meshes whose textures register with it
+		std::unique_ptr<TextureStreamer> textureStreamer;
+
+		// Built from the scene depth at the end of every frame, the next frame's cluster culling tests against it
+		std::unique_ptr<DepthPyramid> depthPyramid;
+
+		// Windowed only, alive while Run is
+		std::unique_ptr<RenderThread> renderThread;
 
 		std::unique_ptr<VulkanImGuiOverlay> imGuiOverlay;
 		
@@ -46,9 +170,61 @@ namespace VulkanRenderer
 
 		std::vector<std::unique_ptr<Mesh>> meshes;
 
+		// Main thread, proxies and their members are all in meshes as well
+		std::vector<HlodGroup> hlodGroups;
+
+		// Render thread state from here on, the main thread only touches it while the render thread is idle
 		int currentFrame = 0;
+
+		uint32_t frameNumber = 0;
+
+		// Swap chain image or offscreen color image the scene is rendered into
+		RenderGraphResource backbuffer = 0;
+
+		// Packet being drawn, read by the render graph's pass callbacks
+		FramePacket* currentPacket = nullptr;
+
+		// The depth pyramid for cluster culling, allocated from the frame's descriptor allocator
+		VkDescriptorSet occlusionDescriptorSet = VK_NULL_HANDLE;
+
+		// State the last drawn frame was built from, compared to detect changes when rendering on demand
+		Transform lastCameraTransform;
+		float lastCameraFov = 0.0f;
+		std::vector<Transform> lastMeshTransforms;
+
+		EngineSettings settings;
 		
-		void DrawFrame();
+		// Main thread: snapshots the scene, uniforms and UI for one frame
+		void BuildFramePacket(FramePacket& packet, VkExtent2D framebufferExtent);
+
+		// Main thread: hides either each group's proxy or its members by the group's distance to the camera
+		void UpdateHlods();
+
+		// Render thread (windowed) or main thread (headless)
+		void DrawFrame(FramePacket& packet);
+		void DrawOffscreenFrame(FramePacket& packet);
+		void ReadbackFrame();
+
+		// Points the packet's camera uniforms and the occlusion set at the current depth pyramid, before the uniforms are written
+		void PrepareClusterCulling(FramePacket& packet);
+		void WriteUniformBuffers(const FramePacket& packet);
+
+		// Outside the render graph: requests the packet's texture mips, streams them and rebinds replaced textures
+		void StreamTextures(VkCommandBuffer commandBuffer, const FramePacket& packet);
+
+		// Makes the frame about to be submitted wait for every upload submitted so far, called under the queue lock
+		void WaitForSubmittedUploads();
+
+		bool BeginCommandBuffer(VkCommandBuffer commandBuffer);
+		bool EndCommandBuffer(VkCommandBuffer commandBuffer);
+
+		VkExtent2D GetRenderExtent() const;
+
+		// Compares the camera and mesh transforms against the last frame's and records the current ones
+		bool SceneChanged();
 		void RecreateSwapChain();
+
+		// Declares and compiles the frame's passes, called again whenever the render extent changes
+		void BuildRenderGraph();
 	};
 }
\ No newline at end of file
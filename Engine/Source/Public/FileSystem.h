@@ -0,0 +1,59 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <cstdint>
+
+#include <MappedFile.h>
+
+namespace VulkanRenderer
+{
+	// The bytes of one file: a view into a mounted pak for entries stored uncompressed, a mapping of a loose file,
+	// or a buffer holding a decompressed entry. Valid until reset or destroyed.
+	class FileData
+	{
+	public:
+		FileData() = default;
+
+		FileData(const FileData&) = delete;
+		FileData& operator=(const FileData&) = delete;
+
+		const uint8_t* GetData() const;
+		size_t GetSize() const;
+
+		// Points at memory that outlives the data, e.g. a mounted pak
+		void SetView(const uint8_t* viewData, size_t viewSize);
+
+		bool Map(const std::string& path);
+
+		// Owned storage for the caller to fill
+		uint8_t* Allocate(size_t bufferSize);
+
+		// Drops bytes off the end, e.g. a trailer that has been checked
+		void Truncate(size_t newSize);
+
+		void Reset();
+
+	private:
+		const uint8_t* data = nullptr;
+		size_t size = 0;
+
+		MappedFile mappedFile;
+		std::unique_ptr<uint8_t[]> buffer;
+	};
+
+	// Every asset is read through here. Paths are relative to the working directory, e.g. "Assets/Shaders/Vert.spv",
+	// and are looked up in the mounted paks before falling back to loose files.
+	namespace FileSystem
+	{
+		// Paks mounted later take precedence over earlier ones. Mount and unmount only while nothing is being
+		// loaded, reads may come from any thread.
+		bool MountPak(const std::string& path);
+		void UnmountAll();
+
+		bool ReadFile(const std::string& path, FileData& data);
+
+		// Forward slashes, no "." segments or leading "./", the form paks store paths in
+		std::string NormalizePath(const std::string& path);
+	}
+}
\ No newline at end of file
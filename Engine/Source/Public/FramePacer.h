@@ -0,0 +1,82 @@
+#pragma once
+
+#include <vector>
+#include <deque>
+#include <chrono>
+#include <atomic>
+
+#include <volk.h>
+
+namespace VulkanRenderer
+{
+	class VulkanDevice;
+
+	// Limits the frame rate and measures input to present latency. With VK_KHR_present_wait the latency runs
+	// until the image is actually displayed, otherwise until vkQueuePresentKHR returns.
+	class FramePacer
+	{
+	public:
+		FramePacer(VulkanDevice* device);
+
+		// Sleeps most of the way to the next frame deadline and spins for the rest, 0 fps disables the limiter
+		void WaitForNextFrame();
+
+		// Called right after input is polled, the frame rendered next is measured from here
+		void MarkInputSampled();
+		std::chrono::steady_clock::time_point GetInputTime() const;
+
+		// Render thread: the input time travels with the frame packet since the main thread is already sampling
+		// the next frame's input. Returns the id to chain into VkPresentIdKHR, 0 when present wait is not available.
+		uint64_t BeginPresent(std::chrono::steady_clock::time_point frameInputTime);
+		void EndPresent(uint64_t presentId, std::chrono::steady_clock::time_point frameInputTime);
+
+		// Collects displayed frames without blocking, latencies resolve no later than the next frame
+		void PollPresents(VkSwapchainKHR swapChain);
+
+		// Present ids pending on a replaced swap chain can no longer be waited on
+		void DropPendingPresents();
+
+		// Render on demand: polls input and reports whether a frame is due, otherwise blocks until an event
+		// arrives or the idle timeout passes so external scene changes are still picked up
+		void PollEvents();
+
+		// Queues enough frames for the change to settle, UI widgets take a few frames to react to input
+		void RequestRedraw();
+
+		// Consumes one queued frame, always true while render on demand is off
+		bool ShouldDrawFrame();
+
+		// Draws the limiter, present mode and latency controls
+		void DrawImGui();
+
+		float targetFps = 0.0f;
+
+		bool renderOnDemand = false;
+
+		// Written by the UI, applied by the engine by recreating the swap chain
+		VkPresentModeKHR requestedPresentMode = VK_PRESENT_MODE_MAILBOX_KHR;
+		std::vector<VkPresentModeKHR> supportedPresentModes;
+
+		// Measured on the render thread, shown by the UI on the main thread
+		std::atomic<double> latencyMs = 0.0;
+
+	private:
+		struct PendingPresent
+		{
+			uint64_t presentId;
+			std::chrono::steady_clock::time_point inputTime;
+		};
+
+		void AddLatencySample(std::chrono::steady_clock::time_point frameInputTime);
+
+		VulkanDevice* device;
+
+		std::chrono::steady_clock::time_point nextFrameTime;
+		std::chrono::steady_clock::time_point inputTime;
+
+		uint32_t pendingRedrawFrames = 0;
+
+		uint64_t nextPresentId = 1;
+		std::deque<PendingPresent> pendingPresents;
+	};
+}
\ No newline at end of file
@@ -20,5 +20,14 @@ namespace VulkanRenderer
 		GLFWwindow* window;
 
 		static void FramebufferResizeCallback(GLFWwindow* window, int width, int height);
+
+		// Installed before ImGui, which chains to them, so any input wakes an idle render loop
+		static void CursorPosCallback(GLFWwindow* window, double x, double y);
+		static void MouseButtonCallback(GLFWwindow* window, int button, int action, int mods);
+		static void ScrollCallback(GLFWwindow* window, double xOffset, double yOffset);
+		static void KeyCallback(GLFWwindow* window, int key, int scancode, int action, int mods);
+		static void CharCallback(GLFWwindow* window, unsigned int codepoint);
+		static void WindowRefreshCallback(GLFWwindow* window);
+		static void RequestRedraw(GLFWwindow* window);
 	};
 }
\ No newline at end of file
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <cstdint>
+
+#include <glm/glm.hpp>
+
+#include <Mesh.h>
+#include <StaticBatch.h>
+
+namespace VulkanRenderer
+{
+	// A group swaps back to its members a little closer than it swapped to its proxy, so groups near the HLOD
+	// distance do not flicker between the two
+	constexpr float HlodHysteresis = 0.9f;
+
+	struct HlodBuildSettings
+	{
+		// Meshes whose bounds centers fall into the same cell of a uniform grid centered on the origin are merged
+		float cellSize = 16.0f;
+
+		// Cells with fewer meshes keep drawing them individually
+		uint32_t minMeshes = 2;
+
+		// Size in texels of each material's square tile in the atlases
+		uint32_t tileSize = 256;
+
+		// The atlases are written here as PNGs, the proxies' texture paths point at them
+		std::string outputDirectory;
+	};
+
+	// Merged geometry of a group of meshes in world space, textured by baked atlases
+	struct HlodProxy
+	{
+		MeshInfo info;
+
+		// Indices into the sources the proxy stands in for
+		std::vector<uint32_t> sources;
+
+		// World space bounding sphere of the group
+		glm::vec3 center{0.0f};
+		float radius = 0.0f;
+	};
+
+	// Offline step: groups spatially close opaque and alpha tested sources into proxies. Every group's geometry is
+	// transformed into world space and merged, each distinct material is resampled into a tile of base color,
+	// roughness and metallic atlases and the texture coordinates are remapped into their tile. Texture coordinates
+	// outside [0, 1] are clamped, so tiling materials are approximated, which goes unnoticed at proxy distances.
+	std::vector<HlodProxy> BuildHlodProxies(const std::vector<StaticMeshSource>& sources, const HlodBuildSettings& settings);
+
+	// Runtime side of a proxy: drawn instead of its members once the group is far enough away
+	struct HlodGroup
+	{
+		Mesh* proxy;
+		std::vector<Mesh*> members;
+
+		glm::vec3 center;
+		float radius;
+
+		bool useProxy = false;
+	};
+}
\ No newline at end of file
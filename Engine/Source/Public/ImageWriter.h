@@ -0,0 +1,10 @@
+#pragma once
+
+#include <string>
+#include <cstdint>
+
+namespace VulkanRenderer
+{
+	// Writes tightly packed 8-bit RGBA pixels as an uncompressed PNG
+	bool WritePng(const std::string& path, uint32_t width, uint32_t height, const uint8_t* rgbaPixels);
+}
\ No newline at end of file
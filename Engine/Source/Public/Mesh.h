@@ -10,41 +10,147 @@
 
 #include <Vertex.h>
 #include <VulkanUniformBuffer.h>
+#include <VulkanDescriptorAllocator.h>
 #include <Transform.h>
+#include <MeshUBO.h>
+#include <MeshOptimizer.h>
+#include <Meshlet.h>
+#include <MeshSimplifier.h>
 
 namespace VulkanRenderer
 {
 	class VulkanDevice;
 	class VulkanTexture;
+	class TextureStreamer;
+	struct CookedMeshView;
+
+	// How the base color alpha is used, each mode is drawn with its own pipeline
+	enum class BlendMode : uint32_t
+	{
+		Opaque,			// Alpha ignored
+		AlphaTest,		// Fragments below half alpha are discarded
+		Transparent		// Blended back to front after the opaque draws, depth is tested but not written
+	};
+
+	constexpr uint32_t BlendModeCount = 3;
+
+	// Triangles of one source mesh within a static batch, culled on their own, see StaticBatch.h
+	struct MeshRange
+	{
+		uint32_t indexOffset;
+		uint32_t indexCount;
+
+		// Bounding sphere in mesh space
+		glm::vec3 center;
+		float radius;
+	};
 
 	struct MeshInfo
 	{
 		std::vector<Vertex> vertices;
-		std::vector<uint16_t> indices;
+		std::vector<uint32_t> indices;
 		std::string baseColorPath;
 		std::string roughnessPath;
 		std::string metallicPath;
+		BlendMode blendMode = BlendMode::Opaque;
+
+		// Welds and reorders the vertices and triangles on import, see MeshOptimizer.h
+		bool optimize = true;
+
+		// Simplified levels of detail drawn in the distance, see MeshSimplifier.h
+		bool generateLods = true;
+
+		// Static batches only, back to back in indices. The triangle order is kept, so optimize and generateLods are ignored.
+		std::vector<MeshRange> ranges;
 	};
 	
 	class Mesh
 	{
 	public:
-		Mesh(VulkanDevice* device, VkDescriptorSetLayout descriptorSetLayout, const MeshInfo& info);
+		// Cooks the mesh in memory first, see CookMesh. With a streamer the textures load their mip tail only.
+		Mesh(VulkanDevice* device, VkDescriptorSetLayout descriptorSetLayout, VkDescriptorSetLayout clusterDescriptorSetLayout, const MeshInfo& info, TextureStreamer* textureStreamer = nullptr);
+
+		// Copies the cooked streams into staging memory as they are, e.g. straight from a mapped cooked mesh file
+		Mesh(VulkanDevice* device, VkDescriptorSetLayout descriptorSetLayout, VkDescriptorSetLayout clusterDescriptorSetLayout, const CookedMeshView& cooked, TextureStreamer* textureStreamer = nullptr);
 		~Mesh();
 
-		void CreateDescriptorSets(VkDescriptorPool descriptorPool);
+		void CreateDescriptorSets(VulkanDescriptorAllocator* descriptorAllocator);
+
+		// Render thread: rewrites the frame's descriptor set when a texture image was replaced since it was last
+		// written. The set is idle once the frame slot is.
+		void UpdateDescriptorSet(uint32_t currentImage);
+
+		// Sum of the texture versions, changes whenever the streamer replaces one of their images
+		uint64_t GetTextureVersion() const;
 
-		void UpdateUniformBuffer(uint32_t currentImage, VkExtent2D swapChainExtent);
+		// Main thread: diameter of the bounding sphere in pixels, infinite with the camera inside it
+		float GetScreenSize(const glm::mat4& model, const glm::vec3& cameraPosition, float pixelsPerUnit) const;
 
+		// Render thread
+		void RequestTextureMips(TextureStreamer* textureStreamer, float screenSize);
+
+		// Rebuilds per-frame uniform buffers and descriptor sets after the frames in flight count changed
+		void RecreateFrameResources(VulkanDescriptorAllocator* descriptorAllocator);
+
+		// Built from the transform on the main thread, written into the frame's buffer on the render thread
+		MeshUBO BuildUniformData() const;
+		void WriteUniformBuffer(uint32_t currentImage, const MeshUBO& ubo);
+
+		// Full resolution level
 		size_t GetIndicesSize() const;
 
+		// Levels share the vertex and index buffers, level 0 is the full resolution mesh
+		uint32_t GetLodCount() const;
+		const MeshLod& GetLod(uint32_t lod) const;
+
+		// Main thread: the coarsest level whose error projects to at most errorThreshold pixels, pixelsPerUnit being
+		// the size in pixels of one unit at distance one. Coarser levels are taken with hysteresis, see LodHysteresis.
+		uint32_t SelectLod(const glm::mat4& model, const glm::vec3& cameraPosition, float pixelsPerUnit, float errorThreshold);
+		uint32_t GetSelectedLod() const;
+
+		// Static batches are frustum culled range by range when their draws are built, see DrawList
+		bool IsStaticBatch() const;
+		const std::vector<MeshRange>& GetRanges() const;
+
+		// 16-bit when every vertex is addressable with it, 32-bit otherwise
+		VkIndexType GetIndexType() const;
+
+		// Meshes with at least ClusterCullingMinTriangles triangles are split into meshlets and culled per cluster
+		bool HasMeshlets() const;
+		uint32_t GetMeshletCount() const;
+
 		VulkanBuffer* vertexBuffer;
 		VulkanBuffer* indexBuffer;
 
+		// Quantized positions only, drawn by the depth prepass
+		VulkanBuffer* positionBuffer;
+
 		std::vector<VkDescriptorSet> descriptorSets;
 
+		// Meshlets only, null otherwise. The culling pass writes the surviving triangles as 32-bit indices into
+		// culledIndexBuffer and their count into the indirect draw in drawCommandBuffer.
+		VulkanBuffer* meshletBuffer = nullptr;
+		VulkanBuffer* meshletVertexBuffer = nullptr;
+		VulkanBuffer* meshletTriangleBuffer = nullptr;
+		VulkanBuffer* culledIndexBuffer = nullptr;
+		VulkanBuffer* drawCommandBuffer = nullptr;
+
+		// Meshlet buffers and the vertex buffer for the task, mesh and culling shaders, not per frame
+		VkDescriptorSet clusterDescriptorSet = VK_NULL_HANDLE;
+
 		Transform transform;
 
+		// Main thread: left out of frames, e.g. while an HLOD proxy stands in for the mesh, see Hlod.h
+		bool hidden = false;
+
+		BlendMode blendMode;
+
+		// Same for meshes built from the same textures, so their draws sort next to each other
+		uint32_t materialId;
+
+		// Left at zero when the mesh was not optimized
+		MeshOptimizationStats optimizationStats;
+
 	private:
 		VulkanDevice* device;
 		
@@ -54,12 +160,29 @@ namespace VulkanRenderer
 
 		std::vector<VulkanUniformBuffer> uniformBuffers;
 
+		// Texture version each frame's descriptor set was written with
+		std::vector<uint64_t> descriptorSetTextureVersions;
+
 		VkDescriptorSetLayout descriptorSetLayout;
+		VkDescriptorSetLayout clusterDescriptorSetLayout;
+
+		VkIndexType indexType;
+
+		std::vector<MeshLod> lods;
 
-		size_t indicesSize;
+		std::vector<MeshRange> ranges;
 
-		void CreateVertexBuffer(const std::vector<Vertex>& vertices);
-		void CreateIndexBuffer(const std::vector<uint16_t>& indices);
+		// Main thread, the level selected last frame
+		uint32_t currentLod = 0;
+
+		uint32_t meshletCount = 0;
+
+		// Quantized positions are relative to these
+		VertexBounds bounds;
+
+		void CreateMeshletBuffers(const CookedMeshView& cooked);
 		void CreateUniformBuffers();
+
+		std::vector<DescriptorBinding> GetDescriptorBindings(uint32_t frame) const;
 	};
 }
\ No newline at end of file
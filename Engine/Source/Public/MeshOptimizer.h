@@ -0,0 +1,41 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+
+#include <Vertex.h>
+
+namespace VulkanRenderer
+{
+	// Post-transform cache size the statistics are simulated with, a FIFO of this many vertices
+	constexpr uint32_t MeshOptimizerCacheSize = 16;
+
+	struct MeshOptimizationStats
+	{
+		size_t vertexCountBefore = 0;
+		size_t vertexCountAfter = 0;
+
+		// Average cache miss ratio, transformed vertices per triangle. 0.5 is the best a regular grid can do, 3 the worst.
+		float acmrBefore = 0.0f;
+		float acmrAfter = 0.0f;
+	};
+
+	// Merges vertices whose attributes are bit-identical and remaps the indices to them
+	void WeldVertices(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices);
+
+	// Reorders triangles so recently transformed vertices are reused while still in the post-transform cache.
+	// Greedy scoring after Forsyth's linear-speed vertex cache optimization.
+	void OptimizeVertexCache(std::vector<uint32_t>& indices, size_t vertexCount);
+
+	// Splits the cache-ordered triangles into clusters where the cache starts over and draws outward facing clusters
+	// first, so they occlude the rest of the mesh. Locality within a cluster is kept.
+	void OptimizeOverdraw(std::vector<uint32_t>& indices, const std::vector<Vertex>& vertices);
+
+	// Stores vertices in the order the indices first reference them, unreferenced vertices are dropped
+	void OptimizeVertexFetch(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices);
+
+	float ComputeAcmr(const std::vector<uint32_t>& indices, size_t vertexCount, uint32_t cacheSize = MeshOptimizerCacheSize);
+
+	// Runs every pass above in order on a triangle list
+	MeshOptimizationStats OptimizeMesh(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices);
+}
\ No newline at end of file
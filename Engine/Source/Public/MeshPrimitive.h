@@ -1,6 +1,7 @@
 #pragma once
 
 #include <vector>
+#include <cstdint>
 
 #include <Vertex.h>
 #include <Texture.h>
@@ -10,7 +11,7 @@ namespace VulkanRenderer
 	struct MeshPrimitive
 	{
 		std::vector<Vertex> vertices;
-		std::vector<unsigned int> indices;
+		std::vector<uint32_t> indices;
 
 		std::vector<Texture> textures;
 	};
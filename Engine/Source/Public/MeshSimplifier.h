@@ -0,0 +1,37 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+
+#include <Vertex.h>
+
+namespace VulkanRenderer
+{
+	// Levels per mesh including the full resolution one
+	constexpr uint32_t MeshMaxLods = 6;
+
+	// Levels are not built below this many triangles
+	constexpr uint32_t LodMinTriangles = 32;
+
+	// A coarser level is only switched to once its screen space error drops below this fraction of the threshold,
+	// so meshes near a switching distance do not pop back and forth
+	constexpr float LodHysteresis = 0.75f;
+
+	struct MeshLod
+	{
+		uint32_t indexOffset;
+		uint32_t indexCount;
+
+		// Upper bound on how far the level's surface strays from the full mesh, in mesh units
+		float error;
+	};
+
+	// Collapses edges in order of quadric error until the triangle list is down to the target index count or the
+	// next collapse would exceed maxError. Vertices only move onto a neighbour, so the result indexes the same
+	// vertices. Open borders and attribute seams are kept in place. Returns the largest error of a collapse.
+	float SimplifyMesh(const std::vector<Vertex>& vertices, std::vector<uint32_t>& indices, size_t targetIndexCount, float maxError);
+
+	// Level 0 is the given triangle list, every further level halves the triangle count of the one before until
+	// simplification stalls. The indices of every level are written one after another into lodIndices.
+	std::vector<MeshLod> BuildLodChain(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices, std::vector<uint32_t>& lodIndices);
+}
\ No newline at end of file
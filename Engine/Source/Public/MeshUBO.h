@@ -7,5 +7,12 @@ namespace VulkanRenderer
 	struct MeshUBO
 	{
 		alignas(16) glm::mat4 model;
+
+		// Decodes quantized positions: offset + position * scale, w unused
+		alignas(16) glm::vec4 positionOffset;
+		alignas(16) glm::vec4 positionScale;
+
+		// x: meshlet count, 0 when the mesh is drawn whole
+		alignas(16) glm::uvec4 meshletInfo;
 	};
 }
\ No newline at end of file
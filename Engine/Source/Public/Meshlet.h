@@ -0,0 +1,51 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+
+#include <glm/glm.hpp>
+
+#include <Vertex.h>
+
+namespace VulkanRenderer
+{
+	// Sizes commonly recommended for mesh shader hardware, one workgroup of 64 threads handles a meshlet
+	constexpr uint32_t MeshletMaxVertices = 64;
+	constexpr uint32_t MeshletMaxTriangles = 124;
+
+	// Meshes with fewer triangles are drawn whole, culling their clusters costs more than it saves
+	constexpr uint32_t ClusterCullingMinTriangles = 1024;
+
+	// std430 layout, matches the Meshlet struct in Culling.glsl. Bounds are in mesh space.
+	struct Meshlet
+	{
+		glm::vec3 center;
+		float radius;
+
+		// Every triangle faces away from a viewer for which dot(center - viewer, coneAxis) >= coneCutoff *
+		// length(center - viewer) + radius. A cutoff of 1 never culls.
+		glm::vec3 coneAxis;
+		float coneCutoff;
+
+		uint32_t vertexOffset;		// Into MeshletData::vertices
+		uint32_t triangleOffset;	// Into MeshletData::triangles
+		uint32_t vertexCount;
+		uint32_t triangleCount;
+	};
+
+	static_assert(sizeof(Meshlet) == 48, "Meshlet must match its std430 layout");
+
+	struct MeshletData
+	{
+		std::vector<Meshlet> meshlets;
+
+		// Mesh vertex indices referenced by each meshlet
+		std::vector<uint32_t> vertices;
+
+		// One triangle per element, three 8-bit indices into the meshlet's vertices
+		std::vector<uint32_t> triangles;
+	};
+
+	// Splits a triangle list into meshlets in index order, so a cache optimized mesh keeps its locality
+	MeshletData BuildMeshlets(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices);
+}
\ No newline at end of file
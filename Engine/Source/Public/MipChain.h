@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+namespace VulkanRenderer
+{
+	// RGBA8 mip chains as textures upload them, levels packed back to back from the finest one kept
+
+	// Levels of a full chain, down to 1x1
+	uint32_t GetMipLevelCount(uint32_t width, uint32_t height);
+
+	// Width or height of a level
+	uint32_t GetMipExtent(uint32_t size, uint32_t level);
+
+	size_t GetMipLevelSize(uint32_t width, uint32_t height, uint32_t level);
+
+	// Bytes of the levels from firstLevel to the last
+	size_t GetMipChainSize(uint32_t width, uint32_t height, uint32_t firstLevel);
+
+	// Downsamples sRGB pixels (level 0) with a box filter into levels firstLevel and coarser, written to target
+	// which holds GetMipChainSize bytes. Color is averaged in linear space, alpha as it is. The target may start at
+	// the pixels themselves: with firstLevel 0 the coarser levels follow them, otherwise the levels are filtered
+	// over them in place, so the buffer needs to hold the larger of the pixels and the chain.
+	void BuildMipChain(const uint8_t* pixels, uint32_t width, uint32_t height, uint32_t firstLevel, uint8_t* target);
+}
\ No newline at end of file
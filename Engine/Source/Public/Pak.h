@@ -0,0 +1,127 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <string_view>
+#include <cstdint>
+
+#include <MappedFile.h>
+#include <FileSystem.h>
+
+namespace VulkanRenderer
+{
+	// "VRPK" read as a little-endian uint32
+	constexpr uint32_t PakMagic = 0x4B505256;
+
+	constexpr uint32_t PakVersion = 1;
+
+	// Entries and tables start on this boundary, so a cooked mesh read in place keeps its section alignment
+	constexpr uint64_t PakAlignment = 64;
+
+	// Compressed entries are split into blocks of this size that decompress independently, in parallel
+	constexpr uint32_t PakBlockSize = 256 * 1024;
+
+	enum class PakCompression : uint32_t
+	{
+		None,		// Read in place from the mapping
+		Lz,			// LzCompress per block, see Compression.h
+		Count
+	};
+
+	// At the start of the file, little-endian. The entry, block and string tables follow the entry data.
+	struct PakHeader
+	{
+		uint32_t magic;
+		uint32_t version;
+		uint32_t entryCount;
+		uint32_t blockCount;
+
+		uint64_t entriesOffset;		// PakEntry, sorted by path hash
+		uint64_t blocksOffset;		// PakBlock
+		uint64_t stringsOffset;		// Entry paths, not null terminated
+		uint64_t stringsSize;
+	};
+
+	static_assert(sizeof(PakHeader) == 48, "PakHeader is part of the file format");
+
+	struct PakEntry
+	{
+		uint64_t pathHash;
+		uint64_t offset;			// Stored entries only
+		uint64_t size;				// Uncompressed
+		uint32_t pathOffset;
+		uint32_t pathLength;
+		uint32_t compression;		// PakCompression
+		uint32_t firstBlock;		// Compressed entries only
+		uint32_t blockCount;
+		uint32_t padding;
+	};
+
+	static_assert(sizeof(PakEntry) == 48, "PakEntry is part of the file format");
+
+	// A block that did not shrink is stored as is, with equal sizes
+	struct PakBlock
+	{
+		uint64_t offset;
+		uint32_t compressedSize;
+		uint32_t size;
+	};
+
+	static_assert(sizeof(PakBlock) == 16, "PakBlock is part of the file format");
+
+	// FNV-1a over the normalized path
+	uint64_t HashPakPath(std::string_view path);
+
+	struct PakSource
+	{
+		// Stored path, see FileSystem::NormalizePath
+		std::string path;
+
+		// File read from disk while building
+		std::string filePath;
+	};
+
+	struct PakBuildSettings
+	{
+		bool compress = false;
+
+		// An entry is only compressed when it shrinks by at least this fraction, others stay readable in place
+		float minSavings = 0.125f;
+	};
+
+	struct PakBuildStats
+	{
+		uint64_t size = 0;
+		uint64_t storedSize = 0;
+		uint32_t compressedEntryCount = 0;
+	};
+
+	bool WritePak(const std::string& path, const std::vector<PakSource>& sources, const PakBuildSettings& settings, PakBuildStats* stats = nullptr);
+
+	// A pak mapped into memory. Every table is validated on open and then read in place.
+	class PakFile
+	{
+	public:
+		bool Open(const std::string& path);
+
+		// Takes a normalized path, null when the pak does not have it
+		const PakEntry* Find(std::string_view path) const;
+
+		// Stored entries are a view into the mapping, compressed entries decompress into the data's buffer
+		bool Read(const PakEntry& entry, FileData& data) const;
+
+		uint32_t GetEntryCount() const;
+		const std::string& GetPath() const;
+
+	private:
+		MappedFile file;
+		std::string path;
+
+		const PakEntry* entries = nullptr;
+		uint32_t entryCount = 0;
+		const PakBlock* blocks = nullptr;
+		const char* strings = nullptr;
+
+		std::string_view GetEntryPath(const PakEntry& entry) const;
+	};
+}
\ No newline at end of file
@@ -0,0 +1,136 @@
+#pragma once
+
+#include <vector>
+#include <deque>
+#include <string>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+
+#include <volk.h>
+
+namespace VulkanRenderer
+{
+	class VulkanDevice;
+
+	// A completed scope, times are relative to the start of its frame
+	struct ProfileEvent
+	{
+		const char* name;
+		uint32_t threadIndex;
+		uint32_t depth;
+		double startMs;
+		double durationMs;
+	};
+
+	struct ProfileFrame
+	{
+		uint64_t frameNumber = 0;
+		double startUs = 0.0;			// CPU frame start since the profiler was created
+		double cpuFrameMs = 0.0;
+		double gpuFrameMs = 0.0;
+
+		std::vector<ProfileEvent> cpuEvents;
+		std::vector<ProfileEvent> gpuEvents;
+	};
+
+	// Records nested CPU scopes from any thread and GPU timestamp scopes per frame slot. GPU results are read
+	// when the slot comes around again, MAX_FRAMES_IN_FLIGHT frames later, so resolving never stalls.
+	class Profiler
+	{
+	public:
+		Profiler(VulkanDevice* device, uint32_t framesInFlight);
+		~Profiler();
+
+		Profiler(const Profiler&) = delete;
+		Profiler& operator=(const Profiler&) = delete;
+
+		// Recreates the query pools for a new frames in flight count, the device must be idle
+		void RecreateFrameResources(uint32_t framesInFlight);
+
+		// Starts collecting CPU scopes for a frame that will use the given frame slot
+		void BeginFrame(uint32_t frameIndex);
+		void EndFrame();
+
+		// Resolves the slot's previous frame and resets its queries, the slot must be idle on the GPU and
+		// the command buffer outside a render pass
+		void RecordQueryReset(VkCommandBuffer commandBuffer);
+
+		// Scope names are stored by pointer and must outlive the profiler, string literals are expected
+		void BeginCpuScope(const char* name);
+		void EndCpuScope();
+
+		void BeginGpuScope(VkCommandBuffer commandBuffer, const char* name);
+		void EndGpuScope(VkCommandBuffer commandBuffer);
+
+		// Draws frame time histograms and a flame chart of the latest resolved frame
+		void DrawImGui();
+
+		bool WriteChromeTrace(const std::string& path) const;
+
+		// A copy, frames are resolved on the render thread while the UI reads them on the main thread
+		std::deque<ProfileFrame> GetHistory() const;
+
+		std::atomic<bool> paused = false;
+
+	private:
+		struct GpuScope
+		{
+			const char* name;
+			uint32_t depth;
+			uint32_t beginQuery;
+			uint32_t endQuery;
+		};
+
+		// A frame whose CPU side is done and whose GPU side waits for its slot to come around
+		struct PendingFrame
+		{
+			ProfileFrame frame;
+			std::vector<GpuScope> gpuScopes;
+			uint32_t queryCount = 0;
+			bool valid = false;
+		};
+
+		void CreateQueryPools(uint32_t framesInFlight);
+		void DestroyQueryPools();
+		void ResolvePendingFrame(uint32_t frameIndex);
+
+		VulkanDevice* device;
+
+		std::vector<VkQueryPool> queryPools;
+		std::vector<PendingFrame> pendingFrames;
+
+		bool gpuTimestampsSupported = false;
+		double timestampPeriodNs = 1.0;
+		uint64_t timestampMask = ~0ull;
+
+		// Frame currently being recorded
+		PendingFrame currentFrame;
+		uint32_t currentFrameIndex = 0;
+		bool frameOpen = false;
+		uint64_t frameCounter = 0;
+		std::vector<uint32_t> gpuScopeStack;
+
+		std::chrono::steady_clock::time_point epoch;
+		std::chrono::steady_clock::time_point frameStart;
+
+		// Guards currentFrame.frame.cpuEvents against scopes ending on worker threads
+		std::mutex cpuEventMutex;
+
+		// Guards history, written when a frame resolves and read by the UI and trace export
+		mutable std::mutex historyMutex;
+
+		std::deque<ProfileFrame> history;
+	};
+
+	// Times the enclosing block on the calling thread, a null profiler makes it a no-op
+	class ProfileScope
+	{
+	public:
+		ProfileScope(Profiler* profiler, const char* name);
+		~ProfileScope();
+
+	private:
+		Profiler* profiler;
+	};
+}
\ No newline at end of file
@@ -0,0 +1,219 @@
+#pragma once
+
+#include <vector>
+#include <memory>
+#include <optional>
+#include <functional>
+#include <map>
+
+#include <volk.h>
+
+namespace VulkanRenderer
+{
+	class VulkanDevice;
+	class VulkanImage;
+	class Profiler;
+	class VulkanSync;
+
+	// Index of an image declared in a render graph
+	using RenderGraphResource = uint32_t;
+
+	// How an imported image is used right before the graph executes
+	struct RenderGraphImageState
+	{
+		VkPipelineStageFlags2 stageMask = VK_PIPELINE_STAGE_2_NONE;
+		VkAccessFlags2 accessMask = VK_ACCESS_2_NONE;
+		VkImageLayout layout = VK_IMAGE_LAYOUT_UNDEFINED;
+	};
+
+	class RenderGraphPass
+	{
+	public:
+		// Color attachments are bound in declaration order, a pass without attachments runs outside a render pass.
+		// Attachment passes begin a render pass, or dynamic rendering on devices that support it.
+		RenderGraphPass& WriteColor(RenderGraphResource resource, bool clear, VkClearColorValue clearValue = {});
+		RenderGraphPass& WriteDepth(RenderGraphResource resource, bool clear, float clearDepth = 1.0f);
+
+		RenderGraphPass& ReadTexture(RenderGraphResource resource, VkPipelineStageFlags2 stageMask = VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT);
+		RenderGraphPass& ReadTransfer(RenderGraphResource resource);
+
+		// Every mip level is written through storage images in the general layout, barriers between the
+		// pass's own dispatches are up to the pass
+		RenderGraphPass& WriteStorage(RenderGraphResource resource, VkPipelineStageFlags2 stageMask = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT);
+		RenderGraphPass& WriteTransfer(RenderGraphResource resource);
+
+		// Keeps the pass even when nothing in the graph reads its output, e.g. a readback to the host
+		RenderGraphPass& SetSideEffects();
+
+		RenderGraphPass& SetExecute(std::function<void(VkCommandBuffer commandBuffer, VkExtent2D extent)> callback);
+
+	private:
+		friend class RenderGraph;
+
+		struct ResourceUse
+		{
+			RenderGraphResource resource;
+			VkPipelineStageFlags2 stageMask;
+			VkAccessFlags2 accessMask;
+			VkImageLayout layout;
+			VkImageUsageFlags usage;
+			bool reads;
+			bool writes;
+		};
+
+		struct Attachment
+		{
+			RenderGraphResource resource;
+			VkAttachmentLoadOp loadOp;
+			VkAttachmentStoreOp storeOp;
+			VkClearValue clearValue;
+		};
+
+		RenderGraphPass(const char* name);
+
+		void AddUse(const ResourceUse& use);
+
+		const char* name;
+
+		std::vector<ResourceUse> uses;
+		std::vector<Attachment> colorAttachments;
+		std::optional<Attachment> depthAttachment;
+
+		bool sideEffects = false;
+		std::function<void(VkCommandBuffer, VkExtent2D)> execute;
+
+		bool HasAttachments() const;
+
+		// Filled in by RenderGraph::Compile, renderPass stays null with dynamic rendering
+		uint32_t refCount = 0;
+		bool culled = false;
+		VkRenderPass renderPass = VK_NULL_HANDLE;
+		VkExtent2D extent{};
+	};
+
+	// Passes declare the images they read and write, the graph orders nothing itself (passes run in declaration
+	// order) but culls passes whose output is never consumed, derives the barriers and layout transitions between
+	// them and places transient images with disjoint lifetimes in the same device memory.
+	class RenderGraph
+	{
+	public:
+		RenderGraph(VulkanDevice* device);
+		~RenderGraph();
+
+		RenderGraph(const RenderGraph&) = delete;
+		RenderGraph& operator=(const RenderGraph&) = delete;
+
+		// Destroys every pass and physical resource so the graph can be declared again. With a sync object set the
+		// physical resources are retired until in-flight frames are done with them, otherwise the device must be idle.
+		void Reset();
+
+		// An image owned outside the graph, it is left in finalLayout after execution
+		RenderGraphResource ImportImage(const char* name, VkFormat format, VkExtent2D extent, const RenderGraphImageState& initialState, VkImageLayout finalLayout);
+
+		// Points an imported resource at a concrete image, e.g. the acquired swap chain image for this frame
+		void BindImportedImage(RenderGraphResource resource, VkImage image, VkImageView imageView);
+
+		// An image that only lives for the duration of the graph, its memory may be shared with other transients
+		RenderGraphResource CreateImage(const char* name, VkFormat format, VkExtent2D extent);
+
+		// The returned pass stays valid until Reset
+		RenderGraphPass& AddPass(const char* name);
+
+		// Culls unused passes, allocates transient images and creates render passes
+		void Compile();
+
+		// Records every surviving pass with the barriers it needs
+		void Execute(VkCommandBuffer commandBuffer);
+
+		void SetProfiler(Profiler* frameProfiler);
+		void SetSync(VulkanSync* frameSync);
+
+		// Physical view of a resource, valid once the graph is compiled (transients) or the image is bound (imported)
+		VkImageView GetImageView(RenderGraphResource resource) const;
+
+		uint32_t GetCulledPassCount() const;
+		VkDeviceSize GetTransientMemorySize() const;
+		VkDeviceSize GetUnaliasedTransientMemorySize() const;
+
+	private:
+		struct BarrierState
+		{
+			VkImageLayout layout = VK_IMAGE_LAYOUT_UNDEFINED;
+			VkPipelineStageFlags2 writeStageMask = VK_PIPELINE_STAGE_2_NONE;
+			VkAccessFlags2 writeAccessMask = VK_ACCESS_2_NONE;
+			VkPipelineStageFlags2 readStageMask = VK_PIPELINE_STAGE_2_NONE;
+			VkAccessFlags2 readAccessMask = VK_ACCESS_2_NONE;
+			bool usedThisFrame = false;
+		};
+
+		struct Resource
+		{
+			const char* name;
+			VkFormat format;
+			VkExtent2D extent;
+			bool imported;
+
+			RenderGraphImageState initialState;
+			VkImageLayout finalLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+			VkImage image = VK_NULL_HANDLE;
+			VkImageView imageView = VK_NULL_HANDLE;
+
+			// Transient only
+			VulkanImage* view = nullptr;
+			VkImageUsageFlags usage = 0;
+			VkMemoryRequirements memoryRequirements{};
+			int memoryBlock = -1;
+
+			uint32_t refCount = 0;
+			uint32_t firstPass = UINT32_MAX;
+			uint32_t lastPass = 0;
+
+			BarrierState state;
+		};
+
+		// Device memory shared by transient images whose lifetimes do not overlap
+		struct MemoryBlock
+		{
+			VkDeviceMemory memory = VK_NULL_HANDLE;
+			VkDeviceSize size = 0;
+			uint32_t memoryTypeBits = ~0u;
+			std::vector<RenderGraphResource> resources;
+
+			// Last use of any image in the block, the next alias waits on it before reusing the memory
+			VkPipelineStageFlags2 stageMask = VK_PIPELINE_STAGE_2_NONE;
+			VkAccessFlags2 accessMask = VK_ACCESS_2_NONE;
+		};
+
+		void CullPasses();
+		void ComputeLifetimes();
+		void AllocateTransients();
+		void CreateRenderPasses();
+		VkRenderPass CreateRenderPass(const RenderGraphPass& pass);
+		VkFramebuffer GetFramebuffer(const RenderGraphPass& pass);
+
+		void BeginRendering(VkCommandBuffer commandBuffer, const RenderGraphPass& pass);
+		void EndRendering(VkCommandBuffer commandBuffer, const RenderGraphPass& pass);
+
+		// Barriers keep their own stage masks, they are only merged on the legacy path
+		bool AddBarrier(const RenderGraphPass::ResourceUse& use, std::vector<VkImageMemoryBarrier2>& barriers);
+		void AddFinalTransitions(VkCommandBuffer commandBuffer);
+
+		void DestroyPhysicalResources(bool immediate);
+
+		VulkanDevice* device;
+
+		std::vector<Resource> resources;
+		std::vector<std::unique_ptr<RenderGraphPass>> passes;
+		std::vector<MemoryBlock> memoryBlocks;
+
+		// Keyed by render pass and attachment views so imported images can change from frame to frame
+		std::map<std::vector<uint64_t>, VkFramebuffer> framebufferCache;
+
+		Profiler* profiler = nullptr;
+		VulkanSync* sync = nullptr;
+
+		uint32_t culledPassCount = 0;
+		VkDeviceSize unaliasedMemorySize = 0;
+	};
+}
\ No newline at end of file
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <vector>
+#include <memory>
+#include <chrono>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+#include <volk.h>
+
+#include <CameraUBO.h>
+#include <MeshUBO.h>
+#include <DrawList.h>
+#include <VulkanImGuiOverlay.h>
+
+namespace VulkanRenderer
+{
+	class Mesh;
+
+	// Everything the render thread needs to draw one frame, built on the main thread from the scene as it was
+	// when input was sampled. The render thread never reads transforms or ImGui state directly.
+	struct FramePacket
+	{
+		CameraUBO cameraUniforms{};
+
+		// Parallel arrays, the meshes only provide their buffers and descriptor sets
+		std::vector<Mesh*> meshes;
+		std::vector<MeshUBO> meshUniforms;
+		std::vector<uint32_t> meshLods;
+
+		// Bounding sphere diameter in pixels, picks the texture mips to stream in
+		std::vector<float> meshScreenSizes;
+
+		// Sorted on the main thread, indices into meshes
+		DrawList drawList;
+
+		ImGuiDrawSnapshot ui;
+
+		// Window size when the packet was built, 0x0 never reaches the render thread
+		VkExtent2D framebufferExtent{};
+
+		VkPresentModeKHR presentMode = VK_PRESENT_MODE_FIFO_KHR;
+
+		std::chrono::steady_clock::time_point inputTime;
+	};
+
+	// Draws frame packets on a dedicated thread. One packet can wait while another is drawn, so the main thread
+	// builds frame N+1 while frame N is recorded, submitted and presented, and never runs further ahead than that.
+	class RenderThread
+	{
+	public:
+		RenderThread(std::function<void(FramePacket& packet)> drawFrame);
+
+		// Draws every submitted packet before joining
+		~RenderThread();
+
+		RenderThread(const RenderThread&) = delete;
+		RenderThread& operator=(const RenderThread&) = delete;
+
+		// Hands the packet to the render thread and replaces it with one it has finished drawing, so packets and
+		// their allocations are recycled. Blocks while the previous packet is still waiting to be picked up.
+		void Submit(std::unique_ptr<FramePacket>& packet);
+
+		// Blocks until every submitted packet has been drawn, the thread then waits for the next one. Used to
+		// change per-frame resources from the main thread.
+		void WaitIdle();
+
+	private:
+		void Run();
+
+		std::function<void(FramePacket&)> drawFrame;
+
+		std::unique_ptr<FramePacket> pendingPacket;
+		std::unique_ptr<FramePacket> drawingPacket;
+
+		bool packetPending = false;
+		bool drawing = false;
+		bool stopping = false;
+
+		std::mutex mutex;
+		std::condition_variable condition;
+
+		std::thread thread;
+	};
+}
\ No newline at end of file
@@ -1,7 +1,7 @@
 #pragma once
 
 #include <string>
-#include <vector>
+#include <cstdint>
 
 #include <volk.h>
 
@@ -20,7 +20,6 @@ namespace VulkanRenderer
 		VkShaderModule shaderModule = VK_NULL_HANDLE;
 		VkPipelineShaderStageCreateInfo stageCreateInfo{};
 
-		void CreateShaderModule(const std::vector<char>& code);
-		static std::vector<char> ReadFile(const std::string& filePath);
+		void CreateShaderModule(const uint8_t* code, size_t codeSize);
 	};
 }
\ No newline at end of file
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+
+#include <glm/glm.hpp>
+
+#include <Mesh.h>
+
+namespace VulkanRenderer
+{
+	// A static mesh as placed in the scene, input to the offline batching and HLOD builders
+	struct StaticMeshSource
+	{
+		const MeshInfo* info;
+		glm::mat4 model;
+	};
+
+	struct StaticBatchSettings
+	{
+		// Batches never span more than one cell of a uniform grid centered on the origin, which bounds how much
+		// precision the quantized positions lose over a merged batch's extent
+		float cellSize = 64.0f;
+
+		// Cells with fewer meshes of a material keep drawing them individually
+		uint32_t minMeshes = 2;
+	};
+
+	// Meshes sharing a material merged in world space, drawn with one bind. Each source keeps its own range of
+	// the index buffer, see MeshRange.
+	struct StaticBatch
+	{
+		MeshInfo info;
+
+		// Indices into the sources in the order of their ranges
+		std::vector<uint32_t> sources;
+	};
+
+	// Offline step: merges opaque and alpha tested sources with the same textures and blend mode per grid cell.
+	// Sources are optimized on their own before merging, since the batch itself must keep its triangle order.
+	std::vector<StaticBatch> BuildStaticBatches(const std::vector<StaticMeshSource>& sources, const StaticBatchSettings& settings);
+
+	// Appends the triangles transformed by model, mirroring transforms get their winding and bitangent sign
+	// flipped. Returns the index of the first appended vertex.
+	uint32_t AppendTransformedGeometry(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices, const glm::mat4& model, std::vector<Vertex>& outVertices, std::vector<uint32_t>& outIndices);
+}
\ No newline at end of file
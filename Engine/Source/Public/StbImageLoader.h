@@ -0,0 +1,19 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+namespace VulkanRenderer
+{
+	// Reads the dimensions from the image header without decoding
+	bool GetImageSize(const uint8_t* data, size_t size, uint32_t& width, uint32_t& height);
+
+	// JPEG asks for one byte past the pixels, a target this much larger takes those in place as well
+	constexpr size_t DecodeImageSlack = 1;
+
+	// Decodes to RGBA8, flipped vertically so rows run bottom to top the way textures are sampled, into the first
+	// width * height * 4 bytes of the target. stb allocates through hooks that hand the target out for an allocation
+	// the size of the final image, so for the common formats the pixels are decoded straight into it, anything else
+	// is copied over once.
+	bool DecodeImage(const uint8_t* data, size_t size, uint8_t* target, size_t targetCapacity);
+}
\ No newline at end of file
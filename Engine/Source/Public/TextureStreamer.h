@@ -0,0 +1,169 @@
+#pragma once
+
+#include <vector>
+#include <deque>
+#include <memory>
+#include <unordered_map>
+#include <string>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+
+#include <volk.h>
+
+#include <VulkanStagingRing.h>
+
+namespace VulkanRenderer
+{
+	class VulkanDevice;
+	class VulkanSync;
+	class VulkanTexture;
+	class VulkanImage;
+
+	// Keeps each texture's finest mip levels resident only while something on screen needs them. Textures load
+	// their mip tail, a texture's size on screen picks the finest level it wants, finer levels are decoded on a
+	// worker thread and uploaded in the frame's command buffer, and past the budget the least recently used
+	// textures drop levels through a GPU copy into a smaller image. Replaced images are retired until in-flight
+	// frames are done with them and the meshes rewrite their frame's descriptor set, so nothing waits on the device.
+	class TextureStreamer
+	{
+	public:
+		TextureStreamer(VulkanDevice* device, VkDeviceSize budget);
+
+		// Joins the decode thread and releases undelivered decodes, every texture must be unregistered by now
+		~TextureStreamer();
+
+		TextureStreamer(const TextureStreamer&) = delete;
+		TextureStreamer& operator=(const TextureStreamer&) = delete;
+
+		// Levels at most this many texels across are never evicted and are all a texture starts with
+		static constexpr uint32_t TailSize = 128;
+		static uint32_t GetTailMip(uint32_t width, uint32_t height);
+
+		// Replaced images are retired on the frame timeline, must be set before the first update
+		void SetSync(VulkanSync* frameSync);
+
+		// Any thread: textures register once their tail is uploaded and unregister before they are destroyed
+		void Register(VulkanTexture* texture);
+		void Unregister(VulkanTexture* texture);
+
+		// Render thread: the texture covers about this many pixels across on screen this frame, assuming its UVs
+		// span the mesh once
+		void Request(VulkanTexture* texture, float screenSize);
+
+		// Render thread, outside a render pass: uploads finished decodes, evicts down to the budget and queues
+		// decodes for this frame's requests. Textures whose version changed must be rebound before drawing.
+		void Update(VkCommandBuffer commandBuffer);
+
+		// Main thread
+		void DrawImGui();
+
+		// Written by the UI, read by the render thread. Counts every resident level, tails included.
+		std::atomic<VkDeviceSize> budget;
+
+		// Headless runs wait for each frame's decodes, so every captured frame has the levels it asked for
+		bool waitForDecodes = false;
+
+	private:
+		static constexpr uint32_t NoMip = ~0u;
+
+		// Decodes queued at once while rendering interactively, each one decodes a full source image
+		static constexpr uint32_t MaxPendingDecodes = 4;
+
+		struct Entry
+		{
+			VulkanTexture* texture;
+			uint64_t id;
+			uint32_t tailMip;
+
+			// Finest level requested in lastUsedFrame
+			uint32_t wantedMip;
+			uint64_t lastUsedFrame = 0;
+
+			// Level a decode is in flight for
+			uint32_t pendingMip = NoMip;
+
+			// Set when the source can no longer be decoded, the texture keeps what it has
+			bool failed = false;
+		};
+
+		struct DecodeJob
+		{
+			uint64_t id;
+			std::string path;
+			uint32_t width;
+			uint32_t height;
+			uint32_t mip;
+		};
+
+		// Levels mip and coarser packed in staging memory as BuildMipChain writes them, the decode thread decodes and
+		// filters them there so they are uploaded without another copy. Nothing is allocated when decoding failed.
+		struct DecodeResult
+		{
+			uint64_t id;
+			uint32_t mip;
+			bool decoded;
+			StagingAllocation staging;
+		};
+
+		void RunDecodeThread();
+
+		Entry* FindEntry(uint64_t id);
+
+		void UploadDecodes(VkCommandBuffer commandBuffer, std::vector<DecodeResult>& results);
+
+		// Returns the number of decodes in flight
+		uint32_t QueueDecodes();
+
+		// Finest level Evict may leave the entry with
+		uint32_t GetEvictionFloor(const Entry& entry) const;
+
+		// Drops levels from the least recently used textures until at most limit bytes are resident. Textures used
+		// this frame only drop the levels finer than they asked for, keep is left alone.
+		void Evict(VkCommandBuffer commandBuffer, VkDeviceSize limit, const Entry* keep);
+
+		// Bytes Evict could free without touching keep
+		VkDeviceSize GetEvictableSize(const Entry* keep) const;
+
+		// Levels mip and coarser start levelsOffset bytes into the staging allocation, which is released once this
+		// frame completes
+		void UploadMips(VkCommandBuffer commandBuffer, Entry& entry, uint32_t mip, const StagingAllocation& staging, VkDeviceSize levelsOffset);
+		void CopyMips(VkCommandBuffer commandBuffer, Entry& entry, uint32_t mip);
+
+		// Swaps in the new image and retires the old one once this frame completes
+		void ReplaceImage(Entry& entry, VulkanImage* image, uint32_t mip);
+
+		VkDeviceSize GetResidentSize(const Entry& entry, uint32_t mip) const;
+
+		VulkanDevice* device;
+		VulkanSync* sync = nullptr;
+
+		// Guards entries, textures register from the main thread while the render thread streams
+		std::mutex mutex;
+		std::unordered_map<VulkanTexture*, Entry> entries;
+
+		uint64_t nextId = 1;
+		uint64_t frameIndex = 1;
+
+		VkDeviceSize residentSize = 0;
+
+		// Decode thread queues
+		std::mutex decodeMutex;
+		std::condition_variable decodeCondition;
+		std::condition_variable resultCondition;
+		std::deque<DecodeJob> decodeJobs;
+		std::vector<DecodeResult> decodeResults;
+		bool stopping = false;
+
+		std::thread decodeThread;
+
+		// Published for the UI
+		std::atomic<VkDeviceSize> publishedResidentSize = 0;
+		std::atomic<uint32_t> publishedTextureCount = 0;
+		std::atomic<uint32_t> publishedStreamedCount = 0;
+		std::atomic<uint32_t> publishedPendingCount = 0;
+		std::atomic<uint64_t> streamedInCount = 0;
+		std::atomic<uint64_t> evictedCount = 0;
+	};
+}
\ No newline at end of file
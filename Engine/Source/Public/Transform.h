@@ -2,10 +2,28 @@
 
 #include <glm/glm.hpp>
 #include <glm/gtc/type_ptr.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/quaternion.hpp>
 
 struct Transform
 {
 	glm::vec3 position{};
 	glm::quat rotation{};
 	glm::vec3 scale{1.0f, 1.0f, 1.0f};
+
+	// Scale, then rotation, then translation
+	glm::mat4 GetMatrix() const
+	{
+		return glm::translate(glm::mat4(1.0f), position) * glm::mat4_cast(rotation) * glm::scale(glm::mat4(1.0f), scale);
+	}
+
+	bool operator==(const Transform& other) const
+	{
+		return position == other.position && rotation == other.rotation && scale == other.scale;
+	}
+
+	bool operator!=(const Transform& other) const
+	{
+		return !(*this == other);
+	}
 };
\ No newline at end of file
@@ -1,21 +1,87 @@
 #pragma once
 
 #include <array>
+#include <vector>
+#include <cstdint>
 
 #include <volk.h>
 
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 
+#include <VertexLayout.h>
+
 namespace VulkanRenderer
 {
+	// A vertex as authored, at full precision. Meshes quantize these into PackedVertex on upload.
 	struct Vertex
 	{
 		glm::vec3 position;
 		glm::vec2 texCoord;
+		glm::vec3 normal{0.0f, 0.0f, 1.0f};
+		glm::vec4 tangent{1.0f, 0.0f, 0.0f, 1.0f};	// w is the bitangent sign
+
+		static constexpr std::array<VertexAttribute, 4> GetAttributes()
+		{
+			return {VERTEX_ATTRIBUTE(Vertex, position), VERTEX_ATTRIBUTE(Vertex, texCoord), VERTEX_ATTRIBUTE(Vertex, normal), VERTEX_ATTRIBUTE(Vertex, tangent)};
+		}
+	};
+
+	// Axis-aligned box the quantized positions are relative to
+	struct VertexBounds
+	{
+		glm::vec3 min{0.0f};
+		glm::vec3 extent{0.0f};
+
+		static VertexBounds Compute(const std::vector<Vertex>& vertices);
+	};
+
+	// 16 bytes instead of the 48 a full precision vertex takes, decoded in the vertex shader:
+	// - position: 16-bit unorm within the mesh bounds, w holds the bitangent sign (0 or 1)
+	// - texCoord: half floats
+	// - normal and tangent: octahedral encoded into two 8-bit snorm pairs
+	struct PackedVertex
+	{
+		Unorm16x4 position;
+		Half2 texCoord;
+		Snorm8x4 normalTangent;
 
-		static VkVertexInputBindingDescription GetBindingDescription();
+		static PackedVertex Pack(const Vertex& vertex, const VertexBounds& bounds);
 
-		static std::array<VkVertexInputAttributeDescription, 2> GetAttributeDescriptions();
+		static constexpr std::array<VertexAttribute, 3> GetAttributes()
+		{
+			return {VERTEX_ATTRIBUTE(PackedVertex, position), VERTEX_ATTRIBUTE(PackedVertex, texCoord), VERTEX_ATTRIBUTE(PackedVertex, normalTangent)};
+		}
 	};
+
+	// Separate stream of quantized positions only, depth-only passes fetch nothing they do not use
+	struct PositionVertex
+	{
+		Unorm16x4 position;
+
+		static constexpr std::array<VertexAttribute, 1> GetAttributes()
+		{
+			return {VERTEX_ATTRIBUTE(PositionVertex, position)};
+		}
+	};
+
+	// PackedVertex plus four joint indices and their normalized weights, for skinned meshes
+	struct SkinnedPackedVertex
+	{
+		Unorm16x4 position;
+		Half2 texCoord;
+		Snorm8x4 normalTangent;
+		Uint8x4 joints;
+		Unorm8x4 weights;
+
+		static constexpr std::array<VertexAttribute, 5> GetAttributes()
+		{
+			return {VERTEX_ATTRIBUTE(SkinnedPackedVertex, position), VERTEX_ATTRIBUTE(SkinnedPackedVertex, texCoord), VERTEX_ATTRIBUTE(SkinnedPackedVertex, normalTangent),
+				VERTEX_ATTRIBUTE(SkinnedPackedVertex, joints), VERTEX_ATTRIBUTE(SkinnedPackedVertex, weights)};
+		}
+	};
+
+	static_assert(VertexLayout<PackedVertex>::stride == 16, "PackedVertex must stay tightly packed");
+	static_assert(VertexLayout<PositionVertex>::stride == 8, "PositionVertex must stay tightly packed");
+	static_assert(VertexLayout<SkinnedPackedVertex>::stride == 24, "SkinnedPackedVertex must stay tightly packed");
 }
\ No newline at end of file
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <cstddef>
+
+#include <volk.h>
+
+#include <glm/glm.hpp>
+
+// Declares a member as an attribute, its format follows from the member's type
+#define VERTEX_ATTRIBUTE(VertexType, member) \
+	::VulkanRenderer::VertexAttribute::Of<decltype(VertexType::member)>(offsetof(VertexType, member))
+
+namespace VulkanRenderer
+{
+	// Storage types for packed attributes, the type alone decides the Vulkan format
+	struct Unorm8x4 { uint8_t value[4]; };
+	struct Snorm8x4 { int8_t value[4]; };
+	struct Uint8x4 { uint8_t value[4]; };
+	struct Unorm16x4 { uint16_t value[4]; };
+	struct Half2 { uint16_t value[2]; };
+
+	template<typename T>
+	struct VertexFormatOf;
+
+	template<> struct VertexFormatOf<float> { static constexpr VkFormat value = VK_FORMAT_R32_SFLOAT; };
+	template<> struct VertexFormatOf<glm::vec2> { static constexpr VkFormat value = VK_FORMAT_R32G32_SFLOAT; };
+	template<> struct VertexFormatOf<glm::vec3> { static constexpr VkFormat value = VK_FORMAT_R32G32B32_SFLOAT; };
+	template<> struct VertexFormatOf<glm::vec4> { static constexpr VkFormat value = VK_FORMAT_R32G32B32A32_SFLOAT; };
+	template<> struct VertexFormatOf<Unorm8x4> { static constexpr VkFormat value = VK_FORMAT_R8G8B8A8_UNORM; };
+	template<> struct VertexFormatOf<Snorm8x4> { static constexpr VkFormat value = VK_FORMAT_R8G8B8A8_SNORM; };
+	template<> struct VertexFormatOf<Uint8x4> { static constexpr VkFormat value = VK_FORMAT_R8G8B8A8_UINT; };
+	template<> struct VertexFormatOf<Unorm16x4> { static constexpr VkFormat value = VK_FORMAT_R16G16B16A16_UNORM; };
+	template<> struct VertexFormatOf<Half2> { static constexpr VkFormat value = VK_FORMAT_R16G16_SFLOAT; };
+
+	struct VertexAttribute
+	{
+		VkFormat format;
+		uint32_t offset;
+
+		template<typename T>
+		static constexpr VertexAttribute Of(size_t offset)
+		{
+			return {VertexFormatOf<T>::value, static_cast<uint32_t>(offset)};
+		}
+	};
+
+	// Vulkan input descriptions generated at compile time from a vertex type's attribute list. The type provides
+	// static constexpr GetAttributes() returning a std::array<VertexAttribute, N>, locations follow that order.
+	template<typename Vertex>
+	struct VertexLayout
+	{
+		static constexpr auto attributes = Vertex::GetAttributes();
+		static constexpr uint32_t attributeCount = static_cast<uint32_t>(attributes.size());
+		static constexpr uint32_t stride = sizeof(Vertex);
+
+		static_assert(attributeCount > 0, "A vertex layout needs at least one attribute");
+
+		static constexpr VkVertexInputBindingDescription GetBindingDescription(uint32_t binding = 0)
+		{
+			return {binding, stride, VK_VERTEX_INPUT_RATE_VERTEX};
+		}
+
+		static constexpr std::array<VkVertexInputAttributeDescription, attributeCount> GetAttributeDescriptions(uint32_t binding = 0, uint32_t firstLocation = 0)
+		{
+			std::array<VkVertexInputAttributeDescription, attributeCount> descriptions{};
+			for (uint32_t i = 0; i < attributeCount; i++)
+			{
+				descriptions[i] = {firstLocation + i, binding, attributes[i].format, attributes[i].offset};
+			}
+			return descriptions;
+		}
+	};
+}
\ No newline at end of file
@@ -6,6 +6,10 @@ namespace VulkanConfig
 {
 	extern int MAX_FRAMES_IN_FLIGHT;
 
+	// Bounds for changing MAX_FRAMES_IN_FLIGHT at runtime
+	extern const int MIN_SUPPORTED_FRAMES_IN_FLIGHT;
+	extern const int MAX_SUPPORTED_FRAMES_IN_FLIGHT;
+
 	extern bool enableValidationLayers;
 
 	extern const std::vector<const char*> validationLayers;
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <vector>
+#include <unordered_map>
+
+#include <volk.h>
+
+namespace VulkanRenderer
+{
+	class VulkanDevice;
+
+	// One resource bound to a descriptor set binding, used both to write the set and as its cache key
+	struct DescriptorBinding
+	{
+		uint32_t binding = 0;
+		VkDescriptorType type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+		VkDescriptorBufferInfo bufferInfo{};
+		VkDescriptorImageInfo imageInfo{};
+
+		static DescriptorBinding Buffer(uint32_t binding, VkDescriptorType type, VkBuffer buffer, VkDeviceSize offset, VkDeviceSize range);
+		static DescriptorBinding Image(uint32_t binding, VkDescriptorType type, VkImageView imageView, VkSampler sampler, VkImageLayout imageLayout);
+	};
+
+	// Writes every binding into the set, which no pending command buffer may use
+	void WriteDescriptorSet(VkDevice device, VkDescriptorSet descriptorSet, const std::vector<DescriptorBinding>& bindings);
+
+	class VulkanDescriptorAllocator
+	{
+	public:
+		VulkanDescriptorAllocator(VulkanDevice* device, uint32_t initialSetsPerPool = 64);
+		~VulkanDescriptorAllocator();
+
+		VulkanDescriptorAllocator(const VulkanDescriptorAllocator&) = delete;
+		VulkanDescriptorAllocator& operator=(const VulkanDescriptorAllocator&) = delete;
+
+		// Allocates from the current pool, chaining a new pool when the current one is exhausted
+		bool Allocate(VkDescriptorSetLayout layout, VkDescriptorSet* descriptorSet);
+
+		// Returns a set with the given bindings written, reusing a previous set with identical contents
+		VkDescriptorSet GetOrCreate(VkDescriptorSetLayout layout, const std::vector<DescriptorBinding>& bindings);
+
+		// Resets every pool in the chain and keeps them for reuse; all sets from this allocator become invalid
+		void ResetPools();
+
+		size_t GetPoolCount() const;
+		size_t GetCachedSetCount() const;
+
+	private:
+		struct CacheKey
+		{
+			VkDescriptorSetLayout layout;
+			std::vector<DescriptorBinding> bindings;
+
+			bool operator==(const CacheKey& other) const;
+		};
+
+		struct CacheKeyHash
+		{
+			size_t operator()(const CacheKey& key) const;
+		};
+
+		VulkanDevice* device;
+
+		VkDescriptorPool currentPool = VK_NULL_HANDLE;
+		std::vector<VkDescriptorPool> usedPools;
+		std::vector<VkDescriptorPool> freePools;
+
+		uint32_t setsPerPool;
+
+		std::unordered_map<CacheKey, VkDescriptorSet, CacheKeyHash> setCache;
+
+		VkDescriptorPool GrabPool();
+		VkDescriptorPool CreatePool(uint32_t setCount);
+	};
+}
\ No newline at end of file
@@ -2,6 +2,10 @@
 
 #include <vector>
 #include <optional>
+#include <mutex>
+#include <memory>
+#include <atomic>
+#include <functional>
 
 #include <GLFW/glfw3.h>
 
@@ -11,20 +15,49 @@
 
 namespace VulkanRenderer
 {
+	class VulkanStagingRing;
+
 	class VulkanDevice
 	{
 	public:
+		// A null surface selects any device with a graphics queue, including CPU implementations
 		VulkanDevice(VkInstance instance, VkSurfaceKHR surface);
 		~VulkanDevice();
 
 		uint32_t FindMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags propertyFlags);
 
+		// Host visible and coherent, plus device local while direct uploads are on. For buffers the CPU rewrites
+		// every frame, the GPU then reads them from its own memory instead of over the bus.
+		VkMemoryPropertyFlags GetDynamicMemoryProperties() const;
+
+		// Safe to call from any thread, the commands come from their own pool and the submit holds the queue mutex.
+		// The submit does not wait, it signals the returned value on the upload timeline and every frame submitted
+		// after it waits for that value, so uploaded resources may be used from the next frame on.
 		VkCommandBuffer BeginSingleTimeCommands() const;
-		void EndSingleTimeCommands(VkCommandBuffer commandBuffer) const;
+		uint64_t EndSingleTimeCommands(VkCommandBuffer commandBuffer) const;
+
+		// Runs release once the upload timeline reaches the value, e.g. to free the staging memory an upload read
+		void RetireUpload(uint64_t value, std::function<void()> release);
+
+		// Runs the releases whose uploads have completed, never blocks
+		void ReleaseCompletedUploads();
+
+		// Blocks until every upload submitted so far has completed, for callers that destroy what they uploaded
+		void WaitForUploads() const;
+
+		// Value signalled by the most recent single-time submit, 0 before the first one
+		uint64_t GetSubmittedUploadValue() const;
+		VkSemaphore GetUploadTimeline() const;
+
+		// Reallocates one command buffer per frame in flight, the device must be idle
+		void RecreateCommandBuffers();
 
 		VkDevice GetLogical() const;
 		VkPhysicalDevice GetPhysical() const;
 
+		// Shared by every upload, see VulkanStagingRing
+		VulkanStagingRing* GetStagingRing() const;
+
 		std::vector<VkCommandBuffer> commandBuffers;
 
 		VkQueue graphicsQueue;
@@ -32,6 +65,34 @@ namespace VulkanRenderer
 
 		uint32_t graphicsQueueFamily;
 
+		// Queues are externally synchronized, every submit and present locks this (graphics and present may be one queue)
+		mutable std::mutex queueMutex;
+
+		bool samplerAnisotropyEnabled = false;
+
+		// Vulkan 1.3 features, render passes and legacy barriers are used when they are missing
+		bool dynamicRenderingEnabled = false;
+		bool synchronization2Enabled = false;
+
+		// VK_KHR_present_id + VK_KHR_present_wait, used to measure when frames reach the display
+		bool presentWaitEnabled = false;
+
+		// VK_EXT_mesh_shader task and mesh stages, cluster culling falls back to a compute pass without them
+		bool meshShaderEnabled = false;
+
+		// Device memory is system memory, integrated GPUs and CPU implementations or any device whose device local
+		// memory types are all host visible
+		bool unifiedMemory = false;
+
+		// Largest heap with device local, host visible and coherent memory, 0 without one. Discrete GPUs expose a
+		// 256 MiB window into VRAM, with resizable BAR the window covers the whole heap.
+		VkDeviceSize hostVisibleDeviceLocalHeapSize = 0;
+		bool resizableBarEnabled = false;
+
+		// Static buffers are written straight into device memory instead of going through the staging ring. On by
+		// default with unified memory or resizable BAR, must be set before anything is uploaded.
+		bool directUploads = false;
+
 	private:
 		VkDevice logicaldevice;
 		VkPhysicalDevice physicalDevice;
@@ -41,10 +102,46 @@ namespace VulkanRenderer
 
 		VkCommandPool commandPool;
 
+		// Single-time commands are recorded on whichever thread uploads, frame command buffers on the render thread
+		VkCommandPool singleTimeCommandPool;
+		mutable std::mutex singleTimeCommandPoolMutex;
+
+		struct PendingUpload
+		{
+			uint64_t value;
+			VkCommandBuffer commandBuffer;
+		};
+
+		struct RetiredUpload
+		{
+			uint64_t value;
+			std::function<void()> release;
+		};
+
+		VkSemaphore uploadTimeline = VK_NULL_HANDLE;
+
+		// Incremented under the queue mutex, read by the render thread before each frame submit
+		mutable std::atomic<uint64_t> uploadValue = 0;
+
+		// Command buffers are freed once their submit completes, guarded by the pool mutex
+		mutable std::vector<PendingUpload> pendingUploads;
+
+		std::mutex retiredUploadsMutex;
+		std::vector<RetiredUpload> retiredUploads;
+
+		std::unique_ptr<VulkanStagingRing> stagingRing;
+
 		void SelectPhysicalDevice();
 		void CreateLogicalDevice();
+		void DetectUploadMemory();
 
 		void CreateCommandPool();
 		void CreateCommandBuffers();
+		void CreateUploadTimeline();
+
+		uint64_t GetCompletedUploadValue() const;
+
+		// Under the pool mutex
+		void FreeCompletedCommandBuffers() const;
 	};
 }
\ No newline at end of file
@@ -19,6 +19,13 @@ namespace VulkanRenderer
 		bool IsComplete() const;
 	};
 
+	// Pipeline stages and access types that use an image in a given layout
+	struct ImageLayoutAccess
+	{
+		VkPipelineStageFlags2 stageMask;
+		VkAccessFlags2 accessMask;
+	};
+
 	struct SwapChainSupportDetails
 	{
 		VkSurfaceCapabilitiesKHR capabilities;
@@ -26,7 +33,11 @@ namespace VulkanRenderer
 		std::vector<VkPresentModeKHR> presentModes;
 	};
 	
+	// A null surface rates devices for headless rendering, where presentation support is not required
 	int RateDeviceSuitability(VkPhysicalDevice device, VkSurfaceKHR surface);
+
+	std::vector<const char*> GetRequiredDeviceExtensions(VkSurfaceKHR surface);
+	bool IsDeviceExtensionSupported(VkPhysicalDevice device, const char* extensionName);
 	
 	QueueFamilyIndices FindQueueFamilies(VkPhysicalDevice device, VkSurfaceKHR surface);
 	SwapChainSupportDetails QuerySwapChainSupport(VkPhysicalDevice device, VkSurfaceKHR surface);
@@ -38,7 +49,16 @@ namespace VulkanRenderer
 	VkFormat FindDepthFormat(VkPhysicalDevice device);
 
 	bool HasStencilComponent(VkFormat format);
+	VkImageAspectFlags GetImageAspectFlags(VkFormat format);
+
+	ImageLayoutAccess GetLayoutAccess(VkImageLayout layout);
+
+	// Records the barriers with vkCmdPipelineBarrier2, or merges them into one legacy vkCmdPipelineBarrier when
+	// synchronization2 is not enabled on the device
+	void RecordPipelineBarrier(VulkanDevice* device, VkCommandBuffer commandBuffer, const std::vector<VkImageMemoryBarrier2>& imageBarriers, const std::vector<VkBufferMemoryBarrier2>& bufferBarriers = {});
 
-	void CopyBuffer(VulkanDevice* device, VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size);
-	void CopyBufferToImage(VulkanDevice* device, VkBuffer buffer, VkImage image, uint32_t width, uint32_t height);
+	// Submit without waiting and return the upload timeline value that signals completion
+	uint64_t CopyBuffer(VulkanDevice* device, VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size, VkDeviceSize srcOffset = 0);
+	uint64_t CopyBufferToImage(VulkanDevice* device, VkBuffer buffer, VkImage image, uint32_t width, uint32_t height);
+	void RecordCopyBufferToImage(VkCommandBuffer commandBuffer, VkBuffer buffer, VkImage image, uint32_t width, uint32_t height, VkDeviceSize bufferOffset = 0, uint32_t mipLevel = 0);
 }
\ No newline at end of file
@@ -4,7 +4,7 @@
 #include <memory>
 
 #include <volk.h>
-#include <glfw/glfw3.h>
+#include <GLFW/glfw3.h>
 
 #include <imgui.h>
 #include <imgui_impl_glfw.h>
@@ -17,6 +17,29 @@ namespace VulkanRenderer
 	class VulkanSwapChain;
 	class VulkanRenderPass;
 	class ImGuiDescriptorPool;
+
+	// A copy of a frame's ImGui draw data that stays valid after the next ImGui::NewFrame, so the UI can be built
+	// on the main thread while the render thread records the previous frame. Capture and destruction must happen
+	// on the thread that owns the ImGui context.
+	class ImGuiDrawSnapshot
+	{
+	public:
+		ImGuiDrawSnapshot() = default;
+		~ImGuiDrawSnapshot();
+
+		ImGuiDrawSnapshot(const ImGuiDrawSnapshot&) = delete;
+		ImGuiDrawSnapshot& operator=(const ImGuiDrawSnapshot&) = delete;
+
+		void Capture(const ImDrawData* source);
+		void Clear();
+
+		// Null when nothing was captured
+		ImDrawData* Get();
+
+	private:
+		ImDrawData drawData;
+		bool valid = false;
+	};
 	
 	class VulkanImGuiOverlay
 	{
@@ -25,7 +48,11 @@ namespace VulkanRenderer
 		~VulkanImGuiOverlay();
 
 		void NewFrame();
-		void Draw(VkCommandBuffer commandBuffer);
+
+		// Ends the UI frame on the main thread and copies its draw data for the render thread
+		void Render(ImGuiDrawSnapshot& snapshot);
+
+		void Draw(VkCommandBuffer commandBuffer, ImDrawData* drawData);
 
 	private:
 		GLFWwindow* glfwWindow;
@@ -9,21 +9,27 @@ namespace VulkanRenderer
 	class VulkanImage
 	{
 	public:
-		VulkanImage(VulkanDevice* device, uint32_t width, uint32_t height, VkFormat format, VkImageUsageFlags usageFlags, VkMemoryPropertyFlags propertyFlags, VkImageAspectFlags aspectFlags);
+		VulkanImage(VulkanDevice* device, uint32_t width, uint32_t height, VkFormat format, VkImageUsageFlags usageFlags, VkMemoryPropertyFlags propertyFlags, VkImageAspectFlags aspectFlags, uint32_t mipLevels = 1);
 		VulkanImage(VulkanDevice* device, VkImage existingImage, VkFormat format, VkImageAspectFlags aspectFlags);
 		~VulkanImage();
 
 		VkImage Get() const;
 		VkImageView GetImageView() const;
+		uint32_t GetMipLevels() const;
 
 		void CreateImageView(VkImageAspectFlags aspectFlags);
 
+		// Transitions every mip level in its own single-time command buffer
 		void TransitionImageLayout(VkImageLayout newLayout);
 
+		// Records a transition into an existing command buffer so several uploads can share one submit
+		void RecordLayoutTransition(VkCommandBuffer commandBuffer, VkImageLayout newLayout);
+
 	private:
 		VkImage image;
 		VkImageLayout currentLayout = VK_IMAGE_LAYOUT_UNDEFINED;
 		VkFormat format;
+		uint32_t mipLevels = 1;
 
 		VkImageView imageView;
 		VkDeviceMemory memory;
@@ -10,6 +10,7 @@ namespace VulkanRenderer
 	class VulkanInstance
 	{
 	public:
+		// Pass a null window to create a headless instance without surface extensions
 		VulkanInstance(GLFWwindow* window);
 		~VulkanInstance();
 
@@ -23,10 +24,10 @@ namespace VulkanRenderer
 
 		VkDebugUtilsMessengerEXT debugMessenger = VK_NULL_HANDLE;
 
-		void CreateInstance();
+		void CreateInstance(bool presentation);
 		void CreateSurface(GLFWwindow* window);
 
-		std::vector<const char*> GetRequiredExtensions();
+		std::vector<const char*> GetRequiredExtensions(bool presentation);
 
 		void PopulateDebugMessengerCreateInfo(VkDebugUtilsMessengerCreateInfoEXT& createInfo);
 
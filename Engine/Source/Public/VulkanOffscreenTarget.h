@@ -0,0 +1,47 @@
+#pragma once
+
+#include <vector>
+#include <string>
+
+#include <volk.h>
+
+namespace VulkanRenderer
+{
+	class VulkanDevice;
+	class VulkanImage;
+	class VulkanBuffer;
+
+	// Color image rendered without a swap chain, with a host-visible buffer for readback
+	class VulkanOffscreenTarget
+	{
+	public:
+		VulkanOffscreenTarget(VulkanDevice* device, VkExtent2D extent);
+		~VulkanOffscreenTarget();
+
+		// Copies the color attachment into the readback buffer, the image must be in TRANSFER_SRC_OPTIMAL
+		void RecordReadback(VkCommandBuffer commandBuffer);
+
+		// Returns the last read back frame as tightly packed RGBA8, the frame must have completed on the GPU
+		const std::vector<uint8_t>& ReadPixels();
+
+		bool WritePng(const std::string& path);
+
+		VkImage GetColorImage() const;
+		VkImageView GetColorImageView() const;
+		VkFormat GetColorFormat() const;
+
+		VkExtent2D extent;
+
+	private:
+		VulkanImage* colorImage;
+
+		VulkanBuffer* readbackBuffer;
+		void* mappedData = nullptr;
+
+		std::vector<uint8_t> pixels;
+
+		VkFormat colorFormat = VK_FORMAT_R8G8B8A8_UNORM;
+
+		VulkanDevice* device;
+	};
+}
\ No newline at end of file
@@ -2,46 +2,120 @@
 
 #include <vector>
 #include <memory>
+#include <array>
 
 #include <volk.h>
 
+#include <Mesh.h>
+
+struct ImDrawData;
+
 namespace VulkanRenderer
 {
 	class VulkanDevice;
-	class VulkanSwapChain;
 	class VulkanRenderPass;
-	class Mesh;
 	class Camera;
+	class DrawList;
+	struct DrawItem;
 	class VulkanImGuiOverlay;
+	class VulkanSync;
+	class Profiler;
+	class FramePacer;
+	class TextureStreamer;
 
 	class VulkanPipeline
 	{
 	public:
-		VulkanPipeline(VulkanDevice* device, VulkanSwapChain* swapChain, VulkanRenderPass* renderPass);
+		VulkanPipeline(VulkanDevice* device, VulkanRenderPass* renderPass);
 		~VulkanPipeline();
 
 		void SetImGuiOverlay(VulkanImGuiOverlay* overlay);
+		void SetSync(VulkanSync* frameSync);
+		void SetProfiler(Profiler* frameProfiler);
+		void SetFramePacer(FramePacer* pacer);
+		void SetTextureStreamer(TextureStreamer* streamer);
+
+		// Main thread: builds the scene UI, the overlay's Render ends the frame and captures the draw data
+		void BuildUI(Camera* camera, const std::vector<std::unique_ptr<Mesh>>& meshes);
 
-		void RecordCommandBuffer(VkCommandBuffer commandBuffer, uint32_t imageIndex, uint32_t currentFrame, const std::vector<std::unique_ptr<Mesh>>& meshes, Camera* camera);
+		// Render thread: records the scene and UI draws into a render pass the render graph has already begun.
+		// Clustered draws go first, then opaque draws in key order, then transparent ones back to front. Only the
+		// meshes' buffers and descriptor sets are used, their transforms belong to the main thread.
+		void RecordCommandBuffer(VkCommandBuffer commandBuffer, VkExtent2D extent, uint32_t currentFrame, const std::vector<Mesh*>& meshes, const DrawList& drawList, Camera* camera, VkDescriptorSet occlusionDescriptorSet, ImDrawData* uiDrawData);
+
+		// Render thread, outside a render pass: culls the meshlets of every clustered draw and writes the survivors'
+		// triangles into the mesh's indirect draw. Only used without mesh shaders, the task shader culls otherwise.
+		void RecordClusterCulling(VkCommandBuffer commandBuffer, uint32_t currentFrame, const std::vector<Mesh*>& meshes, const DrawList& drawList, Camera* camera, VkDescriptorSet occlusionDescriptorSet);
 
 		VkDescriptorSetLayout GetCameraDescriptorSetLayout() const;
 		VkDescriptorSetLayout GetMeshDescriptorSetLayout() const;
+		VkDescriptorSetLayout GetClusterDescriptorSetLayout() const;
+		VkDescriptorSetLayout GetOcclusionDescriptorSetLayout() const;
+
+		// Main thread: lay down opaque depth from the position stream first, so opaque shading runs once per pixel.
+		// Toggled from the UI and passed to the render thread through the frame's draw list.
+		bool depthPrepass = false;
+
+		// Main thread: cull meshes with meshlets per cluster against the frustum, their normal cones and the previous
+		// frame's depth. Passed to the render thread through the frame's draw list like the depth prepass.
+		bool clusterCulling = true;
+
+		// Main thread: screen space error in pixels a mesh's level of detail may have, 0 draws full resolution only
+		float lodErrorThreshold = 1.0f;
+
+		// Main thread: HLOD groups whose nearest point is farther than this draw their proxy instead of their
+		// members, 0 always draws the members
+		float hlodDistance = 50.0f;
 
 	private:
 		void CreateCameraDescriptorSetLayout();
 		void CreateMeshDescriptorSetLayout();
-		void CreateGraphicsPipeline();
+		void CreateClusterDescriptorSetLayouts();
+		void CreateGraphicsPipelines();
+		void CreateClusterCullPipeline();
+
+		// Binds the pipeline when it differs from the bound one, then draws the mesh
+		void RecordDraw(VkCommandBuffer commandBuffer, uint32_t currentFrame, Mesh* mesh, const DrawItem& draw, const DrawList& drawList, VkPipeline meshPipeline, VkPipeline& boundPipeline);
+		void RecordDepthDraw(VkCommandBuffer commandBuffer, uint32_t currentFrame, Mesh* mesh, const DrawItem& draw, const DrawList& drawList);
+
+		// Task and mesh shaders with mesh shader support, the culled indirect draw otherwise
+		void RecordClusteredDraw(VkCommandBuffer commandBuffer, uint32_t currentFrame, Mesh* mesh, VkPipeline& boundPipeline);
 
-		VkPipeline pipeline;
+		// Indexed by BlendMode
+		std::array<VkPipeline, BlendModeCount> pipelines{};
+
+		// Opaque shading after the depth prepass: depth compare EQUAL and no depth writes
+		VkPipeline prepassedOpaquePipeline = VK_NULL_HANDLE;
+
+		// Position stream only, no fragment shader and no color writes
+		VkPipeline depthPrepassPipeline = VK_NULL_HANDLE;
+
+		// Task and mesh shaders instead of the vertex stage, indexed by BlendMode. Opaque and alpha-tested only, and
+		// only created when the device supports mesh shaders.
+		std::array<VkPipeline, BlendModeCount> meshletPipelines{};
+
+		// Compute, one workgroup per meshlet
+		VkPipeline clusterCullPipeline = VK_NULL_HANDLE;
+
+		// Shared by every graphics and compute pipeline, sets: camera, mesh, mesh clusters, depth pyramid
 		VkPipelineLayout pipelineLayout;
 
 		VkDescriptorSetLayout cameraDescriptorSetLayout;
 		VkDescriptorSetLayout meshDescriptorSetLayout;
+		VkDescriptorSetLayout clusterDescriptorSetLayout;
+		VkDescriptorSetLayout occlusionDescriptorSetLayout;
 
-		VulkanSwapChain* swapChain;
 		VulkanRenderPass* renderPass;
 
-		VulkanImGuiOverlay* imGuiOverlay;
+		VulkanImGuiOverlay* imGuiOverlay = nullptr;
+
+		VulkanSync* sync = nullptr;
+
+		Profiler* profiler = nullptr;
+
+		FramePacer* framePacer = nullptr;
+
+		TextureStreamer* textureStreamer = nullptr;
 
 		VulkanDevice* device;
 	};
@@ -6,19 +6,32 @@ namespace VulkanRenderer
 {
 	class VulkanDevice;
 
+	// Color + depth layout that the scene pipeline and ImGui are built against. Frames are recorded with
+	// compatible render passes created by the render graph, which owns load/store ops and layout transitions.
+	// With dynamic rendering no render pass object exists and pipelines are built from the formats instead.
 	class VulkanRenderPass
 	{
 	public:
-		VulkanRenderPass(VulkanDevice* device, VkFormat swapChainImageFormat);
+		VulkanRenderPass(VulkanDevice* device, VkFormat colorFormat);
 		~VulkanRenderPass();
 
+		// VK_NULL_HANDLE when the device renders dynamically
 		VkRenderPass Get() const;
 
+		VkFormat GetColorFormat() const;
+		VkFormat GetDepthFormat() const;
+
+		// Chained into pipeline creation when Get() is null, points into this object
+		VkPipelineRenderingCreateInfo GetPipelineRenderingInfo() const;
+
 	private:
-		VkRenderPass renderPass;
+		VkRenderPass renderPass = VK_NULL_HANDLE;
+
+		VkFormat colorFormat;
+		VkFormat depthFormat;
 
 		VulkanDevice* device;
 
-		void CreateRenderPass(VkFormat swapChainImageFormat);
+		void CreateRenderPass();
 	};
 }
\ No newline at end of file
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <deque>
+#include <mutex>
+#include <cstdint>
+
+#include <volk.h>
+
+namespace VulkanRenderer
+{
+	class VulkanDevice;
+	class VulkanBuffer;
+
+	// Host memory for one upload, data stays mapped until the allocation is released
+	struct StagingAllocation
+	{
+		VkBuffer buffer = VK_NULL_HANDLE;
+		VkDeviceSize offset = 0;
+		VkDeviceSize size = 0;
+		uint8_t* data = nullptr;
+
+	private:
+		friend class VulkanStagingRing;
+
+		uint64_t id = 0;
+
+		// Uploads larger than the free space get their own buffer
+		VulkanBuffer* dedicatedBuffer = nullptr;
+	};
+
+	// One persistently mapped, host coherent staging buffer that uploads take slots from in order, so an upload
+	// costs neither a buffer allocation nor a map. Slots are released once the copies reading them have completed,
+	// in any order, and the space before the oldest live slot is reused. Safe to use from any thread.
+	class VulkanStagingRing
+	{
+	public:
+		VulkanStagingRing(VulkanDevice* device, VkDeviceSize size);
+		~VulkanStagingRing();
+
+		VulkanStagingRing(const VulkanStagingRing&) = delete;
+		VulkanStagingRing& operator=(const VulkanStagingRing&) = delete;
+
+		// Never fails for want of space, a dedicated buffer is created when the ring is full
+		StagingAllocation Allocate(VkDeviceSize size);
+		void Release(const StagingAllocation& allocation);
+
+	private:
+		struct Slot
+		{
+			uint64_t id;
+			VkDeviceSize begin;
+			bool released;
+		};
+
+		// Offsets are kept aligned well past any texel size and copy offset alignment
+		static constexpr VkDeviceSize Alignment = 256;
+
+		VulkanDevice* device;
+		VulkanBuffer* buffer;
+		VkDeviceSize capacity;
+		uint8_t* mapped = nullptr;
+
+		std::mutex mutex;
+
+		// Live slots in allocation order, the oldest one's begin is where free space ends
+		std::deque<Slot> slots;
+		VkDeviceSize head = 0;
+		uint64_t nextId = 1;
+	};
+}
\ No newline at end of file
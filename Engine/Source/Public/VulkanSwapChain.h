@@ -7,11 +7,12 @@
 namespace VulkanRenderer
 {
 	class VulkanImage;
+	class VulkanSync;
 
 	class VulkanSwapChain
 	{
 	public:
-		VulkanSwapChain(VulkanDevice* device, VkSurfaceKHR surface, GLFWwindow* window);
+		VulkanSwapChain(VulkanDevice* device, VkSurfaceKHR surface, GLFWwindow* window, VkPresentModeKHR preferredPresentMode = VK_PRESENT_MODE_MAILBOX_KHR);
 		~VulkanSwapChain();
 
 		VkSwapchainKHR Get() const;
@@ -19,22 +20,36 @@ namespace VulkanRenderer
 		uint32_t GetImageCount() const;
 		uint32_t GetMinImageCount() const;
 
+		VkImage GetImage(uint32_t index) const;
+		VkImageView GetImageView(uint32_t index) const;
+
 		void CreateSwapChain();
-		void CreateDepthResources();
-		void CreateFramebuffers(VkRenderPass renderPass);
+
+		// Creates the new swap chain from the current one and retires the old chain and its views until the
+		// frames that may still present from it have completed. Returns false when the surface has no area.
+		bool RecreateSwapChain(VulkanSync* sync);
 
 		void CleanupSwapChain();
 
-		std::vector<VkFramebuffer> framebuffers;
 		VkExtent2D extent;
 
+		// Window size in pixels, used when the surface leaves the extent to the swap chain. GLFW may only be queried
+		// on the main thread, so the render thread updates this from each frame packet.
+		VkExtent2D framebufferExtent{};
+
 		VkFormat imageFormat;
 
 		VkSurfaceFormatKHR surfaceFormat;
 		VkPresentModeKHR presentMode;
 
+		// Used when the surface supports it, FIFO otherwise. Takes effect the next time the swap chain is created.
+		VkPresentModeKHR preferredPresentMode;
+
+		// Present modes the surface reported at the last creation
+		std::vector<VkPresentModeKHR> supportedPresentModes;
+
 	private:
-		VkSurfaceFormatKHR VulkanSwapChain::ChooseSwapSurfaceFormat(const std::vector<VkSurfaceFormatKHR>& availableFormats);
+		VkSurfaceFormatKHR ChooseSwapSurfaceFormat(const std::vector<VkSurfaceFormatKHR>& availableFormats);
 		VkPresentModeKHR ChooseSwapPresentMode(const std::vector<VkPresentModeKHR>& availablePresentModes);
 		VkExtent2D ChooseSwapExtent(const VkSurfaceCapabilitiesKHR& capabilities);
 
@@ -44,8 +59,6 @@ namespace VulkanRenderer
 
 		VkSurfaceKHR surface;
 
-		VulkanImage* depthImage;
-
 		VulkanDevice* device;
 
 		GLFWwindow* window;
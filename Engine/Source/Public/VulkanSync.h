@@ -1,25 +1,110 @@
 #pragma once
 
 #include <vector>
+#include <chrono>
+#include <functional>
+#include <mutex>
 
 #include <volk.h>
 
 namespace VulkanRenderer
 {
+	// Smoothed CPU-side frame pacing measurements in milliseconds
+	struct FrameTimings
+	{
+		double frameWaitMs = 0.0;		// Blocked waiting for the GPU to release the frame slot
+		double acquireMs = 0.0;			// Blocked in vkAcquireNextImageKHR
+		double submitMs = 0.0;			// Spent in vkQueueSubmit
+		double presentMs = 0.0;			// Spent in vkQueuePresentKHR
+		double frameIntervalMs = 0.0;	// Present to present
+
+		// Exponential moving average so the readout stays stable from frame to frame
+		static void Smooth(double& value, double sampleMs);
+	};
+
 	class VulkanSync
 	{
 	public:
-		VulkanSync(VkDevice logicalDevice);
+		VulkanSync(VkDevice logicalDevice, uint32_t swapChainImageCount);
 		~VulkanSync();
 
-		void CreateSyncObjects();
+		void CreateSyncObjects(uint32_t swapChainImageCount);
 		void CleanupSyncObjects();
 
+		// Recreates the binary semaphores used by the swap chain, timeline values are preserved. Present semaphores
+		// may still be waited on by the presentation engine, so the old ones are retired rather than destroyed.
+		void RecreateSwapChainSemaphores(uint32_t swapChainImageCount);
+
+		// Blocks until the GPU has finished the last submission that used this frame slot
+		void WaitForFrameSlot(uint32_t frameIndex);
+
+		// Makes the next frame submission wait until another timeline reaches the value, waits on the same
+		// semaphore are merged into one
+		void AddTimelineWait(VkSemaphore timeline, uint64_t value, VkPipelineStageFlags stageMask);
+
+		// Submits the frame's command buffer and signals the next frame timeline value, the binary acquire/present
+		// semaphores may be null when rendering offscreen. Timeline waits added since the last submit are included.
+		VkResult SubmitFrame(VkQueue queue, VkCommandBuffer commandBuffer, uint32_t frameIndex, VkSemaphore waitSemaphore, VkSemaphore signalSemaphore);
+
+		// Blocks until every submission on the frame timeline has completed
+		void WaitForAllFrames();
+
+		// Value signalled by the most recent frame submission, 0 before the first frame
+		uint64_t GetSubmittedFrameValue() const;
+
+		// Defers destroying a resource that in-flight frames may still use until the frame timeline reaches the
+		// value, so replacing it never has to wait for the device to go idle
+		void Retire(uint64_t value, std::function<void()> destroy);
+
+		// Destroys every retired resource whose frames have completed, never blocks
+		void ReleaseRetired();
+
+		void MarkPresented();
+
+		// timings is written by the render thread, the UI reads the copy published at the end of each frame
+		void PublishTimings();
+		FrameTimings GetPublishedTimings() const;
+
 		std::vector<VkSemaphore> imageAvailableSemaphores;
 		std::vector<VkSemaphore> renderFinishedSemaphores;
-		std::vector<VkFence> inFlightFences;
+
+		VkSemaphore frameTimeline = VK_NULL_HANDLE;
+
+		FrameTimings timings;
+
+		// Written by the UI, applied by the engine between frames while the render thread is idle
+		int requestedFramesInFlight;
 
 	private:
+		struct RetiredResource
+		{
+			uint64_t frameValue;
+			std::function<void()> destroy;
+		};
+
+		struct TimelineWait
+		{
+			VkSemaphore semaphore;
+			uint64_t value;
+			VkPipelineStageFlags stageMask;
+		};
+
 		VkDevice logicalDevice;
+
+		uint64_t frameValue = 0;
+
+		std::vector<TimelineWait> pendingWaits;
+
+		// Timeline value signalled by the last submission of each frame slot
+		std::vector<uint64_t> frameSlotValues;
+
+		std::vector<RetiredResource> retiredResources;
+
+		std::chrono::steady_clock::time_point lastPresentTime;
+
+		FrameTimings publishedTimings;
+		mutable std::mutex publishedTimingsMutex;
+
+		VkSemaphore CreateTimelineSemaphore();
 	};
 }
\ No newline at end of file
@@ -8,23 +8,48 @@ namespace VulkanRenderer
 {
 	class VulkanDevice;
 	class VulkanImage;
+	class TextureStreamer;
 
 	class VulkanTexture
 	{
 	public:
-		VulkanTexture(VulkanDevice* device, const std::string& path);
+		// Uploads the full mip chain, or with a streamer only the mip tail, finer levels are streamed in and out later
+		VulkanTexture(VulkanDevice* device, const std::string& path, TextureStreamer* streamer = nullptr);
 		~VulkanTexture();
 
 		VkImageView GetImageView() const;
 		VkSampler GetSampler() const;
 
+		// Render thread: bumped whenever the streamer replaces the image, sets written with an older view are stale
+		uint64_t GetVersion() const;
+
 	private:
-		VulkanImage* image;
+		friend class TextureStreamer;
+
+		VulkanImage* image = nullptr;
 		VkSampler sampler;
 
 		VulkanDevice* device;
+		TextureStreamer* streamer;
+
+		std::string path;
+
+		// Of the full chain, the image holds levels residentMip and coarser with residentMip as its level 0
+		uint32_t width = 0;
+		uint32_t height = 0;
+		uint32_t mipLevels = 0;
+		uint32_t residentMip = 0;
 
-		void CreateTextureImage(const std::string& path);
+		uint64_t version = 0;
+
+		void CreateTextureImage();
 		void CreateTextureSampler();
+
+		// An image for levels firstMip and coarser
+		VulkanImage* CreateMipImage(uint32_t firstMip) const;
+
+		// Copies levels firstMip and coarser, packed as BuildMipChain writes them, into an image from CreateMipImage
+		// and leaves it ready to sample
+		void RecordMipUploads(VkCommandBuffer commandBuffer, VulkanImage* target, VkBuffer buffer, VkDeviceSize offset, uint32_t firstMip) const;
 	};
 }
\ No newline at end of file
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <volk.h>
+
+namespace VulkanRenderer
+{
+	class VulkanDevice;
+	class VulkanBuffer;
+
+	enum class UploadPath
+	{
+		Automatic,		// Direct when the device has direct uploads enabled, staged otherwise
+		Staged,			// Copied from the staging ring into device local memory on the GPU
+		Direct			// Written by the CPU into device local, host visible memory, no copy
+	};
+
+	// A device local buffer with the given contents, data may be null to leave them undefined. Waits for the upload
+	// to complete, the buffer is ready to use on return. Transfer writes stay allowed on either path.
+	VulkanBuffer* CreateDeviceLocalBuffer(VulkanDevice* device, const void* data, VkDeviceSize size, VkBufferUsageFlags usageFlags, UploadPath path = UploadPath::Automatic);
+
+	// Times both upload paths over a range of buffer sizes and prints the results, the direct path is skipped on
+	// devices without device local, host visible memory
+	void RunUploadBenchmark(VulkanDevice* device);
+}
\ No newline at end of file
@@ -0,0 +1,86 @@
+#include <Pak.h>
+
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <filesystem>
+
+using namespace VulkanRenderer;
+
+namespace
+{
+	// Files keep the path they were given by, so packing "Assets" from the directory the engine runs in stores
+	// "Assets/Shaders/Vert.spv" under the name the engine asks for
+	bool AddSources(const std::filesystem::path& path, std::vector<PakSource>& sources)
+	{
+		std::error_code error;
+		if (std::filesystem::is_regular_file(path, error))
+		{
+			sources.push_back({path.generic_string(), path.string()});
+			return true;
+		}
+
+		if (!std::filesystem::is_directory(path, error))
+		{
+			std::cerr << "Failed to find " << path.generic_string() << std::endl;
+			return false;
+		}
+
+		std::vector<std::filesystem::path> files;
+		for (const std::filesystem::directory_entry& entry : std::filesystem::recursive_directory_iterator(path, error))
+		{
+			if (entry.is_regular_file())
+				files.push_back(entry.path());
+		}
+
+		// Directory order differs between file systems, sorting keeps builds reproducible
+		std::sort(files.begin(), files.end());
+		for (const std::filesystem::path& file : files)
+		{
+			sources.push_back({file.generic_string(), file.string()});
+		}
+		return true;
+	}
+}
+
+// Packs files and directories into one pak for FileSystem::MountPak
+int main(int argc, char** argv)
+{
+	std::string outputPath;
+	std::vector<std::filesystem::path> inputPaths;
+	PakBuildSettings settings;
+
+	for (int i = 1; i < argc; i++)
+	{
+		const char* arg = argv[i];
+
+		if (strcmp(arg, "--compress") == 0)
+			settings.compress = true;
+		else if (outputPath.empty())
+			outputPath = arg;
+		else
+			inputPaths.push_back(arg);
+	}
+
+	if (outputPath.empty() || inputPaths.empty())
+	{
+		std::cerr << "Usage: Packer <output.pak> <file or directory>... [--compress]" << std::endl;
+		return 1;
+	}
+
+	std::vector<PakSource> sources;
+	for (const std::filesystem::path& inputPath : inputPaths)
+	{
+		if (!AddSources(inputPath, sources))
+			return 1;
+	}
+
+	PakBuildStats stats;
+	if (!WritePak(outputPath, sources, settings, &stats))
+		return 1;
+
+	std::cout << "Packed " << sources.size() << " files into " << outputPath << ": " << stats.size << " bytes stored as " << stats.storedSize << ", " << stats.compressedEntryCount << " compressed" << std::endl;
+	return 0;
+}
\ No newline at end of file
@@ -0,0 +1,23 @@
+project "Packer"
+	kind "ConsoleApp"
+	language "C++"
+	cppdialect "C++17"
+
+	local outBinDir = "%{wks.location}/out/bin/" .. outputdir .. "/%{prj.name}"
+
+	targetdir (outBinDir)
+	objdir ("%{wks.location}/out/obj/" .. outputdir .. "/%{prj.name}")
+
+	defines { "VK_NO_PROTOTYPES" }
+
+	files {
+		"Source/**.h",
+		"Source/**.cpp"
+	}
+
+	includedirs {
+		"Source/Public",
+		"%{wks.location}/Engine/Source/Public"
+	}
+
+	links { "Engine" }
\ No newline at end of file
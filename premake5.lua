@@ -28,4 +28,6 @@ group ""
 group "VulkanRenderer"
 	include "Engine"
 	include "App"
+	include "Cooker"
+	include "Packer"
 group ""